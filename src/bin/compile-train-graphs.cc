@@ -55,6 +55,9 @@ int main(int argc, char *argv[]) {
     po.Register("batch-size", &batch_size,
                 "Number of FSTs to compile at a time (more -> faster but uses "
                 "more memory.  E.g. 500");
+    po.Register("num-threads", &gopts.num_threads, "Number of threads used "
+                "to compile each batch of FSTs (only applies if "
+                "--batch-size > 1)");
     po.Register("read-disambig-syms", &disambig_rxfilename, "File containing "
                 "list of disambiguation symbols in phone symbol table");
     
@@ -146,6 +149,9 @@ int main(int argc, char *argv[]) {
     }
     KALDI_LOG << "compile-train-graphs: succeeded for " << num_succeed
               << " graphs, failed for " << num_fail;
+    if (gopts.graph_cache_size > 0)
+      KALDI_LOG << "Graph cache: " << gc.NumGraphCacheHits() << " hits, "
+                << gc.NumGraphCacheMisses() << " misses.";
     return (num_succeed != 0 ? 0 : 1);
   } catch(const std::exception &e) {
     std::cerr << e.what();
@@ -21,6 +21,7 @@
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
 #include "nnet3/nnet-chain-training2.h"
+#include "nnet3/nnet-compute-profiler.h"
 #include "cudamatrix/cu-allocator.h"
 
 
@@ -46,6 +47,7 @@ int main(int argc, char *argv[]) {
     bool binary_write = true;
     std::string use_gpu = "yes";
     NnetChainTraining2Options opts;
+    NnetComputeProfilerOptions profiler_opts;
 
     ParseOptions po(usage);
     po.Register("srand", &srand_seed, "Seed for random number generator ");
@@ -54,6 +56,7 @@ int main(int argc, char *argv[]) {
                 "yes|no|optional|wait, only has effect if compiled with CUDA");
 
     opts.Register(&po);
+    profiler_opts.Register(&po);
     RegisterCuAllocatorOptions(&po);
 
     po.Read(argc, argv);
@@ -64,6 +67,10 @@ int main(int argc, char *argv[]) {
       po.PrintUsage();
       exit(1);
     }
+    profiler_opts.Check();
+    NnetComputeProfiler profiler;
+    if (profiler_opts.Enabled())
+      opts.nnet_config.compute_config.profiler = &profiler;
 
 #if HAVE_CUDA==1
     CuDevice::Instantiate().SelectGpuId(use_gpu);
@@ -94,6 +101,8 @@ int main(int argc, char *argv[]) {
 #if HAVE_CUDA==1
     CuDevice::Instantiate().PrintProfile();
 #endif
+    if (profiler_opts.Enabled())
+      profiler.Write(profiler_opts);
     WriteKaldiObject(nnet, nnet_wxfilename, binary_write);
     KALDI_LOG << "Wrote raw model to " << nnet_wxfilename;
     return (ok ? 0 : 1);
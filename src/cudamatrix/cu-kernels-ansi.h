@@ -479,6 +479,19 @@ void cudaD_heaviside(dim3 Gr, dim3 Bl, double *y, const double *x, MatrixDim d,
                      int src_stride);
 void cudaF_heaviside(dim3 Gr, dim3 Bl, float *y, const float *x, MatrixDim d,
                      int src_stride);
+void cudaD_bias_relu_offset(dim3 Gr, dim3 Bl, double *y, const double *x,
+                            const double *bias, const double *offset,
+                            MatrixDim d, int src_stride);
+void cudaF_bias_relu_offset(dim3 Gr, dim3 Bl, float *y, const float *x,
+                            const float *bias, const float *offset,
+                            MatrixDim d, int src_stride);
+void cudaD_diff_bias_relu_offset(dim3 Gr, dim3 Bl, double *eout,
+                                 const double *e, const double *x,
+                                 const double *bias, MatrixDim d,
+                                 int e_stride, int x_stride);
+void cudaF_diff_bias_relu_offset(dim3 Gr, dim3 Bl, float *eout, const float *e,
+                                 const float *x, const float *bias,
+                                 MatrixDim d, int e_stride, int x_stride);
 void cudaD_exp(dim3 Gr, dim3 Bl, double *y, const double *x, MatrixDim d,
 	       int src_stride);
 void cudaF_exp(dim3 Gr, dim3 Bl, float *y, const float *x, MatrixDim d,
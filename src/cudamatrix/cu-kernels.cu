@@ -2724,6 +2724,35 @@ static void _heaviside(Real* y, const Real* x, MatrixDim d, int src_stride) {
   }
 }
 
+template<typename Real>
+__global__
+static void _bias_relu_offset(Real* y, const Real* x, const Real* bias,
+                              const Real* offset, MatrixDim d,
+                              int src_stride) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;
+  int j = blockIdx.y * blockDim.y + threadIdx.y;
+  int dst_index = i + j * d.stride, src_index = i + j * src_stride;
+  if (i < d.cols && j < d.rows) {
+    Real res = x[src_index] + bias[i];
+    y[dst_index] = (res > 0.0 ? res : 0.0) + offset[i];
+  }
+}
+
+template<typename Real>
+__global__
+static void _diff_bias_relu_offset(Real* eout, const Real* e, const Real* x,
+                                   const Real* bias, MatrixDim d,
+                                   int e_stride, int x_stride) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;
+  int j = blockIdx.y * blockDim.y + threadIdx.y;
+  int dst_index = i + j * d.stride, e_index = i + j * e_stride,
+      x_index = i + j * x_stride;
+  if (i < d.cols && j < d.rows) {
+    Real res = x[x_index] + bias[i];
+    eout[dst_index] = (res > 0.0 ? e[e_index] : 0.0);
+  }
+}
+
 template<typename Real>
 __global__
 static void _exp(Real* y, const Real* x, MatrixDim d, int src_stride) {
@@ -4603,6 +4632,19 @@ void cudaF_heaviside(dim3 Gr, dim3 Bl, float* y, const float* x, MatrixDim d,
   _heaviside<<<Gr,Bl>>>(y, x, d, src_stride);
 }
 
+void cudaF_diff_bias_relu_offset(dim3 Gr, dim3 Bl, float* eout,
+                                 const float* e, const float* x, const float* bias,
+                                 MatrixDim d, int e_stride, int x_stride) {
+  _diff_bias_relu_offset<<<Gr,Bl>>>(eout, e, x, bias, d, e_stride,
+                                    x_stride);
+}
+
+void cudaF_bias_relu_offset(dim3 Gr, dim3 Bl, float* y, const float* x,
+                            const float* bias, const float* offset, MatrixDim d,
+                            int src_stride) {
+  _bias_relu_offset<<<Gr,Bl>>>(y, x, bias, offset, d, src_stride);
+}
+
 void cudaF_exp(dim3 Gr, dim3 Bl, float* y, const float* x, MatrixDim d,
 	       int src_stride) {
   _exp<<<Gr,Bl>>>(y, x, d, src_stride);
@@ -5306,6 +5348,19 @@ void cudaD_heaviside(dim3 Gr, dim3 Bl, double* y, const double* x, MatrixDim d,
   _heaviside<<<Gr,Bl>>>(y, x, d, src_stride);
 }
 
+void cudaD_diff_bias_relu_offset(dim3 Gr, dim3 Bl, double* eout,
+                                 const double* e, const double* x, const double* bias,
+                                 MatrixDim d, int e_stride, int x_stride) {
+  _diff_bias_relu_offset<<<Gr,Bl>>>(eout, e, x, bias, d, e_stride,
+                                    x_stride);
+}
+
+void cudaD_bias_relu_offset(dim3 Gr, dim3 Bl, double* y, const double* x,
+                            const double* bias, const double* offset, MatrixDim d,
+                            int src_stride) {
+  _bias_relu_offset<<<Gr,Bl>>>(y, x, bias, offset, d, src_stride);
+}
+
 void cudaD_exp(dim3 Gr, dim3 Bl, double* y, const double* x, MatrixDim d,
 	       int src_stride) {
   _exp<<<Gr,Bl>>>(y, x, d, src_stride);
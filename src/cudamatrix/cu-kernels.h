@@ -885,6 +885,31 @@ inline void cuda_heaviside(dim3 Gr, dim3 Bl, float* y, const float* x,
                            MatrixDim d, int src_stride) {
   cudaF_heaviside(Gr, Bl, y, x, d, src_stride);
 }
+inline void cuda_bias_relu_offset(dim3 Gr, dim3 Bl, double* y,
+                                  const double* x, const double* bias,
+                                  const double* offset, MatrixDim d,
+                                  int src_stride) {
+  cudaD_bias_relu_offset(Gr, Bl, y, x, bias, offset, d, src_stride);
+}
+inline void cuda_bias_relu_offset(dim3 Gr, dim3 Bl, float* y, const float* x,
+                                  const float* bias, const float* offset,
+                                  MatrixDim d, int src_stride) {
+  cudaF_bias_relu_offset(Gr, Bl, y, x, bias, offset, d, src_stride);
+}
+inline void cuda_diff_bias_relu_offset(dim3 Gr, dim3 Bl, double* eout,
+                                       const double* e, const double* x,
+                                       const double* bias, MatrixDim d,
+                                       int e_stride, int x_stride) {
+  cudaD_diff_bias_relu_offset(Gr, Bl, eout, e, x, bias, d, e_stride,
+                              x_stride);
+}
+inline void cuda_diff_bias_relu_offset(dim3 Gr, dim3 Bl, float* eout,
+                                       const float* e, const float* x,
+                                       const float* bias, MatrixDim d,
+                                       int e_stride, int x_stride) {
+  cudaF_diff_bias_relu_offset(Gr, Bl, eout, e, x, bias, d, e_stride,
+                              x_stride);
+}
 inline void cuda_exp(dim3 Gr, dim3 Bl, double* y, const double* x,
 		     MatrixDim d, int src_stride) {
   cudaD_exp(Gr, Bl, y, x, d, src_stride);
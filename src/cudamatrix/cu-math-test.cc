@@ -476,6 +476,167 @@ static void UnitTestBackpropLstmNonlinearity() {
   }
 }
 
+// A simple scalar version of cu::CpuComputeLstmNonlinearity(), used to check
+// the (possibly vectorized) float version and to measure its speed.
+static void LstmNonlinearityReference(const MatrixBase<float> &input,
+                                      const MatrixBase<float> &params,
+                                      MatrixBase<float> *output) {
+  int32 cell_dim = params.NumCols();
+  bool have_dropout_mask = (input.NumCols() == 5 * cell_dim + 3);
+  for (int32 r = 0; r < input.NumRows(); r++) {
+    const float *in = input.RowData(r);
+    float i_scale = (have_dropout_mask ? in[5 * cell_dim] : 1.0),
+        f_scale = (have_dropout_mask ? in[5 * cell_dim + 1] : 1.0),
+        o_scale = (have_dropout_mask ? in[5 * cell_dim + 2] : 1.0);
+    for (int32 c = 0; c < cell_dim; c++) {
+      float c_prev = in[c + 4 * cell_dim],
+          i_t = 1.0 / (1.0 + Exp(-(in[c] + params(0, c) * c_prev))),
+          f_t = 1.0 / (1.0 + Exp(-(in[c + cell_dim] + params(1, c) * c_prev))),
+          c_t = f_t * f_scale * c_prev +
+              i_t * i_scale * std::tanh(in[c + 2 * cell_dim]),
+          o_t = 1.0 / (1.0 + Exp(-(in[c + 3 * cell_dim] + params(2, c) * c_t)));
+      (*output)(r, c) = c_t;
+      (*output)(r, c + cell_dim) = o_t * o_scale * std::tanh(c_t);
+    }
+  }
+}
+
+// Tests the CPU code for the LSTM and GRU nonlinearities in float, which is
+// vectorized if the CPU supports AVX2, by comparing it with the double
+// versions (which are always scalar); and compares the speed of the float
+// LSTM code with and without the vectorized kernels.
+static void UnitTestCpuLstmGruNonlinearity() {
+  for (int32 i = 0; i < 5; i++) {
+    int32 num_rows = RandInt(1, 50),
+        cell_dim = RandInt(1, 100),
+        dropout_dim = (RandInt(0, 1) == 0 ? 0 : 3);
+    Matrix<float> input(num_rows, 5 * cell_dim + dropout_dim),
+        params(3, cell_dim), output_deriv(num_rows, 2 * cell_dim);
+    input.SetRandn();
+    input.Scale(3.0);  // so that some of the nonlinearities saturate.
+    params.SetRandn();
+    output_deriv.SetRandn();
+    Matrix<double> input_dbl(input), params_dbl(params),
+        output_deriv_dbl(output_deriv);
+
+    Matrix<float> output(num_rows, 2 * cell_dim),
+        output_ref(num_rows, 2 * cell_dim);
+    Matrix<double> output_dbl(num_rows, 2 * cell_dim);
+    cu::CpuComputeLstmNonlinearity(input, params, &output);
+    cu::CpuComputeLstmNonlinearity(input_dbl, params_dbl, &output_dbl);
+    LstmNonlinearityReference(input, params, &output_ref);
+    AssertEqual(output, Matrix<float>(output_dbl), 1.0e-05);
+    AssertEqual(output, output_ref, 1.0e-05);
+
+    Matrix<double> deriv_sum_in(5, cell_dim);
+    deriv_sum_in.SetRandn();
+    deriv_sum_in.ApplyPow(2.0);
+    Vector<float> self_repair_config(10);
+    self_repair_config.Range(0, 5).Set(0.5);
+    self_repair_config.Range(5, 5).Set(0.1);
+    double count_in = RandInt(0, 2);
+    Matrix<float> input_deriv(num_rows, 5 * cell_dim + dropout_dim),
+        params_deriv(3, cell_dim), self_repair_sum(5, cell_dim);
+    Matrix<double> value_sum(5, cell_dim), deriv_sum(5, cell_dim);
+    Matrix<double> input_deriv_dbl(num_rows, 5 * cell_dim + dropout_dim),
+        params_deriv_dbl(3, cell_dim), self_repair_sum_dbl(5, cell_dim),
+        value_sum_dbl(5, cell_dim), deriv_sum_dbl(5, cell_dim);
+    cu::CpuBackpropLstmNonlinearity(input, params, output_deriv,
+                                    deriv_sum_in, self_repair_config,
+                                    count_in, &input_deriv, &params_deriv,
+                                    &value_sum, &deriv_sum, &self_repair_sum);
+    cu::CpuBackpropLstmNonlinearity(input_dbl, params_dbl, output_deriv_dbl,
+                                    deriv_sum_in,
+                                    Vector<double>(self_repair_config),
+                                    count_in, &input_deriv_dbl,
+                                    &params_deriv_dbl, &value_sum_dbl,
+                                    &deriv_sum_dbl, &self_repair_sum_dbl);
+    AssertEqual(input_deriv, Matrix<float>(input_deriv_dbl), 1.0e-04);
+    AssertEqual(params_deriv, Matrix<float>(params_deriv_dbl), 1.0e-04);
+    AssertEqual(value_sum, value_sum_dbl, 1.0e-05);
+    AssertEqual(deriv_sum, deriv_sum_dbl, 1.0e-05);
+    AssertEqual(self_repair_sum, Matrix<float>(self_repair_sum_dbl));
+
+    // Now the GRU.  h_t and h_t_deriv are input and output.
+    CuMatrix<float> z_t(num_rows, cell_dim), c_t1(num_rows, cell_dim),
+        h_t(num_rows, cell_dim), c_t(num_rows, cell_dim),
+        c_t_deriv(num_rows, cell_dim), h_t_deriv(num_rows, cell_dim),
+        z_t_deriv(num_rows, cell_dim), c_t1_deriv(num_rows, cell_dim);
+    z_t.SetRandUniform();
+    c_t1.SetRandn();
+    h_t.SetRandn();
+    h_t.Scale(3.0);
+    c_t_deriv.SetRandn();
+    h_t_deriv.SetRandn();
+    z_t_deriv.SetRandn();
+    c_t1_deriv.SetRandn();
+    CuMatrix<double> z_t_dbl(z_t), c_t1_dbl(c_t1), h_t_dbl(h_t),
+        c_t_dbl(num_rows, cell_dim), c_t_deriv_dbl(c_t_deriv),
+        h_t_deriv_dbl(h_t_deriv), z_t_deriv_dbl(z_t_deriv),
+        c_t1_deriv_dbl(c_t1_deriv);
+    cu::ComputeGruNonlinearity(z_t, c_t1, &h_t, &c_t);
+    cu::ComputeGruNonlinearity(z_t_dbl, c_t1_dbl, &h_t_dbl, &c_t_dbl);
+    AssertEqual(h_t, CuMatrix<float>(h_t_dbl), 1.0e-05);
+    AssertEqual(c_t, CuMatrix<float>(c_t_dbl), 1.0e-05);
+    cu::BackpropGruNonlinearity(z_t, c_t1, h_t, c_t_deriv, &h_t_deriv,
+                                &z_t_deriv, &c_t1_deriv);
+    cu::BackpropGruNonlinearity(z_t_dbl, c_t1_dbl, h_t_dbl, c_t_deriv_dbl,
+                                &h_t_deriv_dbl, &z_t_deriv_dbl,
+                                &c_t1_deriv_dbl);
+    AssertEqual(h_t_deriv, CuMatrix<float>(h_t_deriv_dbl), 1.0e-05);
+    AssertEqual(z_t_deriv, CuMatrix<float>(z_t_deriv_dbl), 1.0e-05);
+    AssertEqual(c_t1_deriv, CuMatrix<float>(c_t1_deriv_dbl), 1.0e-05);
+  }
+
+  // Compare the speed of the float code with and without the AVX2 kernels
+  // (if the CPU does not support AVX2, both use the scalar code).
+  for (int32 dim = 64; dim <= 1024; dim *= 4) {
+    BaseFloat time_in_secs = 0.05;
+    int32 num_rows = 64, cell_dim = dim;
+    Matrix<float> input(num_rows, 5 * cell_dim), params(3, cell_dim),
+        output(num_rows, 2 * cell_dim), output_deriv(num_rows, 2 * cell_dim),
+        input_deriv(num_rows, 5 * cell_dim), params_deriv(3, cell_dim),
+        self_repair_sum(5, cell_dim);
+    Matrix<double> deriv_sum(5, cell_dim), value_sum(5, cell_dim);
+    Vector<float> self_repair_config(10);
+    input.SetRandn();
+    params.SetRandn();
+    output_deriv.SetRandn();
+
+    // forward_time[1] and backward_time[1] are with the AVX2 kernels.
+    double forward_time[2], backward_time[2];
+    for (int32 simd = 0; simd <= 1; simd++) {
+      cu::SetCpuNonlinearitySimd(simd != 0);
+      {
+        Timer tim;
+        int32 iter = 0;
+        for (; tim.Elapsed() < time_in_secs; iter++)
+          cu::CpuComputeLstmNonlinearity(input, params, &output);
+        forward_time[simd] = tim.Elapsed() / iter;
+      }
+      {
+        Timer tim;
+        int32 iter = 0;
+        for (; tim.Elapsed() < time_in_secs; iter++)
+          cu::CpuBackpropLstmNonlinearity(input, params, output_deriv,
+                                          deriv_sum, self_repair_config, 0.0,
+                                          &input_deriv, &params_deriv,
+                                          &value_sum, &deriv_sum,
+                                          &self_repair_sum);
+        backward_time[simd] = tim.Elapsed() / iter;
+      }
+    }
+    cu::SetCpuNonlinearitySimd(true);
+    KALDI_LOG << "For CPU LSTM nonlinearity in float with " << num_rows
+              << " rows and cell-dim " << cell_dim << ", forward took "
+              << (forward_time[1] * 1.0e+06) << " us vs. "
+              << (forward_time[0] * 1.0e+06) << " us for the scalar code; "
+              << "backprop took " << (backward_time[1] * 1.0e+06)
+              << " us vs. " << (backward_time[0] * 1.0e+06)
+              << " us for the scalar code.";
+  }
+}
+
 template<typename Real>
 static void UnitTestCuMathNormalizePerRow() {
 
@@ -704,6 +865,8 @@ template<typename Real> void CudaMathUnitTest() {
   UnitTestLstmNonlinearity();
   UnitTestEnsureNonzero<Real>();
   UnitTestBackpropLstmNonlinearity<Real>();
+  if (sizeof(Real) == sizeof(float))
+    UnitTestCpuLstmGruNonlinearity();
   UnitTestCuMathNormalizePerRow<Real>();
   UnitTestCuMathNormalizePerRow_v2<Real>();
   UnitTestCuDiffNormalizePerRow<Real>();
@@ -24,6 +24,11 @@
 #include "cudamatrix/cu-device.h"
 #include "cudamatrix/cu-kernels.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KALDI_CU_MATH_AVX2 1
+#include <immintrin.h>
+#endif
+
 namespace kaldi {
 
 namespace cu {
@@ -441,6 +446,448 @@ static inline Real ScalarTanh(Real a) {
   }
 }
 
+// See SetCpuNonlinearitySimd().
+static bool cpu_nonlinearity_simd = true;
+
+void SetCpuNonlinearitySimd(bool enable) {
+  cpu_nonlinearity_simd = enable;
+}
+
+#ifdef KALDI_CU_MATH_AVX2
+// The following are AVX2 versions of the CPU code for the LSTM and GRU
+// nonlinearities, for float only.  Each of them processes the first n cells
+// (columns), where n is the largest multiple of 8 not exceeding the cell
+// dimension, and returns n; the calling code does the remaining cells with
+// the scalar code.  They call _mm256_zeroupper() before returning because
+// GCC only inserts vzeroupper itself at -O2 and above, and Kaldi's default
+// is -O1.
+
+// Returns true if the AVX2 kernels should be used.
+static bool CpuSupportsAvx2() {
+  static bool have_avx2 = __builtin_cpu_supports("avx2") &&
+      __builtin_cpu_supports("fma");
+  return have_avx2 && cpu_nonlinearity_simd;
+}
+
+// Computes exp(x) for x <= 0, using the polynomial approximation from Cephes'
+// expf() (relative error around 2e-7).  Arguments below -87 are treated as
+// -87, so the result is never denormal.
+__attribute__((target("avx2,fma")))
+static inline __m256 ExpNonPositive(__m256 x) {
+  x = _mm256_max_ps(x, _mm256_set1_ps(-87.0f));
+  // exp(x) = 2^n exp(r), with n = round(x / log(2)).  We compute
+  // r = x - n log(2) with log(2) split into two parts, for accuracy.
+  __m256 n = _mm256_round_ps(
+      _mm256_mul_ps(x, _mm256_set1_ps(1.44269504088896341f)),
+      _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  __m256 r = _mm256_fnmadd_ps(n, _mm256_set1_ps(0.693359375f), x);
+  r = _mm256_fnmadd_ps(n, _mm256_set1_ps(-2.12194440e-4f), r);
+  __m256 p = _mm256_set1_ps(1.9875691500e-4f);
+  p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.3981999507e-3f));
+  p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(8.3334519073e-3f));
+  p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(4.1665795894e-2f));
+  p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.6666665459e-1f));
+  p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(5.0000001201e-1f));
+  p = _mm256_fmadd_ps(p, _mm256_mul_ps(r, r),
+                      _mm256_add_ps(r, _mm256_set1_ps(1.0f)));
+  __m256i pow2n = _mm256_slli_epi32(
+      _mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+  return _mm256_mul_ps(p, _mm256_castsi256_ps(pow2n));
+}
+
+// Vector version of ScalarSigmoid(): with e = exp(-|x|), this is 1 / (1 + e)
+// for x > 0 and e / (1 + e) otherwise.
+__attribute__((target("avx2,fma")))
+static inline __m256 VectorSigmoid(__m256 x) {
+  const __m256 one = _mm256_set1_ps(1.0f);
+  __m256 e = ExpNonPositive(_mm256_or_ps(x, _mm256_set1_ps(-0.0f))),
+      inv = _mm256_div_ps(one, _mm256_add_ps(one, e));
+  return _mm256_blendv_ps(_mm256_mul_ps(e, inv), inv,
+                          _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_GT_OQ));
+}
+
+// Vector version of ScalarTanh(): with e = exp(-2|x|), tanh(|x|) is
+// (1 - e) / (1 + e), and the sign is copied from x.
+__attribute__((target("avx2,fma")))
+static inline __m256 VectorTanh(__m256 x) {
+  const __m256 one = _mm256_set1_ps(1.0f), sign_mask = _mm256_set1_ps(-0.0f);
+  __m256 e = ExpNonPositive(_mm256_mul_ps(_mm256_andnot_ps(sign_mask, x),
+                                          _mm256_set1_ps(-2.0f))),
+      t = _mm256_div_ps(_mm256_sub_ps(one, e), _mm256_add_ps(one, e));
+  return _mm256_or_ps(t, _mm256_and_ps(x, sign_mask));
+}
+
+// AVX2 version of the inner loop of CpuComputeLstmNonlinearity().
+__attribute__((target("avx2,fma")))
+static int32 ComputeLstmNonlinearityAvx2(const MatrixBase<float> &input_mat,
+                                         const MatrixBase<float> &params_mat,
+                                         MatrixBase<float> *output) {
+  int32 num_rows = input_mat.NumRows(),
+      input_cols = input_mat.NumCols(),
+      cell_dim = input_cols / 5,
+      simd_dim = cell_dim - cell_dim % 8;
+  const float *w_ic_data = params_mat.RowData(0),
+      *w_fc_data = params_mat.RowData(1),
+      *w_oc_data = params_mat.RowData(2);
+  for (int32 r = 0; r < num_rows; r++) {
+    const float *input_row = input_mat.RowData(r);
+    float *output_row = output->RowData(r);
+    bool have_dropout_mask = (input_cols != cell_dim * 5);
+    __m256 i_scale = _mm256_set1_ps(have_dropout_mask ?
+                                    input_row[cell_dim * 5] : 1.0f),
+        f_scale = _mm256_set1_ps(have_dropout_mask ?
+                                 input_row[cell_dim * 5 + 1] : 1.0f),
+        o_scale = _mm256_set1_ps(have_dropout_mask ?
+                                 input_row[cell_dim * 5 + 2] : 1.0f);
+    for (int32 c = 0; c < simd_dim; c += 8) {
+      __m256 i_part = _mm256_loadu_ps(input_row + c),
+          f_part = _mm256_loadu_ps(input_row + c + cell_dim),
+          c_part = _mm256_loadu_ps(input_row + c + 2 * cell_dim),
+          o_part = _mm256_loadu_ps(input_row + c + 3 * cell_dim),
+          c_prev = _mm256_loadu_ps(input_row + c + 4 * cell_dim),
+          w_ic = _mm256_loadu_ps(w_ic_data + c),
+          w_fc = _mm256_loadu_ps(w_fc_data + c),
+          w_oc = _mm256_loadu_ps(w_oc_data + c);
+      __m256 i_t = VectorSigmoid(_mm256_fmadd_ps(w_ic, c_prev, i_part)),
+          f_t = VectorSigmoid(_mm256_fmadd_ps(w_fc, c_prev, f_part)),
+          c_t = _mm256_fmadd_ps(
+              _mm256_mul_ps(f_t, f_scale), c_prev,
+              _mm256_mul_ps(_mm256_mul_ps(i_t, i_scale), VectorTanh(c_part))),
+          o_t = VectorSigmoid(_mm256_fmadd_ps(w_oc, c_t, o_part)),
+          m_t = _mm256_mul_ps(_mm256_mul_ps(o_t, o_scale), VectorTanh(c_t));
+      _mm256_storeu_ps(output_row + c, c_t);
+      _mm256_storeu_ps(output_row + c + cell_dim, m_t);
+    }
+  }
+  _mm256_zeroupper();
+  return simd_dim;
+}
+
+// AVX2 version of the main loop of CpuBackpropLstmNonlinearity(); see that
+// function for explanation.  Unlike the scalar code this goes through the
+// input row by row, accumulating the per-cell sums in a temporary matrix, so
+// the memory access is sequential; the order of summation (and so the
+// roundoff) is the same.
+__attribute__((target("avx2,fma")))
+static int32 BackpropLstmNonlinearityAvx2(
+    const MatrixBase<float> &input_mat,
+    const MatrixBase<float> &params_mat,
+    const MatrixBase<float> &output_deriv_mat,
+    const MatrixBase<double> &deriv_sum_in_mat,
+    const VectorBase<float> &sr_config,
+    float count,
+    MatrixBase<float> *input_deriv_mat,
+    MatrixBase<float> *params_deriv_mat,
+    MatrixBase<double> *value_sum_out_mat,
+    MatrixBase<double> *deriv_sum_out_mat,
+    MatrixBase<float> *self_repair_sum_out_mat) {
+  int32 num_rows = input_mat.NumRows(),
+      input_cols = input_mat.NumCols(),
+      cell_dim = input_cols / 5,
+      simd_dim = cell_dim - cell_dim % 8;
+  if (simd_dim == 0)
+    return 0;
+  bool have_dropout_mask = (input_cols != cell_dim * 5);
+
+  // The self-repair scales for the 5 nonlinearities (i_t, f_t, c_part, o_t,
+  // c_t), for each cell.
+  Matrix<float> self_repair(5, simd_dim, kUndefined);
+  for (int32 i = 0; i < 5; i++)
+    for (int32 c = 0; c < simd_dim; c++)
+      self_repair(i, c) = (deriv_sum_in_mat(i, c) / count < sr_config(i) ?
+                           sr_config(i + 5) : 0.0);
+  // Rows 0 through 4 of 'sums' are the value sums of the 5 nonlinearities,
+  // rows 5 through 9 are their derivative sums, and rows 10 through 12 are
+  // the derivatives w.r.t. w_ic, w_fc and w_oc.
+  Matrix<float> sums(13, simd_dim);
+
+  const __m256 one = _mm256_set1_ps(1.0f), two = _mm256_set1_ps(2.0f);
+  const float *w_ic_data = params_mat.RowData(0),
+      *w_fc_data = params_mat.RowData(1),
+      *w_oc_data = params_mat.RowData(2);
+  for (int32 r = 0; r < num_rows; r++) {
+    const float *input_row = input_mat.RowData(r),
+        *output_deriv_row = output_deriv_mat.RowData(r);
+    float *input_deriv_row = (input_deriv_mat == NULL ? NULL :
+                              input_deriv_mat->RowData(r));
+    __m256 i_scale = _mm256_set1_ps(have_dropout_mask ?
+                                    input_row[cell_dim * 5] : 1.0f),
+        f_scale = _mm256_set1_ps(have_dropout_mask ?
+                                 input_row[cell_dim * 5 + 1] : 1.0f),
+        o_scale = _mm256_set1_ps(have_dropout_mask ?
+                                 input_row[cell_dim * 5 + 2] : 1.0f);
+    for (int32 c = 0; c < simd_dim; c += 8) {
+      __m256 i_part = _mm256_loadu_ps(input_row + c),
+          f_part = _mm256_loadu_ps(input_row + c + cell_dim),
+          c_part = _mm256_loadu_ps(input_row + c + 2 * cell_dim),
+          o_part = _mm256_loadu_ps(input_row + c + 3 * cell_dim),
+          c_prev = _mm256_loadu_ps(input_row + c + 4 * cell_dim),
+          w_ic = _mm256_loadu_ps(w_ic_data + c),
+          w_fc = _mm256_loadu_ps(w_fc_data + c),
+          w_oc = _mm256_loadu_ps(w_oc_data + c);
+
+      // The forward computation.
+      __m256 i_t = VectorSigmoid(_mm256_fmadd_ps(w_ic, c_prev, i_part)),
+          f_t = VectorSigmoid(_mm256_fmadd_ps(w_fc, c_prev, f_part)),
+          tanh_c_part = VectorTanh(c_part),
+          c_t = _mm256_fmadd_ps(
+              _mm256_mul_ps(f_t, f_scale), c_prev,
+              _mm256_mul_ps(_mm256_mul_ps(i_t, i_scale), tanh_c_part)),
+          o_t = VectorSigmoid(_mm256_fmadd_ps(w_oc, c_t, o_part)),
+          tanh_c_t = VectorTanh(c_t);
+      // The derivatives of the nonlinearities.
+      __m256 i_t_deriv = _mm256_mul_ps(i_t, _mm256_sub_ps(one, i_t)),
+          f_t_deriv = _mm256_mul_ps(f_t, _mm256_sub_ps(one, f_t)),
+          c_part_deriv = _mm256_fnmadd_ps(tanh_c_part, tanh_c_part, one),
+          o_t_deriv = _mm256_mul_ps(o_t, _mm256_sub_ps(one, o_t)),
+          c_t_deriv = _mm256_fnmadd_ps(tanh_c_t, tanh_c_t, one);
+
+      if (params_deriv_mat != NULL) {
+        __m256 values[10] = { i_t, f_t, tanh_c_part, o_t, tanh_c_t,
+                              i_t_deriv, f_t_deriv, c_part_deriv, o_t_deriv,
+                              c_t_deriv };
+        for (int32 i = 0; i < 10; i++) {
+          float *sum = sums.RowData(i) + c;
+          _mm256_storeu_ps(sum, _mm256_add_ps(_mm256_loadu_ps(sum),
+                                              values[i]));
+        }
+      }
+
+      __m256 i_t_self_repair = _mm256_loadu_ps(self_repair.RowData(0) + c),
+          f_t_self_repair = _mm256_loadu_ps(self_repair.RowData(1) + c),
+          c_part_self_repair = _mm256_loadu_ps(self_repair.RowData(2) + c),
+          o_t_self_repair = _mm256_loadu_ps(self_repair.RowData(3) + c),
+          c_t_self_repair = _mm256_loadu_ps(self_repair.RowData(4) + c);
+
+      // The backward computation.
+      __m256 dc_t_out = _mm256_loadu_ps(output_deriv_row + c),
+          dm_t = _mm256_loadu_ps(output_deriv_row + c + cell_dim),
+          dtanh_c_t = _mm256_mul_ps(_mm256_mul_ps(o_t, o_scale), dm_t),
+          do_t = _mm256_mul_ps(_mm256_mul_ps(o_scale, tanh_c_t), dm_t),
+          do_t_input = _mm256_fnmadd_ps(_mm256_fmsub_ps(two, o_t, one),
+                                        o_t_self_repair,
+                                        _mm256_mul_ps(o_t_deriv, do_t)),
+          dc_t = _mm256_fnmadd_ps(
+              tanh_c_t, c_t_self_repair,
+              _mm256_fmadd_ps(do_t_input, w_oc,
+                              _mm256_fmadd_ps(c_t_deriv, dtanh_c_t,
+                                              dc_t_out))),
+          dtanh_c_part = _mm256_mul_ps(_mm256_mul_ps(i_t, i_scale), dc_t),
+          df_t = _mm256_mul_ps(_mm256_mul_ps(dc_t, f_scale), c_prev),
+          df_t_input = _mm256_fnmadd_ps(_mm256_fmsub_ps(two, f_t, one),
+                                        f_t_self_repair,
+                                        _mm256_mul_ps(df_t, f_t_deriv)),
+          di_t = _mm256_mul_ps(_mm256_mul_ps(dc_t, i_scale), tanh_c_part),
+          di_t_input = _mm256_fnmadd_ps(_mm256_fmsub_ps(two, i_t, one),
+                                        i_t_self_repair,
+                                        _mm256_mul_ps(di_t, i_t_deriv));
+
+      if (params_deriv_mat != NULL) {
+        __m256 values[3] = { _mm256_mul_ps(c_prev, di_t_input),
+                             _mm256_mul_ps(c_prev, df_t_input),
+                             _mm256_mul_ps(c_t, do_t_input) };
+        for (int32 i = 0; i < 3; i++) {
+          float *sum = sums.RowData(10 + i) + c;
+          _mm256_storeu_ps(sum, _mm256_add_ps(_mm256_loadu_ps(sum),
+                                              values[i]));
+        }
+      }
+      if (input_deriv_row != NULL) {
+        __m256 dc_prev = _mm256_fmadd_ps(
+            w_ic, di_t_input,
+            _mm256_fmadd_ps(w_fc, df_t_input,
+                            _mm256_mul_ps(_mm256_mul_ps(f_t, f_scale), dc_t))),
+            dc_part = _mm256_fnmadd_ps(tanh_c_part, c_part_self_repair,
+                                       _mm256_mul_ps(c_part_deriv,
+                                                     dtanh_c_part));
+        _mm256_storeu_ps(input_deriv_row + c, di_t_input);
+        _mm256_storeu_ps(input_deriv_row + c + cell_dim, df_t_input);
+        _mm256_storeu_ps(input_deriv_row + c + 2 * cell_dim, dc_part);
+        _mm256_storeu_ps(input_deriv_row + c + 3 * cell_dim, do_t_input);
+        _mm256_storeu_ps(input_deriv_row + c + 4 * cell_dim, dc_prev);
+      }
+    }
+  }
+  _mm256_zeroupper();
+
+  if (params_deriv_mat != NULL) {
+    for (int32 c = 0; c < simd_dim; c++) {
+      for (int32 i = 0; i < 3; i++)
+        (*params_deriv_mat)(i, c) = sums(10 + i, c);
+      // as in the scalar code, we need to update self_repair_sum_out before
+      // deriv_sum_out, because deriv_sum_out and deriv_sum_in might point to
+      // the same memory.
+      for (int32 i = 0; i < 5; i++) {
+        (*value_sum_out_mat)(i, c) += sums(i, c);
+        (*self_repair_sum_out_mat)(i, c) =
+            (deriv_sum_in_mat(i, c) / count < sr_config(i) ? num_rows : 0);
+        (*deriv_sum_out_mat)(i, c) += sums(5 + i, c);
+      }
+    }
+  }
+  return simd_dim;
+}
+
+// AVX2 version of the CPU code in ComputeGruNonlinearity().
+__attribute__((target("avx2,fma")))
+static int32 ComputeGruNonlinearityAvx2(const MatrixBase<float> &z_t,
+                                        const MatrixBase<float> &c_t1,
+                                        MatrixBase<float> *h_t,
+                                        MatrixBase<float> *c_t) {
+  int32 num_rows = z_t.NumRows(), cell_dim = z_t.NumCols(),
+      simd_dim = cell_dim - cell_dim % 8;
+  for (int32 r = 0; r < num_rows; r++) {
+    const float *z_row = z_t.RowData(r), *c_t1_row = c_t1.RowData(r);
+    float *h_row = h_t->RowData(r), *c_row = c_t->RowData(r);
+    for (int32 c = 0; c < simd_dim; c += 8) {
+      __m256 h = VectorTanh(_mm256_loadu_ps(h_row + c)),
+          z = _mm256_loadu_ps(z_row + c),
+          c_prev = _mm256_loadu_ps(c_t1_row + c);
+      _mm256_storeu_ps(h_row + c, h);
+      _mm256_storeu_ps(c_row + c,
+                       _mm256_fmadd_ps(z, _mm256_sub_ps(c_prev, h), h));
+    }
+  }
+  _mm256_zeroupper();
+  return simd_dim;
+}
+
+// AVX2 version of the CPU code in BackpropGruNonlinearity().
+__attribute__((target("avx2,fma")))
+static int32 BackpropGruNonlinearityAvx2(const MatrixBase<float> &z_t,
+                                         const MatrixBase<float> &c_t1,
+                                         const MatrixBase<float> &h_t,
+                                         const MatrixBase<float> &c_t_deriv,
+                                         MatrixBase<float> *h_t_deriv,
+                                         MatrixBase<float> *z_t_deriv,
+                                         MatrixBase<float> *c_t1_deriv) {
+  int32 num_rows = z_t.NumRows(), cell_dim = z_t.NumCols(),
+      simd_dim = cell_dim - cell_dim % 8;
+  const __m256 one = _mm256_set1_ps(1.0f);
+  for (int32 r = 0; r < num_rows; r++) {
+    const float *z_row = z_t.RowData(r), *c_t1_row = c_t1.RowData(r),
+        *h_row = h_t.RowData(r), *c_deriv_row = c_t_deriv.RowData(r);
+    float *h_deriv_row = h_t_deriv->RowData(r),
+        *z_deriv_row = (z_t_deriv == NULL ? NULL : z_t_deriv->RowData(r)),
+        *c_t1_deriv_row = (c_t1_deriv == NULL ? NULL :
+                           c_t1_deriv->RowData(r));
+    for (int32 c = 0; c < simd_dim; c += 8) {
+      __m256 z = _mm256_loadu_ps(z_row + c),
+          h = _mm256_loadu_ps(h_row + c),
+          c_deriv = _mm256_loadu_ps(c_deriv_row + c),
+          h_deriv = _mm256_fmadd_ps(c_deriv, _mm256_sub_ps(one, z),
+                                    _mm256_loadu_ps(h_deriv_row + c));
+      _mm256_storeu_ps(h_deriv_row + c,
+                       _mm256_mul_ps(_mm256_fnmadd_ps(h, h, one), h_deriv));
+      if (z_deriv_row != NULL) {
+        __m256 c_prev = _mm256_loadu_ps(c_t1_row + c);
+        _mm256_storeu_ps(z_deriv_row + c,
+                         _mm256_fmadd_ps(c_deriv, _mm256_sub_ps(c_prev, h),
+                                         _mm256_loadu_ps(z_deriv_row + c)));
+      }
+      if (c_t1_deriv_row != NULL)
+        _mm256_storeu_ps(c_t1_deriv_row + c,
+                         _mm256_fmadd_ps(c_deriv, z,
+                                         _mm256_loadu_ps(c_t1_deriv_row + c)));
+    }
+  }
+  _mm256_zeroupper();
+  return simd_dim;
+}
+#endif  // KALDI_CU_MATH_AVX2
+
+// The following functions compute the first n cells of the corresponding CPU
+// code with SIMD instructions, if possible, and return n; see the AVX2
+// versions above.  The double versions always return zero.
+static int32 SimdComputeLstmNonlinearity(const MatrixBase<double> &input,
+                                         const MatrixBase<double> &params,
+                                         MatrixBase<double> *output) {
+  return 0;
+}
+
+static int32 SimdComputeLstmNonlinearity(const MatrixBase<float> &input,
+                                         const MatrixBase<float> &params,
+                                         MatrixBase<float> *output) {
+#ifdef KALDI_CU_MATH_AVX2
+  if (CpuSupportsAvx2())
+    return ComputeLstmNonlinearityAvx2(input, params, output);
+#endif
+  return 0;
+}
+
+static int32 SimdBackpropLstmNonlinearity(
+    const MatrixBase<double> &input, const MatrixBase<double> &params,
+    const MatrixBase<double> &output_deriv,
+    const MatrixBase<double> &deriv_sum_in,
+    const VectorBase<double> &self_repair_config, double count,
+    MatrixBase<double> *input_deriv, MatrixBase<double> *params_deriv,
+    MatrixBase<double> *value_sum_out, MatrixBase<double> *deriv_sum_out,
+    MatrixBase<double> *self_repair_sum_out) {
+  return 0;
+}
+
+static int32 SimdBackpropLstmNonlinearity(
+    const MatrixBase<float> &input, const MatrixBase<float> &params,
+    const MatrixBase<float> &output_deriv,
+    const MatrixBase<double> &deriv_sum_in,
+    const VectorBase<float> &self_repair_config, float count,
+    MatrixBase<float> *input_deriv, MatrixBase<float> *params_deriv,
+    MatrixBase<double> *value_sum_out, MatrixBase<double> *deriv_sum_out,
+    MatrixBase<float> *self_repair_sum_out) {
+#ifdef KALDI_CU_MATH_AVX2
+  if (CpuSupportsAvx2())
+    return BackpropLstmNonlinearityAvx2(input, params, output_deriv,
+                                        deriv_sum_in, self_repair_config,
+                                        count, input_deriv, params_deriv,
+                                        value_sum_out, deriv_sum_out,
+                                        self_repair_sum_out);
+#endif
+  return 0;
+}
+
+static int32 SimdComputeGruNonlinearity(const MatrixBase<double> &z_t,
+                                        const MatrixBase<double> &c_t1,
+                                        MatrixBase<double> *h_t,
+                                        MatrixBase<double> *c_t) {
+  return 0;
+}
+
+static int32 SimdComputeGruNonlinearity(const MatrixBase<float> &z_t,
+                                        const MatrixBase<float> &c_t1,
+                                        MatrixBase<float> *h_t,
+                                        MatrixBase<float> *c_t) {
+#ifdef KALDI_CU_MATH_AVX2
+  if (CpuSupportsAvx2())
+    return ComputeGruNonlinearityAvx2(z_t, c_t1, h_t, c_t);
+#endif
+  return 0;
+}
+
+static int32 SimdBackpropGruNonlinearity(const MatrixBase<double> &z_t,
+                                         const MatrixBase<double> &c_t1,
+                                         const MatrixBase<double> &h_t,
+                                         const MatrixBase<double> &c_t_deriv,
+                                         MatrixBase<double> *h_t_deriv,
+                                         MatrixBase<double> *z_t_deriv,
+                                         MatrixBase<double> *c_t1_deriv) {
+  return 0;
+}
+
+static int32 SimdBackpropGruNonlinearity(const MatrixBase<float> &z_t,
+                                         const MatrixBase<float> &c_t1,
+                                         const MatrixBase<float> &h_t,
+                                         const MatrixBase<float> &c_t_deriv,
+                                         MatrixBase<float> *h_t_deriv,
+                                         MatrixBase<float> *z_t_deriv,
+                                         MatrixBase<float> *c_t1_deriv) {
+#ifdef KALDI_CU_MATH_AVX2
+  if (CpuSupportsAvx2())
+    return BackpropGruNonlinearityAvx2(z_t, c_t1, h_t, c_t_deriv, h_t_deriv,
+                                       z_t_deriv, c_t1_deriv);
+#endif
+  return 0;
+}
+
 template<typename Real>
 void CpuComputeLstmNonlinearity(const MatrixBase<Real> &input_mat,
                                 const MatrixBase<Real> &params_mat,
@@ -454,6 +901,11 @@ void CpuComputeLstmNonlinearity(const MatrixBase<Real> &input_mat,
   KALDI_ASSERT(params_mat.NumCols() == cell_dim);
   KALDI_ASSERT(output->NumCols() == 2 * cell_dim);
 
+  // The SIMD code, if used, does the first 'simd_dim' cells.
+  int32 simd_dim = SimdComputeLstmNonlinearity(input_mat, params_mat, output);
+  if (simd_dim == cell_dim)
+    return;
+
   MatrixBase<Real> &output_mat = *output;
   const Real *params_data = params_mat.Data();
   int32 params_stride = params_mat.Stride();
@@ -465,7 +917,7 @@ void CpuComputeLstmNonlinearity(const MatrixBase<Real> &input_mat,
          o_scale = (input_cols == cell_dim*5 ? 1.0:input_row[cell_dim*5 + 2]);
 
     Real *output_row = output_mat.RowData(r);
-    for (int32 c = 0; c < cell_dim; c++) {
+    for (int32 c = simd_dim; c < cell_dim; c++) {
       Real i_part = input_row[c];
       Real f_part = input_row[c + cell_dim];
       Real c_part = input_row[c + 2 * cell_dim];
@@ -604,7 +1056,12 @@ void CpuBackpropLstmNonlinearity(const MatrixBase<Real> &input,
 
   // We add 1.0 (i.e. a small value) to the count to avoid division by zero.
   Real count = 1.0 + count_in;
-  for (int32 c = 0; c < cell_dim; c++) {
+  // The SIMD code, if used, does the first 'simd_dim' cells.
+  int32 simd_dim = SimdBackpropLstmNonlinearity(
+      input_mat, params_mat, output_deriv_mat, deriv_sum_in_mat, sr_config,
+      count, input_deriv_mat, params_deriv_mat, value_sum_out_mat,
+      deriv_sum_out_mat, self_repair_sum_out_mat);
+  for (int32 c = simd_dim; c < cell_dim; c++) {
     // parameters
     Real w_ic = params_mat(0, c);
     Real w_fc = params_mat(1, c);
@@ -993,6 +1450,132 @@ void BackpropLstmNonlinearity(const CuMatrixBase<double> &input,
                               CuMatrixBase<double> *self_repair_sum_out);
 
 
+template<typename Real>
+void ComputeGruNonlinearity(const CuMatrixBase<Real> &z_t,
+                            const CuMatrixBase<Real> &c_t1,
+                            CuMatrixBase<Real> *h_t,
+                            CuMatrixBase<Real> *c_t) {
+  KALDI_ASSERT(SameDim(z_t, c_t1) && SameDim(z_t, *h_t) &&
+               SameDim(z_t, *c_t));
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    h_t->Tanh(*h_t);
+    // now, h_t = tanh(h_t_input).
+    c_t->CopyFromMat(*h_t);
+    // now c_t = h_t
+    c_t->AddMatMatElements(-1.0, z_t, *h_t, 1.0);
+    // now c_t = (1 - z_t) \dot h_t.
+    c_t->AddMatMatElements(1.0, z_t, c_t1, 1.0);
+    // now c_t = (1 - z_t) \dot h_t  +  z_t \dot c_{t-1}.
+  } else
+#endif
+  {
+    const MatrixBase<Real> &z_t_mat = z_t.Mat(), &c_t1_mat = c_t1.Mat();
+    MatrixBase<Real> &h_t_mat = h_t->Mat(), &c_t_mat = c_t->Mat();
+    int32 num_rows = z_t.NumRows(), cell_dim = z_t.NumCols();
+    // The SIMD code, if used, does the first 'simd_dim' cells.
+    int32 simd_dim = SimdComputeGruNonlinearity(z_t_mat, c_t1_mat,
+                                                &h_t_mat, &c_t_mat);
+    if (simd_dim == cell_dim)
+      return;
+    for (int32 r = 0; r < num_rows; r++) {
+      const Real *z_row = z_t_mat.RowData(r), *c_t1_row = c_t1_mat.RowData(r);
+      Real *h_row = h_t_mat.RowData(r), *c_row = c_t_mat.RowData(r);
+      for (int32 c = simd_dim; c < cell_dim; c++) {
+        Real h = ScalarTanh(h_row[c]), z = z_row[c];
+        h_row[c] = h;
+        c_row[c] = (Real(1) - z) * h + z * c_t1_row[c];
+      }
+    }
+  }
+}
+
+template<typename Real>
+void BackpropGruNonlinearity(const CuMatrixBase<Real> &z_t,
+                             const CuMatrixBase<Real> &c_t1,
+                             const CuMatrixBase<Real> &h_t,
+                             const CuMatrixBase<Real> &c_t_deriv,
+                             CuMatrixBase<Real> *h_t_deriv,
+                             CuMatrixBase<Real> *z_t_deriv,
+                             CuMatrixBase<Real> *c_t1_deriv) {
+  KALDI_ASSERT(SameDim(z_t, c_t1) && SameDim(z_t, h_t) &&
+               SameDim(z_t, c_t_deriv) && SameDim(z_t, *h_t_deriv) &&
+               (z_t_deriv == NULL || SameDim(z_t, *z_t_deriv)) &&
+               (c_t1_deriv == NULL || SameDim(z_t, *c_t1_deriv)));
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    // First do: h_t_deriv += c_t_deriv \dot (1 - z_t).
+    h_t_deriv->AddMat(1.0, c_t_deriv);
+    h_t_deriv->AddMatMatElements(-1.0, c_t_deriv, z_t, 1.0);
+    // these should be self-explanatory if you study
+    // the expression "c_t = (1 - z_t) \dot h_t + z_t \dot c_{t-1}".
+    if (z_t_deriv != NULL) {
+      z_t_deriv->AddMatMatElements(-1.0, c_t_deriv, h_t, 1.0);
+      z_t_deriv->AddMatMatElements(1.0, c_t_deriv, c_t1, 1.0);
+    }
+    if (c_t1_deriv != NULL)
+      c_t1_deriv->AddMatMatElements(1.0, c_t_deriv, z_t, 1.0);
+    h_t_deriv->DiffTanh(h_t, *h_t_deriv);
+  } else
+#endif
+  {
+    const MatrixBase<Real> &z_t_mat = z_t.Mat(), &c_t1_mat = c_t1.Mat(),
+        &h_t_mat = h_t.Mat(), &c_t_deriv_mat = c_t_deriv.Mat();
+    MatrixBase<Real> &h_t_deriv_mat = h_t_deriv->Mat();
+    MatrixBase<Real> *z_t_deriv_mat = (z_t_deriv == NULL ? NULL :
+                                       &(z_t_deriv->Mat())),
+        *c_t1_deriv_mat = (c_t1_deriv == NULL ? NULL : &(c_t1_deriv->Mat()));
+    int32 num_rows = z_t.NumRows(), cell_dim = z_t.NumCols();
+    // The SIMD code, if used, does the first 'simd_dim' cells.
+    int32 simd_dim = SimdBackpropGruNonlinearity(
+        z_t_mat, c_t1_mat, h_t_mat, c_t_deriv_mat, &h_t_deriv_mat,
+        z_t_deriv_mat, c_t1_deriv_mat);
+    if (simd_dim == cell_dim)
+      return;
+    for (int32 r = 0; r < num_rows; r++) {
+      const Real *z_row = z_t_mat.RowData(r), *c_t1_row = c_t1_mat.RowData(r),
+          *h_row = h_t_mat.RowData(r), *c_deriv_row = c_t_deriv_mat.RowData(r);
+      Real *h_deriv_row = h_t_deriv_mat.RowData(r);
+      for (int32 c = simd_dim; c < cell_dim; c++) {
+        Real z = z_row[c], h = h_row[c], c_deriv = c_deriv_row[c],
+            h_deriv = h_deriv_row[c] + c_deriv * (Real(1) - z);
+        h_deriv_row[c] = (Real(1) - h * h) * h_deriv;
+        if (z_t_deriv_mat != NULL)
+          (*z_t_deriv_mat)(r, c) += c_deriv * (c_t1_row[c] - h);
+        if (c_t1_deriv_mat != NULL)
+          (*c_t1_deriv_mat)(r, c) += c_deriv * z;
+      }
+    }
+  }
+}
+
+template
+void ComputeGruNonlinearity(const CuMatrixBase<float> &z_t,
+                            const CuMatrixBase<float> &c_t1,
+                            CuMatrixBase<float> *h_t,
+                            CuMatrixBase<float> *c_t);
+template
+void ComputeGruNonlinearity(const CuMatrixBase<double> &z_t,
+                            const CuMatrixBase<double> &c_t1,
+                            CuMatrixBase<double> *h_t,
+                            CuMatrixBase<double> *c_t);
+template
+void BackpropGruNonlinearity(const CuMatrixBase<float> &z_t,
+                             const CuMatrixBase<float> &c_t1,
+                             const CuMatrixBase<float> &h_t,
+                             const CuMatrixBase<float> &c_t_deriv,
+                             CuMatrixBase<float> *h_t_deriv,
+                             CuMatrixBase<float> *z_t_deriv,
+                             CuMatrixBase<float> *c_t1_deriv);
+template
+void BackpropGruNonlinearity(const CuMatrixBase<double> &z_t,
+                             const CuMatrixBase<double> &c_t1,
+                             const CuMatrixBase<double> &h_t,
+                             const CuMatrixBase<double> &c_t_deriv,
+                             CuMatrixBase<double> *h_t_deriv,
+                             CuMatrixBase<double> *z_t_deriv,
+                             CuMatrixBase<double> *c_t1_deriv);
+
 
 } //namespace cu
 
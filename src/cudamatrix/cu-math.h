@@ -134,6 +134,10 @@ void ComputeLstmNonlinearity(const CuMatrixBase<Real> &input,
                              CuMatrixBase<Real> *output);
 // This is a version of ComputeLstmNonlinearity that only uses the CPU
 // even if a GPU is available. It's made available for testing purposes.
+// For float, it uses AVX2 instructions if the CPU supports them; the
+// exponentials are then computed with a polynomial approximation, so the
+// results differ slightly (relative differences around 1e-6) from the
+// double-precision version.
 template<typename Real>
 void CpuComputeLstmNonlinearity(const MatrixBase<Real> &input,
                                 const MatrixBase<Real> &params,
@@ -256,6 +260,60 @@ void CpuBackpropLstmNonlinearity(const MatrixBase<Real> &input,
                                  MatrixBase<double> *deriv_sum_out,
                                  MatrixBase<Real> *self_repair_sum_out);
 
+
+/**
+   This is a special-purpose function used by classes GruNonlinearityComponent
+   and OutputGruNonlinearityComponent (see ../nnet3/nnet-combined-component.h)
+   to do the elementwise part of their forward propagation, i.e.
+      h_t = tanh(h_t_input)
+      c_t = (1 - z_t) \dot h_t + z_t \dot c_{t-1}
+   All the matrices must have the same dimension N by C.  On the CPU this
+   is done in a single pass over the data (using AVX2 instructions for float,
+   if the CPU supports them).
+
+   @param [in] z_t      The update gate z_t (already passed through the sigmoid).
+   @param [in] c_t1     The previous cell state c_{t-1}.
+   @param [in,out] h_t  At entry, the input to the tanh, h_t_input; at exit,
+                        h_t.
+   @param [out] c_t     The cell state c_t.
+*/
+template<typename Real>
+void ComputeGruNonlinearity(const CuMatrixBase<Real> &z_t,
+                            const CuMatrixBase<Real> &c_t1,
+                            CuMatrixBase<Real> *h_t,
+                            CuMatrixBase<Real> *c_t);
+
+/**
+   This function does the backward pass corresponding to
+   ComputeGruNonlinearity().  All the matrices must have the same dimension.
+
+   @param [in] z_t, c_t1  The same as in ComputeGruNonlinearity().
+   @param [in] h_t        The output h_t of ComputeGruNonlinearity().
+   @param [in] c_t_deriv  The derivative of the objective function w.r.t. c_t.
+   @param [in,out] h_t_deriv  At entry, the derivative of the objective
+                        function w.r.t. h_t, not counting the part that comes
+                        via c_t (normally zero); at exit, the derivative w.r.t.
+                        the input to the tanh, h_t_input.
+   @param [out] z_t_deriv   If not NULL, the derivative w.r.t. z_t is *added*
+                        to this location.
+   @param [out] c_t1_deriv  If not NULL, the derivative w.r.t. c_{t-1} (via c_t
+                        only) is *added* to this location.
+*/
+template<typename Real>
+void BackpropGruNonlinearity(const CuMatrixBase<Real> &z_t,
+                             const CuMatrixBase<Real> &c_t1,
+                             const CuMatrixBase<Real> &h_t,
+                             const CuMatrixBase<Real> &c_t_deriv,
+                             CuMatrixBase<Real> *h_t_deriv,
+                             CuMatrixBase<Real> *z_t_deriv,
+                             CuMatrixBase<Real> *c_t1_deriv);
+
+/// By default, the CPU versions of the LSTM and GRU nonlinearity functions
+/// above use AVX2 code for float if the CPU supports it.  Calling this with
+/// 'enable' = false makes them use the scalar code instead; it is intended
+/// for testing, and is not thread-safe.
+void SetCpuNonlinearitySimd(bool enable);
+
 /// Normalize nonlinearity modifies the vector of activations
 /// by scaling it so that the root-mean-square equals 1.0.
 ///
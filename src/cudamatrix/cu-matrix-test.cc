@@ -988,6 +988,77 @@ static void UnitTestCuMatrixHeaviside() {
   }
 }
 
+template<typename Real>
+static void UnitTestCuMatrixBiasReluOffset() {
+  for (int32 i = 0; i < 2; i++) {
+    Matrix<Real> H(10 + Rand() % 60, 10 + Rand() % 20);
+    H.SetRandn();
+    Vector<Real> bias(H.NumCols()), offset(H.NumCols());
+    bias.SetRandn();
+    offset.SetRandn();
+
+    CuMatrix<Real> cH(H);
+    CuVector<Real> cbias(bias), coffset(offset);
+    if (i == 0) {
+      CuMatrix<Real> cH2(H.NumRows(), H.NumCols(), kUndefined);
+      cH2.BiasReluOffset(cH, cbias, coffset);
+      cH.Swap(&cH2);
+    } else {
+      cH.BiasReluOffset(cH, cbias, coffset);  // in-place.
+    }
+    H.AddVecToRows(1.0, bias);
+    H.ApplyFloor(0.0);
+    H.AddVecToRows(1.0, offset);
+    Matrix<Real> H2(cH);
+    KALDI_ASSERT(ApproxEqual(H, H2));
+  }
+}
+
+template<typename Real>
+static void UnitTestCuMatrixDiffBiasReluOffset() {
+  for (int32 i = 0; i < 2; i++) {
+    Matrix<Real> X(10 + Rand() % 60, 10 + Rand() % 20), D(X.NumRows(),
+                                                          X.NumCols());
+    X.SetRandn();
+    D.SetRandn();
+    Vector<Real> bias(X.NumCols()), offset(X.NumCols());
+    bias.SetRandn();
+    offset.SetRandn();
+    // Give every other column an offset so large that a small ReLU output is
+    // absorbed when it is added (i.e. the output equals the offset), and make
+    // the ReLU output small but positive in some places.
+    for (int32 c = 0; c < X.NumCols(); c += 2)
+      offset(c) *= 1.0e+20;
+    for (int32 r = 0; r < X.NumRows(); r += 3)
+      X(r, r % X.NumCols()) = 1.0e-03 - bias(r % X.NumCols());
+
+    CuMatrix<Real> cX(X), cD(D), cY(X.NumRows(), X.NumCols());
+    CuVector<Real> cbias(bias), coffset(offset);
+    cY.BiasReluOffset(cX, cbias, coffset);
+    if (i == 0) {
+      CuMatrix<Real> cD2(D.NumRows(), D.NumCols(), kUndefined);
+      cD2.DiffBiasReluOffset(cX, cbias, cD);
+      cD.Swap(&cD2);
+    } else {
+      cD.DiffBiasReluOffset(cX, cbias, cD);  // in-place.
+    }
+    Matrix<Real> Y(cY), D2(cD);
+    int32 num_absorbed = 0;
+    for (int32 r = 0; r < X.NumRows(); r++) {
+      for (int32 c = 0; c < X.NumCols(); c++) {
+        Real x = X(r, c) + bias(c);
+        KALDI_ASSERT(D2(r, c) == (x > 0.0 ? D(r, c) : 0.0));
+        if (x > 0.0 && Y(r, c) == offset(c))
+          num_absorbed++;
+      }
+    }
+    // The derivative of the units whose output was absorbed must still have
+    // been passed through, which comparing the output with the offset
+    // would not do.
+    KALDI_ASSERT(num_absorbed > 0);
+  }
+}
+
 
 template<typename Real>
 static void UnitTestCuMatrixMulElements() {
@@ -2964,6 +3035,8 @@ template<typename Real> void CudaMatrixUnitTest() {
   UnitTestCuMatrixApplyCeiling<Real>();
   UnitTestCuMatrixApplyHeaviside<Real>();
   UnitTestCuMatrixHeaviside<Real>();
+  UnitTestCuMatrixBiasReluOffset<Real>();
+  UnitTestCuMatrixDiffBiasReluOffset<Real>();
   UnitTestCuMatrixMulElements<Real>();
   UnitTestCuMatrixDivElements<Real>();
   UnitTestCuMatrixMax<Real>();
@@ -2494,6 +2494,80 @@ void CuMatrixBase<Real>::Heaviside(const CuMatrixBase<Real> &src) {
   }
 }
 
+template<typename Real>
+void CuMatrixBase<Real>::BiasReluOffset(const CuMatrixBase<Real> &src,
+                                        const CuVectorBase<Real> &bias,
+                                        const CuVectorBase<Real> &offset) {
+  KALDI_ASSERT(SameDim(*this, src) && bias.Dim() == NumCols() &&
+               offset.Dim() == NumCols());
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    CuTimer tim;
+    dim3 dimGrid, dimBlock;
+    GetBlockSizesForSimpleMatrixOperation(NumRows(), NumCols(),
+                                          &dimGrid, &dimBlock);
+    cuda_bias_relu_offset(dimGrid, dimBlock, this->data_, src.data_,
+                          bias.Data(), offset.Data(), this->Dim(),
+                          src.Stride());
+    CU_SAFE_CALL(cudaGetLastError());
+
+    CuDevice::Instantiate().AccuProfile(__func__, tim);
+  } else
+  #endif
+  {
+    MatrixBase<Real> &mat = Mat();
+    const MatrixBase<Real> &src_mat = src.Mat();
+    const Real *bias_data = bias.Vec().Data(),
+        *offset_data = offset.Vec().Data();
+    int32 num_rows = mat.NumRows(), num_cols = mat.NumCols();
+    for (int32 r = 0; r < num_rows; r++) {
+      const Real *src_row = src_mat.RowData(r);
+      Real *row = mat.RowData(r);
+      for (int32 c = 0; c < num_cols; c++) {
+        Real x = src_row[c] + bias_data[c];
+        row[c] = (x > 0.0 ? x : 0.0) + offset_data[c];
+      }
+    }
+  }
+}
+
+template<typename Real>
+void CuMatrixBase<Real>::DiffBiasReluOffset(const CuMatrixBase<Real> &src,
+                                            const CuVectorBase<Real> &bias,
+                                            const CuMatrixBase<Real> &diff) {
+  KALDI_ASSERT(SameDim(*this, src) && SameDim(*this, diff) &&
+               bias.Dim() == NumCols());
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    CuTimer tim;
+    dim3 dimGrid, dimBlock;
+    GetBlockSizesForSimpleMatrixOperation(NumRows(), NumCols(),
+                                          &dimGrid, &dimBlock);
+    cuda_diff_bias_relu_offset(dimGrid, dimBlock, this->data_, diff.data_,
+                               src.data_, bias.Data(), this->Dim(),
+                               diff.Stride(), src.Stride());
+    CU_SAFE_CALL(cudaGetLastError());
+
+    CuDevice::Instantiate().AccuProfile(__func__, tim);
+  } else
+  #endif
+  {
+    MatrixBase<Real> &mat = Mat();
+    const MatrixBase<Real> &src_mat = src.Mat(), &diff_mat = diff.Mat();
+    const Real *bias_data = bias.Vec().Data();
+    int32 num_rows = mat.NumRows(), num_cols = mat.NumCols();
+    for (int32 r = 0; r < num_rows; r++) {
+      const Real *src_row = src_mat.RowData(r),
+          *diff_row = diff_mat.RowData(r);
+      Real *row = mat.RowData(r);
+      for (int32 c = 0; c < num_cols; c++) {
+        Real x = src_row[c] + bias_data[c];
+        row[c] = (x > 0.0 ? diff_row[c] : 0.0);
+      }
+    }
+  }
+}
+
 template<typename Real>
 void CuMatrixBase<Real>::Exp(const CuMatrixBase<Real> &src) {
   KALDI_ASSERT(SameDim(*this, src));
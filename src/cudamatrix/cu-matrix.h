@@ -292,6 +292,22 @@ class CuMatrixBase {
   /// in general, there are different ways to deal with the situation when x==0.]
   void Heaviside(const CuMatrixBase<Real> &src);
 
+  /// Sets (*this)(i, j) = max(src(i, j) + bias(j), 0) + offset(j).  This
+  /// does, in one pass, what would otherwise be a bias addition, a ReLU and
+  /// the offset of a test-mode batchnorm; see BiasReluOffsetComponent.
+  /// "src" may be the same matrix as *this.
+  void BiasReluOffset(const CuMatrixBase<Real> &src,
+                      const CuVectorBase<Real> &bias,
+                      const CuVectorBase<Real> &offset);
+
+  /// Differentiate backward through BiasReluOffset().  Here, "src" and "bias"
+  /// are the same as its arguments; the offset does not matter.  Does,
+  /// element by element, *this = (src(i, j) + bias(j) > 0 ? diff(i, j) : 0).
+  /// Supports in-place operation, this == &diff.
+  void DiffBiasReluOffset(const CuMatrixBase<Real> &src,
+                          const CuVectorBase<Real> &bias,
+                          const CuMatrixBase<Real> &diff);
+
   void Exp(const CuMatrixBase<Real> &src);
 
   void Log(const CuMatrixBase<Real> &src);
@@ -572,14 +572,12 @@ void ModifyGraphForCarefulAlignment(
 }
 
 
-void AlignUtteranceWrapper(
+AlignUtteranceClass::AlignUtteranceClass(
     const AlignConfig &config,
     const std::string &utt,
-    BaseFloat acoustic_scale,  // affects scores written to scores_writer, if
-                               // present
-    fst::VectorFst<fst::StdArc> *fst,  // non-const in case config.careful ==
-                                       // true.
-    DecodableInterface *decodable,  // not const but is really an input.
+    BaseFloat acoustic_scale,
+    fst::VectorFst<fst::StdArc> *fst,
+    DecodableInterface *decodable,
     Int32VectorWriter *alignment_writer,
     BaseFloatWriter *scores_writer,
     int32 *num_done,
@@ -587,45 +585,51 @@ void AlignUtteranceWrapper(
     int32 *num_retried,
     double *tot_like,
     int64 *frame_count,
-    BaseFloatVectorWriter *per_frame_acwt_writer) {
-
+    BaseFloatVectorWriter *per_frame_acwt_writer):
+    config_(config), utt_(utt), acoustic_scale_(acoustic_scale), fst_(fst),
+    decodable_(decodable), alignment_writer_(alignment_writer),
+    scores_writer_(scores_writer), num_done_(num_done), num_error_(num_error),
+    num_retried_(num_retried), tot_like_(tot_like), frame_count_(frame_count),
+    per_frame_acwt_writer_(per_frame_acwt_writer), computed_(false),
+    success_(false), retried_(false), num_frames_(0), cost_(0.0) {
   if ((config.retry_beam != 0 && config.retry_beam <= config.beam) ||
       config.beam <= 0.0) {
     KALDI_ERR << "Beams do not make sense: beam " << config.beam
               << ", retry-beam " << config.retry_beam;
   }
+}
 
-  if (fst->Start() == fst::kNoStateId) {
-    KALDI_WARN << "Empty decoding graph for " << utt;
-    if (num_error != NULL) (*num_error)++;
+void AlignUtteranceClass::operator () () {
+  computed_ = true;
+  if (fst_->Start() == fst::kNoStateId) {
+    KALDI_WARN << "Empty decoding graph for " << utt_;
     return;
   }
 
-  if (config.careful)
-    ModifyGraphForCarefulAlignment(fst);
+  if (config_.careful)
+    ModifyGraphForCarefulAlignment(fst_);
 
   FasterDecoderOptions decode_opts;
-  decode_opts.beam = config.beam;
+  decode_opts.beam = config_.beam;
 
-  FasterDecoder decoder(*fst, decode_opts);
-  decoder.Decode(decodable);
+  FasterDecoder decoder(*fst_, decode_opts);
+  decoder.Decode(decodable_);
 
   bool ans = decoder.ReachedFinal();  // consider only final states.
 
-  if (!ans && config.retry_beam != 0.0) {
-    if (num_retried != NULL) (*num_retried)++;
-    KALDI_WARN << "Retrying utterance " << utt << " with beam "
-               << config.retry_beam;
-    decode_opts.beam = config.retry_beam;
+  if (!ans && config_.retry_beam != 0.0) {
+    retried_ = true;
+    KALDI_WARN << "Retrying utterance " << utt_ << " with beam "
+               << config_.retry_beam;
+    decode_opts.beam = config_.retry_beam;
     decoder.SetOptions(decode_opts);
-    decoder.Decode(decodable);
+    decoder.Decode(decodable_);
     ans = decoder.ReachedFinal();
   }
 
   if (!ans) {  // Still did not reach final state.
-    KALDI_WARN << "Did not successfully decode file " << utt << ", len = "
-               << decodable->NumFramesReady();
-    if (num_error != NULL) (*num_error)++;
+    KALDI_WARN << "Did not successfully decode file " << utt_ << ", len = "
+               << decodable_->NumFramesReady();
     return;
   }
 
@@ -633,33 +637,70 @@ void AlignUtteranceWrapper(
   decoder.GetBestPath(&decoded);
   if (decoded.NumStates() == 0) {
     KALDI_WARN << "Error getting best path from decoder (likely a bug)";
-    if (num_error != NULL) (*num_error)++;
     return;
   }
 
-  std::vector<int32> alignment;
   std::vector<int32> words;
   LatticeWeight weight;
 
-  GetLinearSymbolSequence(decoded, &alignment, &words, &weight);
-  BaseFloat like = -(weight.Value1()+weight.Value2()) / acoustic_scale;
+  GetLinearSymbolSequence(decoded, &alignment_, &words, &weight);
+  cost_ = weight.Value1() + weight.Value2();
+  num_frames_ = decodable_->NumFramesReady();
 
-  if (num_done != NULL) (*num_done)++;
-  if (tot_like != NULL) (*tot_like) += like;
-  if (frame_count != NULL) (*frame_count) += decodable->NumFramesReady();
-
-  if (alignment_writer != NULL && alignment_writer->IsOpen())
-    alignment_writer->Write(utt, alignment);
+  if (per_frame_acwt_writer_ != NULL && per_frame_acwt_writer_->IsOpen()) {
+    GetPerFrameAcousticCosts(decoded, &per_frame_loglikes_);
+    per_frame_loglikes_.Scale(-1 / acoustic_scale_);
+  }
+  success_ = true;
+}
 
-  if (scores_writer != NULL && scores_writer->IsOpen())
-    scores_writer->Write(utt, -(weight.Value1()+weight.Value2()));
+AlignUtteranceClass::~AlignUtteranceClass() {
+  if (!computed_)
+    KALDI_ERR << "Destructor called without operator (), error in calling code.";
 
-  Vector<BaseFloat> per_frame_loglikes;
-  if (per_frame_acwt_writer != NULL && per_frame_acwt_writer->IsOpen()) {
-    GetPerFrameAcousticCosts(decoded, &per_frame_loglikes);
-    per_frame_loglikes.Scale(-1 / acoustic_scale);
-    per_frame_acwt_writer->Write(utt, per_frame_loglikes);
+  if (retried_ && num_retried_ != NULL) (*num_retried_)++;
+  if (!success_) {
+    if (num_error_ != NULL) (*num_error_)++;
+    return;
   }
+  BaseFloat like = -cost_ / acoustic_scale_;
+
+  if (num_done_ != NULL) (*num_done_)++;
+  if (tot_like_ != NULL) (*tot_like_) += like;
+  if (frame_count_ != NULL) (*frame_count_) += num_frames_;
+
+  if (alignment_writer_ != NULL && alignment_writer_->IsOpen())
+    alignment_writer_->Write(utt_, alignment_);
+
+  if (scores_writer_ != NULL && scores_writer_->IsOpen())
+    scores_writer_->Write(utt_, -cost_);
+
+  if (per_frame_acwt_writer_ != NULL && per_frame_acwt_writer_->IsOpen())
+    per_frame_acwt_writer_->Write(utt_, per_frame_loglikes_);
+}
+
+void AlignUtteranceWrapper(
+    const AlignConfig &config,
+    const std::string &utt,
+    BaseFloat acoustic_scale,  // affects scores written to scores_writer, if
+                               // present
+    fst::VectorFst<fst::StdArc> *fst,  // non-const in case config.careful ==
+                                       // true.
+    DecodableInterface *decodable,  // not const but is really an input.
+    Int32VectorWriter *alignment_writer,
+    BaseFloatWriter *scores_writer,
+    int32 *num_done,
+    int32 *num_error,
+    int32 *num_retried,
+    double *tot_like,
+    int64 *frame_count,
+    BaseFloatVectorWriter *per_frame_acwt_writer) {
+  AlignUtteranceClass aligner(config, utt, acoustic_scale, fst, decodable,
+                              alignment_writer, scores_writer, num_done,
+                              num_error, num_retried, tot_like, frame_count,
+                              per_frame_acwt_writer);
+  aligner();
+  // The output happens in the destructor.
 }
 
 } // end namespace kaldi.
@@ -74,6 +74,60 @@ void AlignUtteranceWrapper(
     BaseFloatVectorWriter *per_frame_acwt_writer = NULL);
 
 
+/// This class does the same job as the function AlignUtteranceWrapper (which
+/// is implemented using it), but in a way that allows us to build a
+/// multi-threaded command line program more easily.  The alignment takes
+/// place in operator (), and the output and the updates of the statistics
+/// happen in the destructor.  Unlike DecodeUtteranceLatticeFasterClass, this
+/// does not take ownership of "fst" or "decodable"; they must not be deleted
+/// before operator () has been called.
+class AlignUtteranceClass {
+ public:
+  // The arguments are as for AlignUtteranceWrapper.
+  AlignUtteranceClass(
+      const AlignConfig &config,
+      const std::string &utt,
+      BaseFloat acoustic_scale,
+      fst::VectorFst<fst::StdArc> *fst,
+      DecodableInterface *decodable,
+      Int32VectorWriter *alignment_writer,
+      BaseFloatWriter *scores_writer,
+      int32 *num_done,
+      int32 *num_error,
+      int32 *num_retried,
+      double *tot_like,
+      int64 *frame_count,
+      BaseFloatVectorWriter *per_frame_acwt_writer = NULL);
+  void operator () ();  // The alignment happens here.
+  ~AlignUtteranceClass();  // Output happens here.
+ private:
+  // The following variables correspond to inputs:
+  const AlignConfig &config_;
+  std::string utt_;
+  BaseFloat acoustic_scale_;
+  fst::VectorFst<fst::StdArc> *fst_;
+  DecodableInterface *decodable_;
+  Int32VectorWriter *alignment_writer_;
+  BaseFloatWriter *scores_writer_;
+  int32 *num_done_;
+  int32 *num_error_;
+  int32 *num_retried_;
+  double *tot_like_;
+  int64 *frame_count_;
+  BaseFloatVectorWriter *per_frame_acwt_writer_;
+
+  // The following variables are stored by the computation.
+  bool computed_;  // operator () was called.
+  bool success_;  // alignment succeeded.
+  bool retried_;  // the retry beam was used.
+  int32 num_frames_;
+  std::vector<int32> alignment_;
+  BaseFloat cost_;  // total (graph + acoustic) cost of the best path.
+  Vector<BaseFloat> per_frame_loglikes_;  // only set if
+                                          // per_frame_acwt_writer is open.
+};
+
+
 
 /// This function modifies the decoding graph for what we call "careful
 /// alignment".  The problem we are trying to solve is that if the decoding eats
@@ -0,0 +1,139 @@
+// decoder/lattice-faster-online-decoder-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "decoder/lattice-faster-online-decoder.h"
+#include "decoder/decodable-matrix.h"
+#include "hmm/hmm-test-utils.h"
+
+namespace kaldi {
+
+// Creates a random decoding graph with 'num_states' states, all of them
+// final, and no epsilon arcs.  Every arc into state d has, as its input label,
+// a transition-id tid with tid % num_states == d, so that if on some frame
+// only those transition-ids have a reasonable likelihood, only one token
+// (for state d) survives that frame.
+static void RandDecodingGraph(int32 num_states, int32 num_transition_ids,
+                              fst::VectorFst<fst::StdArc> *graph) {
+  typedef fst::StdArc Arc;
+  graph->DeleteStates();
+  for (int32 s = 0; s < num_states; s++) {
+    graph->AddState();
+    graph->SetFinal(s, Arc::Weight(RandUniform()));
+  }
+  graph->SetStart(0);
+  for (int32 s = 0; s < num_states; s++) {
+    for (int32 d = 0; d < num_states; d++) {
+      int32 num_arcs = RandInt(1, 2);
+      for (int32 n = 0; n < num_arcs; n++) {
+        int32 tid;
+        do {
+          tid = RandInt(1, num_transition_ids);
+        } while (tid % num_states != d);
+        int32 word = (RandInt(0, 2) == 0 ? 0 : RandInt(1, 4));
+        graph->AddArc(s, Arc(tid, word, Arc::Weight(RandUniform()), d));
+      }
+    }
+  }
+}
+
+// Decodes random likelihoods in chunks with LatticeFasterOnlineDecoder,
+// calling LatticeSegmentDeterminizer::Update() after each chunk as
+// SingleUtteranceNnet3Decoder::UpdateLatticeDeterminization() does, and checks
+// that the lattice it outputs, made of determinized segments of the raw
+// lattice (see GetRawLatticeSegment()), is equivalent to determinizing the
+// whole raw lattice.
+void UnitTestLatticeSegmentDeterminizer() {
+  ContextDependency *ctx_dep = NULL;
+  TransitionModel *trans_model = GenRandTransitionModel(&ctx_dep);
+  int32 num_states = 3,
+      num_transition_ids = trans_model->NumTransitionIds();
+  KALDI_ASSERT(num_transition_ids >= num_states);
+  fst::VectorFst<fst::StdArc> graph;
+  RandDecodingGraph(num_states, num_transition_ids, &graph);
+
+  // On about one frame in four, only the transition-ids into one state of the
+  // graph are likely; the beam prunes the others, which makes the frame after
+  // it one on which the lattice can be split.
+  int32 num_frames = RandInt(30, 60);
+  Matrix<BaseFloat> loglikes(num_frames, num_transition_ids);
+  loglikes.SetRandn();
+  for (int32 t = 0; t < num_frames; t++) {
+    if (t % 4 != 3)
+      continue;
+    int32 d = RandInt(0, num_states - 1);
+    for (int32 tid = 1; tid <= num_transition_ids; tid++)
+      if (tid % num_states != d)
+        loglikes(t, tid - 1) = -1000.0;
+  }
+  DecodableMatrixScaled decodable(loglikes, 1.0);
+
+  // The lattice beam is large enough that pruning the pieces separately makes
+  // no difference.
+  LatticeFasterDecoderConfig config;
+  config.beam = 10.0;
+  config.lattice_beam = 1000.0;
+  config.prune_interval = RandInt(1, 10);
+  LatticeFasterOnlineDecoder decoder(graph, config);
+  LatticeSegmentDeterminizer<fst::StdFst> determinizer(*trans_model, config);
+  decoder.InitDecoding();
+  determinizer.Init();
+  int32 min_chunk_size = RandInt(1, 5);
+  while (decoder.NumFramesDecoded() < num_frames) {
+    decoder.AdvanceDecoding(&decodable, RandInt(1, 10));
+    int32 num_frames_determinized =
+        determinizer.Update(decoder, min_chunk_size);
+    KALDI_ASSERT(num_frames_determinized ==
+                 determinizer.NumFramesDeterminized() &&
+                 num_frames_determinized < decoder.NumFramesDecoded());
+  }
+  KALDI_ASSERT(determinizer.NumFramesDeterminized() > 0);
+
+  bool use_final_probs = (RandInt(0, 1) == 0);
+  if (use_final_probs && RandInt(0, 1) == 0)
+    decoder.FinalizeDecoding();
+  CompactLattice clat;
+  determinizer.GetLattice(decoder, use_final_probs, &clat);
+
+  Lattice raw_lat;
+  KALDI_ASSERT(decoder.GetRawLattice(&raw_lat, use_final_probs));
+  CompactLattice ref_clat;
+  DeterminizeLatticePhonePrunedWrapper(*trans_model, &raw_lat,
+                                       config.lattice_beam, &ref_clat,
+                                       config.det_opts);
+  KALDI_ASSERT(clat.NumStates() > 0 && ref_clat.NumStates() > 0);
+  KALDI_ASSERT(fst::RandEquivalent(clat, ref_clat, 5/*paths*/,
+                                   0.01/*delta*/, Rand()/*seed*/,
+                                   200/*path length, max*/));
+
+  // After Init() the determinizer starts again from the first frame.
+  decoder.InitDecoding();
+  determinizer.Init();
+  KALDI_ASSERT(determinizer.NumFramesDeterminized() == 0);
+
+  delete trans_model;
+  delete ctx_dep;
+}
+
+}  // end namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 10; i++)
+    UnitTestLatticeSegmentDeterminizer();
+  std::cout << "Test OK.\n";
+  return 0;
+}
@@ -273,6 +273,182 @@ bool LatticeFasterOnlineDecoderTpl<FST>::GetRawLatticePruned(
 }
 
 
+template <typename FST>
+bool LatticeFasterOnlineDecoderTpl<FST>::IsSingleTokenFrame(int32 frame) const {
+  KALDI_ASSERT(frame >= 0 && frame < this->active_toks_.size());
+  Token *toks = this->active_toks_[frame].toks;
+  return (toks != NULL && toks->next == NULL);
+}
+
+template <typename FST>
+bool LatticeFasterOnlineDecoderTpl<FST>::GetRawLatticeSegment(
+    int32 begin_frame,
+    int32 end_frame,
+    bool use_final_probs,
+    Lattice *ofst) const {
+  typedef LatticeArc Arc;
+  typedef Arc::StateId StateId;
+  typedef Arc::Weight Weight;
+
+  int32 num_frames = this->NumFramesDecoded();
+  KALDI_ASSERT(num_frames > 0 && begin_frame >= 0 &&
+               begin_frame < end_frame && end_frame <= num_frames);
+  if (begin_frame > 0 && !IsSingleTokenFrame(begin_frame))
+    KALDI_ERR << "GetRawLatticeSegment: frame " << begin_frame
+              << " has more than one active token.";
+  bool is_last_segment = (end_frame == num_frames);
+  if (!is_last_segment && !IsSingleTokenFrame(end_frame))
+    KALDI_ERR << "GetRawLatticeSegment: frame " << end_frame
+              << " has more than one active token.";
+
+  if (this->decoding_finalized_ && is_last_segment && !use_final_probs)
+    KALDI_ERR << "You cannot call FinalizeDecoding() and then call "
+              << "GetRawLatticeSegment() with use_final_probs == false";
+
+  unordered_map<Token*, BaseFloat> final_costs_local;
+  const unordered_map<Token*, BaseFloat> &final_costs =
+      (this->decoding_finalized_ ? this->final_costs_ : final_costs_local);
+  if (is_last_segment && !this->decoding_finalized_ && use_final_probs)
+    this->ComputeFinalCosts(&final_costs_local, NULL, NULL);
+
+  ofst->DeleteStates();
+  unordered_map<Token*, StateId> tok_map;
+  std::vector<Token*> token_list;
+  for (int32 f = begin_frame; f <= end_frame; f++) {
+    if (this->active_toks_[f].toks == NULL) {
+      KALDI_WARN << "GetRawLatticeSegment: no tokens active on frame " << f
+                 << ": not producing lattice.\n";
+      return false;
+    }
+    this->TopSortTokens(this->active_toks_[f].toks, &token_list);
+    for (size_t i = 0; i < token_list.size(); i++)
+      if (token_list[i] != NULL)
+        tok_map[token_list[i]] = ofst->AddState();
+  }
+  // As in GetRawLattice(), the tokens were topologically sorted so state zero
+  // is the start state.
+  ofst->SetStart(0);
+
+  for (int32 f = begin_frame; f <= end_frame; f++) {
+    for (Token *tok = this->active_toks_[f].toks; tok != NULL;
+         tok = tok->next) {
+      StateId cur_state = tok_map[tok];
+      // On the last frame of a non-final segment there is only one token, and
+      // all its links lead to the next frame, which belongs to the next
+      // segment.
+      if (f < end_frame || is_last_segment) {
+        for (ForwardLinkT *l = tok->links; l != NULL; l = l->next) {
+          typename unordered_map<Token*, StateId>::const_iterator
+              iter = tok_map.find(l->next_tok);
+          KALDI_ASSERT(iter != tok_map.end());
+          BaseFloat cost_offset = 0.0;
+          if (l->ilabel != 0) {  // emitting..
+            KALDI_ASSERT(f >= 0 && f < this->cost_offsets_.size());
+            cost_offset = this->cost_offsets_[f];
+          }
+          Arc arc(l->ilabel, l->olabel,
+                  Weight(l->graph_cost, l->acoustic_cost - cost_offset),
+                  iter->second);
+          ofst->AddArc(cur_state, arc);
+        }
+      }
+      if (f == end_frame) {
+        if (is_last_segment && use_final_probs && !final_costs.empty()) {
+          typename unordered_map<Token*, BaseFloat>::const_iterator
+              iter = final_costs.find(tok);
+          if (iter != final_costs.end())
+            ofst->SetFinal(cur_state, LatticeWeight(iter->second, 0));
+        } else {
+          ofst->SetFinal(cur_state, LatticeWeight::One());
+        }
+      }
+    }
+  }
+  return (ofst->NumStates() > 0);
+}
+
+
+template <typename FST>
+LatticeSegmentDeterminizer<FST>::LatticeSegmentDeterminizer(
+    const TransitionModel &trans_model,
+    const LatticeFasterDecoderConfig &config):
+    trans_model_(trans_model), config_(config),
+    num_frames_determinized_(0) { }
+
+template <typename FST>
+void LatticeSegmentDeterminizer<FST>::Init() {
+  determinized_prefix_.DeleteStates();
+  num_frames_determinized_ = 0;
+}
+
+template <typename FST>
+int32 LatticeSegmentDeterminizer<FST>::Update(
+    const LatticeFasterOnlineDecoderTpl<FST> &decoder,
+    int32 min_chunk_size) {
+  KALDI_ASSERT(min_chunk_size > 0);
+  int32 num_frames_decoded = decoder.NumFramesDecoded(),
+      first_frame = num_frames_determinized_ + min_chunk_size;
+  if (first_frame >= num_frames_decoded)
+    return num_frames_determinized_;
+  // We search backwards for the most recent frame with a single active token,
+  // so that as much as possible is determinized now.  The most recently
+  // decoded frame is excluded, since the chunk after the last split point must
+  // be nonempty.
+  int32 split_frame = -1;
+  for (int32 f = num_frames_decoded - 1; f >= first_frame; f--) {
+    if (decoder.IsSingleTokenFrame(f)) {
+      split_frame = f;
+      break;
+    }
+  }
+  if (split_frame < 0)
+    return num_frames_determinized_;
+
+  Lattice raw_lat;
+  if (!decoder.GetRawLatticeSegment(num_frames_determinized_, split_frame,
+                                    false, &raw_lat))
+    return num_frames_determinized_;
+  CompactLattice clat;
+  DeterminizeLatticePhonePrunedWrapper(
+      trans_model_, &raw_lat, config_.lattice_beam, &clat, config_.det_opts);
+  if (clat.NumStates() == 0) {
+    KALDI_WARN << "Empty lattice determinizing frames "
+               << num_frames_determinized_ << " to " << split_frame;
+    return num_frames_determinized_;
+  }
+  if (num_frames_determinized_ == 0)
+    determinized_prefix_ = clat;
+  else
+    fst::Concat(&determinized_prefix_, clat);
+  num_frames_determinized_ = split_frame;
+  KALDI_VLOG(3) << "Determinized lattice up to frame " << split_frame;
+  return num_frames_determinized_;
+}
+
+template <typename FST>
+void LatticeSegmentDeterminizer<FST>::GetLattice(
+    const LatticeFasterOnlineDecoderTpl<FST> &decoder,
+    bool use_final_probs,
+    CompactLattice *clat) const {
+  Lattice raw_lat;
+  if (num_frames_determinized_ == 0)
+    decoder.GetRawLattice(&raw_lat, use_final_probs);
+  else
+    decoder.GetRawLatticeSegment(num_frames_determinized_,
+                                 decoder.NumFramesDecoded(),
+                                 use_final_probs, &raw_lat);
+  DeterminizeLatticePhonePrunedWrapper(
+      trans_model_, &raw_lat, config_.lattice_beam, clat, config_.det_opts);
+
+  if (num_frames_determinized_ > 0) {
+    // Prepend the part of the lattice that was already determinized.
+    if (clat->NumStates() == 0)
+      KALDI_WARN << "Empty lattice after the already-determinized frames.";
+    else
+      fst::Concat(determinized_prefix_, clat);
+  }
+}
+
 
 // Instantiate the template for the FST types that we'll need.
 template class LatticeFasterOnlineDecoderTpl<fst::Fst<fst::StdArc> >;
@@ -280,6 +456,11 @@ template class LatticeFasterOnlineDecoderTpl<fst::VectorFst<fst::StdArc> >;
 template class LatticeFasterOnlineDecoderTpl<fst::ConstFst<fst::StdArc> >;
 template class LatticeFasterOnlineDecoderTpl<fst::ConstGrammarFst >;
 template class LatticeFasterOnlineDecoderTpl<fst::VectorGrammarFst >;
+template class LatticeSegmentDeterminizer<fst::Fst<fst::StdArc> >;
+template class LatticeSegmentDeterminizer<fst::VectorFst<fst::StdArc> >;
+template class LatticeSegmentDeterminizer<fst::ConstFst<fst::StdArc> >;
+template class LatticeSegmentDeterminizer<fst::ConstGrammarFst >;
+template class LatticeSegmentDeterminizer<fst::VectorGrammarFst >;
 
 
 } // end namespace kaldi.
@@ -34,6 +34,7 @@
 #include "fstext/fstext-lib.h"
 #include "lat/determinize-lattice-pruned.h"
 #include "lat/kaldi-lattice.h"
+#include "hmm/transition-model.h"
 #include "decoder/lattice-faster-decoder.h"
 
 namespace kaldi {
@@ -136,12 +137,89 @@ class LatticeFasterOnlineDecoderTpl:
                            bool use_final_probs,
                            BaseFloat beam) const;
 
+  /// Returns true if exactly one token is active on frame 'frame' (where
+  /// 'frame' is an index into the frames of the lattice, i.e. in the range
+  /// [0, NumFramesDecoded()]).  Since tokens are only ever removed from a frame
+  /// once it has been decoded, such a frame is a point that every path through
+  /// the final lattice must pass through; the parts of the lattice before and
+  /// after it can be determinized separately.  See GetRawLatticeSegment().
+  bool IsSingleTokenFrame(int32 frame) const;
+
+  /// Outputs the part of the raw lattice (as GetRawLattice() would produce it)
+  /// that covers frames begin_frame through end_frame.  'begin_frame' must be
+  /// zero or a frame for which IsSingleTokenFrame() returns true; its (first)
+  /// token becomes the start state.  If end_frame == NumFramesDecoded() the
+  /// final-probs are treated as in GetRawLattice(); otherwise 'end_frame' must
+  /// be a frame for which IsSingleTokenFrame() returns true, and that token
+  /// becomes the only final state, with final-prob One().  Concatenating the
+  /// lattices for [0, t] and [t, NumFramesDecoded()] gives a lattice
+  /// equivalent to the one GetRawLattice() outputs.
+  bool GetRawLatticeSegment(int32 begin_frame,
+                            int32 end_frame,
+                            bool use_final_probs,
+                            Lattice *ofst) const;
+
   KALDI_DISALLOW_COPY_AND_ASSIGN(LatticeFasterOnlineDecoderTpl);
 };
 
 typedef LatticeFasterOnlineDecoderTpl<fst::StdFst> LatticeFasterOnlineDecoder;
 
 
+/**
+   LatticeSegmentDeterminizer determinizes, and stores, the part of the lattice
+   of a LatticeFasterOnlineDecoderTpl that precedes a frame on which only a
+   single token is active (see IsSingleTokenFrame()), so that when the lattice
+   is needed only the frames after that point have to be determinized.  It is
+   used by SingleUtteranceNnet3Decoder.  The lattice it outputs is equivalent
+   to determinizing the whole raw lattice with
+   DeterminizeLatticePhonePrunedWrapper(), but it may have epsilon arcs where
+   the determinized pieces were joined, and since each piece is pruned
+   separately with the lattice beam it may retain a few more paths.
+ */
+template <typename FST>
+class LatticeSegmentDeterminizer {
+ public:
+  /// "config" supplies the lattice beam and the determinization options; it
+  /// and "trans_model" must outlive this object.
+  LatticeSegmentDeterminizer(const TransitionModel &trans_model,
+                             const LatticeFasterDecoderConfig &config);
+
+  /// Forgets the determinized part; call this when you call InitDecoding() on
+  /// the decoder.
+  void Init();
+
+  /// Determinizes, and stores, the part of the lattice of "decoder" that
+  /// precedes the most recent frame on which only a single token is active,
+  /// provided that this would add at least 'min_chunk_size' frames to the
+  /// part already determinized.  Returns the number of frames covered by the
+  /// determinized part.
+  int32 Update(const LatticeFasterOnlineDecoderTpl<FST> &decoder,
+               int32 min_chunk_size);
+
+  /// Outputs the determinized lattice for all the frames decoded by
+  /// "decoder" (which must be the decoder that Update() was called with
+  /// since the last Init()); "use_final_probs" is as for
+  /// GetRawLattice().
+  void GetLattice(const LatticeFasterOnlineDecoderTpl<FST> &decoder,
+                  bool use_final_probs,
+                  CompactLattice *clat) const;
+
+  /// Returns the number of frames covered by the determinized part.
+  int32 NumFramesDeterminized() const { return num_frames_determinized_; }
+
+ private:
+  const TransitionModel &trans_model_;
+  const LatticeFasterDecoderConfig &config_;
+  // The determinized lattice for frames [0, num_frames_determinized_] of the
+  // decoder; its final state corresponds to the single token active on frame
+  // num_frames_determinized_.  Empty if num_frames_determinized_ == 0.
+  CompactLattice determinized_prefix_;
+  int32 num_frames_determinized_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(LatticeSegmentDeterminizer);
+};
+
+
 } // end namespace kaldi.
 
 #endif
@@ -0,0 +1,184 @@
+// decoder/training-graph-compiler-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "decoder/training-graph-compiler.h"
+#include "hmm/hmm-test-utils.h"
+
+namespace kaldi {
+
+// Creates a random lexicon FST (phones on the input side, words on the
+// output side) with words 1 ... num_words, each pronounced as a sequence of
+// one to three of the phones.
+static fst::VectorFst<fst::StdArc> *RandLexiconFst(
+    const std::vector<int32> &phones, int32 num_words) {
+  using fst::StdArc;
+  fst::VectorFst<StdArc> *lex_fst = new fst::VectorFst<StdArc>();
+  int32 loop_state = lex_fst->AddState();
+  lex_fst->SetStart(loop_state);
+  lex_fst->SetFinal(loop_state, StdArc::Weight::One());
+  for (int32 word = 1; word <= num_words; word++) {
+    int32 num_phones = RandInt(1, 3), cur_state = loop_state;
+    for (int32 i = 0; i < num_phones; i++) {
+      int32 phone = phones[RandInt(0, phones.size() - 1)],
+          next_state = (i + 1 == num_phones ? loop_state :
+                        lex_fst->AddState());
+      lex_fst->AddArc(cur_state, StdArc(phone, (i == 0 ? word : 0),
+                                        StdArc::Weight::One(), next_state));
+      cur_state = next_state;
+    }
+  }
+  return lex_fst;
+}
+
+// Checks the hits and misses of the graph cache of TrainingGraphCompiler,
+// including the eviction of the least recently used graph, and that the
+// graphs it outputs are the same as those compiled without the cache.
+void UnitTestTrainingGraphCompilerCache() {
+  ContextDependency *ctx_dep = NULL;
+  TransitionModel *trans_model = GenRandTransitionModel(&ctx_dep);
+  int32 num_words = 5;
+  fst::VectorFst<fst::StdArc> *lex_fst =
+      RandLexiconFst(trans_model->GetPhones(), num_words);
+  std::vector<int32> disambig_syms;
+
+  TrainingGraphCompilerOptions opts, cache_opts;
+  cache_opts.graph_cache_size = 2;
+  TrainingGraphCompiler gc(*trans_model, *ctx_dep,
+                           new fst::VectorFst<fst::StdArc>(*lex_fst),
+                           disambig_syms, opts),
+      cache_gc(*trans_model, *ctx_dep, lex_fst, disambig_syms, cache_opts);
+
+  std::vector<std::vector<int32> > transcripts(3);
+  for (size_t i = 0; i < transcripts.size(); i++) {
+    // Make the transcripts distinct by their lengths.
+    for (size_t j = 0; j <= i; j++)
+      transcripts[i].push_back(RandInt(1, num_words));
+  }
+  std::vector<fst::VectorFst<fst::StdArc> > ref_graphs(transcripts.size());
+  for (size_t i = 0; i < transcripts.size(); i++)
+    KALDI_ASSERT(gc.CompileGraphFromText(transcripts[i], &(ref_graphs[i])));
+  KALDI_ASSERT(gc.NumGraphCacheHits() == 0 && gc.NumGraphCacheMisses() == 0);
+
+  // Compile transcripts 0, 1, 0, 2, 1 one at a time.  With room for two
+  // graphs, compiling 2 evicts 1 (0 was used more recently), and compiling 1
+  // again evicts 0.
+  int32 order[] = { 0, 1, 0, 2, 1 };
+  bool expected_hit[] = { false, false, true, false, false };
+  for (int32 n = 0; n < 5; n++) {
+    int32 i = order[n];
+    int64 num_hits = cache_gc.NumGraphCacheHits(),
+        num_misses = cache_gc.NumGraphCacheMisses();
+    fst::VectorFst<fst::StdArc> graph;
+    KALDI_ASSERT(cache_gc.CompileGraphFromText(transcripts[i], &graph));
+    KALDI_ASSERT(fst::Equal(graph, ref_graphs[i]));
+    KALDI_ASSERT(cache_gc.NumGraphCacheHits() ==
+                 num_hits + (expected_hit[n] ? 1 : 0) &&
+                 cache_gc.NumGraphCacheMisses() ==
+                 num_misses + (expected_hit[n] ? 0 : 1));
+  }
+
+  // Now the cache holds 2 and 1; compile 2, 1, 0 and 0 as a batch.  The first
+  // two are hits; 0 is a miss both times, but it is only compiled once.
+  std::vector<std::vector<int32> > batch;
+  batch.push_back(transcripts[2]);
+  batch.push_back(transcripts[1]);
+  batch.push_back(transcripts[0]);
+  batch.push_back(transcripts[0]);
+  std::vector<fst::VectorFst<fst::StdArc>*> graphs;
+  KALDI_ASSERT(cache_gc.CompileGraphsFromText(batch, &graphs));
+  KALDI_ASSERT(cache_gc.NumGraphCacheHits() == 3 &&
+               cache_gc.NumGraphCacheMisses() == 6);
+  KALDI_ASSERT(graphs.size() == 4 &&
+               fst::Equal(*(graphs[0]), ref_graphs[2]) &&
+               fst::Equal(*(graphs[1]), ref_graphs[1]) &&
+               fst::Equal(*(graphs[2]), ref_graphs[0]) &&
+               fst::Equal(*(graphs[3]), ref_graphs[0]));
+  DeletePointers(&graphs);
+
+  // The batch cached 0 in place of 2, the least recently used; so 0 is now
+  // a hit and 2 a miss.
+  fst::VectorFst<fst::StdArc> graph;
+  KALDI_ASSERT(cache_gc.CompileGraphFromText(transcripts[0], &graph) &&
+               cache_gc.CompileGraphFromText(transcripts[2], &graph));
+  KALDI_ASSERT(fst::Equal(graph, ref_graphs[2]));
+  KALDI_ASSERT(cache_gc.NumGraphCacheHits() == 4 &&
+               cache_gc.NumGraphCacheMisses() == 7);
+
+  delete trans_model;
+  delete ctx_dep;
+}
+
+// Checks that CompileGraphsFromText() with num_threads = 4 outputs the same
+// graphs as compiling them one at a time, with and without the graph cache.
+void UnitTestTrainingGraphCompilerThreads() {
+  ContextDependency *ctx_dep = NULL;
+  TransitionModel *trans_model = GenRandTransitionModel(&ctx_dep);
+  int32 num_words = 5;
+  fst::VectorFst<fst::StdArc> *lex_fst =
+      RandLexiconFst(trans_model->GetPhones(), num_words);
+  std::vector<int32> disambig_syms;
+
+  TrainingGraphCompilerOptions opts, threaded_opts;
+  threaded_opts.num_threads = 4;
+  threaded_opts.graph_cache_size = RandInt(0, 1) * 4;
+  TrainingGraphCompiler gc(*trans_model, *ctx_dep,
+                           new fst::VectorFst<fst::StdArc>(*lex_fst),
+                           disambig_syms, opts),
+      threaded_gc(*trans_model, *ctx_dep, lex_fst, disambig_syms,
+                  threaded_opts);
+
+  // Some transcripts are repeated, so that with the cache some are hits.
+  int32 num_transcripts = RandInt(8, 20);
+  std::vector<std::vector<int32> > transcripts(num_transcripts);
+  for (int32 i = 0; i < num_transcripts; i++) {
+    if (i > 0 && RandInt(0, 3) == 0) {
+      transcripts[i] = transcripts[RandInt(0, i - 1)];
+    } else {
+      int32 length = RandInt(1, 6);
+      for (int32 j = 0; j < length; j++)
+        transcripts[i].push_back(RandInt(1, num_words));
+    }
+  }
+
+  // Compile the batch twice, so that with the cache the second time has hits.
+  for (int32 n = 0; n < 2; n++) {
+    std::vector<fst::VectorFst<fst::StdArc>*> graphs;
+    KALDI_ASSERT(threaded_gc.CompileGraphsFromText(transcripts, &graphs));
+    KALDI_ASSERT(graphs.size() == transcripts.size());
+    for (int32 i = 0; i < num_transcripts; i++) {
+      fst::VectorFst<fst::StdArc> ref_graph;
+      KALDI_ASSERT(gc.CompileGraphFromText(transcripts[i], &ref_graph));
+      KALDI_ASSERT(fst::Equal(*(graphs[i]), ref_graph));
+    }
+    DeletePointers(&graphs);
+  }
+
+  delete trans_model;
+  delete ctx_dep;
+}
+
+}  // end namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 5; i++) {
+    UnitTestTrainingGraphCompilerCache();
+    UnitTestTrainingGraphCompilerThreads();
+  }
+  std::cout << "Test OK.\n";
+  return 0;
+}
@@ -18,8 +18,11 @@
 // MERCHANTABLITY OR NON-INFRINGEMENT.
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
+#include <atomic>
+
 #include "decoder/training-graph-compiler.h"
 #include "hmm/hmm-utils.h" // for GetHTransducer
+#include "util/kaldi-thread.h"
 
 namespace kaldi {
 
@@ -30,7 +33,8 @@ TrainingGraphCompiler::TrainingGraphCompiler(const TransitionModel &trans_model,
                                              const std::vector<int32> &disambig_syms,
                                              const TrainingGraphCompilerOptions &opts):
     trans_model_(trans_model), ctx_dep_(ctx_dep), lex_fst_(lex_fst),
-    disambig_syms_(disambig_syms), opts_(opts) {
+    disambig_syms_(disambig_syms), num_cache_hits_(0), num_cache_misses_(0),
+    opts_(opts) {
   using namespace fst;
   const std::vector<int32> &phone_syms = trans_model_.GetPhones();  // needed to create context fst.
 
@@ -64,13 +68,65 @@ TrainingGraphCompiler::TrainingGraphCompiler(const TransitionModel &trans_model,
   }
 }
 
+TrainingGraphCompiler::~TrainingGraphCompiler() {
+  delete lex_fst_;
+  DeletePointers(&thread_caches_);
+  for (CacheType::iterator iter = graph_cache_.begin();
+       iter != graph_cache_.end(); ++iter)
+    delete iter->second.first;
+}
+
+bool TrainingGraphCompiler::GetCachedGraph(
+    const std::vector<int32> &transcript,
+    fst::VectorFst<fst::StdArc> *out_fst) {
+  if (opts_.graph_cache_size <= 0)
+    return false;
+  CacheType::iterator iter = graph_cache_.find(transcript);
+  if (iter == graph_cache_.end()) {
+    num_cache_misses_++;
+    return false;
+  }
+  num_cache_hits_++;
+  // Move it to the end of the access queue.
+  access_queue_.splice(access_queue_.end(), access_queue_,
+                       iter->second.second);
+  *out_fst = *(iter->second.first);
+  return true;
+}
+
+void TrainingGraphCompiler::CacheGraph(
+    const std::vector<int32> &transcript,
+    const fst::VectorFst<fst::StdArc> &fst) {
+  if (opts_.graph_cache_size <= 0 || graph_cache_.count(transcript) != 0)
+    return;
+  if (static_cast<int32>(graph_cache_.size()) >= opts_.graph_cache_size) {
+    // Remove the least recently used graph.
+    CacheType::iterator iter = graph_cache_.find(access_queue_.front());
+    KALDI_ASSERT(iter != graph_cache_.end());
+    delete iter->second.first;
+    graph_cache_.erase(iter);
+    access_queue_.pop_front();
+  }
+  AqType::iterator ait = access_queue_.insert(access_queue_.end(),
+                                              transcript);
+  // VectorFst copies share their states until one of them is modified, so
+  // this is cheap.
+  graph_cache_[transcript] = std::make_pair(
+      new fst::VectorFst<fst::StdArc>(fst), ait);
+}
+
 bool TrainingGraphCompiler::CompileGraphFromText(
     const std::vector<int32> &transcript,
     fst::VectorFst<fst::StdArc> *out_fst) {
   using namespace fst;
+  if (GetCachedGraph(transcript, out_fst))
+    return true;
   VectorFst<StdArc> word_fst;
   MakeLinearAcceptor(transcript, &word_fst);
-  return CompileGraph(word_fst, out_fst);
+  if (!CompileGraph(word_fst, out_fst))
+    return false;
+  CacheGraph(transcript, *out_fst);
+  return true;
 }
 
 bool TrainingGraphCompiler::CompileGraphFromLG(const fst::VectorFst<fst::StdArc> &phone2word_fst,
@@ -140,13 +196,20 @@ bool TrainingGraphCompiler::CompileGraphFromLG(const fst::VectorFst<fst::StdArc>
 
 bool TrainingGraphCompiler::CompileGraph(const fst::VectorFst<fst::StdArc> &word_fst,
                                          fst::VectorFst<fst::StdArc> *out_fst) {
+  return CompileGraphWithCache(word_fst, &lex_cache_, out_fst);
+}
+
+bool TrainingGraphCompiler::CompileGraphWithCache(
+    const fst::VectorFst<fst::StdArc> &word_fst,
+    fst::TableComposeCache<fst::Fst<fst::StdArc> > *cache,
+    fst::VectorFst<fst::StdArc> *out_fst) {
   using namespace fst;
   KALDI_ASSERT(lex_fst_ !=NULL);
   KALDI_ASSERT(out_fst != NULL);
 
   VectorFst<StdArc> phone2word_fst;
   // TableCompose more efficient than compose.
-  TableCompose(*lex_fst_, word_fst, &phone2word_fst, &lex_cache_);
+  TableCompose(*lex_fst_, word_fst, &phone2word_fst, cache);
   return CompileGraphFromLG(phone2word_fst, out_fst);
 }
 
@@ -154,28 +217,119 @@ bool TrainingGraphCompiler::CompileGraphsFromText(
     const std::vector<std::vector<int32> > &transcripts,
     std::vector<fst::VectorFst<fst::StdArc>*> *out_fsts) {
   using namespace fst;
-  std::vector<const VectorFst<StdArc>* > word_fsts(transcripts.size());
-  for (size_t i = 0; i < transcripts.size(); i++) {
-    VectorFst<StdArc> *word_fst = new VectorFst<StdArc>();
-    MakeLinearAcceptor(transcripts[i], word_fst);
-    word_fsts[i] = word_fst;
+  int32 num_graphs = transcripts.size();
+  out_fsts->resize(num_graphs, NULL);
+  // For each graph, the index into word_fsts of the graph to compile for it,
+  // or -1 if it was found in the cache.  Transcripts repeated within the
+  // batch share one entry.
+  std::vector<int32> compiled_index(num_graphs, -1);
+  std::vector<const VectorFst<StdArc>* > word_fsts;
+  std::vector<int32> first_graph;  // the graph each word_fst was made for.
+  unordered_map<std::vector<int32>, int32, VectorHasher<int32> > to_compile;
+  for (int32 i = 0; i < num_graphs; i++) {
+    VectorFst<StdArc> cached_fst;
+    if (GetCachedGraph(transcripts[i], &cached_fst)) {
+      (*out_fsts)[i] = cached_fst.Copy();
+      continue;
+    }
+    unordered_map<std::vector<int32>, int32,
+                  VectorHasher<int32> >::iterator iter =
+        to_compile.find(transcripts[i]);
+    if (iter != to_compile.end()) {
+      compiled_index[i] = iter->second;
+    } else {
+      VectorFst<StdArc> *word_fst = new VectorFst<StdArc>();
+      MakeLinearAcceptor(transcripts[i], word_fst);
+      compiled_index[i] = word_fsts.size();
+      to_compile[transcripts[i]] = word_fsts.size();
+      word_fsts.push_back(word_fst);
+      first_graph.push_back(i);
+    }
+  }
+  std::vector<VectorFst<StdArc>* > compiled_fsts;
+  bool ans = CompileGraphs(word_fsts, &compiled_fsts);
+  DeletePointers(&word_fsts);
+  if (!ans) {
+    DeletePointers(&compiled_fsts);
+    DeletePointers(out_fsts);
+    return false;
+  }
+  for (int32 i = 0; i < num_graphs; i++) {
+    int32 j = compiled_index[i];
+    if (j == -1)
+      continue;
+    if (first_graph[j] == i) {
+      (*out_fsts)[i] = compiled_fsts[j];
+      CacheGraph(transcripts[i], *(compiled_fsts[j]));
+    } else {
+      (*out_fsts)[i] = compiled_fsts[j]->Copy();
+    }
   }
-  bool ans = CompileGraphs(word_fsts, out_fsts);
-  for (size_t i = 0; i < transcripts.size(); i++)
-    delete word_fsts[i];
-  return ans;
+  return true;
 }
 
+// This class is used in CompileGraphs() to compile the graphs in parallel.
+// The threads take the next graph to compile from a shared counter, and each
+// thread uses its own matcher cache for the composition with the lexicon.
+class CompileGraphsClass: public MultiThreadable {
+ public:
+  CompileGraphsClass(
+      TrainingGraphCompiler *gc,
+      const std::vector<const fst::VectorFst<fst::StdArc>* > &word_fsts,
+      std::atomic<int32> *next_graph,
+      std::atomic<bool> *failed,
+      std::vector<fst::VectorFst<fst::StdArc>* > *out_fsts):
+      gc_(gc), word_fsts_(word_fsts), next_graph_(next_graph),
+      failed_(failed), out_fsts_(out_fsts) { }
+
+  void operator() () {
+    fst::TableComposeCache<fst::Fst<fst::StdArc> > *cache =
+        (thread_id_ == 0 ? &(gc_->lex_cache_) :
+         gc_->thread_caches_[thread_id_ - 1]);
+    int32 num_graphs = word_fsts_.size();
+    for (int32 i = (*next_graph_)++; i < num_graphs; i = (*next_graph_)++) {
+      fst::VectorFst<fst::StdArc> trans2word_fst;
+      if (!gc_->CompileGraphWithCache(*(word_fsts_[i]), cache,
+                                      &trans2word_fst)) {
+        *failed_ = true;
+        return;
+      }
+      (*out_fsts_)[i] = trans2word_fst.Copy();
+    }
+  }
+ private:
+  TrainingGraphCompiler *gc_;
+  const std::vector<const fst::VectorFst<fst::StdArc>* > &word_fsts_;
+  std::atomic<int32> *next_graph_;
+  std::atomic<bool> *failed_;
+  std::vector<fst::VectorFst<fst::StdArc>* > *out_fsts_;
+};
+
 bool TrainingGraphCompiler::CompileGraphs(
     const std::vector<const fst::VectorFst<fst::StdArc>* > &word_fsts,
     std::vector<fst::VectorFst<fst::StdArc>* > *out_fsts) {
   out_fsts->resize(word_fsts.size(), NULL);
-  for (size_t i = 0; i < word_fsts.size(); i++) {
-    fst::VectorFst<fst::StdArc> trans2word_fst;
-    if (!CompileGraph(*(word_fsts[i]), &trans2word_fst)) return false;
-    (*out_fsts)[i] = trans2word_fst.Copy();
+  int32 num_threads = std::min<int32>(opts_.num_threads, word_fsts.size());
+  if (num_threads <= 1) {
+    for (size_t i = 0; i < word_fsts.size(); i++) {
+      fst::VectorFst<fst::StdArc> trans2word_fst;
+      if (!CompileGraph(*(word_fsts[i]), &trans2word_fst)) return false;
+      (*out_fsts)[i] = trans2word_fst.Copy();
+    }
+    return true;
   }
-  return true;
+  // The matcher caches are kept between calls, as the tables they build for
+  // the lexicon are reused.
+  while (static_cast<int32>(thread_caches_.size()) < num_threads - 1)
+    thread_caches_.push_back(
+        new fst::TableComposeCache<fst::Fst<fst::StdArc> >());
+  std::atomic<int32> next_graph(0);
+  std::atomic<bool> failed(false);
+  CompileGraphsClass c(this, word_fsts, &next_graph, &failed, out_fsts);
+  {
+    MultiThreader<CompileGraphsClass> m(num_threads, c);
+  }
+  return !failed;
 }
 
 
@@ -20,7 +20,12 @@
 #ifndef KALDI_DECODER_TRAINING_GRAPH_COMPILER_H_
 #define KALDI_DECODER_TRAINING_GRAPH_COMPILER_H_
 
+#include <list>
+#include <utility>
+#include <vector>
+
 #include "base/kaldi-common.h"
+#include "util/stl-utils.h"
 #include "hmm/transition-model.h"
 #include "fst/fstlib.h"
 #include "fstext/fstext-lib.h"
@@ -35,6 +40,9 @@ struct TrainingGraphCompilerOptions {
   BaseFloat self_loop_scale;
   bool rm_eps;
   bool reorder;  // (Dan-style graphs)
+  int32 num_threads;  // Number of threads used in CompileGraphs(); not
+                      // registered here as only the batch programs use it.
+  int32 graph_cache_size;
 
   explicit TrainingGraphCompilerOptions(BaseFloat transition_scale = 1.0,
                                         BaseFloat self_loop_scale = 1.0,
@@ -42,7 +50,9 @@ struct TrainingGraphCompilerOptions {
       transition_scale(transition_scale),
       self_loop_scale(self_loop_scale),
       rm_eps(false),
-      reorder(b) { }
+      reorder(b),
+      num_threads(1),
+      graph_cache_size(0) { }
 
   void Register(OptionsItf *opts) {
     opts->Register("transition-scale", &transition_scale, "Scale of transition "
@@ -52,6 +62,10 @@ struct TrainingGraphCompilerOptions {
     opts->Register("reorder", &reorder, "Reorder transition ids for greater decoding efficiency.");
     opts->Register("rm-eps", &rm_eps,  "Remove [most] epsilons before minimization (only applicable "
                    "if disambig symbols present)");
+    opts->Register("graph-cache-size", &graph_cache_size, "Number of compiled "
+                   "graphs to cache, indexed by transcript, so that repeated "
+                   "transcripts are only compiled once (0 disables the "
+                   "cache).");
   }
 };
 
@@ -80,23 +94,57 @@ class TrainingGraphCompiler {
                                    fst::VectorFst<fst::StdArc> * out_fst);
 
   // CompileGraphs allows you to compile a number of graphs at the same
-  // time.  This consumes more memory but is faster.
+  // time.  This consumes more memory but is faster.  If
+  // opts.num_threads > 1, the graphs are compiled in parallel.
   bool CompileGraphs(
       const std::vector<const fst::VectorFst<fst::StdArc> *> &word_fsts,
       std::vector<fst::VectorFst<fst::StdArc> *> *out_fsts);
 
   // This version creates an FST from the text and calls CompileGraph.
+  // If opts.graph_cache_size > 0, graphs of previously seen transcripts are
+  // taken from the cache.
   bool CompileGraphFromText(const std::vector<int32> &transcript,
                             fst::VectorFst<fst::StdArc> *out_fst);
 
   // This function creates FSTs from the text and calls CompileGraphs.
+  // Transcripts that are repeated within the batch are only compiled once,
+  // and if opts.graph_cache_size > 0, graphs of transcripts seen in earlier
+  // calls are taken from the cache.
   bool CompileGraphsFromText(
       const std::vector<std::vector<int32> >  &word_grammar,
       std::vector<fst::VectorFst<fst::StdArc> *> *out_fsts);
 
 
-  ~TrainingGraphCompiler() { delete lex_fst_; }
+  // The number of lookups of transcripts in the graph cache that found,
+  // and that did not find, the graph (both are zero if
+  // opts.graph_cache_size == 0).  A transcript repeated within one call to
+  // CompileGraphsFromText() counts as a miss each time if it was not cached
+  // before the call, although it is only compiled once.
+  int64 NumGraphCacheHits() const { return num_cache_hits_; }
+  int64 NumGraphCacheMisses() const { return num_cache_misses_; }
+
+  ~TrainingGraphCompiler();
  private:
+  friend class CompileGraphsClass;
+
+  // Does the work of CompileGraph(), using "cache" for the matcher on the
+  // lexicon.  This only reads the other members, so it may be called from
+  // multiple threads at once as long as each uses its own cache.
+  bool CompileGraphWithCache(
+      const fst::VectorFst<fst::StdArc> &word_fst,
+      fst::TableComposeCache<fst::Fst<fst::StdArc> > *cache,
+      fst::VectorFst<fst::StdArc> *out_fst);
+
+  // If the graph for this transcript is in graph_cache_, outputs a copy of it
+  // to "out_fst", marks it as most recently used and returns true.
+  bool GetCachedGraph(const std::vector<int32> &transcript,
+                      fst::VectorFst<fst::StdArc> *out_fst);
+
+  // Adds a copy of the graph for this transcript to graph_cache_, removing
+  // the least recently used graph if the cache is full.
+  void CacheGraph(const std::vector<int32> &transcript,
+                  const fst::VectorFst<fst::StdArc> &fst);
+
   const TransitionModel &trans_model_;
   const ContextDependency &ctx_dep_;
   fst::VectorFst<fst::StdArc> *lex_fst_; // lexicon FST (an input; we take
@@ -107,6 +155,24 @@ class TrainingGraphCompiler {
   fst::TableComposeCache<fst::Fst<fst::StdArc> > lex_cache_;  // stores matcher..
   // this is one of Dan's extensions.
 
+  // The matcher caches used by threads 1 ... num_threads - 1 in
+  // CompileGraphs(); thread 0 uses lex_cache_.  Owned here.
+  std::vector<fst::TableComposeCache<fst::Fst<fst::StdArc> >*> thread_caches_;
+
+  // The transcripts in graph_cache_, least recently used first.
+  typedef std::list<std::vector<int32> > AqType;
+  AqType access_queue_;
+
+  // Map from transcript to pair of (compiled graph, and position in
+  // access_queue_).  The graphs are owned here.
+  typedef unordered_map<std::vector<int32>,
+                        std::pair<fst::VectorFst<fst::StdArc>*,
+                                  AqType::iterator>,
+                        VectorHasher<int32> > CacheType;
+  CacheType graph_cache_;
+  int64 num_cache_hits_;
+  int64 num_cache_misses_;
+
   TrainingGraphCompilerOptions opts_;
 };
 
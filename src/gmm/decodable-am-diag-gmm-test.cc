@@ -0,0 +1,102 @@
+// gmm/decodable-am-diag-gmm-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gmm/model-test-common.h"
+#include "gmm/decodable-am-diag-gmm.h"
+#include "base/timer.h"
+
+namespace kaldi {
+
+void InitRandAmDiagGmm(int32 dim, int32 num_pdfs, int32 max_comp,
+                       AmDiagGmm *am_gmm) {
+  for (int32 i = 0; i < num_pdfs; i++) {
+    int32 num_comp = 1 + RandInt(0, max_comp - 1);
+    DiagGmm gmm;
+    unittest::InitRandDiagGmm(dim, num_comp, &gmm);
+    am_gmm->AddPdf(gmm);
+  }
+}
+
+void UnitTestDecodableAmDiagGmmBatched() {
+  int32 dim = 1 + RandInt(0, 9), num_pdfs = 5 + RandInt(0, 9),
+      num_frames = 1 + RandInt(0, 30);
+  AmDiagGmm am_gmm;
+  InitRandAmDiagGmm(dim, num_pdfs, 10, &am_gmm);
+  Matrix<BaseFloat> feats(num_frames, dim);
+  feats.SetRandn();
+  BaseFloat log_sum_exp_prune = (RandInt(0, 1) == 0 ? -1.0 : 5.0);
+
+  AmDiagGmmBatchComputer computer(am_gmm);
+  DecodableAmDiagGmmUnmapped decodable(am_gmm, feats, log_sum_exp_prune),
+      decodable_batched(am_gmm, feats, log_sum_exp_prune);
+  decodable_batched.SetBatchComputer(&computer, 1 + RandInt(0, 9));
+
+  for (int32 t = 0; t < num_frames; t++) {
+    for (int32 n = 0; n < 5; n++) {
+      int32 pdf = RandInt(0, num_pdfs - 1);
+      BaseFloat a = decodable.LogLikelihood(t, pdf + 1),
+          b = decodable_batched.LogLikelihood(t, pdf + 1);
+      AssertEqual(a, b, 1.0e-03);
+      KALDI_ASSERT(std::abs(a - am_gmm.LogLikelihood(pdf, feats.Row(t))) <
+                   1.0e-03 * (1.0 + std::abs(a)) || log_sum_exp_prune > 0);
+    }
+  }
+}
+
+// Compares the speed of the per-pdf and batched computation, computing all
+// pdfs for every frame.
+void UnitTestDecodableAmDiagGmmBatchedSpeed() {
+  int32 dim = 40, num_pdfs = 2000, num_frames = 200;
+  AmDiagGmm am_gmm;
+  InitRandAmDiagGmm(dim, num_pdfs, 20, &am_gmm);
+  Matrix<BaseFloat> feats(num_frames, dim);
+  feats.SetRandn();
+  AmDiagGmmBatchComputer computer(am_gmm);
+  double time1, time2, sum1 = 0.0, sum2 = 0.0;
+  {
+    Timer timer;
+    DecodableAmDiagGmmUnmapped decodable(am_gmm, feats);
+    for (int32 t = 0; t < num_frames; t++)
+      for (int32 pdf = 0; pdf < num_pdfs; pdf++)
+        sum1 += decodable.LogLikelihood(t, pdf + 1);
+    time1 = timer.Elapsed();
+  }
+  {
+    Timer timer;
+    DecodableAmDiagGmmUnmapped decodable(am_gmm, feats);
+    decodable.SetBatchComputer(&computer);
+    for (int32 t = 0; t < num_frames; t++)
+      for (int32 pdf = 0; pdf < num_pdfs; pdf++)
+        sum2 += decodable.LogLikelihood(t, pdf + 1);
+    time2 = timer.Elapsed();
+  }
+  AssertEqual(sum1, sum2, 1.0e-03);
+  KALDI_LOG << "For " << am_gmm.NumGauss() << " Gaussians, per-pdf "
+            << "computation took " << time1 << "s, batched computation took "
+            << time2 << "s for " << num_frames << " frames.";
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 10; i++)
+    UnitTestDecodableAmDiagGmmBatched();
+  UnitTestDecodableAmDiagGmmBatchedSpeed();
+  std::cout << "Test OK.\n";
+  return 0;
+}
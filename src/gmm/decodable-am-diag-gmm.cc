@@ -25,6 +25,86 @@ using std::vector;
 
 namespace kaldi {
 
+AmDiagGmmBatchComputer::AmDiagGmmBatchComputer(const AmDiagGmm &am):
+    dim_(am.Dim()) {
+  int32 num_pdfs = am.NumPdfs(), dim = dim_;
+  pdf_offsets_.resize(num_pdfs + 1);
+  int32 num_gauss = 0;
+  for (int32 pdf = 0; pdf < num_pdfs; pdf++) {
+    pdf_offsets_[pdf] = num_gauss;
+    num_gauss += am.GetPdf(pdf).NumGauss();
+  }
+  pdf_offsets_[num_pdfs] = num_gauss;
+  params_.Resize(num_gauss, 2 * dim + 1, kUndefined);
+  for (int32 pdf = 0; pdf < num_pdfs; pdf++) {
+    const DiagGmm &gmm = am.GetPdf(pdf);
+    if (!gmm.valid_gconsts())
+      KALDI_ERR << "State "  << pdf  << ": Must call ComputeGconsts() "
+          "before computing likelihood.";
+    int32 offset = pdf_offsets_[pdf], n = gmm.NumGauss();
+    params_.Range(offset, n, 0, dim).CopyFromMat(gmm.means_invvars());
+    SubMatrix<BaseFloat> inv_vars_part(params_, offset, n, dim, dim);
+    inv_vars_part.CopyFromMat(gmm.inv_vars());
+    inv_vars_part.Scale(-0.5);
+    params_.Range(offset, n, 2 * dim, 1).CopyColFromVec(gmm.gconsts(), 0);
+  }
+}
+
+void AmDiagGmmBatchComputer::LogLikelihoods(
+    const MatrixBase<BaseFloat> &feats,
+    BaseFloat log_sum_exp_prune,
+    Matrix<BaseFloat> *loglikes) const {
+  int32 num_frames = feats.NumRows(), dim = dim_, num_pdfs = NumPdfs();
+  if (feats.NumCols() != dim)
+    KALDI_ERR << "Dim mismatch: data dim = "  << feats.NumCols()
+              << " vs. model dim = " << dim;
+  // The features extended as [ x, x^2, 1 ].
+  Matrix<BaseFloat> feats_ext(num_frames, 2 * dim + 1, kUndefined);
+  feats_ext.Range(0, num_frames, 0, dim).CopyFromMat(feats);
+  SubMatrix<BaseFloat> feats_sq(feats_ext, 0, num_frames, dim, dim);
+  feats_sq.CopyFromMat(feats);
+  feats_sq.ApplyPow(2.0);
+  feats_ext.Range(0, num_frames, 2 * dim, 1).Set(1.0);
+
+  Matrix<BaseFloat> gauss_loglikes(num_frames, params_.NumRows(), kUndefined);
+  gauss_loglikes.AddMatMat(1.0, feats_ext, kNoTrans, params_, kTrans, 0.0);
+
+  loglikes->Resize(num_frames, num_pdfs, kUndefined);
+  for (int32 t = 0; t < num_frames; t++) {
+    const SubVector<BaseFloat> row(gauss_loglikes, t);
+    BaseFloat *out = loglikes->RowData(t);
+    for (int32 pdf = 0; pdf < num_pdfs; pdf++) {
+      int32 offset = pdf_offsets_[pdf],
+          n = pdf_offsets_[pdf + 1] - offset;
+      BaseFloat log_sum = row.Range(offset, n).LogSumExp(log_sum_exp_prune);
+      if (KALDI_ISNAN(log_sum) || KALDI_ISINF(log_sum))
+        KALDI_ERR << "Invalid answer (overflow or invalid variances/features?)";
+      out[pdf] = log_sum;
+    }
+  }
+}
+
+void DecodableAmDiagGmmUnmapped::SetBatchComputer(
+    const AmDiagGmmBatchComputer *computer,
+    int32 frames_per_block) {
+  KALDI_ASSERT(computer == NULL ||
+               (computer->NumPdfs() == acoustic_model_.NumPdfs() &&
+                frames_per_block > 0));
+  batch_computer_ = computer;
+  frames_per_block_ = frames_per_block;
+  block_begin_ = -1;
+  block_loglikes_.Resize(0, 0);
+}
+
+void DecodableAmDiagGmmUnmapped::ComputeBlock(int32 frame) {
+  int32 num_frames = std::min(frames_per_block_, NumFramesReady() - frame);
+  SubMatrix<BaseFloat> feats(feature_matrix_, frame, num_frames,
+                             0, feature_matrix_.NumCols());
+  batch_computer_->LogLikelihoods(feats, log_sum_exp_prune_,
+                                  &block_loglikes_);
+  block_begin_ = frame;
+}
+
 BaseFloat DecodableAmDiagGmmUnmapped::LogLikelihoodZeroBased(
     int32 frame, int32 state) {
   KALDI_ASSERT(static_cast<size_t>(frame) <
@@ -32,6 +112,12 @@ BaseFloat DecodableAmDiagGmmUnmapped::LogLikelihoodZeroBased(
   KALDI_ASSERT(static_cast<size_t>(state) < static_cast<size_t>(NumIndices()) &&
                "Likely graph/model mismatch, e.g. using wrong HCLG.fst");
 
+  if (batch_computer_ != NULL) {
+    if (frame < block_begin_ || frame >= block_begin_ + block_loglikes_.NumRows())
+      ComputeBlock(frame);
+    return block_loglikes_(frame - block_begin_, state);
+  }
+
   if (log_like_cache_[state].hit_time == frame) {
     return log_like_cache_[state].log_like;  // return cached value, if found
   }
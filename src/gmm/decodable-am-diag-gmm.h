@@ -34,6 +34,41 @@
 
 namespace kaldi {
 
+/// AmDiagGmmBatchComputer computes the log-likelihoods of all the pdfs of an
+/// AmDiagGmm for a block of frames at once.  The parameters of all the
+/// Gaussians are stacked into one matrix, with rows
+/// [ means_invvars, -0.5 * inv_vars, gconst ], so that the per-Gaussian
+/// log-likelihoods for all the frames are given by a single matrix
+/// multiplication with the features extended as [ x, x^2, 1 ]; this is much
+/// faster than a matrix-vector product per pdf per frame, as long as a
+/// reasonable fraction of the pdfs is needed on each frame (as in
+/// decoding with a normal beam).  Create one of these per model and share it
+/// between the decodable objects; it is not modified by LogLikelihoods(), so
+/// it may be shared between threads.
+class AmDiagGmmBatchComputer {
+ public:
+  /// The model must have valid gconsts (see DiagGmm::ComputeGconsts()).  The
+  /// model is not referenced after the constructor returns.
+  explicit AmDiagGmmBatchComputer(const AmDiagGmm &am);
+
+  int32 NumPdfs() const { return static_cast<int32>(pdf_offsets_.size()) - 1; }
+  int32 Dim() const { return dim_; }
+
+  /// Computes the log-likelihoods of the frames in "feats" for all the pdfs;
+  /// "loglikes" is resized to feats.NumRows() by NumPdfs().
+  /// "log_sum_exp_prune" is as for DecodableAmDiagGmmUnmapped.
+  void LogLikelihoods(const MatrixBase<BaseFloat> &feats,
+                      BaseFloat log_sum_exp_prune,
+                      Matrix<BaseFloat> *loglikes) const;
+ private:
+  int32 dim_;
+  // The stacked parameters, of dimension (total #Gaussians) by (2 * dim + 1).
+  Matrix<BaseFloat> params_;
+  // pdf_offsets_[p] is the first row of params_ that belongs to pdf p;
+  // the dimension is #pdfs + 1.
+  std::vector<int32> pdf_offsets_;
+};
+
 /// DecodableAmDiagGmmUnmapped is a decodable object that
 /// takes indices that correspond to pdf-id's plus one.
 /// This may be used in future in a decoder that doesn't need
@@ -52,7 +87,8 @@ class DecodableAmDiagGmmUnmapped : public DecodableInterface {
                              const Matrix<BaseFloat> &feats,
                              BaseFloat log_sum_exp_prune = -1.0):
     acoustic_model_(am), feature_matrix_(feats),
-    previous_frame_(-1), log_sum_exp_prune_(log_sum_exp_prune), 
+    previous_frame_(-1), log_sum_exp_prune_(log_sum_exp_prune),
+    batch_computer_(NULL), frames_per_block_(0), block_begin_(-1),
     data_squared_(feats.NumCols()) {
     ResetLogLikeCache();
   }
@@ -72,10 +108,24 @@ class DecodableAmDiagGmmUnmapped : public DecodableInterface {
     return (frame == NumFramesReady() - 1);
   }
 
+  /// Makes this object compute the log-likelihoods of all the pdfs for
+  /// "frames_per_block" frames at a time using "computer" (which must have
+  /// been created from the same model and must outlive this object), instead
+  /// of one pdf at a time as they are requested.  The results are the same
+  /// up to roundoff.  The batched path lives in this class's
+  /// LogLikelihoodZeroBased(), and the computer only knows the unadapted
+  /// model, so derived classes that override LogLikelihoodZeroBased() (e.g.
+  /// the regression-tree adapted decodables) must override this too, to die.
+  virtual void SetBatchComputer(const AmDiagGmmBatchComputer *computer,
+                                int32 frames_per_block = 8);
+
  protected:
   void ResetLogLikeCache();
   virtual BaseFloat LogLikelihoodZeroBased(int32 frame, int32 state_index);
 
+  // Computes block_loglikes_ for the block of frames starting at "frame".
+  void ComputeBlock(int32 frame);
+
   const AmDiagGmm &acoustic_model_;
   const Matrix<BaseFloat> &feature_matrix_;
   int32 previous_frame_;
@@ -87,6 +137,12 @@ class DecodableAmDiagGmmUnmapped : public DecodableInterface {
     int32 hit_time;     ///< Frame for which this value is relevant
   };
   std::vector<LikelihoodCacheRecord> log_like_cache_;
+
+  // The following are only used if SetBatchComputer() was called.
+  const AmDiagGmmBatchComputer *batch_computer_;
+  int32 frames_per_block_;
+  int32 block_begin_;  // The first frame in block_loglikes_.
+  Matrix<BaseFloat> block_loglikes_;  // Indexed [frame - block_begin_][pdf].
  private:
   Vector<BaseFloat> data_squared_;  ///< Cache for fast likelihood calculation
 
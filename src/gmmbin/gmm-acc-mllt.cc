@@ -25,6 +25,67 @@
 #include "hmm/transition-model.h"
 #include "transform/mllt.h"
 #include "hmm/posterior.h"
+#include "util/kaldi-thread.h"
+
+namespace kaldi {
+
+class AccMlltTask {
+ public:
+  AccMlltTask(const TransitionModel &trans_model,
+              const AmDiagGmm &am_gmm,
+              const Matrix<BaseFloat> &feats,
+              const Posterior &posterior,
+              ObjectPool<MlltAccs> *accs,
+              int32 *num_done,
+              double *tot_like,
+              double *tot_t):
+      trans_model_(trans_model), am_gmm_(am_gmm), feats_(feats),
+      posterior_(posterior), accs_(accs), num_done_(num_done),
+      tot_like_(tot_like), tot_t_(tot_t), tot_like_this_file_(0.0),
+      tot_weight_(0.0) { }
+
+  void operator () () {
+    Posterior pdf_posterior;
+    ConvertPosteriorToPdfs(trans_model_, posterior_, &pdf_posterior);
+    MlltAccs *mllt_accs = accs_->Acquire();
+    for (size_t i = 0; i < posterior_.size(); i++) {
+      for (size_t j = 0; j < pdf_posterior[i].size(); j++) {
+        int32 pdf_id = pdf_posterior[i][j].first;
+        BaseFloat weight = pdf_posterior[i][j].second;
+
+        tot_like_this_file_ += mllt_accs->AccumulateFromGmm(
+            am_gmm_.GetPdf(pdf_id), feats_.Row(i), weight) * weight;
+        tot_weight_ += weight;
+      }
+    }
+    accs_->Release(mllt_accs);
+  }
+
+  ~AccMlltTask() {
+    (*num_done_)++;
+    KALDI_LOG << "Average like for this file is "
+              << (tot_like_this_file_/tot_weight_) << " over "
+              << tot_weight_ << " frames.";
+    *tot_like_ += tot_like_this_file_;
+    *tot_t_ += tot_weight_;
+    if (*num_done_ % 10 == 0)
+      KALDI_LOG << "Avg like per frame so far is "
+                << (*tot_like_ / *tot_t_);
+  }
+ private:
+  const TransitionModel &trans_model_;
+  const AmDiagGmm &am_gmm_;
+  Matrix<BaseFloat> feats_;
+  Posterior posterior_;
+  ObjectPool<MlltAccs> *accs_;
+  int32 *num_done_;
+  double *tot_like_;
+  double *tot_t_;
+  BaseFloat tot_like_this_file_;
+  BaseFloat tot_weight_;
+};
+
+}  // namespace kaldi
 
 
 int main(int argc, char *argv[]) {
@@ -39,7 +100,9 @@ int main(int argc, char *argv[]) {
     ParseOptions po(usage);
     bool binary = true;
     BaseFloat rand_prune = 0.25;
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
     po.Register("binary", &binary, "Write output in binary mode");
+    sequencer_config.Register(&po);
     po.Register("rand-prune", &rand_prune, "Randomized pruning parameter to speed up "
                 "accumulation (larger -> more pruning.  May exceed one).");
     po.Read(argc, argv);
@@ -66,7 +129,12 @@ int main(int argc, char *argv[]) {
       am_gmm.Read(ki.Stream(), binary);
     }
 
-    MlltAccs mllt_accs(am_gmm.Dim(), rand_prune);
+    // Each thread accumulates into its own copy of the stats.
+    std::vector<MlltAccs*> accs_list(
+        std::max<int32>(1, sequencer_config.num_threads));
+    for (size_t i = 0; i < accs_list.size(); i++)
+      accs_list[i] = new MlltAccs(am_gmm.Dim(), rand_prune);
+    ObjectPool<MlltAccs> accs(accs_list);
 
     double tot_like = 0.0;
     double tot_t = 0.0;
@@ -75,46 +143,26 @@ int main(int argc, char *argv[]) {
     RandomAccessPosteriorReader posteriors_reader(posteriors_rspecifier);
 
     int32 num_done = 0, num_no_posterior = 0, num_other_error = 0;
-    for (; !feature_reader.Done(); feature_reader.Next()) {
-      std::string key = feature_reader.Key();
-      if (!posteriors_reader.HasKey(key)) {
-        num_no_posterior++;
-      } else {
-        const Matrix<BaseFloat> &mat = feature_reader.Value();
-        const Posterior &posterior = posteriors_reader.Value(key);
-
-        if (static_cast<int32>(posterior.size()) != mat.NumRows()) {
-          KALDI_WARN << "Posterior vector has wrong size "<< (posterior.size()) << " vs. "<< (mat.NumRows());
-          num_other_error++;
-          continue;
-        }
-
-        num_done++;
-        BaseFloat tot_like_this_file = 0.0, tot_weight = 0.0;
-
-        Posterior pdf_posterior;
-        ConvertPosteriorToPdfs(trans_model, posterior, &pdf_posterior);
-        for (size_t i = 0; i < posterior.size(); i++) {
-          for (size_t j = 0; j < pdf_posterior[i].size(); j++) {
-            int32 pdf_id = pdf_posterior[i][j].first;
-            BaseFloat weight = pdf_posterior[i][j].second;
-
-            tot_like_this_file += mllt_accs.AccumulateFromGmm(am_gmm.GetPdf(pdf_id),
-                                                              mat.Row(i),
-                                                              weight) * weight;
-            tot_weight += weight;
+    {
+      TaskSequencer<AccMlltTask> sequencer(sequencer_config);
+      for (; !feature_reader.Done(); feature_reader.Next()) {
+        std::string key = feature_reader.Key();
+        if (!posteriors_reader.HasKey(key)) {
+          num_no_posterior++;
+        } else {
+          const Matrix<BaseFloat> &mat = feature_reader.Value();
+          const Posterior &posterior = posteriors_reader.Value(key);
+
+          if (static_cast<int32>(posterior.size()) != mat.NumRows()) {
+            KALDI_WARN << "Posterior vector has wrong size "<< (posterior.size()) << " vs. "<< (mat.NumRows());
+            num_other_error++;
+            continue;
           }
+          sequencer.Run(new AccMlltTask(trans_model, am_gmm, mat, posterior,
+                                        &accs, &num_done, &tot_like, &tot_t));
         }
-        KALDI_LOG << "Average like for this file is "
-                  << (tot_like_this_file/tot_weight) << " over "
-                  << tot_weight << " frames.";
-        tot_like += tot_like_this_file;
-        tot_t += tot_weight;
-        if (num_done % 10 == 0)
-          KALDI_LOG << "Avg like per frame so far is "
-                    << (tot_like/tot_t);
       }
-    }
+    }  // the destructor of "sequencer" waits for the tasks to finish.
 
     KALDI_LOG << "Done " << num_done << " files, " << num_no_posterior
               << " with no posteriors, " << num_other_error
@@ -123,7 +171,10 @@ int main(int argc, char *argv[]) {
     KALDI_LOG << "Overall avg like per frame (Gaussian only) = "
               << (tot_like/tot_t) << " over " << tot_t << " frames.";
 
-    WriteKaldiObject(mllt_accs, accs_wxfilename, binary);
+    MlltAccs *mllt_accs = accs_list[0];
+    for (size_t i = 1; i < accs_list.size(); i++)
+      mllt_accs->Add(*(accs_list[i]));
+    WriteKaldiObject(*mllt_accs, accs_wxfilename, binary);
     KALDI_LOG << "Written accs.";
     return (num_done != 0 ? 0 : 1);
   } catch(const std::exception &e) {
@@ -23,8 +23,68 @@
 #include "gmm/am-diag-gmm.h"
 #include "hmm/transition-model.h"
 #include "gmm/mle-am-diag-gmm.h"
+#include "util/kaldi-thread.h"
+
+namespace kaldi {
+
+// The stats accumulated by one thread; they are summed at the end.
+struct GmmAccsShard {
+  Vector<double> transition_accs;
+  AccumAmDiagGmm gmm_accs;
+};
+
+class AccStatsAliTask {
+ public:
+  AccStatsAliTask(const TransitionModel &trans_model,
+                  const AmDiagGmm &am_gmm,
+                  const std::string &key,
+                  const Matrix<BaseFloat> &feats,
+                  const std::vector<int32> &alignment,
+                  ObjectPool<GmmAccsShard> *shards,
+                  int32 *num_done,
+                  double *tot_like,
+                  int64 *tot_t):
+      trans_model_(trans_model), am_gmm_(am_gmm), key_(key), feats_(feats),
+      alignment_(alignment), shards_(shards), num_done_(num_done),
+      tot_like_(tot_like), tot_t_(tot_t), tot_like_this_file_(0.0) { }
+
+  void operator () () {
+    GmmAccsShard *shard = shards_->Acquire();
+    for (size_t i = 0; i < alignment_.size(); i++) {
+      int32 tid = alignment_[i],  // transition identifier.
+          pdf_id = trans_model_.TransitionIdToPdf(tid);
+      trans_model_.Accumulate(1.0, tid, &(shard->transition_accs));
+      tot_like_this_file_ += shard->gmm_accs.AccumulateForGmm(
+          am_gmm_, feats_.Row(i), pdf_id, 1.0);
+    }
+    shards_->Release(shard);
+  }
 
-
+  ~AccStatsAliTask() {
+    (*num_done_)++;
+    *tot_like_ += tot_like_this_file_;
+    *tot_t_ += alignment_.size();
+    if (*num_done_ % 50 == 0) {
+      KALDI_LOG << "Processed " << *num_done_ << " utterances; for utterance "
+                << key_ << " avg. like is "
+                << (tot_like_this_file_/alignment_.size())
+                << " over " << alignment_.size() <<" frames.";
+    }
+  }
+ private:
+  const TransitionModel &trans_model_;
+  const AmDiagGmm &am_gmm_;
+  std::string key_;
+  Matrix<BaseFloat> feats_;
+  std::vector<int32> alignment_;
+  ObjectPool<GmmAccsShard> *shards_;
+  int32 *num_done_;
+  double *tot_like_;
+  int64 *tot_t_;
+  BaseFloat tot_like_this_file_;
+};
+
+}  // namespace kaldi
 
 
 int main(int argc, char *argv[]) {
@@ -39,7 +99,9 @@ int main(int argc, char *argv[]) {
 
     ParseOptions po(usage);
     bool binary = true;
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
     po.Register("binary", &binary, "Write output in binary mode");
+    sequencer_config.Register(&po);
     po.Read(argc, argv);
 
     if (po.NumArgs() != 4) {
@@ -61,10 +123,15 @@ int main(int argc, char *argv[]) {
       am_gmm.Read(ki.Stream(), binary);
     }
 
-    Vector<double> transition_accs;
-    trans_model.InitStats(&transition_accs);
-    AccumAmDiagGmm gmm_accs;
-    gmm_accs.Init(am_gmm, kGmmAll);
+    // Each thread accumulates into its own copy of the stats.
+    std::vector<GmmAccsShard*> shard_list(
+        std::max<int32>(1, sequencer_config.num_threads));
+    for (size_t i = 0; i < shard_list.size(); i++) {
+      shard_list[i] = new GmmAccsShard();
+      trans_model.InitStats(&(shard_list[i]->transition_accs));
+      shard_list[i]->gmm_accs.Init(am_gmm, kGmmAll);
+    }
+    ObjectPool<GmmAccsShard> shards(shard_list);
 
     double tot_like = 0.0;
     kaldi::int64 tot_t = 0;
@@ -73,52 +140,44 @@ int main(int argc, char *argv[]) {
     RandomAccessInt32VectorReader alignments_reader(alignments_rspecifier);
 
     int32 num_done = 0, num_err = 0;
-    for (; !feature_reader.Done(); feature_reader.Next()) {
-      std::string key = feature_reader.Key();
-      if (!alignments_reader.HasKey(key)) {
-        KALDI_WARN << "No alignment for utterance " << key;
-        num_err++;
-      } else {
-        const Matrix<BaseFloat> &mat = feature_reader.Value();
-        const std::vector<int32> &alignment = alignments_reader.Value(key);
-
-        if (alignment.size() != mat.NumRows()) {
-          KALDI_WARN << "Alignments has wrong size " << (alignment.size())
-                     << " vs. " << (mat.NumRows());
+    {
+      TaskSequencer<AccStatsAliTask> sequencer(sequencer_config);
+      for (; !feature_reader.Done(); feature_reader.Next()) {
+        std::string key = feature_reader.Key();
+        if (!alignments_reader.HasKey(key)) {
+          KALDI_WARN << "No alignment for utterance " << key;
           num_err++;
-          continue;
-        }
-
-        num_done++;
-        BaseFloat tot_like_this_file = 0.0;
-
-        for (size_t i = 0; i < alignment.size(); i++) {
-          int32 tid = alignment[i],  // transition identifier.
-              pdf_id = trans_model.TransitionIdToPdf(tid);
-          trans_model.Accumulate(1.0, tid, &transition_accs);
-          tot_like_this_file += gmm_accs.AccumulateForGmm(am_gmm, mat.Row(i),
-                                                          pdf_id, 1.0);
-        }
-        tot_like += tot_like_this_file;
-        tot_t += alignment.size();
-        if (num_done % 50 == 0) {
-          KALDI_LOG << "Processed " << num_done << " utterances; for utterance "
-                    << key << " avg. like is "
-                    << (tot_like_this_file/alignment.size())
-                    << " over " << alignment.size() <<" frames.";
+        } else {
+          const Matrix<BaseFloat> &mat = feature_reader.Value();
+          const std::vector<int32> &alignment = alignments_reader.Value(key);
+
+          if (alignment.size() != mat.NumRows()) {
+            KALDI_WARN << "Alignments has wrong size " << (alignment.size())
+                       << " vs. " << (mat.NumRows());
+            num_err++;
+            continue;
+          }
+          sequencer.Run(new AccStatsAliTask(trans_model, am_gmm, key, mat,
+                                            alignment, &shards, &num_done,
+                                            &tot_like, &tot_t));
         }
       }
-    }
+    }  // the destructor of "sequencer" waits for the tasks to finish.
     KALDI_LOG << "Done " << num_done << " files, " << num_err
               << " with errors.";
 
     KALDI_LOG << "Overall avg like per frame (Gaussian only) = "
               << (tot_like/tot_t) << " over " << tot_t << " frames.";
 
+    GmmAccsShard *total = shard_list[0];
+    for (size_t i = 1; i < shard_list.size(); i++) {
+      total->transition_accs.AddVec(1.0, shard_list[i]->transition_accs);
+      total->gmm_accs.Add(1.0, shard_list[i]->gmm_accs);
+    }
     {
       Output ko(accs_wxfilename, binary);
-      transition_accs.Write(ko.Stream(), binary);
-      gmm_accs.Write(ko.Stream(), binary);
+      total->transition_accs.Write(ko.Stream(), binary);
+      total->gmm_accs.Write(ko.Stream(), binary);
     }
     KALDI_LOG << "Written accs.";
     if (num_done != 0)
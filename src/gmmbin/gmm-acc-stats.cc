@@ -25,6 +25,81 @@
 #include "hmm/transition-model.h"
 #include "gmm/mle-am-diag-gmm.h"
 #include "hmm/posterior.h"
+#include "util/kaldi-thread.h"
+
+namespace kaldi {
+
+// The stats accumulated by one thread; they are summed at the end.
+struct GmmAccsShard {
+  Vector<double> transition_accs;
+  AccumAmDiagGmm gmm_accs;
+};
+
+class AccStatsTask {
+ public:
+  AccStatsTask(const TransitionModel &trans_model,
+               const AmDiagGmm &am_gmm,
+               const std::string &key,
+               const Matrix<BaseFloat> &feats,
+               const Posterior &posterior,
+               ObjectPool<GmmAccsShard> *shards,
+               int32 *num_done,
+               double *tot_like,
+               double *tot_t):
+      trans_model_(trans_model), am_gmm_(am_gmm), key_(key), feats_(feats),
+      posterior_(posterior), shards_(shards), num_done_(num_done),
+      tot_like_(tot_like), tot_t_(tot_t), tot_like_this_file_(0.0),
+      tot_weight_(0.0) { }
+
+  void operator () () {
+    Posterior pdf_posterior;
+    ConvertPosteriorToPdfs(trans_model_, posterior_, &pdf_posterior);
+    GmmAccsShard *shard = shards_->Acquire();
+    for (size_t i = 0; i < posterior_.size(); i++) {
+      // Accumulates for GMM.
+      for (size_t j = 0; j < pdf_posterior[i].size(); j++) {
+        int32 pdf_id = pdf_posterior[i][j].first;
+        BaseFloat weight = pdf_posterior[i][j].second;
+        tot_like_this_file_ += shard->gmm_accs.AccumulateForGmm(
+            am_gmm_, feats_.Row(i), pdf_id, weight) * weight;
+        tot_weight_ += weight;
+      }
+
+      // Accumulates for transitions.
+      for (size_t j = 0; j < posterior_[i].size(); j++) {
+        int32 tid = posterior_[i][j].first;
+        BaseFloat weight = posterior_[i][j].second;
+        trans_model_.Accumulate(weight, tid, &(shard->transition_accs));
+      }
+    }
+    shards_->Release(shard);
+  }
+
+  ~AccStatsTask() {
+    (*num_done_)++;
+    if (*num_done_ % 50 == 0) {
+      KALDI_LOG << "Processed " << *num_done_ << " utterances; for utterance "
+                << key_ << " avg. like is " << (tot_like_this_file_/tot_weight_)
+                << " over " << tot_weight_ <<" frames.";
+    }
+    *tot_like_ += tot_like_this_file_;
+    *tot_t_ += tot_weight_;
+  }
+ private:
+  const TransitionModel &trans_model_;
+  const AmDiagGmm &am_gmm_;
+  std::string key_;
+  Matrix<BaseFloat> feats_;
+  Posterior posterior_;
+  ObjectPool<GmmAccsShard> *shards_;
+  int32 *num_done_;
+  double *tot_like_;
+  double *tot_t_;
+  BaseFloat tot_like_this_file_;
+  BaseFloat tot_weight_;
+};
+
+}  // namespace kaldi
 
 
 int main(int argc, char *argv[]) {
@@ -42,9 +117,11 @@ int main(int argc, char *argv[]) {
     bool binary = true;
     std::string update_flags_str = "mvwt"; // note: t is ignored, we acc
     // transition stats regardless.
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
     po.Register("binary", &binary, "Write output in binary mode");
     po.Register("update-flags", &update_flags_str, "Which GMM parameters will be "
                 "updated: subset of mvwt.");
+    sequencer_config.Register(&po);
     po.Read(argc, argv);
 
     if (po.NumArgs() != 4) {
@@ -67,10 +144,15 @@ int main(int argc, char *argv[]) {
       am_gmm.Read(ki.Stream(), binary);
     }
 
-    Vector<double> transition_accs;
-    trans_model.InitStats(&transition_accs);
-    AccumAmDiagGmm gmm_accs;
-    gmm_accs.Init(am_gmm, StringToGmmFlags(update_flags_str));
+    // Each thread accumulates into its own copy of the stats.
+    std::vector<GmmAccsShard*> shard_list(
+        std::max<int32>(1, sequencer_config.num_threads));
+    for (size_t i = 0; i < shard_list.size(); i++) {
+      shard_list[i] = new GmmAccsShard();
+      trans_model.InitStats(&(shard_list[i]->transition_accs));
+      shard_list[i]->gmm_accs.Init(am_gmm, StringToGmmFlags(update_flags_str));
+    }
+    ObjectPool<GmmAccsShard> shards(shard_list);
 
     double tot_like = 0.0;
     double tot_t = 0.0;
@@ -79,54 +161,30 @@ int main(int argc, char *argv[]) {
     RandomAccessPosteriorReader posteriors_reader(posteriors_rspecifier);
 
     int32 num_done = 0, num_err = 0;
-    for (; !feature_reader.Done(); feature_reader.Next()) {
-      std::string key = feature_reader.Key();
-      if (!posteriors_reader.HasKey(key)) {
-        KALDI_WARN << "Could not find posteriors for utterance " << key;
-        num_err++;
-      } else {
-        const Matrix<BaseFloat> &mat = feature_reader.Value();
-        const Posterior &posterior = posteriors_reader.Value(key);
-
-        if (static_cast<int32>(posterior.size()) != mat.NumRows()) {
-          KALDI_WARN << "Posterior vector has wrong size " 
-                     << (posterior.size()) << " vs. "
-                     << (mat.NumRows());
+    {
+      TaskSequencer<AccStatsTask> sequencer(sequencer_config);
+      for (; !feature_reader.Done(); feature_reader.Next()) {
+        std::string key = feature_reader.Key();
+        if (!posteriors_reader.HasKey(key)) {
+          KALDI_WARN << "Could not find posteriors for utterance " << key;
           num_err++;
-          continue;
-        }
-
-        num_done++;
-        BaseFloat tot_like_this_file = 0.0, tot_weight = 0.0;
-
-        Posterior pdf_posterior;
-        ConvertPosteriorToPdfs(trans_model, posterior, &pdf_posterior);
-        for (size_t i = 0; i < posterior.size(); i++) {
-          // Accumulates for GMM.
-          for (size_t j = 0; j < pdf_posterior[i].size(); j++) {
-            int32 pdf_id = pdf_posterior[i][j].first;
-            BaseFloat weight = pdf_posterior[i][j].second;
-            tot_like_this_file += gmm_accs.AccumulateForGmm(am_gmm, mat.Row(i), pdf_id, weight)
-                * weight;
-            tot_weight += weight;
-          }
-
-          // Accumulates for transitions.
-          for (size_t j = 0; j < posterior[i].size(); j++) {
-            int32 tid = posterior[i][j].first;
-            BaseFloat weight = posterior[i][j].second;
-            trans_model.Accumulate(weight, tid, &transition_accs);
+        } else {
+          const Matrix<BaseFloat> &mat = feature_reader.Value();
+          const Posterior &posterior = posteriors_reader.Value(key);
+
+          if (static_cast<int32>(posterior.size()) != mat.NumRows()) {
+            KALDI_WARN << "Posterior vector has wrong size "
+                       << (posterior.size()) << " vs. "
+                       << (mat.NumRows());
+            num_err++;
+            continue;
           }
+          sequencer.Run(new AccStatsTask(trans_model, am_gmm, key, mat,
+                                         posterior, &shards, &num_done,
+                                         &tot_like, &tot_t));
         }
-        if (num_done % 50 == 0) {
-          KALDI_LOG << "Processed " << num_done << " utterances; for utterance "
-                    << key << " avg. like is " << (tot_like_this_file/tot_weight)
-                    << " over " << tot_weight <<" frames.";
-        }
-        tot_like += tot_like_this_file;
-        tot_t += tot_weight;
       }
-    }
+    }  // the destructor of "sequencer" waits for the tasks to finish.
 
     KALDI_LOG << "Done " << num_done << " files, " << num_err
               << " with errors.";
@@ -134,10 +192,15 @@ int main(int argc, char *argv[]) {
     KALDI_LOG << "Overall avg like per frame (Gaussian only) = "
               << (tot_like/tot_t) << " over " << tot_t << " frames.";
 
+    GmmAccsShard *total = shard_list[0];
+    for (size_t i = 1; i < shard_list.size(); i++) {
+      total->transition_accs.AddVec(1.0, shard_list[i]->transition_accs);
+      total->gmm_accs.Add(1.0, shard_list[i]->gmm_accs);
+    }
     {
       Output ko(accs_wxfilename, binary);
-      transition_accs.Write(ko.Stream(), binary);
-      gmm_accs.Write(ko.Stream(), binary);
+      total->transition_accs.Write(ko.Stream(), binary);
+      total->gmm_accs.Write(ko.Stream(), binary);
     }
     KALDI_LOG << "Written accs.";
     return (num_done != 0 ? 0 : 1);
@@ -53,6 +53,7 @@ int main(int argc, char *argv[]) {
     BaseFloat transition_scale = 1.0;
     BaseFloat self_loop_scale = 1.0;
     std::string per_frame_acwt_wspecifier;
+    int32 batch_frames = 0;
 
     align_config.Register(&po);
     po.Register("transition-scale", &transition_scale,
@@ -64,6 +65,13 @@ int main(int argc, char *argv[]) {
     po.Register("write-per-frame-acoustic-loglikes", &per_frame_acwt_wspecifier,
                 "Wspecifier for table of vectors containing the acoustic log-likelihoods "
                 "per frame for each utterance. E.g. ark:foo/per_frame_logprobs.1.ark");
+    po.Register("batch-frames", &batch_frames,
+                "If > 0, compute the likelihoods of all pdfs for this many "
+                "frames at a time with one matrix multiplication, instead of "
+                "one pdf at a time as the decoder requests them.  Only faster "
+                "if most pdfs are requested on each frame (e.g. about 2.4x "
+                "faster for 21k Gaussians when all pdfs are needed); with "
+                "narrow beams it may be slower.");
     po.Read(argc, argv);
 
     if (po.NumArgs() < 4 || po.NumArgs() > 5) {
@@ -85,6 +93,9 @@ int main(int argc, char *argv[]) {
       trans_model.Read(ki.Stream(), binary);
       am_gmm.Read(ki.Stream(), binary);
     }
+    AmDiagGmmBatchComputer *batch_computer = NULL;
+    if (batch_frames > 0)
+      batch_computer = new AmDiagGmmBatchComputer(am_gmm);
 
     SequentialTableReader<fst::VectorFstHolder> fst_reader(fst_rspecifier);
     RandomAccessBaseFloatMatrixReader feature_reader(feature_rspecifier);
@@ -123,6 +134,8 @@ int main(int argc, char *argv[]) {
 
         DecodableAmDiagGmmScaled gmm_decodable(am_gmm, trans_model, features,
                                                acoustic_scale);
+        if (batch_computer != NULL)
+          gmm_decodable.SetBatchComputer(batch_computer, batch_frames);
 
         KALDI_LOG << utt;
         AlignUtteranceWrapper(align_config, utt,
@@ -137,6 +150,7 @@ int main(int argc, char *argv[]) {
     KALDI_LOG << "Retried " << num_retry << " out of "
               << (num_done + num_err) << " utterances.";
     KALDI_LOG << "Done " << num_done << ", errors on " << num_err;
+    delete batch_computer;
     return (num_done != 0 ? 0 : 1);
   } catch(const std::exception &e) {
     std::cerr << e.what();
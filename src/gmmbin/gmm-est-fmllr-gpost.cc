@@ -30,6 +30,7 @@ using std::vector;
 #include "hmm/transition-model.h"
 #include "transform/fmllr-diag-gmm.h"
 #include "hmm/posterior.h"
+#include "util/kaldi-thread.h"
 
 namespace kaldi {
 void AccumulateForUtterance(const Matrix<BaseFloat> &feats,
@@ -48,6 +49,63 @@ void AccumulateForUtterance(const Matrix<BaseFloat> &feats,
 }
 
 
+// Accumulates the stats for one speaker (or utterance) and estimates its
+// transform; the destructor writes the transform.  Tasks only read the
+// model, so all threads share it.
+class EstFmllrTask {
+ public:
+  EstFmllrTask(const FmllrOptions &opts,
+               const TransitionModel &trans_model,
+               const AmDiagGmm &am_gmm,
+               const std::string &key,
+               bool is_speaker,
+               BaseFloatMatrixWriter *transform_writer,
+               double *tot_impr,
+               double *tot_t):
+      opts_(opts), trans_model_(trans_model), am_gmm_(am_gmm), key_(key),
+      is_speaker_(is_speaker), transform_writer_(transform_writer),
+      tot_impr_(tot_impr), tot_t_(tot_t), impr_(0.0), count_(0.0) { }
+
+  // Adds an utterance to the data (copies it).
+  void AddUtterance(const Matrix<BaseFloat> &feats, const GaussPost &gpost) {
+    feats_.push_back(feats);
+    gposts_.push_back(gpost);
+  }
+
+  void operator () () {
+    FmllrDiagGmmAccs spk_stats(am_gmm_.Dim());
+    for (size_t i = 0; i < feats_.size(); i++)
+      AccumulateForUtterance(feats_[i], gposts_[i], trans_model_, am_gmm_,
+                             &spk_stats);
+    transform_.Resize(am_gmm_.Dim(), am_gmm_.Dim() + 1);
+    transform_.SetUnit();
+    spk_stats.Update(opts_, &transform_, &impr_, &count_);
+  }
+
+  ~EstFmllrTask() {
+    transform_writer_->Write(key_, transform_);
+    KALDI_LOG << "For " << (is_speaker_ ? "speaker " : "utterance ") << key_
+              << ", auxf-impr from fMLLR is " << (impr_ / count_) << ", over "
+              << count_ << " frames.";
+    *tot_impr_ += impr_;
+    *tot_t_ += count_;
+  }
+ private:
+  const FmllrOptions &opts_;
+  const TransitionModel &trans_model_;
+  const AmDiagGmm &am_gmm_;
+  std::string key_;
+  bool is_speaker_;
+  BaseFloatMatrixWriter *transform_writer_;
+  double *tot_impr_;
+  double *tot_t_;
+  std::vector<Matrix<BaseFloat> > feats_;
+  std::vector<GaussPost> gposts_;
+  Matrix<BaseFloat> transform_;
+  BaseFloat impr_;
+  BaseFloat count_;
+};
+
 }
 
 int main(int argc, char *argv[]) {
@@ -66,7 +124,9 @@ int main(int argc, char *argv[]) {
     string spk2utt_rspecifier;
     po.Register("spk2utt", &spk2utt_rspecifier, "rspecifier for speaker to "
                 "utterance-list map");
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
     fmllr_opts.Register(&po);
+    sequencer_config.Register(&po);
 
     po.Read(argc, argv);
 
@@ -101,9 +161,12 @@ int main(int argc, char *argv[]) {
       SequentialTokenVectorReader spk2utt_reader(spk2utt_rspecifier);
       RandomAccessBaseFloatMatrixReader feature_reader(feature_rspecifier);
 
+      TaskSequencer<EstFmllrTask> sequencer(sequencer_config);
       for (; !spk2utt_reader.Done(); spk2utt_reader.Next()) {
-        FmllrDiagGmmAccs spk_stats(am_gmm.Dim());
         string spk = spk2utt_reader.Key();
+        EstFmllrTask *task = new EstFmllrTask(fmllr_opts, trans_model, am_gmm,
+                                              spk, true, &transform_writer,
+                                              &tot_impr, &tot_t);
         const vector<string> &uttlist = spk2utt_reader.Value();
         for (size_t i = 0; i < uttlist.size(); i++) {
           std::string utt = uttlist[i];
@@ -126,25 +189,16 @@ int main(int argc, char *argv[]) {
             continue;
           }
 
-          AccumulateForUtterance(feats, gpost, trans_model, am_gmm, &spk_stats);
+          task->AddUtterance(feats, gpost);
 
           num_done++;
         }  // end looping over all utterances of the current speaker
 
-        BaseFloat impr, spk_tot_t;
-        {  // Compute the transform and write it out.
-          Matrix<BaseFloat> transform(am_gmm.Dim(), am_gmm.Dim()+1);
-          transform.SetUnit();
-          spk_stats.Update(fmllr_opts, &transform, &impr, &spk_tot_t);
-          transform_writer.Write(spk, transform);
-        }
-        KALDI_LOG << "For speaker " << spk << ", auxf-impr from fMLLR is "
-                  << (impr/spk_tot_t) << ", over " << spk_tot_t << " frames.\n";
-        tot_impr += impr;
-        tot_t += spk_tot_t;
+        sequencer.Run(task);
       }  // end looping over speakers
     } else {  // per-utterance adaptation
       SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
+      TaskSequencer<EstFmllrTask> sequencer(sequencer_config);
       for (; !feature_reader.Done(); feature_reader.Next()) {
         string utt = feature_reader.Key();
         if (!gpost_reader.HasKey(utt)) {
@@ -164,22 +218,11 @@ int main(int argc, char *argv[]) {
         }
         num_done++;
 
-        FmllrDiagGmmAccs spk_stats(am_gmm.Dim());
-
-        AccumulateForUtterance(feats, gpost, trans_model, am_gmm,
-                               &spk_stats);
-
-        BaseFloat impr, utt_tot_t;
-        {  // Compute the transform and write it out.
-          Matrix<BaseFloat> transform(am_gmm.Dim(), am_gmm.Dim()+1);
-          transform.SetUnit();
-          spk_stats.Update(fmllr_opts, &transform, &impr, &utt_tot_t);
-          transform_writer.Write(utt, transform);
-        }
-        KALDI_LOG << "For utterancer " << utt << ", auxf-impr from fMLLR is "
-                  << (impr/utt_tot_t) << ", over " << utt_tot_t << " frames.";
-        tot_impr += impr;
-        tot_t += utt_tot_t;
+        EstFmllrTask *task = new EstFmllrTask(fmllr_opts, trans_model, am_gmm,
+                                              utt, false, &transform_writer,
+                                              &tot_impr, &tot_t);
+        task->AddUtterance(feats, gpost);
+        sequencer.Run(task);
       }
     }
 
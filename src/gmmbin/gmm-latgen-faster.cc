@@ -48,6 +48,7 @@ int main(int argc, char *argv[]) {
     bool allow_partial = false;
     BaseFloat acoustic_scale = 0.1;
     LatticeFasterDecoderConfig config;
+    int32 batch_frames = 0;
 
     std::string word_syms_filename;
     config.Register(&po);
@@ -57,6 +58,13 @@ int main(int argc, char *argv[]) {
                 "Symbol table for words [for debug output]");
     po.Register("allow-partial", &allow_partial,
                 "If true, produce output even if end state was not reached.");
+    po.Register("batch-frames", &batch_frames,
+                "If > 0, compute the likelihoods of all pdfs for this many "
+                "frames at a time with one matrix multiplication, instead of "
+                "one pdf at a time as the decoder requests them.  Only faster "
+                "if most pdfs are requested on each frame (e.g. about 2.4x "
+                "faster for 21k Gaussians when all pdfs are needed); with "
+                "narrow beams it may be slower.");
 
     po.Read(argc, argv);
 
@@ -80,6 +88,9 @@ int main(int argc, char *argv[]) {
       trans_model.Read(ki.Stream(), binary);
       am_gmm.Read(ki.Stream(), binary);
     }
+    AmDiagGmmBatchComputer *batch_computer = NULL;
+    if (batch_frames > 0)
+      batch_computer = new AmDiagGmmBatchComputer(am_gmm);
 
     bool determinize = config.determinize_lattice;
     CompactLatticeWriter compact_lattice_writer;
@@ -124,6 +135,8 @@ int main(int argc, char *argv[]) {
 
           DecodableAmDiagGmmScaled gmm_decodable(am_gmm, trans_model, features,
                                                  acoustic_scale);
+          if (batch_computer != NULL)
+            gmm_decodable.SetBatchComputer(batch_computer, batch_frames);
 
           double like;
           if (DecodeUtteranceLatticeFaster(
@@ -159,6 +172,8 @@ int main(int argc, char *argv[]) {
         LatticeFasterDecoder decoder(fst_reader.Value(), config);
         DecodableAmDiagGmmScaled gmm_decodable(am_gmm, trans_model, features,
                                                acoustic_scale);
+        if (batch_computer != NULL)
+          gmm_decodable.SetBatchComputer(batch_computer, batch_frames);
         double like;
         if (DecodeUtteranceLatticeFaster(
                 decoder, gmm_decodable, trans_model, word_syms, utt,
@@ -182,6 +197,7 @@ int main(int argc, char *argv[]) {
               << frame_count << " frames.";
 
     delete word_syms;
+    delete batch_computer;
     if (num_done != 0) return 0;
     else return 1;
   } catch(const std::exception &e) {
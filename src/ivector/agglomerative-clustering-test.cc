@@ -0,0 +1,186 @@
+// ivector/agglomerative-clustering-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+
+#include "base/timer.h"
+#include "ivector/agglomerative-clustering.h"
+
+
+namespace kaldi {
+
+// A cluster in the reference implementation below.
+struct RefAhcCluster {
+  int32 id;
+  std::vector<int32> utts;
+  bool operator < (const RefAhcCluster &other) const { return id < other.id; }
+};
+
+// The average cost between the points of clusters a and b.
+static BaseFloat RefAhcCost(const Matrix<BaseFloat> &costs,
+                            const RefAhcCluster &a, const RefAhcCluster &b) {
+  BaseFloat sum = 0.0;
+  for (size_t i = 0; i < a.utts.size(); i++)
+    for (size_t j = 0; j < b.utts.size(); j++)
+      sum += costs(a.utts[i], b.utts[j]);
+  BaseFloat norm = a.utts.size() * b.utts.size();
+  return sum / norm;
+}
+
+// This is a simple (and slow) version of the clustering done by class
+// AgglomerativeClusterer, written to follow the original priority-queue
+// implementation: on each iteration it merges the pair with the lowest cost,
+// breaking ties by the smaller and then the larger cluster ID, among the pairs
+// that are within the threshold and the size limit; the merged cluster gets
+// ID ++(*count).
+static void RefAhcComputeClusters(const Matrix<BaseFloat> &costs,
+                                  BaseFloat threshold, int32 min_clusters,
+                                  int32 max_cluster_size, int32 *count,
+                                  std::vector<RefAhcCluster> *clusters) {
+  while (clusters->size() > static_cast<size_t>(min_clusters)) {
+    int32 best_a = -1, best_b = -1, best_id1 = 0, best_id2 = 0;
+    BaseFloat best_cost = 0.0;
+    for (size_t a = 0; a < clusters->size(); a++) {
+      for (size_t b = a + 1; b < clusters->size(); b++) {
+        const RefAhcCluster &ca = (*clusters)[a], &cb = (*clusters)[b];
+        if (ca.utts.size() + cb.utts.size() > max_cluster_size)
+          continue;
+        BaseFloat cost = RefAhcCost(costs, ca, cb);
+        if (cost > threshold)
+          continue;
+        int32 id1 = std::min(ca.id, cb.id), id2 = std::max(ca.id, cb.id);
+        if (best_a == -1 || cost < best_cost ||
+            (cost == best_cost && (id1 < best_id1 ||
+                                   (id1 == best_id1 && id2 < best_id2)))) {
+          best_a = a;
+          best_b = b;
+          best_cost = cost;
+          best_id1 = id1;
+          best_id2 = id2;
+        }
+      }
+    }
+    if (best_a == -1)
+      break;
+    RefAhcCluster &ca = (*clusters)[best_a], &cb = (*clusters)[best_b];
+    RefAhcCluster merged;
+    merged.id = ++(*count);
+    merged.utts = (ca.id < cb.id ? ca.utts : cb.utts);
+    const std::vector<int32> &other = (ca.id < cb.id ? cb.utts : ca.utts);
+    merged.utts.insert(merged.utts.end(), other.begin(), other.end());
+    clusters->erase(clusters->begin() + best_b);
+    clusters->erase(clusters->begin() + best_a);
+    clusters->push_back(merged);
+  }
+  std::sort(clusters->begin(), clusters->end());
+}
+
+// Reference version of AgglomerativeCluster(), including the two-pass case.
+static void RefAgglomerativeCluster(const Matrix<BaseFloat> &costs,
+                                    BaseFloat threshold, int32 min_clusters,
+                                    int32 first_pass_max_points,
+                                    BaseFloat max_cluster_fraction,
+                                    std::vector<int32> *assignments) {
+  int32 num_points = costs.NumRows(),
+      max_cluster_size = ceil(num_points * max_cluster_fraction),
+      count = num_points;
+  std::vector<RefAhcCluster> clusters;
+  if (num_points <= first_pass_max_points) {
+    for (int32 i = 0; i < num_points; i++) {
+      RefAhcCluster c;
+      c.id = i + 1;
+      c.utts.push_back(i);
+      clusters.push_back(c);
+    }
+  } else {
+    BaseFloat num_points_f = static_cast<BaseFloat>(num_points);
+    int32 num_subsets = ceil(num_points_f / first_pass_max_points),
+        subset_size = ceil(num_points_f / num_subsets);
+    for (int32 n = 0; n < num_points; n += subset_size) {
+      std::vector<RefAhcCluster> subset;
+      for (int32 i = n; i < std::min(n + subset_size, num_points); i++) {
+        RefAhcCluster c;
+        c.id = i + 1;
+        c.utts.push_back(i);
+        subset.push_back(c);
+      }
+      RefAhcComputeClusters(costs, threshold, min_clusters * 10,
+                            max_cluster_size, &count, &subset);
+      clusters.insert(clusters.end(), subset.begin(), subset.end());
+    }
+    // the second pass renumbers the first-pass clusters from 1.
+    for (size_t i = 0; i < clusters.size(); i++)
+      clusters[i].id = i + 1;
+    count = clusters.size();
+  }
+  RefAhcComputeClusters(costs, threshold, min_clusters, max_cluster_size,
+                        &count, &clusters);
+  assignments->resize(num_points);
+  for (size_t i = 0; i < clusters.size(); i++)
+    for (size_t j = 0; j < clusters[i].utts.size(); j++)
+      (*assignments)[clusters[i].utts[j]] = i + 1;
+}
+
+// Checks AgglomerativeCluster() against the reference version.  The costs
+// are small integers, so that the sums are exact and there are many ties.
+void UnitTestAgglomerativeCluster() {
+  for (int32 i = 0; i < 50; i++) {
+    int32 num_points = RandInt(1, 60), min_clusters = RandInt(1, 4),
+        first_pass_max_points = RandInt(2, 80);
+    BaseFloat threshold = RandInt(0, 8) * 0.5,
+        max_cluster_fraction = (RandInt(0, 1) == 0 ? 1.0 :
+                                1.0 / min_clusters +
+                                RandUniform() * (1.0 - 1.0 / min_clusters));
+    Matrix<BaseFloat> costs(num_points, num_points);
+    for (int32 r = 0; r < num_points; r++)
+      for (int32 c = 0; c < r; c++)
+        costs(r, c) = costs(c, r) = RandInt(0, 9);
+
+    std::vector<int32> assignments, ref_assignments;
+    AgglomerativeCluster(costs, threshold, min_clusters,
+                         first_pass_max_points, max_cluster_fraction,
+                         &assignments);
+    RefAgglomerativeCluster(costs, threshold, min_clusters,
+                            first_pass_max_points, max_cluster_fraction,
+                            &ref_assignments);
+    KALDI_ASSERT(assignments == ref_assignments);
+  }
+}
+
+void UnitTestAgglomerativeClusterSpeed() {
+  int32 num_points = 2000;
+  Matrix<BaseFloat> costs(num_points, num_points);
+  costs.SetRandn();
+  costs.AddMat(1.0, costs, kTrans);
+  std::vector<int32> assignments;
+  Timer timer;
+  AgglomerativeCluster(costs, 0.0, 1, num_points, 1.0, &assignments);
+  KALDI_LOG << "Clustering " << num_points << " points took "
+            << timer.Elapsed() << " seconds, giving "
+            << *std::max_element(assignments.begin(), assignments.end())
+            << " clusters.";
+}
+
+}  // end namespace kaldi.
+
+int main() {
+  using namespace kaldi;
+  UnitTestAgglomerativeCluster();
+  UnitTestAgglomerativeClusterSpeed();
+  std::cout << "Test OK.\n";
+  return 0;
+}
@@ -20,6 +20,7 @@
 // limitations under the License.
 
 #include <algorithm>
+#include <limits>
 #include "ivector/agglomerative-clustering.h"
 
 namespace kaldi {
@@ -53,170 +54,247 @@ void AgglomerativeClusterer::ClusterTwoPass() {
     AddClustersToSecondPass();
   }
 
-  // We swap the contents of the first and second pass data structures so that
-  // we can use the same method to do second pass clustering.
-  clusters_map_.swap(second_pass_clusters_map_);
-  active_clusters_.swap(second_pass_active_clusters_);
-  cluster_cost_map_.swap(second_pass_cluster_cost_map_);
-  queue_.swap(second_pass_queue_);
-  count_ = second_pass_count_;
-
   // This is the second pass. It moves through the queue merging clusters
   // determined in the first pass until a stopping criterion is reached.
+  InitializeSecondPass();
   ComputeClusters(min_clusters_);
 
   AssignClusters();
 }
 
-uint32 AgglomerativeClusterer::EncodePair(int32 i, int32 j) {
-  if (i < j)
-    return (static_cast<uint32>(i) << 16) + static_cast<uint32>(j);
-  else
-    return (static_cast<uint32>(j) << 16) + static_cast<uint32>(i);
-}
-
-std::pair<int32, int32> AgglomerativeClusterer::DecodePair(uint32 key) {
-  return std::make_pair(static_cast<int32>(key >> 16),
-                        static_cast<int32>(key & 0x0000FFFFu));
+void AgglomerativeClusterer::SetClusters(
+    const std::vector<AhcCluster*> &clusters,
+    const std::vector<int32> &ids) {
+  KALDI_ASSERT(clusters.size() == ids.size());
+  clusters_ = clusters;
+  ids_ = ids;
+  num_slots_ = num_active_ = clusters.size();
+  cost_sums_.clear();
+  cost_sums_.resize((static_cast<size_t>(num_slots_) * (num_slots_ - 1)) / 2);
 }
 
 void AgglomerativeClusterer::InitializeClusters(int32 first, int32 last) {
   KALDI_ASSERT(last > first);
-  clusters_map_.clear();
-  active_clusters_.clear();
-  cluster_cost_map_.clear();
-  queue_ = QueueType();  // priority_queue does not have a clear method
-
+  std::vector<AhcCluster*> clusters;
+  std::vector<int32> ids;
   for (int32 i = first; i < last; i++) {
     // create an initial cluster of size 1 for each point
-    std::vector<int32> ids;
-    ids.push_back(i);
-    AhcCluster *c = new AhcCluster(i + 1, -1, -1, ids);
-    clusters_map_[i + 1] = c;
-    active_clusters_.insert(i + 1);
-
-    // propagate the queue with all pairs from the cost matrix
-    for (int32 j = i + 1; j < last; j++) {
-      BaseFloat cost = costs_(i, j);
-      uint32 key = EncodePair(i + 1, j + 1);
-      cluster_cost_map_[key] = cost;
-      if (cost <= threshold_)
-        queue_.push(std::make_pair(cost, key));
+    std::vector<int32> utts;
+    utts.push_back(i);
+    clusters.push_back(new AhcCluster(i + 1, -1, -1, utts));
+    ids.push_back(i + 1);
+  }
+  SetClusters(clusters, ids);
+  for (int32 i = 0; i < num_slots_; i++)
+    for (int32 j = i + 1; j < num_slots_; j++)
+      CostSum(i, j) = costs_(first + i, first + j);
+  InitializeNeighbors();
+}
+
+void AgglomerativeClusterer::InitializeNeighbors() {
+  queue_ = QueueType();  // priority_queue does not have a clear method
+  nearest_.assign(num_slots_, -1);
+  nearest_id_.assign(num_slots_, -1);
+  nearest_cost_.assign(num_slots_, std::numeric_limits<BaseFloat>::infinity());
+  for (int32 i = 0; i < num_slots_; i++)
+    FindNearestNeighbor(i);
+}
+
+void AgglomerativeClusterer::FindNearestNeighbor(int32 i) {
+  int32 best = -1;
+  BaseFloat best_cost = std::numeric_limits<BaseFloat>::infinity();
+  for (int32 j = 0; j < num_slots_; j++) {
+    if (clusters_[j] == NULL || ids_[j] <= ids_[i] || !CanMerge(i, j))
+      continue;
+    BaseFloat cost = Cost(i, j);
+    if (best == -1 || cost < best_cost ||
+        (cost == best_cost && ids_[j] < ids_[best])) {
+      best = j;
+      best_cost = cost;
+    }
+  }
+  nearest_[i] = best;
+  nearest_id_[i] = (best == -1 ? -1 : ids_[best]);
+  nearest_cost_[i] = best_cost;
+  PushNearestNeighbor(i);
+}
+
+void AgglomerativeClusterer::PushNearestNeighbor(int32 i) {
+  if (nearest_[i] == -1 || !(nearest_cost_[i] <= threshold_))
+    return;
+  QueueElement e;
+  e.cost = nearest_cost_[i];
+  e.id1 = ids_[i];
+  e.id2 = nearest_id_[i];
+  e.slot = i;
+  queue_.push(e);
+  // Control memory use by getting rid of out-of-date queue elements.
+  if (queue_.size() >= 4 * static_cast<size_t>(num_slots_))
+    ReconstructQueue();
+}
+
+void AgglomerativeClusterer::ReconstructQueue() {
+  queue_ = QueueType();
+  for (int32 i = 0; i < num_slots_; i++) {
+    if (clusters_[i] != NULL && nearest_[i] != -1 &&
+        nearest_cost_[i] <= threshold_) {
+      QueueElement e;
+      e.cost = nearest_cost_[i];
+      e.id1 = ids_[i];
+      e.id2 = nearest_id_[i];
+      e.slot = i;
+      queue_.push(e);
     }
   }
 }
 
 void AgglomerativeClusterer::ComputeClusters(int32 min_clusters) {
-  while (active_clusters_.size() > min_clusters && !queue_.empty()) {
-    std::pair<BaseFloat, uint32> pr = queue_.top();
-    int32 i, j;
-    std::tie(i, j) = DecodePair(pr.second);
+  while (num_active_ > min_clusters && !queue_.empty()) {
+    QueueElement e = queue_.top();
     queue_.pop();
-    // check to make sure clusters have not already been merged
-    if ((active_clusters_.find(i) != active_clusters_.end()) &&
-        (active_clusters_.find(j) != active_clusters_.end())) {
-      if (clusters_map_[i]->size + clusters_map_[j]->size <= max_cluster_size_)
-        MergeClusters(i, j);
+    int32 i = e.slot;
+    // skip elements that are out of date.
+    if (clusters_[i] == NULL || ids_[i] != e.id1 ||
+        nearest_id_[i] != e.id2 || nearest_cost_[i] != e.cost)
+      continue;
+    int32 j = nearest_[i];
+    if (clusters_[j] == NULL || ids_[j] != e.id2 || !CanMerge(i, j) ||
+        Cost(i, j) != e.cost) {
+      // The nearest neighbour of i has been merged or got further away, so
+      // we have to find the new one.
+      FindNearestNeighbor(i);
+      continue;
     }
+    MergeClusters(i, j);
   }
 }
 
 void AgglomerativeClusterer::MergeClusters(int32 i, int32 j) {
-  AhcCluster *clust1 = clusters_map_[i];
-  AhcCluster *clust2 = clusters_map_[j];
+  AhcCluster *clust1 = clusters_[i];
+  AhcCluster *clust2 = clusters_[j];
+  KALDI_ASSERT(ids_[i] < ids_[j]);
   // For memory efficiency, the first cluster is updated to contain the new
   // merged cluster information, and the second cluster is later deleted.
   clust1->id = ++count_;
-  clust1->parent1 = i;
-  clust1->parent2 = j;
+  clust1->parent1 = ids_[i];
+  clust1->parent2 = ids_[j];
   clust1->size += clust2->size;
   clust1->utt_ids.insert(clust1->utt_ids.end(), clust2->utt_ids.begin(),
                          clust2->utt_ids.end());
-  // Remove the merged clusters from the list of active clusters.
-  active_clusters_.erase(i);
-  active_clusters_.erase(j);
-  // Update the queue with all the new costs involving the new cluster
-  std::set<int32>::iterator it;
-  for (it = active_clusters_.begin(); it != active_clusters_.end(); ++it) {
+  clusters_[j] = NULL;
+  num_active_--;
+  delete clust2;
+  ids_[i] = count_;
+  // The new cluster has the largest ID, so it has no neighbours of its own
+  // yet.
+  nearest_[i] = nearest_[j] = -1;
+  nearest_id_[i] = -1;
+  nearest_cost_[i] = std::numeric_limits<BaseFloat>::infinity();
+  for (int32 k = 0; k < num_slots_; k++) {
+    if (k == i || clusters_[k] == NULL)
+      continue;
     // The new cost is the sum of the costs of the new cluster's parents
-    BaseFloat new_cost = cluster_cost_map_[EncodePair(*it, i)] +
-                         cluster_cost_map_[EncodePair(*it, j)];
-    uint32 new_key = EncodePair(*it, count_);
-    cluster_cost_map_[new_key] = new_cost;
-    BaseFloat norm = clust1->size * (clusters_map_[*it])->size;
-    if (new_cost / norm <= threshold_)
-      queue_.push(std::make_pair(new_cost / norm, new_key));
+    CostSum(i, k) = CostSum(k, i) + CostSum(k, j);
+    // The new cluster becomes the nearest neighbour of k if it is closer
+    // than the one we have; as it has the largest ID it loses ties.
+    if (CanMerge(i, k)) {
+      BaseFloat cost = Cost(i, k);
+      if (cost < nearest_cost_[k]) {
+        nearest_[k] = i;
+        nearest_id_[k] = count_;
+        nearest_cost_[k] = cost;
+        PushNearestNeighbor(k);
+      }
+    }
   }
-  active_clusters_.insert(count_);
-  clusters_map_[count_] = clust1;
-  delete clust2;
 }
 
 void AgglomerativeClusterer::AddClustersToSecondPass() {
   // This method collects the results of first pass clustering for one subset,
-  // i.e. adds the set of active clusters to the set of second pass active
-  // clusters and computes the costs for the newly formed cluster pairs.
-  std::set<int32>::iterator it1, it2;
-  int32 count = second_pass_count_;
-  for (it1 = active_clusters_.begin(); it1 != active_clusters_.end(); ++it1) {
-    AhcCluster *clust1 = clusters_map_[*it1];
-    second_pass_clusters_map_[++count] = clust1;
-
-    // Compute new cluster pair costs
-    for (it2 = second_pass_active_clusters_.begin();
-         it2 != second_pass_active_clusters_.end(); ++it2) {
-      AhcCluster *clust2 = second_pass_clusters_map_[*it2];
-      uint32 new_key = EncodePair(count, *it2);
-
-      BaseFloat new_cost = 0.0;
-      std::vector<int32>::iterator utt_it1, utt_it2;
-      for (utt_it1 = clust1->utt_ids.begin();
-           utt_it1 != clust1->utt_ids.end(); ++utt_it1) {
-         for (utt_it2 = clust2->utt_ids.begin();
-              utt_it2 != clust2->utt_ids.end(); ++utt_it2) {
-           new_cost += costs_(*utt_it1, *utt_it2);
-         }
-      }
+  // i.e. the active clusters in order of ID and the summed costs between
+  // them.  The costs between clusters of different subsets are computed in
+  // InitializeSecondPass().
+  std::vector<std::pair<int32, int32> > id_and_slot;
+  for (int32 i = 0; i < num_slots_; i++)
+    if (clusters_[i] != NULL)
+      id_and_slot.push_back(std::make_pair(ids_[i], i));
+  std::sort(id_and_slot.begin(), id_and_slot.end());
+  int32 n = id_and_slot.size();
+  std::vector<AhcCluster*> clusters(n);
+  std::vector<BaseFloat> cost_sums((static_cast<size_t>(n) * (n - 1)) / 2);
+  size_t index = 0;
+  for (int32 a = 0; a < n; a++) {
+    clusters[a] = clusters_[id_and_slot[a].second];
+    for (int32 b = a + 1; b < n; b++)
+      cost_sums[index++] = CostSum(id_and_slot[a].second,
+                                   id_and_slot[b].second);
+  }
+  second_pass_clusters_.push_back(clusters);
+  second_pass_cost_sums_.push_back(std::vector<BaseFloat>());
+  second_pass_cost_sums_.back().swap(cost_sums);
+}
 
-      second_pass_cluster_cost_map_[new_key] = new_cost;
-      BaseFloat norm = clust1->size * clust2->size;
-      if (new_cost / norm <= threshold_)
-        second_pass_queue_.push(std::make_pair(new_cost / norm, new_key));
+void AgglomerativeClusterer::InitializeSecondPass() {
+  std::vector<AhcCluster*> clusters;
+  std::vector<int32> ids, subset_begin;
+  for (size_t s = 0; s < second_pass_clusters_.size(); s++) {
+    subset_begin.push_back(clusters.size());
+    for (size_t a = 0; a < second_pass_clusters_[s].size(); a++) {
+      clusters.push_back(second_pass_clusters_[s][a]);
+      ids.push_back(clusters.size());
     }
+  }
+  subset_begin.push_back(clusters.size());
+  SetClusters(clusters, ids);
+  count_ = num_slots_;
 
-    // Copy cluster pair costs that were already computed in the first pass
-    int32 count2 = second_pass_count_;
-    for (it2 = active_clusters_.begin(); it2 != it1; ++it2) {
-      uint32 key = EncodePair(*it1, *it2);
-      BaseFloat cost = cluster_cost_map_[key];
-      BaseFloat norm = clust1->size * (clusters_map_[*it2])->size;
-      uint32 new_key = EncodePair(count, ++count2);
-      second_pass_cluster_cost_map_[new_key] = cost;
-      if (cost / norm <= threshold_)
-        second_pass_queue_.push(std::make_pair(cost / norm, new_key));
+  for (size_t s = 0; s < second_pass_clusters_.size(); s++) {
+    int32 begin = subset_begin[s], end = subset_begin[s + 1];
+    size_t index = 0;
+    for (int32 a = begin; a < end; a++) {
+      // Copy cluster pair costs that were already computed in the first pass
+      for (int32 b = a + 1; b < end; b++)
+        CostSum(a, b) = second_pass_cost_sums_[s][index++];
+      // Compute the costs to the clusters of the earlier subsets
+      const AhcCluster *clust1 = clusters_[a];
+      for (int32 b = 0; b < begin; b++) {
+        const AhcCluster *clust2 = clusters_[b];
+        BaseFloat new_cost = 0.0;
+        std::vector<int32>::const_iterator utt_it1, utt_it2;
+        for (utt_it1 = clust1->utt_ids.begin();
+             utt_it1 != clust1->utt_ids.end(); ++utt_it1) {
+          for (utt_it2 = clust2->utt_ids.begin();
+               utt_it2 != clust2->utt_ids.end(); ++utt_it2) {
+            new_cost += costs_(*utt_it1, *utt_it2);
+          }
+        }
+        CostSum(a, b) = new_cost;
+      }
     }
   }
-  // We update second_pass_count_ and second_pass_active_clusters_ here since
-  // above loop assumes they do not change while the loop is running.
-  while (second_pass_count_ < count)
-    second_pass_active_clusters_.insert(++second_pass_count_);
+  second_pass_clusters_.clear();
+  second_pass_cost_sums_.clear();
+  InitializeNeighbors();
 }
 
 void AgglomerativeClusterer::AssignClusters() {
   assignments_->resize(num_points_);
-  int32 label_id = 0;
-  std::set<int32>::iterator it;
-  // Iterate through the clusters and assign all utterances within the cluster
-  // an ID label unique to the cluster. This is the final output and frees up
-  // the cluster memory accordingly.
-  for (it = active_clusters_.begin(); it != active_clusters_.end(); ++it) {
-    ++label_id;
-    AhcCluster *cluster = clusters_map_[*it];
+  // Iterate through the clusters in order of ID and assign all utterances
+  // within the cluster an ID label unique to the cluster. This is the final
+  // output and frees up the cluster memory accordingly.
+  std::vector<std::pair<int32, int32> > id_and_slot;
+  for (int32 i = 0; i < num_slots_; i++)
+    if (clusters_[i] != NULL)
+      id_and_slot.push_back(std::make_pair(ids_[i], i));
+  std::sort(id_and_slot.begin(), id_and_slot.end());
+  for (size_t c = 0; c < id_and_slot.size(); c++) {
+    AhcCluster *cluster = clusters_[id_and_slot[c].second];
     std::vector<int32>::iterator utt_it;
     for (utt_it = cluster->utt_ids.begin();
          utt_it != cluster->utt_ids.end(); ++utt_it)
-      (*assignments_)[*utt_it] = label_id;
+      (*assignments_)[*utt_it] = c + 1;
     delete cluster;
+    clusters_[id_and_slot[c].second] = NULL;
   }
 }
 
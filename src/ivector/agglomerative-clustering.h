@@ -51,7 +51,10 @@ struct AhcCluster {
 };
 
 /// The AgglomerativeClusterer class contains the necessary mechanisms for the
-/// actual clustering algorithm.
+/// actual clustering algorithm.  It stores the costs between clusters in an
+/// upper-triangular matrix and keeps a queue of the nearest neighbour of each
+/// cluster, so for N points it needs O(N^2) memory and, in practice, O(N^2)
+/// time.
 class AgglomerativeClusterer {
  public:
   AgglomerativeClusterer(
@@ -77,11 +80,7 @@ class AgglomerativeClusterer {
     // points, which are the initial set of clusters.
     count_ = num_points_;
 
-    // The second_pass_count_, which is used for identifying the initial set of
-    // second pass clusters and initializing count_ before the second pass, is
-    // initialized to 0 and incremented whenever a new cluster is added to the
-    // initial set of second pass clusters.
-    second_pass_count_ = 0;
+    num_slots_ = num_active_ = 0;
   }
 
   // Clusters points. Chooses single pass or two pass algorithm.
@@ -94,20 +93,50 @@ class AgglomerativeClusterer {
   void ClusterTwoPass();
 
  private:
-  // Encodes cluster pair into a 32bit unsigned integer.
-  uint32 EncodePair(int32 i, int32 j);
-  // Decodes cluster pair from a 32bit unsigned integer.
-  std::pair<int32, int32> DecodePair(uint32 key);
-  // Initializes the clustering queue with singleton clusters
+  // Sets up the clusters of one pass; "ids" are their cluster IDs.  The
+  // summed costs between them have to be set afterwards, followed by a call
+  // to InitializeNeighbors().
+  void SetClusters(const std::vector<AhcCluster*> &clusters,
+                   const std::vector<int32> &ids);
+  // Initializes the clusters with singleton clusters
   void InitializeClusters(int32 first, int32 last);
+  // Computes the nearest neighbours and sets up the queue.
+  void InitializeNeighbors();
   // Does hierarchical agglomerative clustering
   void ComputeClusters(int32 min_clusters);
   // Adds clusters created in first pass to second pass clusters
   void AddClustersToSecondPass();
+  // Sets up the second pass from the clusters added by
+  // AddClustersToSecondPass().
+  void InitializeSecondPass();
   // Assigns points to clusters
   void AssignClusters();
-  // Merges clusters with IDs i and j and updates cost map and queue
+  // Merges the clusters in slots i and j, where i has the smaller ID, and
+  // updates the costs, the nearest neighbours and the queue.
   void MergeClusters(int32 i, int32 j);
+  // Finds the nearest neighbour of the cluster in slot i among the clusters
+  // with larger IDs, and adds it to the queue.
+  void FindNearestNeighbor(int32 i);
+  // Adds the pair (i, nearest_[i]) to the queue if it could be merged.
+  void PushNearestNeighbor(int32 i);
+  // Reconstructs the queue from the nearest neighbours.
+  void ReconstructQueue();
+
+  // The sum of the costs between the points of the clusters in slots i and
+  // j (i != j).
+  BaseFloat &CostSum(int32 i, int32 j) {
+    if (i > j) std::swap(i, j);
+    return cost_sums_[(static_cast<size_t>(i) * (2 * num_slots_ - i - 1)) / 2 +
+                      (j - i - 1)];
+  }
+  // The average cost between the points of the clusters in slots i and j.
+  BaseFloat Cost(int32 i, int32 j) {
+    BaseFloat norm = clusters_[i]->size * clusters_[j]->size;
+    return CostSum(i, j) / norm;
+  }
+  bool CanMerge(int32 i, int32 j) const {
+    return clusters_[i]->size + clusters_[j]->size <= max_cluster_size_;
+  }
 
   const Matrix<BaseFloat> &costs_;  // cost matrix
   BaseFloat threshold_;  // stopping criterion threshold
@@ -118,28 +147,50 @@ class AgglomerativeClusterer {
   int32 num_points_;  // total number of points to cluster
   int32 max_cluster_size_;  // maximum number of points in a cluster
   int32 count_;  // count of first pass clusters, used for identifying clusters
-  int32 second_pass_count_;  // count of second pass clusters
 
+  // The clusters of the current pass are stored in "slots", which are fixed
+  // for the pass.  A slot is NULL once its cluster has been merged into
+  // another one.  Cluster IDs change when clusters are merged (the new
+  // cluster gets the next ID), and among pairs with the same cost, the pair
+  // with the lowest (smaller ID, larger ID) is merged first.
+  int32 num_slots_;
+  int32 num_active_;  // number of non-NULL slots.
+  std::vector<AhcCluster*> clusters_;
+  std::vector<int32> ids_;
+  // Upper-triangular matrix of summed costs between slots; see CostSum().
+  std::vector<BaseFloat> cost_sums_;
+
+  // For each slot i, nearest_[i] is the slot of the cluster with a larger ID
+  // that i is cheapest to merge with (or -1), nearest_id_[i] its ID when it
+  // was found, and nearest_cost_[i] is the cost.  The costs of a slot's pairs
+  // are only updated when they go down, so (nearest_cost_[i], nearest_id_[i])
+  // is only a lower bound on the best pair of slot i; a slot whose nearest
+  // neighbour is out of date is rescanned when it reaches the top of the
+  // queue.  The queue thus holds about one element per cluster rather than
+  // one per pair of clusters.
+  std::vector<int32> nearest_;
+  std::vector<int32> nearest_id_;
+  std::vector<BaseFloat> nearest_cost_;
+
+  struct QueueElement {
+    BaseFloat cost;
+    int32 id1, id2;  // the cluster IDs, id1 < id2.
+    int32 slot;  // the slot of cluster id1.
+    bool operator > (const QueueElement &other) const {
+      if (cost != other.cost) return cost > other.cost;
+      if (id1 != other.id1) return id1 > other.id1;
+      return id2 > other.id2;
+    }
+  };
   // Priority queue using greater (lowest costs are highest priority).
-  // Elements contain pairs of cluster IDs and their cost.
-  typedef std::pair<BaseFloat, uint32> QueueElement;
   typedef std::priority_queue<QueueElement, std::vector<QueueElement>,
     std::greater<QueueElement>  > QueueType;
-  QueueType queue_, second_pass_queue_;
-
-  // Map from cluster IDs to cost between them
-  std::unordered_map<uint32, BaseFloat> cluster_cost_map_;
-  // Map from cluster ID to cluster object address
-  std::unordered_map<int32, AhcCluster*> clusters_map_;
-  // Set of unmerged cluster IDs
-  std::set<int32> active_clusters_;
-
-  // Map from second pass cluster IDs to cost between them
-  std::unordered_map<uint32, BaseFloat> second_pass_cluster_cost_map_;
-  // Map from second pass cluster ID to cluster object address
-  std::unordered_map<int32, AhcCluster*> second_pass_clusters_map_;
-  // Set of unmerged second pass cluster IDs
-  std::set<int32> second_pass_active_clusters_;
+  QueueType queue_;
+
+  // The first pass clusters of each subset, in order of ID, and for each
+  // subset the summed costs between its clusters, as cost_sums_.
+  std::vector<std::vector<AhcCluster*> > second_pass_clusters_;
+  std::vector<std::vector<BaseFloat> > second_pass_cost_sums_;
 };
 
 /** This is the function that is called to perform the agglomerative
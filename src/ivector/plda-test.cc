@@ -17,6 +17,10 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <functional>
+
+#include "base/timer.h"
 #include "ivector/plda.h"
 
 
@@ -89,6 +93,83 @@ void UnitTestPldaEstimation(int32 dim) {
 
 }
 
+// Creates a PLDA model with random parameters, by reading it from a string
+// (the members are not accessible from here).
+static void InitRandomPlda(int32 dim, Plda *plda) {
+  Vector<double> mean(dim), psi(dim);
+  Matrix<double> transform(dim, dim);
+  mean.SetRandn();
+  transform.SetRandn();
+  for (int32 i = 0; i < dim; i++)
+    psi(i) = 0.1 + 10.0 * RandUniform();
+  std::sort(psi.Data(), psi.Data() + dim, std::greater<double>());
+  std::ostringstream os;
+  bool binary = (Rand() % 2 == 0);
+  WriteToken(os, binary, "<Plda>");
+  mean.Write(os, binary);
+  transform.Write(os, binary);
+  psi.Write(os, binary);
+  WriteToken(os, binary, "</Plda>");
+  std::istringstream is(os.str());
+  plda->Read(is, binary);
+}
+
+void UnitTestPldaLogLikelihoodRatios() {
+  int32 dim = 1 + Rand() % 20;
+  Plda plda;
+  InitRandomPlda(dim, &plda);
+  int32 num_enroll = 1 + Rand() % 10, num_test = 1 + Rand() % 10;
+  Matrix<double> enroll(num_enroll, dim), test(num_test, dim);
+  enroll.SetRandn();
+  test.SetRandn();
+  std::vector<int32> num_utts(num_enroll);
+  for (int32 k = 0; k < num_enroll; k++)
+    num_utts[k] = 1 + Rand() % 4;
+  Matrix<double> scores(num_enroll, num_test);
+  plda.LogLikelihoodRatios(enroll, num_utts, test, &scores);
+  for (int32 k = 0; k < num_enroll; k++) {
+    for (int32 j = 0; j < num_test; j++) {
+      double ref = plda.LogLikelihoodRatio(enroll.Row(k), num_utts[k],
+                                           test.Row(j));
+      KALDI_ASSERT(ApproxEqual(scores(k, j), ref, 1.0e-06) ||
+                   std::abs(scores(k, j) - ref) < 1.0e-06);
+    }
+  }
+}
+
+// Compares the speed of LogLikelihoodRatio() and LogLikelihoodRatios().
+void UnitTestPldaScoringSpeed() {
+  int32 dim = 128, num_enroll = 200, num_test = 400;
+  Plda plda;
+  InitRandomPlda(dim, &plda);
+  Matrix<double> enroll(num_enroll, dim), test(num_test, dim);
+  enroll.SetRandn();
+  test.SetRandn();
+  std::vector<int32> num_utts(num_enroll);
+  for (int32 k = 0; k < num_enroll; k++)
+    num_utts[k] = 1 + Rand() % 10;
+  double num_pairs = static_cast<double>(num_enroll) * num_test;
+
+  Matrix<double> scores(num_enroll, num_test);
+  Timer timer;
+  for (int32 k = 0; k < num_enroll; k++)
+    for (int32 j = 0; j < num_test; j++)
+      scores(k, j) = plda.LogLikelihoodRatio(enroll.Row(k), num_utts[k],
+                                             test.Row(j));
+  double pairwise_time = timer.Elapsed();
+
+  Matrix<double> batched_scores(num_enroll, num_test);
+  timer.Reset();
+  int32 num_iters = 10;
+  for (int32 iter = 0; iter < num_iters; iter++)
+    plda.LogLikelihoodRatios(enroll, num_utts, test, &batched_scores);
+  double batched_time = timer.Elapsed() / num_iters;
+  KALDI_ASSERT(scores.ApproxEqual(batched_scores, 1.0e-05));
+  KALDI_LOG << "For dim = " << dim << ", PLDA scoring speed was "
+            << (num_pairs / pairwise_time) << " pairs/sec one at a time, "
+            << (num_pairs / batched_time) << " pairs/sec batched.";
+}
+
 }
 
 
@@ -110,6 +191,9 @@ int main() {
 
   // UnitTestPldaEstimation(400);
   UnitTestPldaEstimation(40);
+  for (int i = 0; i < 10; i++)
+    UnitTestPldaLogLikelihoodRatios();
+  UnitTestPldaScoringSpeed();
   std::cout << "Test OK.\n";
   return 0;
 }
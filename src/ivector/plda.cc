@@ -18,6 +18,7 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <map>
 #include <vector>
 #include "ivector/plda.h"
 
@@ -192,6 +193,93 @@ double Plda::LogLikelihoodRatio(
 }
 
 
+/*
+   Expanding the expression used in LogLikelihoodRatio(), with x the
+   transformed enrollment iVector, y the test iVector, and (per dimension)
+   a = n \psi / (n \psi + 1), v = 1 + \psi / (n \psi + 1) and w = 1 + \psi,
+   the log-likelihood ratio is
+     \sum_i [ (a_i / v_i) x_i y_i  -  0.5 (a_i^2 / v_i) x_i^2
+              + 0.5 (1/w_i - 1/v_i) y_i^2  +  0.5 (log w_i - log v_i) ].
+   The first term is a matrix product over all pairs; the others depend on
+   only one of the two iVectors (and on n).
+*/
+void Plda::LogLikelihoodRatios(
+    const MatrixBase<double> &transformed_enroll_ivectors,
+    const std::vector<int32> &num_enroll_utts,
+    const MatrixBase<double> &transformed_test_ivectors,
+    MatrixBase<double> *scores) const {
+  int32 dim = Dim(),
+      num_enroll = transformed_enroll_ivectors.NumRows(),
+      num_test = transformed_test_ivectors.NumRows();
+  KALDI_ASSERT(transformed_enroll_ivectors.NumCols() == dim &&
+               transformed_test_ivectors.NumCols() == dim &&
+               static_cast<int32>(num_enroll_utts.size()) == num_enroll &&
+               scores->NumRows() == num_enroll &&
+               scores->NumCols() == num_test);
+  if (num_enroll == 0 || num_test == 0)
+    return;
+
+  // Each distinct number of enrollment utterances gets an index.
+  std::map<int32, int32> n_to_index;
+  for (int32 k = 0; k < num_enroll; k++) {
+    KALDI_ASSERT(num_enroll_utts[k] > 0);
+    n_to_index.insert(std::make_pair(num_enroll_utts[k], 0));
+  }
+  int32 num_distinct = n_to_index.size();
+  // cross_coef, enroll_sq_coef and test_sq_coef are the coefficients of x y,
+  // x^2 and y^2 above; offset is the constant term.
+  Matrix<double> cross_coef(num_distinct, dim, kUndefined),
+      enroll_sq_coef(num_distinct, dim, kUndefined),
+      test_sq_coef(num_distinct, dim, kUndefined);
+  Vector<double> offset(num_distinct);
+  {
+    int32 index = 0;
+    for (std::map<int32, int32>::iterator iter = n_to_index.begin();
+         iter != n_to_index.end(); ++iter, ++index) {
+      iter->second = index;
+      double n = iter->first;
+      for (int32 i = 0; i < dim; i++) {
+        double a = n * psi_(i) / (n * psi_(i) + 1.0),
+            v = 1.0 + psi_(i) / (n * psi_(i) + 1.0),
+            w = 1.0 + psi_(i);
+        cross_coef(index, i) = a / v;
+        enroll_sq_coef(index, i) = -0.5 * a * a / v;
+        test_sq_coef(index, i) = 0.5 * (1.0 / w - 1.0 / v);
+        offset(index) += 0.5 * (Log(w) - Log(v));
+      }
+    }
+  }
+
+  Matrix<double> test_sq(transformed_test_ivectors);
+  test_sq.ApplyPow(2.0);
+  // test_terms(index, j) is the y^2 term for test iVector j.
+  Matrix<double> test_terms(num_distinct, num_test, kUndefined);
+  test_terms.AddMatMat(1.0, test_sq_coef, kNoTrans, test_sq, kTrans, 0.0);
+
+  Matrix<double> scaled_enroll(transformed_enroll_ivectors);
+  Vector<double> enroll_sq(dim, kUndefined);
+  Vector<double> enroll_terms(num_enroll, kUndefined);
+  std::vector<int32> indexes(num_enroll);
+  for (int32 k = 0; k < num_enroll; k++) {
+    int32 index = n_to_index[num_enroll_utts[k]];
+    indexes[k] = index;
+    enroll_sq.CopyFromVec(transformed_enroll_ivectors.Row(k));
+    enroll_sq.ApplyPow(2.0);
+    enroll_terms(k) = offset(index) + VecVec(enroll_sq_coef.Row(index),
+                                             enroll_sq);
+    scaled_enroll.Row(k).MulElements(cross_coef.Row(index));
+  }
+
+  scores->AddMatMat(1.0, scaled_enroll, kNoTrans,
+                    transformed_test_ivectors, kTrans, 0.0);
+  for (int32 k = 0; k < num_enroll; k++) {
+    SubVector<double> row(*scores, k);
+    row.AddVec(1.0, test_terms.Row(indexes[k]));
+    row.Add(enroll_terms(k));
+  }
+}
+
+
 void Plda::SmoothWithinClassCovariance(double smoothing_factor) {
   KALDI_ASSERT(smoothing_factor >= 0.0 && smoothing_factor <= 1.0);
   // smoothing_factor > 1.0 is possible but wouldn't really make sense.
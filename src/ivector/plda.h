@@ -122,6 +122,21 @@ class Plda {
                             const VectorBase<double> &transformed_test_ivector)
                             const;
 
+  /// Batched version of LogLikelihoodRatio(): sets (*scores)(i, j) to the
+  /// log-likelihood ratio between row i of transformed_enroll_ivectors
+  /// (averaged over num_enroll_utts[i] utterances) and row j of
+  /// transformed_test_ivectors.  The log-likelihood ratio is a bilinear form
+  /// in the two iVectors plus terms that depend on only one of them, so this
+  /// is done as one matrix multiplication plus a matrix-vector product for
+  /// each distinct value of num_enroll_utts, which is much faster than
+  /// calling LogLikelihoodRatio() for each pair.  "scores" must already have
+  /// the right dimension.
+  void LogLikelihoodRatios(
+      const MatrixBase<double> &transformed_enroll_ivectors,
+      const std::vector<int32> &num_enroll_utts,
+      const MatrixBase<double> &transformed_test_ivectors,
+      MatrixBase<double> *scores) const;
+
 
   /// This function smooths the within-class covariance by adding to it,
   /// smoothing_factor (e.g. 0.1) times the between-class covariance (it's
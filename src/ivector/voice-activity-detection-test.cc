@@ -0,0 +1,148 @@
+// ivector/voice-activity-detection-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+
+#include "ivector/voice-activity-detection.h"
+
+namespace kaldi {
+
+// A source of features where only the first "num_frames_ready" rows of a
+// matrix are available, to simulate online processing.
+class TestOnlineSource: public OnlineFeatureInterface {
+ public:
+  explicit TestOnlineSource(const MatrixBase<BaseFloat> &feats):
+      feats_(feats), num_frames_ready_(0) { }
+  virtual int32 Dim() const { return feats_.NumCols(); }
+  virtual int32 NumFramesReady() const { return num_frames_ready_; }
+  virtual bool IsLastFrame(int32 frame) const {
+    return num_frames_ready_ == feats_.NumRows() &&
+        frame + 1 == feats_.NumRows();
+  }
+  virtual BaseFloat FrameShiftInSeconds() const { return 0.01; }
+  virtual void GetFrame(int32 frame, VectorBase<BaseFloat> *feat) {
+    KALDI_ASSERT(frame < num_frames_ready_);
+    feat->CopyFromVec(feats_.Row(frame));
+  }
+  void AddFrames(int32 num_frames) {
+    num_frames_ready_ = std::min(num_frames_ready_ + num_frames,
+                                 static_cast<int32>(feats_.NumRows()));
+  }
+ private:
+  const MatrixBase<BaseFloat> &feats_;
+  int32 num_frames_ready_;
+};
+
+static void GetRandomVadConfig(VadEnergyOptions *opts) {
+  opts->vad_energy_threshold = 5.0 * RandUniform();
+  opts->vad_energy_mean_scale = (Rand() % 2 == 0 ? 0.0 : RandUniform());
+  opts->vad_frames_context = Rand() % 5;
+  opts->vad_proportion_threshold = 0.1 + 0.8 * RandUniform();
+}
+
+static void GetRandomFeatures(Matrix<BaseFloat> *feats) {
+  feats->Resize(1 + Rand() % 200, 1 + Rand() % 5);
+  feats->SetRandn();
+  // make the log-energy column look like speech and silence.
+  for (int32 t = 0; t < feats->NumRows(); t++)
+    (*feats)(t, 0) = 10.0 * ((t / 20) % 2) + 2.0 * RandGauss();
+}
+
+void UnitTestComputeVadEnergy() {
+  VadEnergyOptions opts;
+  GetRandomVadConfig(&opts);
+  Matrix<BaseFloat> feats;
+  GetRandomFeatures(&feats);
+  Vector<BaseFloat> voiced;
+  ComputeVadEnergy(opts, feats, &voiced);
+
+  // Compare with a direct implementation.
+  int32 T = feats.NumRows();
+  BaseFloat energy_threshold = opts.vad_energy_threshold;
+  if (opts.vad_energy_mean_scale != 0.0) {
+    Vector<BaseFloat> log_energy(T);
+    log_energy.CopyColFromMat(feats, 0);
+    energy_threshold += opts.vad_energy_mean_scale * log_energy.Sum() / T;
+  }
+  for (int32 t = 0; t < T; t++) {
+    int32 num_count = 0, den_count = 0, context = opts.vad_frames_context;
+    for (int32 t2 = t - context; t2 <= t + context; t2++) {
+      if (t2 >= 0 && t2 < T) {
+        den_count++;
+        if (feats(t2, 0) > energy_threshold)
+          num_count++;
+      }
+    }
+    BaseFloat ref = (num_count >= den_count * opts.vad_proportion_threshold ?
+                     1.0 : 0.0);
+    KALDI_ASSERT(voiced(t) == ref);
+  }
+}
+
+void UnitTestOnlineVadEnergy() {
+  VadEnergyOptions opts;
+  GetRandomVadConfig(&opts);
+  Matrix<BaseFloat> feats;
+  GetRandomFeatures(&feats);
+  int32 T = feats.NumRows();
+
+  // Get the decisions by reading them as soon as they are ready.
+  TestOnlineSource src(feats);
+  OnlineVadEnergy vad(opts, &src);
+  Vector<BaseFloat> voiced(T);
+  int32 num_done = 0;
+  while (num_done < T) {
+    src.AddFrames(Rand() % 10);
+    int32 num_ready = vad.NumFramesReady();
+    KALDI_ASSERT(num_ready >= num_done);
+    if (src.NumFramesReady() < T)
+      KALDI_ASSERT(num_ready == std::max(
+          src.NumFramesReady() - opts.vad_frames_context, 0));
+    for (; num_done < num_ready; num_done++) {
+      SubVector<BaseFloat> frame(voiced, num_done, 1);
+      vad.GetFrame(num_done, &frame);
+    }
+  }
+
+  // The decisions must not depend on the order in which they are requested.
+  TestOnlineSource src2(feats);
+  src2.AddFrames(T);
+  OnlineVadEnergy vad2(opts, &src2);
+  KALDI_ASSERT(vad2.NumFramesReady() == T);
+  for (int32 i = 0; i < 10; i++) {
+    int32 t = Rand() % T;
+    KALDI_ASSERT(vad2.IsVoiced(t) == (voiced(t) != 0.0));
+  }
+
+  if (opts.vad_energy_mean_scale == 0.0) {
+    Vector<BaseFloat> offline_voiced;
+    ComputeVadEnergy(opts, feats, &offline_voiced);
+    KALDI_ASSERT(offline_voiced.ApproxEqual(voiced, 0.0));
+  }
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 20; i++) {
+    UnitTestComputeVadEnergy();
+    UnitTestOnlineVadEnergy();
+  }
+  KALDI_LOG << "Success.";
+  return 0;
+}
@@ -18,6 +18,8 @@
 // limitations under the License.
 
 
+#include <algorithm>
+
 #include "ivector/voice-activity-detection.h"
 #include "matrix/matrix-functions.h"
 
@@ -45,21 +47,85 @@ void ComputeVadEnergy(const VadEnergyOptions &opts,
   KALDI_ASSERT(opts.vad_frames_context >= 0);
   KALDI_ASSERT(opts.vad_proportion_threshold > 0.0 &&
                opts.vad_proportion_threshold < 1.0);
+  // num_above[t] is the number of frames before t that have more energy than
+  // the threshold, so the count in any window is a difference of two
+  // elements; this makes the cost independent of the window size.
+  const BaseFloat *log_energy_data = log_energy.Data();
+  std::vector<int32> num_above(T + 1);
+  num_above[0] = 0;
+  for (int32 t = 0; t < T; t++)
+    num_above[t + 1] = num_above[t] +
+        (log_energy_data[t] > energy_threshold ? 1 : 0);
+
+  int32 context = opts.vad_frames_context;
   for (int32 t = 0; t < T; t++) {
-    const BaseFloat *log_energy_data = log_energy.Data();
-    int32 num_count = 0, den_count = 0, context = opts.vad_frames_context;
-    for (int32 t2 = t - context; t2 <= t + context; t2++) {
-      if (t2 >= 0 && t2 < T) {
-        den_count++;
-        if (log_energy_data[t2] > energy_threshold)
-          num_count++;
-      }
-    }
+    int32 begin = std::max(t - context, 0),
+        end = std::min(t + context + 1, T),
+        num_count = num_above[end] - num_above[begin],
+        den_count = end - begin;
     if (num_count >= den_count * opts.vad_proportion_threshold)
       (*output_voiced)(t) = 1.0;
     else
       (*output_voiced)(t) = 0.0;
   }
-}  
+}
+
+
+OnlineVadEnergy::OnlineVadEnergy(const VadEnergyOptions &opts,
+                                 OnlineFeatureInterface *src):
+    opts_(opts), src_(src), log_energy_sum_(1, 0.0) {
+  KALDI_ASSERT(opts.vad_frames_context >= 0);
+  KALDI_ASSERT(opts.vad_energy_mean_scale >= 0.0);
+  KALDI_ASSERT(opts.vad_proportion_threshold > 0.0 &&
+               opts.vad_proportion_threshold < 1.0);
+}
+
+int32 OnlineVadEnergy::NumFramesReady() const {
+  int32 num_src_frames = src_->NumFramesReady();
+  if (num_src_frames == 0 || src_->IsLastFrame(num_src_frames - 1))
+    return num_src_frames;
+  return std::max(num_src_frames - opts_.vad_frames_context, 0);
+}
+
+void OnlineVadEnergy::ReadLogEnergy(int32 frame) {
+  int32 dim = src_->Dim();
+  Vector<BaseFloat> feat(dim);
+  for (int32 t = log_energy_.size(); t <= frame; t++) {
+    src_->GetFrame(t, &feat);
+    log_energy_.push_back(feat(0));
+    log_energy_sum_.push_back(log_energy_sum_.back() + feat(0));
+  }
+}
+
+bool OnlineVadEnergy::IsVoiced(int32 frame) {
+  KALDI_ASSERT(frame >= 0 && frame < NumFramesReady());
+  int32 num_src_frames = src_->NumFramesReady(),
+      context = opts_.vad_frames_context;
+  for (int32 t = voiced_.size(); t <= frame; t++) {
+    // The window is [begin, end); "end" is only limited by the end of the
+    // input once we know where that is.
+    int32 begin = std::max(t - context, 0),
+        end = std::min(t + context + 1, num_src_frames);
+    KALDI_ASSERT(end == t + context + 1 || src_->IsLastFrame(end - 1));
+    ReadLogEnergy(end - 1);
+    BaseFloat energy_threshold = opts_.vad_energy_threshold;
+    if (opts_.vad_energy_mean_scale != 0.0)
+      energy_threshold += opts_.vad_energy_mean_scale *
+          log_energy_sum_[end] / end;
+    int32 num_count = 0, den_count = end - begin;
+    for (int32 t2 = begin; t2 < end; t2++)
+      if (log_energy_[t2] > energy_threshold)
+        num_count++;
+    voiced_.push_back(num_count >= den_count * opts_.vad_proportion_threshold
+                      ? 1 : 0);
+  }
+  return (voiced_[frame] != 0);
+}
+
+void OnlineVadEnergy::GetFrame(int32 frame, VectorBase<BaseFloat> *feat) {
+  KALDI_ASSERT(feat->Dim() == 1);
+  (*feat)(0) = (IsVoiced(frame) ? 1.0 : 0.0);
+}
+
 
 }
@@ -29,6 +29,7 @@
 #include "matrix/matrix-lib.h"
 #include "util/common-utils.h"
 #include "base/kaldi-error.h"
+#include "itf/online-feature-itf.h"
 
 namespace kaldi {
 
@@ -82,6 +83,59 @@ void ComputeVadEnergy(const VadEnergyOptions &opts,
                       Vector<BaseFloat> *output_voiced);
 
 
+/// OnlineVadEnergy makes the same kind of decisions as ComputeVadEnergy(), but
+/// incrementally, from features that are becoming available (e.g. from
+/// OnlineMfcc), so that it can be used to skip silence in a streaming
+/// setting.  It presents the decisions as a one-dimensional feature: 1.0 for
+/// voiced frames and 0.0 otherwise.  The decision for frame t needs the
+/// features up to frame t + vad-frames-context, so it lags the input by that
+/// many frames (until the input is finished).
+///
+/// The difference from ComputeVadEnergy() is that the mean log-energy of the
+/// whole file is not known in advance: the threshold for frame t uses the mean
+/// over the frames up to the end of its context window.  This means the
+/// decisions are the same as ComputeVadEnergy() if --vad-energy-mean-scale is
+/// zero, and they do not depend on the order in which frames are requested.
+class OnlineVadEnergy: public OnlineFeatureInterface {
+ public:
+  /// Caution: this class keeps a pointer to "src", which it does not own.  Its
+  /// first dimension is assumed to be a log-energy or similar (e.g. C0).
+  OnlineVadEnergy(const VadEnergyOptions &opts,
+                  OnlineFeatureInterface *src);
+
+  virtual int32 Dim() const { return 1; }
+
+  virtual int32 NumFramesReady() const;
+
+  virtual bool IsLastFrame(int32 frame) const {
+    return src_->IsLastFrame(frame);
+  }
+
+  virtual BaseFloat FrameShiftInSeconds() const {
+    return src_->FrameShiftInSeconds();
+  }
+
+  virtual void GetFrame(int32 frame, VectorBase<BaseFloat> *feat);
+
+  /// Returns true if the frame is judged to be voiced; requires
+  /// frame < NumFramesReady().
+  bool IsVoiced(int32 frame);
+
+ private:
+  // Reads the log-energies of the source up to and including this frame.
+  void ReadLogEnergy(int32 frame);
+
+  VadEnergyOptions opts_;
+  OnlineFeatureInterface *src_;
+  // log_energy_[t] is the first feature of frame t of the source.
+  std::vector<BaseFloat> log_energy_;
+  // log_energy_sum_[t] is the sum of log_energy_[0] ... log_energy_[t - 1].
+  std::vector<double> log_energy_sum_;
+  // The decisions computed so far (frames 0, 1, ...): 1 for voiced, else 0.
+  std::vector<char> voiced_;
+};
+
+
 }  // namespace kaldi
 
 
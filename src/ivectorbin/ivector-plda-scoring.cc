@@ -51,11 +51,14 @@ int main(int argc, char *argv[]) {
     ParseOptions po(usage);
 
     std::string num_utts_rspecifier;
+    int32 batch_size = 256;
 
     PldaConfig plda_config;
     plda_config.Register(&po);
     po.Register("num-utts", &num_utts_rspecifier, "Table to read the number of "
                 "utterances per speaker, e.g. ark:num_utts.ark\n");
+    po.Register("batch-size", &batch_size, "Number of enrollment speakers "
+                "to score at a time (affects speed and memory use only)");
 
     po.Read(argc, argv);
 
@@ -63,6 +66,8 @@ int main(int argc, char *argv[]) {
       po.PrintUsage();
       exit(1);
     }
+    if (batch_size <= 0)
+      KALDI_ERR << "--batch-size must be positive.";
 
     std::string plda_rxfilename = po.GetArg(1),
         train_ivector_rspecifier = po.GetArg(2),
@@ -151,53 +156,105 @@ int main(int argc, char *argv[]) {
               << (tot_test_renorm_scale / num_test_ivectors);
 
 
-    Input ki(trials_rxfilename);
-    bool binary = false;
-    Output ko(scores_wxfilename, binary);
-
-    double sum = 0.0, sumsq = 0.0;
-    std::string line;
-
-    while (std::getline(ki.Stream(), line)) {
-      std::vector<std::string> fields;
-      SplitStringToVector(line, " \t\n\r", true, &fields);
-      if (fields.size() != 2) {
-        KALDI_ERR << "Bad line " << (num_trials_done + num_trials_err)
-                  << "in input (expected two fields: key1 key2): " << line;
-      }
-      std::string key1 = fields[0], key2 = fields[1];
-      if (train_ivectors.count(key1) == 0) {
-        KALDI_WARN << "Key " << key1 << " not present in training iVectors.";
-        num_trials_err++;
-        continue;
-      }
-      if (test_ivectors.count(key2) == 0) {
-        KALDI_WARN << "Key " << key2 << " not present in test iVectors.";
-        num_trials_err++;
-        continue;
+    // Read the trials first, so that we can score them in batches.  The
+    // enrollment speakers and test utterances that appear in the trials are
+    // given indexes in the order in which they are first seen.
+    std::vector<std::pair<std::string, std::string> > trials;
+    std::vector<std::pair<int32, int32> > trial_indexes;
+    unordered_map<string, int32, StringHasher> train_index, test_index;
+    std::vector<const Vector<BaseFloat>*> train_list, test_list;
+    std::vector<int32> train_num_examples;
+    {
+      Input ki(trials_rxfilename);
+      std::string line;
+      while (std::getline(ki.Stream(), line)) {
+        std::vector<std::string> fields;
+        SplitStringToVector(line, " \t\n\r", true, &fields);
+        if (fields.size() != 2) {
+          KALDI_ERR << "Bad line " << (trials.size() + num_trials_err)
+                    << "in input (expected two fields: key1 key2): " << line;
+        }
+        std::string key1 = fields[0], key2 = fields[1];
+        if (train_ivectors.count(key1) == 0) {
+          KALDI_WARN << "Key " << key1 << " not present in training iVectors.";
+          num_trials_err++;
+          continue;
+        }
+        if (test_ivectors.count(key2) == 0) {
+          KALDI_WARN << "Key " << key2 << " not present in test iVectors.";
+          num_trials_err++;
+          continue;
+        }
+        if (train_index.count(key1) == 0) {
+          train_index[key1] = train_list.size();
+          train_list.push_back(train_ivectors[key1]);
+          // we already checked that num_utts_reader has this key.
+          train_num_examples.push_back(num_utts_rspecifier.empty() ? 1 :
+                                       num_utts_reader.Value(key1));
+        }
+        if (test_index.count(key2) == 0) {
+          test_index[key2] = test_list.size();
+          test_list.push_back(test_ivectors[key2]);
+        }
+        trials.push_back(std::make_pair(key1, key2));
+        trial_indexes.push_back(std::make_pair(train_index[key1],
+                                               test_index[key2]));
       }
-      const Vector<BaseFloat> *train_ivector = train_ivectors[key1],
-          *test_ivector = test_ivectors[key2];
-
-      Vector<double> train_ivector_dbl(*train_ivector),
-          test_ivector_dbl(*test_ivector);
+    }
 
-      int32 num_train_examples;
-      if (!num_utts_rspecifier.empty()) {
-        // we already checked that it has this key.
-        num_train_examples = num_utts_reader.Value(key1);
-      } else {
-        num_train_examples = 1;
+    // trials_for_train[i] is the list of trials for enrollment speaker i.
+    int32 num_train = train_list.size(), num_test = test_list.size();
+    std::vector<std::vector<int32> > trials_for_train(num_train);
+    for (size_t t = 0; t < trial_indexes.size(); t++)
+      trials_for_train[trial_indexes[t].first].push_back(t);
+
+    // Score "batch_size" enrollment speakers at a time against all the test
+    // iVectors that appear in their trials.
+    std::vector<BaseFloat> trial_scores(trials.size());
+    std::vector<int32> test_column(num_test, -1);
+    for (int32 start = 0; start < num_train; start += batch_size) {
+      int32 end = std::min(start + batch_size, num_train);
+      std::vector<int32> batch_tests;
+      for (int32 i = start; i < end; i++) {
+        for (size_t k = 0; k < trials_for_train[i].size(); k++) {
+          int32 j = trial_indexes[trials_for_train[i][k]].second;
+          if (test_column[j] == -1) {
+            test_column[j] = batch_tests.size();
+            batch_tests.push_back(j);
+          }
+        }
       }
+      Matrix<double> train_mat(end - start, dim, kUndefined),
+          test_mat(batch_tests.size(), dim, kUndefined),
+          scores(end - start, batch_tests.size(), kUndefined);
+      for (int32 i = start; i < end; i++)
+        train_mat.Row(i - start).CopyFromVec(*(train_list[i]));
+      for (size_t c = 0; c < batch_tests.size(); c++)
+        test_mat.Row(c).CopyFromVec(*(test_list[batch_tests[c]]));
+      std::vector<int32> num_examples(train_num_examples.begin() + start,
+                                      train_num_examples.begin() + end);
+      plda.LogLikelihoodRatios(train_mat, num_examples, test_mat, &scores);
+      for (int32 i = start; i < end; i++) {
+        for (size_t k = 0; k < trials_for_train[i].size(); k++) {
+          int32 t = trials_for_train[i][k];
+          trial_scores[t] = scores(i - start,
+                                   test_column[trial_indexes[t].second]);
+        }
+      }
+      for (size_t c = 0; c < batch_tests.size(); c++)
+        test_column[batch_tests[c]] = -1;
+    }
 
-
-      BaseFloat score = plda.LogLikelihoodRatio(train_ivector_dbl,
-                                                num_train_examples,
-                                                test_ivector_dbl);
+    bool binary = false;
+    Output ko(scores_wxfilename, binary);
+    double sum = 0.0, sumsq = 0.0;
+    for (size_t t = 0; t < trials.size(); t++) {
+      BaseFloat score = trial_scores[t];
       sum += score;
       sumsq += score * score;
       num_trials_done++;
-      ko.Stream() << key1 << ' ' << key2 << ' ' << score << std::endl;
+      ko.Stream() << trials[t].first << ' ' << trials[t].second << ' '
+                  << score << std::endl;
     }
 
     for (HashType::iterator iter = train_ivectors.begin();
@@ -0,0 +1,140 @@
+// kws/kws-functions-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+
+#include "kws/kws-functions.h"
+#include "kws/kws-inverted-index.h"
+
+namespace kaldi {
+
+// Creates a random word lattice of the kind lattice-to-kws-index reads (i.e.
+// after lattice-align-words): state i is at frame 2 * i, and each arc from
+// state i to state j > i has a word label (or epsilon, for silence) and a
+// string of 2 * (j - i) transition-ids.  The last state is final, and every
+// state is on a path from the start to it.
+static void RandWordLattice(CompactLattice *clat) {
+  clat->DeleteStates();
+  int32 num_states = RandInt(2, 8);
+  for (int32 s = 0; s < num_states; s++)
+    clat->AddState();
+  clat->SetStart(0);
+  clat->SetFinal(num_states - 1,
+                 CompactLatticeWeight(LatticeWeight::One(),
+                                      std::vector<int32>()));
+  for (int32 s = 0; s + 1 < num_states; s++) {
+    int32 num_arcs = RandInt(1, 3);
+    for (int32 n = 0; n < num_arcs; n++) {
+      int32 next_state = (n == 0 ? s + 1 :
+                          RandInt(s + 1, std::min(s + 2, num_states - 1))),
+          word = (RandInt(0, 4) == 0 ? 0 : RandInt(1, 4));
+      std::vector<int32> string(2 * (next_state - s), 1);
+      CompactLatticeWeight weight(
+          LatticeWeight(2.0 * RandUniform(), 2.0 * RandUniform()), string);
+      clat->AddArc(s, CompactLatticeArc(word, word, weight, next_state));
+    }
+  }
+}
+
+// Searches for every keyword of one or two words from {1, ..., 4} in the
+// index and checks that the two indexes give the same hits.
+static void AssertIndexesGiveSameHits(const KwsLexicographicFst &index1,
+                                      const KwsLexicographicFst &index2) {
+  KwsInvertedIndex inverted_index1(index1), inverted_index2(index2);
+  for (int32 w1 = 1; w1 <= 4; w1++) {
+    for (int32 w2 = 0; w2 <= 4; w2++) {
+      KwsLexicographicFst keyword;
+      keyword.AddState();
+      keyword.SetStart(0);
+      keyword.AddState();
+      keyword.AddArc(0, KwsLexicographicArc(w1, w1,
+                                            KwsLexicographicWeight::One(), 1));
+      if (w2 == 0) {
+        keyword.SetFinal(1, KwsLexicographicWeight::One());
+      } else {
+        keyword.AddState();
+        keyword.AddArc(1, KwsLexicographicArc(
+            w2, w2, KwsLexicographicWeight::One(), 2));
+        keyword.SetFinal(2, KwsLexicographicWeight::One());
+      }
+      std::vector<KwsSearchHit> hits1, hits2;
+      inverted_index1.Search(keyword, -1, &hits1);
+      inverted_index2.Search(keyword, -1, &hits2);
+      KALDI_ASSERT(hits1.size() == hits2.size());
+      for (size_t i = 0; i < hits1.size(); i++)
+        KALDI_ASSERT(hits1[i].utterance_id == hits2[i].utterance_id &&
+                     hits1[i].cluster_id == hits2[i].cluster_id &&
+                     fst::ApproxEqual(hits1[i].weight, hits2[i].weight,
+                                      1.0e-03));
+    }
+  }
+}
+
+// Creates per-utterance indexes with CreateKwsIndex() and checks that merging
+// them with KwsIndexMerger in batches, including merging the outputs of two
+// separate mergers as a second kws-index-union job would, gives the same
+// search results as the union of all of them, optimized once and not
+// optimized at all.
+void UnitTestKwsIndexMerger() {
+  for (int32 i = 0; i < 20; i++) {
+    int32 num_utts = RandInt(1, 8);
+    std::vector<KwsLexicographicFst> utt_indexes(num_utts);
+    KwsIndexOptions opts;
+    for (int32 u = 0; u < num_utts; u++) {
+      CompactLattice clat;
+      RandWordLattice(&clat);
+      std::ostringstream key;
+      key << "utt" << u;
+      KALDI_ASSERT(CreateKwsIndex(opts, key.str(), u + 1, &clat,
+                                  &(utt_indexes[u])));
+      KALDI_ASSERT(clat.NumStates() == 0);  // it frees the lattice.
+    }
+
+    KwsLexicographicFst union_index, ref_index, merged_index;
+    KwsIndexMerger union_merger(0, -1, false), ref_merger(0, -1, true);
+    for (int32 u = 0; u < num_utts; u++) {
+      union_merger.Accept(utt_indexes[u]);
+      ref_merger.Accept(utt_indexes[u]);
+    }
+    union_merger.Finish(&union_index);
+    ref_merger.Finish(&ref_index);
+
+    int32 batch_size = RandInt(1, 3), num_utts1 = RandInt(0, num_utts);
+    KwsLexicographicFst partial_index1, partial_index2;
+    KwsIndexMerger merger1(batch_size, -1, true),
+        merger2(batch_size, -1, true), merger3(batch_size, -1, true);
+    for (int32 u = 0; u < num_utts; u++)
+      (u < num_utts1 ? merger1 : merger2).Accept(utt_indexes[u]);
+    merger1.Finish(&partial_index1);
+    merger2.Finish(&partial_index2);
+    merger3.Accept(partial_index1);
+    merger3.Accept(partial_index2);
+    merger3.Finish(&merged_index);
+
+    AssertIndexesGiveSameHits(ref_index, union_index);
+    AssertIndexesGiveSameHits(ref_index, merged_index);
+  }
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestKwsIndexMerger();
+  std::cout << "Test OK.\n";
+  return 0;
+}
@@ -373,4 +373,119 @@ void MaybeDoSanityCheck(const KwsProductFst &product_transducer) {
   MaybeDoSanityCheck(index_transducer);
 }
 
+bool CreateKwsIndex(const KwsIndexOptions &opts,
+                    const std::string &key,
+                    int32 utterance_id,
+                    CompactLattice *clat,
+                    KwsLexicographicFst *index_transducer) {
+  int32 max_silence_frames = 0.5 +
+      opts.max_silence_frames /
+      static_cast<float>(opts.frame_subsampling_factor);
+  int32 max_states = -1;
+  if (opts.max_states_scale > 0) {
+    max_states = static_cast<int32>(
+        opts.max_states_scale * static_cast<BaseFloat>(clat->NumStates()));
+  }
+
+  // Topologically sort the lattice, if not already sorted.
+  uint64 props = clat->Properties(fst::kFstProperties, false);
+  if (!(props & fst::kTopSorted)) {
+    if (fst::TopSort(clat) == false) {
+      KALDI_WARN << "Cycles detected in lattice " << key;
+      return false;
+    }
+  }
+
+  // Pruning is not in Dogan and Murat's paper; the size of the factor
+  // transducer is roughly quadratic in the depth of the lattice, so removing
+  // the low-posterior parts first saves a lot of memory and time.
+  if (opts.beam != std::numeric_limits<BaseFloat>::infinity()) {
+    KALDI_VLOG(1) << "Pruning lattice...";
+    if (!PruneLattice(opts.beam, clat)) {
+      KALDI_WARN << "Error pruning lattice " << key;
+      return false;
+    }
+  }
+
+  // Get the alignments
+  std::vector<int32> state_times;
+  CompactLatticeStateTimes(*clat, &state_times);
+
+  // Cluster the arcs in the CompactLattice, write the cluster_id on the
+  // output label side.
+  // ClusterLattice() corresponds to the second part of the preprocessing in
+  // Dogan and Murat's paper -- clustering. Note that we do the first part
+  // of preprocessing (the weight pushing step) later when generating the
+  // factor transducer.
+  KALDI_VLOG(1) << "Arc clustering...";
+  if (!ClusterLattice(clat, state_times)) {
+    KALDI_WARN << "State id's and alignments do not match for lattice "
+               << key;
+    return false;
+  }
+
+  // The next part is something new, not in the Dogan and Can paper.  It is
+  // necessary because we have epsilon arcs, due to silences, in our
+  // lattices.  We modify the factor transducer, while maintaining
+  // equivalence, to ensure that states don't have both epsilon *and*
+  // non-epsilon arcs entering them.  (and the same, with "entering"
+  // replaced with "leaving").  Later we will find out which states have
+  // non-epsilon arcs leaving/entering them and use it to be more selective
+  // in adding arcs to connect them with the initial/final states.  The goal
+  // here is to disallow silences at the beginning or ending of a keyword
+  // occurrence.
+  EnsureEpsilonProperty(clat);
+  fst::TopSort(clat);
+  // We have to recompute the state times because they will have changed.
+  CompactLatticeStateTimes(*clat, &state_times);
+
+  // Generate factor transducer
+  // CreateFactorTransducer() corresponds to the "Factor Generation" part of
+  // Dogan and Murat's paper. But we also move the weight pushing step to
+  // this function as we have to compute the alphas and betas anyway.
+  KALDI_VLOG(1) << "Generating factor transducer...";
+  KwsProductFst factor_transducer;
+  if (!CreateFactorTransducer(*clat, state_times, utterance_id,
+                              &factor_transducer)) {
+    KALDI_WARN << "Cannot generate factor transducer for lattice " << key;
+    return false;
+  }
+  // We don't need the lattice any more; free its memory before the
+  // expensive steps below.
+  clat->DeleteStates();
+
+  MaybeDoSanityCheck(factor_transducer);
+
+  // Remove long silence arc
+  // We add the filtering step in our implementation. This is because gap
+  // between two successive words in a query term should be less than 0.5s
+  KALDI_VLOG(1) << "Removing long silence...";
+  RemoveLongSilences(max_silence_frames, state_times, &factor_transducer);
+
+  MaybeDoSanityCheck(factor_transducer);
+
+  // Do factor merging, and return a transducer in T*T*T semiring. This step
+  // corresponds to the "Factor Merging" part in Dogan and Murat's paper.
+  KALDI_VLOG(1) << "Merging factors...";
+  DoFactorMerging(&factor_transducer, index_transducer);
+  factor_transducer.DeleteStates();
+
+  MaybeDoSanityCheck(*index_transducer);
+
+  // Do factor disambiguation. It corresponds to the "Factor Disambiguation"
+  // step in Dogan and Murat's paper.
+  KALDI_VLOG(1) << "Doing factor disambiguation...";
+  DoFactorDisambiguation(index_transducer);
+
+  MaybeDoSanityCheck(*index_transducer);
+
+  // Optimize the above factor transducer. It corresponds to the
+  // "Optimization" step in the paper.
+  KALDI_VLOG(1) << "Optimizing factor transducer...";
+  OptimizeFactorTransducer(index_transducer, max_states, opts.allow_partial);
+
+  MaybeDoSanityCheck(*index_transducer);
+  return true;
+}
+
 }  // end namespace kaldi
@@ -21,8 +21,11 @@
 #ifndef KALDI_KWS_KWS_FUNCTIONS_H_
 #define KALDI_KWS_KWS_FUNCTIONS_H_
 
+#include <limits>
+#include <string>
 #include <vector>
 
+#include "itf/options-itf.h"
 #include "lat/kaldi-lattice.h"
 #include "kws/kaldi-kws.h"
 
@@ -100,6 +103,101 @@ void OptimizeFactorTransducer(KwsLexicographicFst *index_transducer,
                               int32 max_states,
                               bool allow_partial);
 
+struct KwsIndexOptions {
+  int32 frame_subsampling_factor;
+  int32 max_silence_frames;
+  BaseFloat max_states_scale;
+  bool allow_partial;
+  BaseFloat beam;
+
+  KwsIndexOptions(): frame_subsampling_factor(1), max_silence_frames(50),
+                     max_states_scale(4), allow_partial(true),
+                     beam(std::numeric_limits<BaseFloat>::infinity()) { }
+
+  void Register(OptionsItf *opts) {
+    opts->Register("frame-subsampling-factor", &frame_subsampling_factor,
+                   "Frame subsampling factor. (Default value 1)");
+    opts->Register("max-silence-frames", &max_silence_frames,
+                   "If --frame-subsampling-factor is used, --max-silence-frames "
+                   "is relative to the the input, not the output frame rate "
+                   "(we divide by frame-subsampling-factor and round to "
+                   "the closest integer, to get the number of symbols in the "
+                   "lattice).");
+    opts->Register("max-states-scale", &max_states_scale, "Number of states in "
+                   "the original lattice times this scale is the number of "
+                   "states allowed when optimizing the index. Negative number "
+                   "means no limit on the number of states.");
+    opts->Register("allow-partial", &allow_partial, "Allow partial output if "
+                   "fails to determinize, otherwise skip determinization if it "
+                   "fails.");
+    opts->Register("beam", &beam, "If finite, prune the lattice with this "
+                   "beam before creating the factor transducer.  This bounds "
+                   "the size of the factor transducer (and the memory and time "
+                   "needed to optimize it), at the cost of dropping "
+                   "low-posterior hits.");
+  }
+};
+
+// This function does the whole per-utterance indexing pipeline that is in
+// Dogan and Murat's paper (plus the pruning, silence-removal and epsilon
+// steps that we add): clustering, factor generation, factor merging, factor
+// disambiguation and optimization.  "clat" is consumed (it is modified and
+// then cleared as soon as the factor transducer has been created, so its
+// memory is freed early).  Returns false, with a warning, on failure.  It
+// does not touch any shared state, so it may be called from multiple threads.
+bool CreateKwsIndex(const KwsIndexOptions &opts,
+                    const std::string &key,
+                    int32 utterance_id,
+                    CompactLattice *clat,
+                    KwsLexicographicFst *index_transducer);
+
+// This class merges a stream of index transducers (e.g. the per-utterance
+// indexes, or the outputs of previous kws-index-union jobs) into a single
+// index.  Instead of taking the union of all the inputs and optimizing the
+// result in one go, which needs the whole un-optimized union in memory, it
+// takes the union of "batch_size" inputs at a time, optimizes it, and then
+// merges the optimized partial indexes pairwise, like a binary counter.  At
+// any time we hold at most one un-optimized batch plus a logarithmic number
+// of optimized partial indexes.  Because the optimization is
+// determinization and minimization of the encoded transducer, the result is
+// equivalent to the result of optimizing the full union.
+// If batch_size <= 0, it just takes the union of everything and optimizes
+// once at the end (the old behavior of kws-index-union).
+class KwsIndexMerger {
+ public:
+  KwsIndexMerger(int32 batch_size, int32 max_states, bool optimize):
+      batch_size_(batch_size), max_states_(max_states), optimize_(optimize),
+      num_pending_(0) { }
+
+  // Adds "index" to the index being built.
+  void Accept(const KwsLexicographicFst &index);
+
+  // Outputs the merged (and, if "optimize" was true, optimized) index.
+  // Must only be called once.
+  void Finish(KwsLexicographicFst *global_index);
+
+  ~KwsIndexMerger();
+ private:
+  void Optimize(KwsLexicographicFst *index) const;
+
+  // Adds an optimized partial index to "levels_", merging as necessary.
+  // Takes ownership of "index".
+  void AddToLevel(size_t level, KwsLexicographicFst *index);
+
+  int32 batch_size_;
+  int32 max_states_;
+  bool optimize_;
+
+  // The union of the inputs that have not been optimized yet.
+  KwsLexicographicFst pending_;
+  int32 num_pending_;
+
+  // levels_[i], if non-NULL, is an optimized index covering batch_size_ * 2^i
+  // inputs.
+  std::vector<KwsLexicographicFst*> levels_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(KwsIndexMerger);
+};
+
 // the following two functions will, if GetVerboseLevel() >= 2, check that the
 // cost of the second-best path in the transducers is not negative, and print
 // out some associated debugging info if GetVerboseLevel() >= 3.  The best path
@@ -137,4 +137,70 @@ void OptimizeFactorTransducer(KwsLexicographicFst *index_transducer,
   Decode(index_transducer, encoder);
 }
 
+void KwsIndexMerger::Optimize(KwsLexicographicFst *index) const {
+  if (!optimize_) return;
+  // Do the encoded epsilon removal, determinization and minimization.  This
+  // falls back to the un-determinized input if determinization fails, which
+  // should affect speed of search but not results.
+  OptimizeFactorTransducer(index, max_states_, false);
+}
+
+void KwsIndexMerger::AddToLevel(size_t level, KwsLexicographicFst *index) {
+  while (true) {
+    if (levels_.size() <= level)
+      levels_.resize(level + 1, NULL);
+    if (levels_[level] == NULL) {
+      levels_[level] = index;
+      return;
+    }
+    KALDI_VLOG(1) << "Merging partial indexes at level " << level;
+    fst::Union(levels_[level], *index);
+    delete index;
+    index = levels_[level];
+    levels_[level] = NULL;
+    Optimize(index);
+    level++;
+  }
+}
+
+void KwsIndexMerger::Accept(const KwsLexicographicFst &index) {
+  fst::Union(&pending_, index);
+  num_pending_++;
+  if (batch_size_ > 0 && num_pending_ >= batch_size_) {
+    KwsLexicographicFst *batch = new KwsLexicographicFst();
+    *batch = pending_;  // shallow copy.
+    pending_ = KwsLexicographicFst();
+    num_pending_ = 0;
+    Optimize(batch);
+    AddToLevel(0, batch);
+  }
+}
+
+void KwsIndexMerger::Finish(KwsLexicographicFst *global_index) {
+  // Combine the leftover batch and the partial indexes, smallest first.
+  *global_index = pending_;
+  pending_ = KwsLexicographicFst();
+  bool have_unoptimized = (num_pending_ > 0 || batch_size_ <= 0);
+  int32 num_parts = (num_pending_ > 0 ? 1 : 0);
+  num_pending_ = 0;
+  for (size_t i = 0; i < levels_.size(); i++) {
+    if (levels_[i] != NULL) {
+      fst::Union(global_index, *(levels_[i]));
+      delete levels_[i];
+      levels_[i] = NULL;
+      num_parts++;
+    }
+  }
+  levels_.clear();
+  // If everything is already in one optimized partial index, there is no
+  // need to optimize again.
+  if (num_parts > 1 || have_unoptimized)
+    Optimize(global_index);
+}
+
+KwsIndexMerger::~KwsIndexMerger() {
+  for (size_t i = 0; i < levels_.size(); i++)
+    delete levels_[i];
+}
+
 } // end namespace kaldi
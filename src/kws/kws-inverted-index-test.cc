@@ -0,0 +1,322 @@
+// kws/kws-inverted-index-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+
+#include "kws/kws-inverted-index.h"
+
+namespace kaldi {
+
+typedef KwsLexicographicArc Arc;
+typedef KwsLexicographicWeight Weight;
+
+// The costs are multiples of 0.5 and the times are integers, so that all the
+// sums are exact whatever order they are done in.
+static Weight RandIndexWeight() {
+  return Weight(RandInt(0, 10) * 0.5,
+                StdLStdWeight(RandInt(0, 20), RandInt(0, 20)));
+}
+
+// Creates a random acyclic index FST with the structure that kws-index-union
+// produces: word arcs (some of them epsilons) between non-final states, and
+// "posting" arcs, with the cluster id on the input side and the utterance id
+// on the output side, into final states that have no arcs out.
+static void RandIndexFst(KwsLexicographicFst *index) {
+  index->DeleteStates();
+  int32 num_word_states = RandInt(1, 10);
+  for (int32 s = 0; s < num_word_states; s++)
+    index->AddState();
+  index->SetStart(0);
+  for (int32 s = 0; s < num_word_states; s++) {
+    if (s + 1 < num_word_states) {
+      int32 num_arcs = RandInt(0, 4);
+      for (int32 n = 0; n < num_arcs; n++)
+        index->AddArc(s, Arc(RandInt(0, 4), 0, RandIndexWeight(),
+                             RandInt(s + 1, num_word_states - 1)));
+    }
+    int32 num_postings = RandInt(0, 2);
+    for (int32 n = 0; n < num_postings; n++) {
+      int32 final_state = index->AddState();
+      index->SetFinal(final_state, RandIndexWeight());
+      index->AddArc(s, Arc(RandInt(1, 3), RandInt(1, 5), RandIndexWeight(),
+                           final_state));
+    }
+  }
+}
+
+// Creates a random keyword FST, as kws-search would: a sequence of words,
+// each with one or two alternatives and possibly an epsilon arc that skips
+// it, with the costs in the first element of the weight.
+static void RandKeywordFst(KwsLexicographicFst *keyword) {
+  keyword->DeleteStates();
+  int32 num_words = RandInt(1, 3);
+  for (int32 s = 0; s <= num_words; s++)
+    keyword->AddState();
+  keyword->SetStart(0);
+  keyword->SetFinal(num_words, Weight::One());
+  for (int32 s = 0; s < num_words; s++) {
+    int32 num_arcs = RandInt(1, 2);
+    for (int32 n = 0; n < num_arcs; n++) {
+      int32 word = RandInt(1, 4);
+      keyword->AddArc(s, Arc(word, word,
+                             Weight(RandInt(0, 4) * 0.5, StdLStdWeight::One()),
+                             s + 1));
+    }
+    if (RandInt(0, 3) == 0)
+      keyword->AddArc(s, Arc(0, 0, Weight::One(), s + 1));
+  }
+}
+
+// Searches the index the way kws-search does without --inverted-index: the
+// cluster and utterance ids of the posting arcs are encoded as one output
+// label, and the hits are read off the result of composing the keyword with
+// the index, projecting on the output and minimizing.  Every path of the
+// result has exactly one (encoded) label, so the best weight of each hit is
+// the best weight over the arcs with that label of the forward cost, the arc
+// weight and the backward cost; this does not depend on the result having
+// the two-state structure that kws-search expects.
+static void ComposeSearch(const KwsLexicographicFst &keyword,
+                          const KwsLexicographicFst &index_in,
+                          std::vector<KwsSearchHit> *hits) {
+  KwsLexicographicFst index(index_in);
+  std::map<int32, std::pair<int32, int32> > label_decoder;
+  std::map<std::pair<int32, int32>, int32> label_encoder;
+  for (int32 s = 0; s < index.NumStates(); s++) {
+    for (fst::MutableArcIterator<KwsLexicographicFst> aiter(&index, s);
+         !aiter.Done(); aiter.Next()) {
+      Arc arc = aiter.Value();
+      if (index.Final(arc.nextstate) == Weight::Zero())
+        continue;
+      std::pair<int32, int32> utt_cluster(arc.olabel, arc.ilabel);
+      if (label_encoder.count(utt_cluster) == 0) {
+        int32 label = label_encoder.size() + 1;
+        label_encoder[utt_cluster] = label;
+        label_decoder[label] = utt_cluster;
+      }
+      arc.olabel = label_encoder[utt_cluster];
+      arc.ilabel = 0;
+      aiter.SetValue(arc);
+    }
+  }
+  fst::ArcSort(&index, fst::ILabelCompare<Arc>());
+
+  KwsLexicographicFst result;
+  fst::Compose(keyword, index, &result);
+  fst::Project(&result, fst::PROJECT_OUTPUT);
+  fst::Minimize(&result, static_cast<KwsLexicographicFst*>(NULL),
+                fst::kDelta, true);
+  fst::RmEpsilon(&result);
+
+  hits->clear();
+  if (result.Start() == fst::kNoStateId)
+    return;
+  std::vector<Weight> alpha, beta;
+  fst::ShortestDistance(result, &alpha);
+  fst::ShortestDistance(result, &beta, true);
+  std::map<std::pair<int32, int32>, Weight> best_hits;
+  for (int32 s = 0; s < result.NumStates(); s++) {
+    if (s >= alpha.size() || alpha[s] == Weight::Zero())
+      continue;
+    for (fst::ArcIterator<KwsLexicographicFst> aiter(result, s);
+         !aiter.Done(); aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      KALDI_ASSERT(arc.olabel != 0 && label_decoder.count(arc.olabel) != 0);
+      if (arc.nextstate >= beta.size() ||
+          beta[arc.nextstate] == Weight::Zero())
+        continue;
+      Weight w = fst::Times(fst::Times(alpha[s], arc.weight),
+                            beta[arc.nextstate]);
+      std::pair<int32, int32> key = label_decoder[arc.olabel];
+      if (best_hits.count(key) == 0)
+        best_hits[key] = w;
+      else
+        best_hits[key] = fst::Plus(best_hits[key], w);
+    }
+  }
+  for (std::map<std::pair<int32, int32>, Weight>::const_iterator
+           iter = best_hits.begin(); iter != best_hits.end(); ++iter) {
+    KwsSearchHit hit;
+    hit.utterance_id = iter->first.first;
+    hit.cluster_id = iter->first.second;
+    hit.weight = iter->second;
+    hits->push_back(hit);
+  }
+}
+
+static void AssertHitsEqual(const std::vector<KwsSearchHit> &hits1,
+                            const std::vector<KwsSearchHit> &hits2) {
+  KALDI_ASSERT(hits1.size() == hits2.size());
+  for (size_t i = 0; i < hits1.size(); i++) {
+    KALDI_ASSERT(hits1[i].utterance_id == hits2[i].utterance_id &&
+                 hits1[i].cluster_id == hits2[i].cluster_id &&
+                 fst::ApproxEqual(hits1[i].weight, hits2[i].weight));
+  }
+}
+
+// Checks that Search() gives the same hits as the composition-based search,
+// before and after writing and reading the index, and that with n_best > 0
+// it gives the n_best best of them.
+void UnitTestKwsInvertedIndexSearch() {
+  const char *filename = "tmp.kws-inverted-index-test";
+  for (int32 i = 0; i < 100; i++) {
+    KwsLexicographicFst index_fst;
+    RandIndexFst(&index_fst);
+    KwsInvertedIndex index(index_fst);
+    {
+      std::ofstream os(filename, std::ios::out | std::ios::binary);
+      index.Write(os);
+    }
+    KwsInvertedIndex index_read;
+    index_read.Read(filename, RandInt(0, 1) == 0);
+    KALDI_ASSERT(index_read.NumStates() == index.NumStates() &&
+                 index_read.NumArcs() == index.NumArcs() &&
+                 index_read.NumPostings() == index.NumPostings());
+
+    for (int32 j = 0; j < 5; j++) {
+      KwsLexicographicFst keyword;
+      RandKeywordFst(&keyword);
+      std::vector<KwsSearchHit> hits, hits_read, ref_hits;
+      index.Search(keyword, -1, &hits);
+      index_read.Search(keyword, -1, &hits_read);
+      ComposeSearch(keyword, index_fst, &ref_hits);
+      AssertHitsEqual(hits, ref_hits);
+      AssertHitsEqual(hits_read, ref_hits);
+
+      int32 n_best = RandInt(1, 3);
+      std::vector<KwsSearchHit> nbest_hits;
+      index.Search(keyword, n_best, &nbest_hits);
+      KALDI_ASSERT(nbest_hits.size() ==
+                   std::min<size_t>(n_best, ref_hits.size()));
+      // None of the hits left out may be better than a hit that was kept.
+      fst::NaturalLess<Weight> less;
+      for (size_t k = 0; k < ref_hits.size(); k++) {
+        bool kept = false;
+        for (size_t l = 0; l < nbest_hits.size(); l++)
+          if (nbest_hits[l].utterance_id == ref_hits[k].utterance_id &&
+              nbest_hits[l].cluster_id == ref_hits[k].cluster_id)
+            kept = true;
+        if (kept) continue;
+        for (size_t l = 0; l < nbest_hits.size(); l++)
+          KALDI_ASSERT(!less(ref_hits[k].weight, nbest_hits[l].weight));
+      }
+    }
+  }
+  unlink(filename);
+}
+
+// Checks that Read() refuses an index whose per-state arc offsets do not
+// start at zero.
+void UnitTestKwsInvertedIndexCorrupted() {
+  const char *filename = "tmp.kws-inverted-index-test";
+  KwsLexicographicFst index_fst;
+  RandIndexFst(&index_fst);
+  KwsInvertedIndex index(index_fst);
+  std::ostringstream data_os;
+  index.Write(data_os);
+  std::string data = data_os.str();
+  // The header is 48 bytes; the arc offsets follow it.
+  int64 bad_offset = 1;
+  KALDI_ASSERT(data.size() >= 48 + sizeof(bad_offset));
+  data.replace(48, sizeof(bad_offset),
+               reinterpret_cast<const char*>(&bad_offset),
+               sizeof(bad_offset));
+  {
+    std::ofstream os(filename, std::ios::out | std::ios::binary);
+    os << data;
+  }
+  bool threw = false;
+  try {
+    KwsInvertedIndex index_read;
+    index_read.Read(filename);
+  } catch (...) {
+    threw = true;
+  }
+  KALDI_ASSERT(threw);
+  unlink(filename);
+}
+
+// Checks that an arc with an out-of-range next-state is not noticed by
+// Read(), which does not read the arcs, but makes Search() throw when it
+// follows that arc.
+void UnitTestKwsInvertedIndexCorruptedArc() {
+  const char *filename = "tmp.kws-inverted-index-test";
+  // Word 1 from state 0 to state 1, which has a posting.
+  KwsLexicographicFst index_fst;
+  for (int32 s = 0; s < 3; s++)
+    index_fst.AddState();
+  index_fst.SetStart(0);
+  index_fst.AddArc(0, Arc(1, 0, RandIndexWeight(), 1));
+  index_fst.AddArc(1, Arc(1, 1, RandIndexWeight(), 2));
+  index_fst.SetFinal(2, RandIndexWeight());
+  KwsInvertedIndex index(index_fst);
+  KALDI_ASSERT(index.NumStates() == 3 && index.NumArcs() == 1);
+  std::ostringstream data_os;
+  index.Write(data_os);
+  std::string data = data_os.str();
+  // The header is 48 bytes, followed by two arrays of NumStates() + 1 int64
+  // offsets and then the arcs; the next-state is the second int32 of an arc.
+  size_t nextstate_pos = 48 + 2 * sizeof(int64) * (index.NumStates() + 1) +
+      sizeof(int32);
+  int32 bad_nextstate = 1000;
+  KALDI_ASSERT(data.size() >= nextstate_pos + sizeof(bad_nextstate));
+  data.replace(nextstate_pos, sizeof(bad_nextstate),
+               reinterpret_cast<const char*>(&bad_nextstate),
+               sizeof(bad_nextstate));
+  {
+    std::ofstream os(filename, std::ios::out | std::ios::binary);
+    os << data;
+  }
+  KwsInvertedIndex index_read;
+  index_read.Read(filename);
+
+  KwsLexicographicFst keyword;
+  keyword.AddState();
+  keyword.AddState();
+  keyword.SetStart(0);
+  keyword.SetFinal(1, Weight::One());
+  keyword.AddArc(0, Arc(2, 2, Weight::One(), 1));
+  std::vector<KwsSearchHit> hits;
+  // A keyword that does not use the arc is fine.
+  index_read.Search(keyword, -1, &hits);
+  KALDI_ASSERT(hits.empty());
+
+  keyword.DeleteArcs(0);
+  keyword.AddArc(0, Arc(1, 1, Weight::One(), 1));
+  bool threw = false;
+  try {
+    index_read.Search(keyword, -1, &hits);
+  } catch (...) {
+    threw = true;
+  }
+  KALDI_ASSERT(threw);
+  unlink(filename);
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestKwsInvertedIndexSearch();
+  UnitTestKwsInvertedIndexCorrupted();
+  UnitTestKwsInvertedIndexCorruptedArc();
+  std::cout << "Test OK.\n";
+  return 0;
+}
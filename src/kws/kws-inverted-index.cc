@@ -0,0 +1,389 @@
+// kws/kws-inverted-index.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <map>
+#include <unordered_map>
+
+#include "kws/kws-inverted-index.h"
+
+namespace kaldi {
+
+static const char kKwsInvertedIndexMagic[8] =
+    { 'K', 'W', 'S', 'I', 'N', 'V', '1', '\0' };
+
+static inline size_t RoundUpTo8(size_t n) { return (n + 7) & ~static_cast<size_t>(7); }
+
+// Works out the byte offsets of the sections of the file: the per-state arc
+// offsets, the per-state posting offsets, the arcs, the weights and the
+// postings; returns the total size.
+template<class Header, class Arc, class Posting>
+static size_t GetSectionOffsets(const Header &header,
+                                std::vector<size_t> *offsets) {
+  offsets->resize(5);
+  size_t pos = RoundUpTo8(sizeof(Header));
+  (*offsets)[0] = pos;
+  pos += sizeof(int64) * (header.num_states + 1);
+  (*offsets)[1] = pos;
+  pos += sizeof(int64) * (header.num_states + 1);
+  (*offsets)[2] = pos;
+  pos = RoundUpTo8(pos + sizeof(Arc) * header.num_arcs);
+  (*offsets)[3] = pos;
+  pos = RoundUpTo8(pos + sizeof(float) * 3 * header.num_weights);
+  (*offsets)[4] = pos;
+  pos = RoundUpTo8(pos + sizeof(Posting) * header.num_postings);
+  return pos;
+}
+
+KwsInvertedIndex::KwsInvertedIndex():
+    num_bytes_(0), header_(NULL), arc_offsets_(NULL), posting_offsets_(NULL),
+    arcs_(NULL), weights_(NULL), postings_(NULL) { }
+
+KwsInvertedIndex::KwsInvertedIndex(const KwsLexicographicFst &index_fst):
+    num_bytes_(0), header_(NULL), arc_offsets_(NULL), posting_offsets_(NULL),
+    arcs_(NULL), weights_(NULL), postings_(NULL) {
+  typedef KwsLexicographicArc FstArc;
+  typedef KwsLexicographicWeight Weight;
+  typedef FstArc::StateId StateId;
+
+  Header header;
+  memcpy(header.magic, kKwsInvertedIndexMagic, sizeof(header.magic));
+  header.num_states = index_fst.NumStates();
+  header.start_state = index_fst.Start();
+  KALDI_ASSERT(header.num_states < std::numeric_limits<int32>::max());
+
+  std::vector<int64> arc_offsets(header.num_states + 1, 0),
+      posting_offsets(header.num_states + 1, 0);
+  std::vector<Arc> arcs;
+  std::vector<Posting> postings;
+  std::vector<float> weights;
+  // Maps from the (score, begin-time, end-time) triple to the weight id.
+  std::map<std::pair<float, std::pair<float, float> >, int32> weight_to_id;
+
+  for (StateId s = 0; s < header.num_states; s++) {
+    arc_offsets[s] = arcs.size();
+    posting_offsets[s] = postings.size();
+    size_t first_arc = arcs.size();
+    for (fst::ArcIterator<KwsLexicographicFst> aiter(index_fst, s);
+         !aiter.Done(); aiter.Next()) {
+      const FstArc &arc = aiter.Value();
+      Weight next_final = index_fst.Final(arc.nextstate);
+      if (next_final != Weight::Zero()) {
+        // This is a posting arc: see the label-moving in kws-search.cc.
+        if (index_fst.NumArcs(arc.nextstate) != 0)
+          KALDI_ERR << "Index FST has an arc out of a final state; this "
+                    << "is not the structure we expected.";
+        Weight w = fst::Times(arc.weight, next_final);
+        Posting posting;
+        posting.utterance_id = arc.olabel;
+        posting.cluster_id = arc.ilabel;
+        posting.weight[0] = w.Value1().Value();
+        posting.weight[1] = w.Value2().Value1().Value();
+        posting.weight[2] = w.Value2().Value2().Value();
+        postings.push_back(posting);
+      } else {
+        if (arc.olabel != 0)
+          KALDI_ERR << "Index FST has output label on a non-final arc; "
+                    << "this is not the structure we expected.";
+        std::pair<float, std::pair<float, float> > triple(
+            arc.weight.Value1().Value(),
+            std::make_pair(arc.weight.Value2().Value1().Value(),
+                           arc.weight.Value2().Value2().Value()));
+        std::map<std::pair<float, std::pair<float, float> >, int32>::iterator
+            iter = weight_to_id.find(triple);
+        int32 weight_id;
+        if (iter == weight_to_id.end()) {
+          weight_id = weight_to_id.size();
+          weight_to_id[triple] = weight_id;
+          weights.push_back(triple.first);
+          weights.push_back(triple.second.first);
+          weights.push_back(triple.second.second);
+        } else {
+          weight_id = iter->second;
+        }
+        Arc new_arc;
+        new_arc.ilabel = arc.ilabel;
+        new_arc.nextstate = arc.nextstate;
+        new_arc.weight_id = weight_id;
+        arcs.push_back(new_arc);
+      }
+    }
+    std::stable_sort(arcs.begin() + first_arc, arcs.end(),
+                     [](const Arc &a, const Arc &b) {
+                       return a.ilabel < b.ilabel;
+                     });
+  }
+  arc_offsets[header.num_states] = arcs.size();
+  posting_offsets[header.num_states] = postings.size();
+  header.num_arcs = arcs.size();
+  header.num_weights = weights.size() / 3;
+  header.num_postings = postings.size();
+
+  std::vector<size_t> offsets;
+  size_t size = GetSectionOffsets<Header, Arc, Posting>(header, &offsets);
+  buffer_.resize(size / sizeof(uint64), 0);
+  char *data = reinterpret_cast<char*>(&(buffer_[0]));
+  memcpy(data, &header, sizeof(header));
+  memcpy(data + offsets[0], &(arc_offsets[0]),
+         sizeof(int64) * arc_offsets.size());
+  memcpy(data + offsets[1], &(posting_offsets[0]),
+         sizeof(int64) * posting_offsets.size());
+  if (!arcs.empty())
+    memcpy(data + offsets[2], &(arcs[0]), sizeof(Arc) * arcs.size());
+  if (!weights.empty())
+    memcpy(data + offsets[3], &(weights[0]), sizeof(float) * weights.size());
+  if (!postings.empty())
+    memcpy(data + offsets[4], &(postings[0]),
+           sizeof(Posting) * postings.size());
+  SetPointers(data, size);
+}
+
+void KwsInvertedIndex::SetPointers(const char *data, size_t size) {
+  if (size < sizeof(Header) ||
+      memcmp(data, kKwsInvertedIndexMagic, sizeof(kKwsInvertedIndexMagic)) != 0)
+    KALDI_ERR << "Not a keyword-search inverted index (or wrong version).";
+  header_ = reinterpret_cast<const Header*>(data);
+  if (header_->num_states < 0 || header_->num_arcs < 0 ||
+      header_->num_weights < 0 || header_->num_postings < 0)
+    KALDI_ERR << "Corrupted keyword-search inverted index.";
+  std::vector<size_t> offsets;
+  size_t expected_size =
+      GetSectionOffsets<Header, Arc, Posting>(*header_, &offsets);
+  if (size != expected_size)
+    KALDI_ERR << "Keyword-search inverted index has wrong size " << size
+              << ", expected " << expected_size << " (corrupted file, or "
+              << "written on a machine with different byte order?)";
+  num_bytes_ = size;
+  arc_offsets_ = reinterpret_cast<const int64*>(data + offsets[0]);
+  posting_offsets_ = reinterpret_cast<const int64*>(data + offsets[1]);
+  arcs_ = reinterpret_cast<const Arc*>(data + offsets[2]);
+  weights_ = reinterpret_cast<const float*>(data + offsets[3]);
+  postings_ = reinterpret_cast<const Posting*>(data + offsets[4]);
+
+  // Only check what we can without reading the per-state data, which may be
+  // large and memory-mapped; Search() checks the offsets of each state it
+  // visits and the arcs it follows (see CheckState() and CheckArc()).
+  int64 num_states = header_->num_states;
+  if (header_->start_state < -1 || header_->start_state >= num_states ||
+      arc_offsets_[0] != 0 || posting_offsets_[0] != 0 ||
+      arc_offsets_[num_states] != header_->num_arcs ||
+      posting_offsets_[num_states] != header_->num_postings)
+    ReportCorrupted();
+}
+
+void KwsInvertedIndex::ReportCorrupted() const {
+  KALDI_ERR << "Invalid offsets or indexes in keyword-search inverted "
+            << "index (corrupted file?)";
+}
+
+void KwsInvertedIndex::Write(std::ostream &os) const {
+  KALDI_ASSERT(header_ != NULL);
+  os.write(reinterpret_cast<const char*>(header_), num_bytes_);
+  if (!os.good())
+    KALDI_ERR << "Error writing keyword-search inverted index.";
+}
+
+void KwsInvertedIndex::Read(const std::string &rxfilename, bool allow_mmap) {
+  buffer_.clear();
+  if (!file_.Open(rxfilename, allow_mmap))
+    KALDI_ERR << "Error reading keyword-search inverted index from "
+              << PrintableRxfilename(rxfilename);
+  SetPointers(file_.Data(), file_.Size());
+  KALDI_VLOG(1) << "Read inverted index with " << NumStates() << " states, "
+                << NumArcs() << " arcs and " << NumPostings() << " postings"
+                << (file_.IsMapped() ? " (memory-mapped)." : ".");
+}
+
+inline void KwsInvertedIndex::CheckState(int64 s) const {
+  if (arc_offsets_[s] < 0 || arc_offsets_[s] > arc_offsets_[s + 1] ||
+      arc_offsets_[s + 1] > header_->num_arcs || posting_offsets_[s] < 0 ||
+      posting_offsets_[s] > posting_offsets_[s + 1] ||
+      posting_offsets_[s + 1] > header_->num_postings)
+    ReportCorrupted();
+}
+
+inline void KwsInvertedIndex::CheckArc(const Arc &arc) const {
+  if (arc.nextstate < 0 || arc.nextstate >= header_->num_states ||
+      arc.weight_id < 0 || arc.weight_id >= header_->num_weights)
+    ReportCorrupted();
+}
+
+inline KwsLexicographicWeight KwsInvertedIndex::ArcWeight(
+    const Arc &arc) const {
+  const float *w = weights_ + 3 * static_cast<size_t>(arc.weight_id);
+  return KwsLexicographicWeight(w[0], StdLStdWeight(w[1], w[2]));
+}
+
+void KwsInvertedIndex::Search(const KwsLexicographicFst &keyword,
+                              int32 n_best,
+                              std::vector<KwsSearchHit> *hits) const {
+  typedef KwsLexicographicArc FstArc;
+  typedef KwsLexicographicWeight Weight;
+  typedef FstArc::StateId StateId;
+  KALDI_ASSERT(header_ != NULL);
+  hits->clear();
+  if (keyword.Start() == fst::kNoStateId || header_->start_state < 0)
+    return;
+
+  // final_weights[k] is the total weight of getting from keyword state k to
+  // a final state using only arcs with epsilon output (the index side does
+  // not move after a posting arc, so this is what we need at the end).
+  StateId num_keyword_states = keyword.NumStates();
+  std::vector<Weight> final_weights(num_keyword_states);
+  for (StateId k = 0; k < num_keyword_states; k++)
+    final_weights[k] = keyword.Final(k);
+  for (StateId iter = 0; ; iter++) {
+    bool changed = false;
+    for (StateId k = num_keyword_states - 1; k >= 0; k--) {
+      for (fst::ArcIterator<KwsLexicographicFst> aiter(keyword, k);
+           !aiter.Done(); aiter.Next()) {
+        const FstArc &arc = aiter.Value();
+        if (arc.olabel != 0) continue;
+        Weight w = fst::Plus(final_weights[k],
+                             fst::Times(arc.weight,
+                                        final_weights[arc.nextstate]));
+        if (w != final_weights[k]) {
+          final_weights[k] = w;
+          changed = true;
+        }
+      }
+    }
+    if (!changed) break;
+    if (iter > num_keyword_states)
+      KALDI_ERR << "Keyword FST has epsilon cycles.";
+  }
+
+  // This is a shortest-distance computation over the pairs (keyword state,
+  // index state) of the composition.  Both FSTs are acyclic, so the simple
+  // queue-based relaxation terminates; the semiring is idempotent, so paths
+  // that the composition filter would merge do not change the result.
+  std::unordered_map<int64, int32> pair_to_id;
+  std::vector<std::pair<StateId, StateId> > pairs;
+  std::vector<Weight> distances;
+  std::vector<bool> in_queue;
+  std::deque<int32> queue;
+  std::map<std::pair<int32, int32>, Weight> best_hits;
+
+  int64 num_index_states = header_->num_states;
+  // Adds weight "w" to the distance of the pair (k, i).
+  auto relax = [&](StateId k, StateId i, const Weight &w) {
+    int64 key = static_cast<int64>(k) * num_index_states + i;
+    std::unordered_map<int64, int32>::iterator iter = pair_to_id.find(key);
+    if (iter == pair_to_id.end()) {
+      int32 id = pairs.size();
+      pair_to_id[key] = id;
+      pairs.push_back(std::make_pair(k, i));
+      distances.push_back(w);
+      in_queue.push_back(true);
+      queue.push_back(id);
+    } else {
+      int32 id = iter->second;
+      Weight new_w = fst::Plus(distances[id], w);
+      if (new_w != distances[id]) {
+        distances[id] = new_w;
+        if (!in_queue[id]) {
+          in_queue[id] = true;
+          queue.push_back(id);
+        }
+      }
+    }
+  };
+
+  relax(keyword.Start(), header_->start_state, Weight::One());
+  while (!queue.empty()) {
+    int32 id = queue.front();
+    queue.pop_front();
+    in_queue[id] = false;
+    StateId k = pairs[id].first, i = pairs[id].second;
+    Weight w = distances[id];
+
+    CheckState(i);
+    const Arc *arcs_begin = arcs_ + arc_offsets_[i],
+        *arcs_end = arcs_ + arc_offsets_[i + 1];
+    // Epsilon arcs on the index side (they sort first).
+    for (const Arc *a = arcs_begin; a != arcs_end && a->ilabel == 0; ++a) {
+      CheckArc(*a);
+      relax(k, a->nextstate, fst::Times(w, ArcWeight(*a)));
+    }
+
+    for (fst::ArcIterator<KwsLexicographicFst> aiter(keyword, k);
+         !aiter.Done(); aiter.Next()) {
+      const FstArc &karc = aiter.Value();
+      if (karc.olabel == 0) {
+        relax(karc.nextstate, i, fst::Times(w, karc.weight));
+        continue;
+      }
+      Arc target;
+      target.ilabel = karc.olabel;
+      const Arc *a = std::lower_bound(
+          arcs_begin, arcs_end, target,
+          [](const Arc &a, const Arc &b) { return a.ilabel < b.ilabel; });
+      for (; a != arcs_end && a->ilabel == karc.olabel; ++a) {
+        CheckArc(*a);
+        relax(karc.nextstate, a->nextstate,
+              fst::Times(fst::Times(w, karc.weight), ArcWeight(*a)));
+      }
+    }
+
+    if (final_weights[k] != Weight::Zero()) {
+      Weight w_final = fst::Times(w, final_weights[k]);
+      for (int64 p = posting_offsets_[i]; p < posting_offsets_[i + 1]; p++) {
+        const Posting &posting = postings_[p];
+        Weight hit_weight = fst::Times(
+            w_final, Weight(posting.weight[0],
+                            StdLStdWeight(posting.weight[1],
+                                          posting.weight[2])));
+        std::pair<int32, int32> hit_key(posting.utterance_id,
+                                        posting.cluster_id);
+        std::map<std::pair<int32, int32>, Weight>::iterator
+            iter = best_hits.find(hit_key);
+        if (iter == best_hits.end())
+          best_hits[hit_key] = hit_weight;
+        else
+          iter->second = fst::Plus(iter->second, hit_weight);
+      }
+    }
+  }
+
+  hits->reserve(best_hits.size());
+  for (std::map<std::pair<int32, int32>, Weight>::const_iterator
+           iter = best_hits.begin(); iter != best_hits.end(); ++iter) {
+    KwsSearchHit hit;
+    hit.utterance_id = iter->first.first;
+    hit.cluster_id = iter->first.second;
+    hit.weight = iter->second;
+    hits->push_back(hit);
+  }
+  if (n_best > 0 && hits->size() > static_cast<size_t>(n_best)) {
+    fst::NaturalLess<Weight> less;
+    std::stable_sort(hits->begin(), hits->end(),
+                     [&less](const KwsSearchHit &a, const KwsSearchHit &b) {
+                       return less(a.weight, b.weight);
+                     });
+    hits->resize(n_best);
+    std::sort(hits->begin(), hits->end(),
+              [](const KwsSearchHit &a, const KwsSearchHit &b) {
+                return std::make_pair(a.utterance_id, a.cluster_id) <
+                    std::make_pair(b.utterance_id, b.cluster_id);
+              });
+  }
+}
+
+}  // namespace kaldi
@@ -0,0 +1,150 @@
+// kws/kws-inverted-index.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_KWS_KWS_INVERTED_INDEX_H_
+#define KALDI_KWS_KWS_INVERTED_INDEX_H_
+
+#include <string>
+#include <vector>
+
+#include "kws/kaldi-kws.h"
+#include "util/kaldi-mmap.h"
+
+namespace kaldi {
+
+/// One search result: a cluster of occurrences of the keyword in an
+/// utterance.  The weight is (negated log posterior, begin frame, end
+/// frame), as in the index.
+struct KwsSearchHit {
+  int32 utterance_id;
+  int32 cluster_id;  // the disambiguation symbol of the factor.
+  KwsLexicographicWeight weight;
+};
+
+/**
+   KwsInvertedIndex is a read-only, flat representation of the index FST
+   produced by lattice-to-kws-index and kws-index-union, designed to be
+   searched in place from a memory-mapped file, so that a search job does not
+   have to read and convert the whole index before answering the first query,
+   and so that several search jobs on the same machine share one copy of it.
+
+   The index FST is a (determinized, minimized) factor automaton: paths from
+   the start state spell word sequences, and the arcs into final states (the
+   "posting" arcs) carry the utterance id on the output side and a cluster
+   id (disambiguation symbol) on the input side.  We store the word arcs of
+   each state sorted by word, with their weights in a separate table of
+   distinct weights (most arcs share a few weights, so this is a lot smaller
+   than the FST), and the posting arcs of each state in a separate array
+   together with the weight of their final state.  The prefix and suffix
+   sharing of the minimized FST is kept, which is what makes the index
+   small; answering a query only touches the states reached by the keyword.
+
+   Searching gives the same hits as kws-search does by composing the keyword
+   with the index FST (projecting on the output, minimizing and optionally
+   taking the n-best): for each (utterance, cluster) pair, the best weight
+   over all the matching paths.
+
+   The file format is the in-memory format (native byte order): a header,
+   then int64 per-state offsets into the word arcs and postings, then the
+   arrays themselves, each 8-byte aligned.
+ */
+class KwsInvertedIndex {
+ public:
+  KwsInvertedIndex();
+
+  /// Creates the index from an index FST, as written by kws-index-union
+  /// (with key "global").
+  explicit KwsInvertedIndex(const KwsLexicographicFst &index_fst);
+
+  /// Writes the index; it is always in binary.
+  void Write(std::ostream &os) const;
+
+  /// Reads the index; it is memory-mapped if "rxfilename" is an ordinary file
+  /// and "allow_mmap" is true.  Throws on error, including if the header or
+  /// the first and last per-state offsets are inconsistent with the size of
+  /// the file.  The rest of the data is only checked as Search() uses it.
+  void Read(const std::string &rxfilename, bool allow_mmap = true);
+
+  /// Finds the occurrences of the keyword, which must be an acceptor (or
+  /// transducer, in which case its output labels are matched against the
+  /// index) whose weights are in the first element of the weight, as produced
+  /// by kws-search.  If n_best > 0, only the n_best best hits are output.
+  /// The hits are output sorted on (utterance_id, cluster_id).  Throws if
+  /// the offsets or indexes it reads from the index are out of range.
+  void Search(const KwsLexicographicFst &keyword,
+              int32 n_best,
+              std::vector<KwsSearchHit> *hits) const;
+
+  int64 NumStates() const { return header_ ? header_->num_states : 0; }
+  int64 NumArcs() const { return header_ ? header_->num_arcs : 0; }
+  int64 NumPostings() const { return header_ ? header_->num_postings : 0; }
+  int64 NumBytes() const { return num_bytes_; }
+
+ private:
+  struct Header {
+    char magic[8];
+    int64 num_states;
+    int64 start_state;
+    int64 num_arcs;
+    int64 num_weights;
+    int64 num_postings;
+  };
+  struct Arc {
+    int32 ilabel;
+    int32 nextstate;
+    int32 weight_id;
+  };
+  struct Posting {
+    int32 utterance_id;
+    int32 cluster_id;
+    float weight[3];
+  };
+
+  // Sets up the pointers below to point into "data", checking the header,
+  // the size and the first and last per-state offsets.  It does not read
+  // the rest of the data, so that loading a memory-mapped index is cheap.
+  void SetPointers(const char *data, size_t size);
+
+  // These check that the offsets of state "s", and the next-state and weight
+  // of "arc", are in range, so that a corrupted file cannot make Search()
+  // read outside the data; they call ReportCorrupted() if not.
+  inline void CheckState(int64 s) const;
+  inline void CheckArc(const Arc &arc) const;
+  void ReportCorrupted() const;
+
+  inline KwsLexicographicWeight ArcWeight(const Arc &arc) const;
+
+  // Used to hold the data if the index was created in memory.
+  std::vector<uint64> buffer_;
+  // Used to hold the data if the index was read.
+  MappedFile file_;
+
+  size_t num_bytes_;
+  const Header *header_;
+  const int64 *arc_offsets_;  // dimension num_states + 1.
+  const int64 *posting_offsets_;  // dimension num_states + 1.
+  const Arc *arcs_;  // dimension num_arcs; sorted on ilabel for each state.
+  const float *weights_;  // dimension num_weights * 3.
+  const Posting *postings_;  // dimension num_postings.
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(KwsInvertedIndex);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_KWS_KWS_INVERTED_INDEX_H_
@@ -0,0 +1,67 @@
+// kwsbin/kws-index-to-inverted.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "kws/kaldi-kws.h"
+#include "kws/kws-inverted-index.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Convert the index produced by kws-index-union (key \"global\") into\n"
+        "the flat inverted-index format, which kws-search --inverted-index\n"
+        "searches in place (memory-mapped) instead of loading and composing\n"
+        "with the index FST.  The search results are the same.\n"
+        "\n"
+        "Usage: kws-index-to-inverted [options] <index-rspecifier> "
+        "<inverted-index-wxfilename>\n"
+        " e.g.: kws-index-to-inverted ark:global.idx global.inv\n";
+
+    ParseOptions po(usage);
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string index_rspecifier = po.GetArg(1),
+        inverted_index_wxfilename = po.GetArg(2);
+
+    RandomAccessTableReader< fst::VectorFstTplHolder<KwsLexicographicArc> >
+                                                index_reader(index_rspecifier);
+    // Index has key "global"
+    KwsInvertedIndex inverted_index(index_reader.Value("global"));
+
+    Output ko(inverted_index_wxfilename, true, false);
+    inverted_index.Write(ko.Stream());
+
+    KALDI_LOG << "Wrote inverted index with " << inverted_index.NumStates()
+              << " states, " << inverted_index.NumArcs() << " arcs and "
+              << inverted_index.NumPostings() << " postings ("
+              << inverted_index.NumBytes() << " bytes) to "
+              << PrintableWxfilename(inverted_index_wxfilename);
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
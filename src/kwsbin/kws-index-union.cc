@@ -37,6 +37,11 @@ int main(int argc, char *argv[]) {
         "the output index is also in the T*T*T semiring. At the end of "
         "this program, encoded\n"
         "epsilon removal, determinization and minimization will be applied.\n"
+        "With --batch-size > 0, the inputs are merged incrementally: each\n"
+        "batch is optimized as it is read and the optimized partial indexes\n"
+        "are merged pairwise, so the whole un-optimized union is never held\n"
+        "in memory.  This also makes it practical to merge the outputs of\n"
+        "previous kws-index-union jobs (shards) hierarchically.\n"
         "\n"
         "Usage: kws-index-union [options]  index-rspecifier index-wspecifier\n"
         " e.g.: kws-index-union ark:input.idx ark:global.idx\n";
@@ -46,12 +51,17 @@ int main(int argc, char *argv[]) {
     bool strict = true;
     bool skip_opt = false;
     int32 max_states = -1;
+    int32 batch_size = 0;
     po.Register("strict", &strict,
         "Will allow 0 lattice if it is set to false.");
     po.Register("skip-optimization", &skip_opt,
         "Skip optimization if it's set to true.");
     po.Register("max-states", &max_states,
         "Maximum states for DeterminizeStar.");
+    po.Register("batch-size", &batch_size,
+        "If > 0, optimize the union of every this-many input indexes as "
+        "they are read and merge the results incrementally (see usage "
+        "message).  Ignored if --skip-optimization=true.");
 
     po.Read(argc, argv);
 
@@ -69,34 +79,18 @@ int main(int argc, char *argv[]) {
                                                 index_writer(index_wspecifier);
 
     int32 n_done = 0;
-    KwsLexicographicFst global_index;
+    if (skip_opt) {
+      KALDI_LOG << "Skipping index optimization...";
+      batch_size = 0;
+    }
+    KwsIndexMerger merger(batch_size, max_states, !skip_opt);
     for (; !index_reader.Done(); index_reader.Next()) {
-      std::string key = index_reader.Key();
-      KwsLexicographicFst index = index_reader.Value();
+      merger.Accept(index_reader.Value());
       index_reader.FreeCurrent();
-
-      Union(&global_index, index);
-
       n_done++;
     }
-
-    if (skip_opt == false) {
-      // Do the encoded epsilon removal, determinization and minimization
-      KwsLexicographicFst ifst = global_index;
-      EncodeMapper<KwsLexicographicArc> encoder(kEncodeLabels, ENCODE);
-      Encode(&ifst, &encoder);
-      try {
-        DeterminizeStar(ifst, &global_index, kDelta, NULL, max_states);
-      } catch(const std::exception &e) {
-        KALDI_WARN << e.what()
-                   << " (should affect speed of search but not results)";
-        global_index = ifst;
-      }
-      Minimize(&global_index, static_cast<KwsLexicographicFst*>(NULL), kDelta, true);
-      Decode(&global_index, encoder);
-    } else {
-      KALDI_LOG << "Skipping index optimization...";
-    }
+    KwsLexicographicFst global_index;
+    merger.Finish(&global_index);
 
     // Write the result
     index_writer.Write("global", global_index);
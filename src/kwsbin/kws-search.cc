@@ -24,6 +24,7 @@
 #include "util/common-utils.h"
 #include "fstext/kaldi-fst-io.h"
 #include "kws/kaldi-kws.h"
+#include "kws/kws-inverted-index.h"
 
 namespace kaldi {
 
@@ -186,10 +187,16 @@ int main(int argc, char *argv[]) {
         " e.g.: \n"
         "KW105-0198 7 335 376 16.01254 0 5766 5659 0\n"
         "\n"
+        "With --inverted-index=true, the first argument is instead the\n"
+        "filename of an index written by kws-index-to-inverted, which is\n"
+        "searched in place (the stats output is not supported then).\n"
+        "\n"
         "Usage: kws-search [options] <index-rspecifier> <keywords-rspecifier> "
         "<results-wspecifier> [<stats_wspecifier>]\n"
         " e.g.: kws-search ark:index.idx ark:keywords.fsts "
-                           "ark:results ark:stats\n";
+                           "ark:results ark:stats\n"
+        "  or:  kws-search --inverted-index=true global.inv ark:keywords.fsts "
+        "ark:results\n";
 
     ParseOptions po(usage);
 
@@ -199,6 +206,7 @@ int main(int argc, char *argv[]) {
     double negative_tolerance = -0.1;
     double keyword_beam = -1;
     int32 frame_subsampling_factor = 1;
+    bool inverted_index = false;
 
     po.Register("frame-subsampling-factor", &frame_subsampling_factor,
                 "Frame subsampling factor. (Default value 1)");
@@ -213,6 +221,10 @@ int main(int argc, char *argv[]) {
     po.Register("keyword-beam", &keyword_beam,
                 "Prune the FST with the given beam if the FST contains "
                 "multiple keywords.");
+    po.Register("inverted-index", &inverted_index,
+                "If true, the index argument is the rxfilename of an index "
+                "created by kws-index-to-inverted, rather than an rspecifier "
+                "of the index FST.");
 
     if (n_best < 0 && n_best != -1) {
       KALDI_ERR << "Bad number for nbest";
@@ -239,52 +251,62 @@ int main(int argc, char *argv[]) {
         result_wspecifier = po.GetArg(3),
         stats_wspecifier = po.GetOptArg(4);
 
-    RandomAccessTableReader< VectorFstTplHolder<KwsLexicographicArc> >
-                                                index_reader(index_rspecifier);
     SequentialTableReader<VectorFstHolder> keyword_reader(keyword_rspecifier);
     VectorOfDoublesWriter result_writer(result_wspecifier);
     VectorOfDoublesWriter stats_writer(stats_wspecifier);
 
-
-    // Index has key "global"
-    KwsLexicographicFst index = index_reader.Value("global");
-
-    // First we have to remove the disambiguation symbols. But rather than
-    // removing them totally, we actually move them from input side to output
-    // side, making the output symbol a "combined" symbol of the disambiguation
-    // symbols and the utterance id's.
-    // Note that in Dogan and Murat's original paper, they simply remove the
-    // disambiguation symbol on the input symbol side, which will not allow us
-    // to do epsilon removal after composition with the keyword FST. They have
-    // to traverse the resulting FST.
-    int32 label_count = 1;
-    unordered_map<uint64, uint32> label_encoder;
+    KwsLexicographicFst index;
+    KwsInvertedIndex index_inverted;
     unordered_map<uint32, uint64> label_decoder;
-    for (StateIterator<KwsLexicographicFst> siter(index);
-                                           !siter.Done(); siter.Next()) {
-      StateId state_id = siter.Value();
-      for (MutableArcIterator<KwsLexicographicFst>
-           aiter(&index, state_id); !aiter.Done(); aiter.Next()) {
-        KwsLexicographicArc arc = aiter.Value();
-        // Skip the non-final arcs
-        if (index.Final(arc.nextstate) == Weight::Zero())
-          continue;
-        // Encode the input and output label of the final arc, and this is the
-        // new output label for this arc; set the input label to <epsilon>
-        uint64 osymbol = EncodeLabel(arc.ilabel, arc.olabel);
-        arc.ilabel = 0;
-        if (label_encoder.find(osymbol) == label_encoder.end()) {
-          arc.olabel = label_count;
-          label_encoder[osymbol] = label_count;
-          label_decoder[label_count] = osymbol;
-          label_count++;
-        } else {
-          arc.olabel = label_encoder[osymbol];
+
+    if (inverted_index) {
+      if (stats_wspecifier != "")
+        KALDI_ERR << "The stats output is not supported with "
+                  << "--inverted-index=true.";
+      index_inverted.Read(index_rspecifier);
+    } else {
+      RandomAccessTableReader< VectorFstTplHolder<KwsLexicographicArc> >
+                                                index_reader(index_rspecifier);
+      // Index has key "global"
+      index = index_reader.Value("global");
+
+      // First we have to remove the disambiguation symbols. But rather than
+      // removing them totally, we actually move them from input side to
+      // output side, making the output symbol a "combined" symbol of the
+      // disambiguation symbols and the utterance id's.
+      // Note that in Dogan and Murat's original paper, they simply remove the
+      // disambiguation symbol on the input symbol side, which will not allow
+      // us to do epsilon removal after composition with the keyword FST. They
+      // have to traverse the resulting FST.
+      int32 label_count = 1;
+      unordered_map<uint64, uint32> label_encoder;
+      for (StateIterator<KwsLexicographicFst> siter(index);
+                                             !siter.Done(); siter.Next()) {
+        StateId state_id = siter.Value();
+        for (MutableArcIterator<KwsLexicographicFst>
+             aiter(&index, state_id); !aiter.Done(); aiter.Next()) {
+          KwsLexicographicArc arc = aiter.Value();
+          // Skip the non-final arcs
+          if (index.Final(arc.nextstate) == Weight::Zero())
+            continue;
+          // Encode the input and output label of the final arc, and this is
+          // the new output label for this arc; set the input label to
+          // <epsilon>
+          uint64 osymbol = EncodeLabel(arc.ilabel, arc.olabel);
+          arc.ilabel = 0;
+          if (label_encoder.find(osymbol) == label_encoder.end()) {
+            arc.olabel = label_count;
+            label_encoder[osymbol] = label_count;
+            label_decoder[label_count] = osymbol;
+            label_count++;
+          } else {
+            arc.olabel = label_encoder[osymbol];
+          }
+          aiter.SetValue(arc);
         }
-        aiter.SetValue(arc);
       }
+      ArcSort(&index, fst::ILabelCompare<KwsLexicographicArc>());
     }
-    ArcSort(&index, fst::ILabelCompare<KwsLexicographicArc>());
 
     int32 n_done = 0;
     int32 n_fail = 0;
@@ -304,47 +326,67 @@ int main(int argc, char *argv[]) {
       }
 
       KwsLexicographicFst keyword_fst;
-      KwsLexicographicFst result_fst;
       Map(keyword, &keyword_fst, VectorFstToKwsLexicographicFstMapper());
-      Compose(keyword_fst, index, &result_fst);
-
-      if (stats_wspecifier != "") {
-        KwsLexicographicFst matched_seq(result_fst);
-        OutputDetailedStatistics(key,
-                                 matched_seq,
-                                 label_decoder,
-                                 &stats_writer);
-      }
 
-      Project(&result_fst, PROJECT_OUTPUT);
-      Minimize(&result_fst, (KwsLexicographicFst *) nullptr, kDelta, true);
-      ShortestPath(result_fst, &result_fst, n_best);
-      RmEpsilon(&result_fst);
+      // The utterance id and weight of each hit.
+      vector<std::pair<int32, Weight> > hits;
+      if (inverted_index) {
+        vector<KwsSearchHit> inverted_hits;
+        index_inverted.Search(keyword_fst, n_best, &inverted_hits);
+        for (size_t i = 0; i < inverted_hits.size(); i++)
+          hits.push_back(std::make_pair(inverted_hits[i].utterance_id,
+                                        inverted_hits[i].weight));
+      } else {
+        KwsLexicographicFst result_fst;
+        Compose(keyword_fst, index, &result_fst);
+
+        if (stats_wspecifier != "") {
+          KwsLexicographicFst matched_seq(result_fst);
+          OutputDetailedStatistics(key,
+                                   matched_seq,
+                                   label_decoder,
+                                   &stats_writer);
+        }
 
+        Project(&result_fst, PROJECT_OUTPUT);
+        Minimize(&result_fst, (KwsLexicographicFst *) nullptr, kDelta, true);
+        ShortestPath(result_fst, &result_fst, n_best);
+        RmEpsilon(&result_fst);
+
+        // No result found
+        if (result_fst.Start() == kNoStateId)
+          continue;
+
+        for (ArcIterator<KwsLexicographicFst>
+             aiter(result_fst, result_fst.Start()); !aiter.Done();
+             aiter.Next()) {
+          const KwsLexicographicArc &arc = aiter.Value();
+
+          // We're expecting a two-state FST
+          if (result_fst.Final(arc.nextstate) != Weight::One()) {
+            KALDI_WARN << "The resulting FST does not have "
+                       << "the expected structure for key " << key;
+            n_fail++;
+            continue;
+          }
+
+          uint64 osymbol = label_decoder[arc.olabel];
+          hits.push_back(std::make_pair(
+              static_cast<int32>(DecodeLabelUid(osymbol)), arc.weight));
+        }
+      }
       // No result found
-      if (result_fst.Start() == kNoStateId)
+      if (hits.empty())
         continue;
 
       // Got something here
       double score;
       int32 tbeg, tend, uid;
-      for (ArcIterator<KwsLexicographicFst>
-           aiter(result_fst, result_fst.Start()); !aiter.Done(); aiter.Next()) {
-        const KwsLexicographicArc &arc = aiter.Value();
-
-        // We're expecting a two-state FST
-        if (result_fst.Final(arc.nextstate) != Weight::One()) {
-          KALDI_WARN << "The resulting FST does not have "
-                     << "the expected structure for key " << key;
-          n_fail++;
-          continue;
-        }
-
-        uint64 osymbol = label_decoder[arc.olabel];
-        uid = static_cast<int32>(DecodeLabelUid(osymbol));
-        tbeg = arc.weight.Value2().Value1().Value();
-        tend = arc.weight.Value2().Value2().Value();
-        score = arc.weight.Value1().Value();
+      for (size_t i = 0; i < hits.size(); i++) {
+        uid = hits[i].first;
+        tbeg = hits[i].second.Value2().Value1().Value();
+        tend = hits[i].second.Value2().Value2().Value();
+        score = hits[i].second.Value1().Value();
 
         if (score < 0) {
           if (score < negative_tolerance) {
@@ -0,0 +1,155 @@
+// lat/lattice-functions-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "lat/kaldi-lattice.h"
+#include "lat/lattice-functions.h"
+#include "base/timer.h"
+
+
+namespace kaldi {
+using namespace fst;
+
+// Creates a random state-level lattice of the kind the decoders produce: the
+// states are arranged in frames, emitting arcs go from one frame to the next
+// and epsilon arcs go to later states within the same frame.  All states on
+// the last frame are final.
+Lattice *RandRawLattice(int32 num_frames, int32 states_per_frame) {
+  Lattice *lat = new Lattice;
+  int32 num_states = (num_frames + 1) * states_per_frame;
+  for (int32 s = 0; s < num_states; s++)
+    lat->AddState();
+  lat->SetStart(0);
+  for (int32 t = 0; t <= num_frames; t++) {
+    for (int32 i = 0; i < states_per_frame; i++) {
+      int32 s = t * states_per_frame + i;
+      if (t == num_frames) {
+        lat->SetFinal(s, LatticeWeight(RandUniform(), 0.0));
+        continue;
+      }
+      int32 num_arcs = 1 + Rand() % 3;
+      for (int32 n = 0; n < num_arcs; n++) {
+        int32 next_i = Rand() % states_per_frame,
+            next_s = (t + 1) * states_per_frame + next_i;
+        LatticeArc arc(1 + Rand() % 20, (Rand() % 2 == 0 ? 0 : 1 + Rand() % 10),
+                       LatticeWeight(5.0 * RandUniform(), 5.0 * RandUniform()),
+                       next_s);
+        lat->AddArc(s, arc);
+      }
+      if (i + 1 < states_per_frame && Rand() % 4 == 0) {
+        int32 next_s = s + 1 + Rand() % (states_per_frame - i - 1);
+        LatticeArc arc(0, 1 + Rand() % 10,
+                       LatticeWeight(RandUniform(), 0.0), next_s);
+        lat->AddArc(s, arc);
+      }
+    }
+  }
+  Connect(lat);
+  TopSort(lat);
+  return lat;
+}
+
+void AssertPosteriorsEqual(const Posterior &post1, const Posterior &post2) {
+  KALDI_ASSERT(post1.size() == post2.size());
+  for (size_t t = 0; t < post1.size(); t++) {
+    KALDI_ASSERT(post1[t].size() == post2[t].size());
+    for (size_t i = 0; i < post1[t].size(); i++) {
+      KALDI_ASSERT(post1[t][i].first == post2[t][i].first);
+      KALDI_ASSERT(ApproxEqual(post1[t][i].second, post2[t][i].second, 1.0e-04)
+                   || std::abs(post1[t][i].second - post2[t][i].second) < 1.0e-06);
+    }
+  }
+}
+
+void AssertLogProbsEqual(const std::vector<double> &a,
+                         const std::vector<double> &b) {
+  KALDI_ASSERT(a.size() == b.size());
+  for (size_t i = 0; i < a.size(); i++) {
+    if (a[i] == kLogZeroDouble || b[i] == kLogZeroDouble)
+      KALDI_ASSERT(a[i] == b[i]);
+    else
+      KALDI_ASSERT(std::abs(a[i] - b[i]) < 1.0e-06 * (1.0 + std::abs(a[i])));
+  }
+}
+
+void TestLatticeForwardBackwardLevelSync() {
+  int32 num_frames = 1 + Rand() % 20, states_per_frame = 1 + Rand() % 10;
+  Lattice *lat = RandRawLattice(num_frames, states_per_frame);
+  if (lat->NumStates() == 0) {
+    delete lat;
+    return;
+  }
+  Posterior post1, post2;
+  double ac_like1, ac_like2;
+  BaseFloat like1 = LatticeForwardBackward(*lat, &post1, &ac_like1),
+      like2 = LatticeForwardBackwardLevelSync(*lat, &post2, &ac_like2);
+  KALDI_ASSERT(ApproxEqual(like1, like2));
+  KALDI_ASSERT(ApproxEqual(ac_like1, ac_like2));
+  AssertPosteriorsEqual(post1, post2);
+
+  CompactLattice clat;
+  ConvertLattice(*lat, &clat);
+  TopSortCompactLatticeIfNeeded(&clat);
+  std::vector<double> alpha1, alpha2, beta1, beta2;
+  KALDI_ASSERT(ComputeCompactLatticeAlphas(clat, &alpha1) &&
+               ComputeCompactLatticeAlphasLevelSync(clat, &alpha2) &&
+               ComputeCompactLatticeBetas(clat, &beta1) &&
+               ComputeCompactLatticeBetasLevelSync(clat, &beta2));
+  AssertLogProbsEqual(alpha1, alpha2);
+  AssertLogProbsEqual(beta1, beta2);
+  delete lat;
+}
+
+// Compares the speed of the two implementations on a large lattice.
+void TestLatticeForwardBackwardSpeed() {
+  int32 num_frames = 2000, states_per_frame = 100;
+  Lattice *lat = RandRawLattice(num_frames, states_per_frame);
+  int64 num_arcs = NumArcs(*lat);
+  int32 num_iters = 3;
+  Posterior post1, post2;
+  double time1, time2;
+  {
+    Timer timer;
+    for (int32 i = 0; i < num_iters; i++)
+      LatticeForwardBackward(*lat, &post1);
+    time1 = timer.Elapsed();
+  }
+  {
+    Timer timer;
+    for (int32 i = 0; i < num_iters; i++)
+      LatticeForwardBackwardLevelSync(*lat, &post2);
+    time2 = timer.Elapsed();
+  }
+  AssertPosteriorsEqual(post1, post2);
+  KALDI_LOG << "For lattice with " << lat->NumStates() << " states and "
+            << num_arcs << " arcs, LatticeForwardBackward() processed "
+            << (num_arcs * num_iters / time1) << " arcs/sec, "
+            << "LatticeForwardBackwardLevelSync() processed "
+            << (num_arcs * num_iters / time2) << " arcs/sec.";
+  delete lat;
+}
+
+} // end namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  using kaldi::int32;
+  for (int32 i = 0; i < 20; i++)
+    TestLatticeForwardBackwardLevelSync();
+  TestLatticeForwardBackwardSpeed();
+  KALDI_LOG << "Success.";
+}
@@ -232,6 +232,331 @@ bool ComputeCompactLatticeBetas(const CompactLattice &clat,
   return true;
 }
 
+namespace {
+
+// This class holds a flattened copy of the arcs of a topologically sorted,
+// acyclic lattice, together with a grouping of the states into "levels" (a
+// state's level is the length, in arcs, of the longest path from the start
+// state to it).  No arc connects two states on the same level, so the alphas
+// (or betas) of all states on a level can be computed at once from those of
+// the previous (or next) levels; we do this with a vectorized log-sum-exp over
+// contiguous arrays, rather than with a LogAdd() per arc.  It works for both
+// Lattice and CompactLattice.
+template <class LatticeType>
+class LevelSyncForwardBackward {
+ public:
+  typedef typename LatticeType::Arc Arc;
+  typedef typename Arc::Weight Weight;
+  typedef typename Arc::StateId StateId;
+
+  // 'lat' is expected to be topologically sorted with start state 0.
+  explicit LevelSyncForwardBackward(const LatticeType &lat);
+
+  // Computes the alphas (log-probs of reaching each state from the start
+  // state, not including the final-prob).
+  void ComputeAlphas(std::vector<double> *alpha) const;
+
+  // Computes the betas (log-probs of reaching a final state from each state,
+  // including the final-prob).
+  void ComputeBetas(std::vector<double> *beta) const;
+
+  // Outputs the log-posterior (not normalized, i.e. you have to subtract the
+  // total log-prob) of each arc, in the order in which an ArcIterator would
+  // visit them state by state, and exponentiates it after subtracting
+  // 'tot_log_prob'.
+  void ComputeArcPosteriors(const std::vector<double> &alpha,
+                            const std::vector<double> &beta,
+                            double tot_log_prob,
+                            Vector<double> *arc_post) const;
+
+  int32 NumArcs() const { return arc_nextstate_.size(); }
+
+ private:
+  // Computes, for each of the segments of 'scores' delimited by consecutive
+  // elements of 'seg_begin', log(sum(exp(scores))) into the corresponding
+  // element of 'output'.  'scores' is destroyed.
+  static void SegmentedLogSumExp(const std::vector<int32> &seg_begin,
+                                 SubVector<double> *scores,
+                                 double *output);
+
+  int32 num_states_;
+  // The states, sorted by level.
+  std::vector<StateId> level_order_;
+  // The start of each level within level_order_ (with one extra element).
+  std::vector<int32> level_begin_;
+
+  // Outgoing arcs, indexed by state and then by arc, in the same order as the
+  // input lattice.
+  std::vector<int32> out_begin_;  // dimension num_states_ + 1.
+  std::vector<StateId> arc_nextstate_;
+  std::vector<double> arc_like_;  // negated cost of each arc.
+  std::vector<double> final_like_;  // negated final-cost of each state.
+
+  // Incoming arcs, grouped by destination state: in_begin_[s] is the start
+  // of the incoming arcs of state s within in_arc_.  in_arc_ contains the
+  // index of the arc in the outgoing-arc arrays above.
+  std::vector<int32> in_begin_;
+  std::vector<int32> in_arc_;
+  std::vector<StateId> arc_prevstate_;  // source state of each arc.
+};
+
+template <class LatticeType>
+LevelSyncForwardBackward<LatticeType>::LevelSyncForwardBackward(
+    const LatticeType &lat): num_states_(lat.NumStates()) {
+  out_begin_.resize(num_states_ + 1, 0);
+  final_like_.resize(num_states_);
+  std::vector<int32> num_in(num_states_ + 1, 0);
+  std::vector<int32> level(num_states_, 0);
+  int32 max_level = 0;
+  for (StateId s = 0; s < num_states_; s++) {
+    out_begin_[s] = arc_nextstate_.size();
+    final_like_[s] = -ConvertToCost(lat.Final(s));
+    for (fst::ArcIterator<LatticeType> aiter(lat, s); !aiter.Done();
+         aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      KALDI_ASSERT(arc.nextstate > s);  // because topologically sorted.
+      arc_nextstate_.push_back(arc.nextstate);
+      arc_prevstate_.push_back(s);
+      arc_like_.push_back(-ConvertToCost(arc.weight));
+      num_in[arc.nextstate]++;
+      if (level[s] + 1 > level[arc.nextstate]) {
+        level[arc.nextstate] = level[s] + 1;
+        if (level[s] + 1 > max_level) max_level = level[s] + 1;
+      }
+    }
+  }
+  int32 num_arcs = arc_nextstate_.size();
+  out_begin_[num_states_] = num_arcs;
+
+  // Counting-sort of states by level.
+  level_begin_.resize(max_level + 2, 0);
+  for (StateId s = 0; s < num_states_; s++)
+    level_begin_[level[s] + 1]++;
+  for (int32 l = 0; l <= max_level; l++)
+    level_begin_[l + 1] += level_begin_[l];
+  level_order_.resize(num_states_);
+  std::vector<int32> next_pos(level_begin_.begin(), level_begin_.end() - 1);
+  for (StateId s = 0; s < num_states_; s++)
+    level_order_[next_pos[level[s]]++] = s;
+
+  // Counting-sort of arcs by destination state.
+  in_begin_.resize(num_states_ + 1, 0);
+  for (StateId s = 0; s < num_states_; s++)
+    in_begin_[s + 1] = in_begin_[s] + num_in[s];
+  in_arc_.resize(num_arcs);
+  std::vector<int32> in_pos(in_begin_.begin(), in_begin_.end() - 1);
+  for (int32 a = 0; a < num_arcs; a++)
+    in_arc_[in_pos[arc_nextstate_[a]]++] = a;
+}
+
+template <class LatticeType>
+void LevelSyncForwardBackward<LatticeType>::SegmentedLogSumExp(
+    const std::vector<int32> &seg_begin,
+    SubVector<double> *scores,
+    double *output) {
+  int32 num_segments = seg_begin.size() - 1;
+  double *data = scores->Data();
+  std::vector<double> seg_max(num_segments);
+  for (int32 i = 0; i < num_segments; i++) {
+    double max = kLogZeroDouble;
+    for (int32 j = seg_begin[i]; j < seg_begin[i + 1]; j++)
+      if (data[j] > max) max = data[j];
+    seg_max[i] = max;
+    if (max == kLogZeroDouble) max = 0.0;  // avoid NaN's; exp gives 0 anyway.
+    for (int32 j = seg_begin[i]; j < seg_begin[i + 1]; j++)
+      data[j] -= max;
+  }
+  scores->ApplyExp();
+  for (int32 i = 0; i < num_segments; i++) {
+    if (seg_max[i] == kLogZeroDouble) {
+      output[i] = kLogZeroDouble;
+    } else {
+      double sum = 0.0;
+      for (int32 j = seg_begin[i]; j < seg_begin[i + 1]; j++)
+        sum += data[j];
+      output[i] = seg_max[i] + Log(sum);
+    }
+  }
+}
+
+template <class LatticeType>
+void LevelSyncForwardBackward<LatticeType>::ComputeAlphas(
+    std::vector<double> *alpha) const {
+  alpha->clear();
+  alpha->resize(num_states_, kLogZeroDouble);
+  if (num_states_ == 0) return;
+  (*alpha)[0] = 0.0;
+  int32 num_levels = level_begin_.size() - 1;
+  Vector<double> scores(NumArcs(), kUndefined);
+  std::vector<int32> seg_begin;
+  std::vector<double> level_alpha;
+  // Level zero only contains states without incoming arcs, so we start from
+  // level 1.
+  for (int32 l = 1; l < num_levels; l++) {
+    seg_begin.clear();
+    int32 n = 0;
+    for (int32 i = level_begin_[l]; i < level_begin_[l + 1]; i++) {
+      StateId s = level_order_[i];
+      seg_begin.push_back(n);
+      for (int32 k = in_begin_[s]; k < in_begin_[s + 1]; k++, n++) {
+        int32 a = in_arc_[k];
+        scores(n) = (*alpha)[arc_prevstate_[a]] + arc_like_[a];
+      }
+    }
+    seg_begin.push_back(n);
+    level_alpha.resize(seg_begin.size() - 1);
+    SubVector<double> level_scores(scores, 0, n);
+    SegmentedLogSumExp(seg_begin, &level_scores, &(level_alpha[0]));
+    for (int32 i = level_begin_[l]; i < level_begin_[l + 1]; i++)
+      (*alpha)[level_order_[i]] = level_alpha[i - level_begin_[l]];
+  }
+}
+
+template <class LatticeType>
+void LevelSyncForwardBackward<LatticeType>::ComputeBetas(
+    std::vector<double> *beta) const {
+  beta->clear();
+  beta->resize(num_states_, kLogZeroDouble);
+  int32 num_levels = level_begin_.size() - 1;
+  // The extra num_states_ elements are for the final-probs.
+  Vector<double> scores(NumArcs() + num_states_, kUndefined);
+  std::vector<int32> seg_begin;
+  std::vector<double> level_beta;
+  for (int32 l = num_levels - 1; l >= 0; l--) {
+    seg_begin.clear();
+    int32 n = 0;
+    for (int32 i = level_begin_[l]; i < level_begin_[l + 1]; i++) {
+      StateId s = level_order_[i];
+      seg_begin.push_back(n);
+      scores(n++) = final_like_[s];
+      for (int32 a = out_begin_[s]; a < out_begin_[s + 1]; a++, n++)
+        scores(n) = (*beta)[arc_nextstate_[a]] + arc_like_[a];
+    }
+    seg_begin.push_back(n);
+    level_beta.resize(seg_begin.size() - 1);
+    SubVector<double> level_scores(scores, 0, n);
+    SegmentedLogSumExp(seg_begin, &level_scores, &(level_beta[0]));
+    for (int32 i = level_begin_[l]; i < level_begin_[l + 1]; i++)
+      (*beta)[level_order_[i]] = level_beta[i - level_begin_[l]];
+  }
+}
+
+template <class LatticeType>
+void LevelSyncForwardBackward<LatticeType>::ComputeArcPosteriors(
+    const std::vector<double> &alpha,
+    const std::vector<double> &beta,
+    double tot_log_prob,
+    Vector<double> *arc_post) const {
+  int32 num_arcs = NumArcs();
+  arc_post->Resize(num_arcs, kUndefined);
+  double *data = arc_post->Data();
+  for (int32 a = 0; a < num_arcs; a++)
+    data[a] = alpha[arc_prevstate_[a]] + arc_like_[a] +
+        beta[arc_nextstate_[a]] - tot_log_prob;
+  arc_post->ApplyExp();
+}
+
+}  // namespace
+
+
+BaseFloat LatticeForwardBackwardLevelSync(const Lattice &lat,
+                                          Posterior *post,
+                                          double *acoustic_like_sum) {
+  using namespace fst;
+  typedef Lattice::Arc Arc;
+  typedef Arc::Weight Weight;
+  typedef Arc::StateId StateId;
+
+  if (acoustic_like_sum) *acoustic_like_sum = 0.0;
+
+  if (lat.Properties(fst::kTopSorted, true) == 0)
+    KALDI_ERR << "Input lattice must be topologically sorted.";
+  KALDI_ASSERT(lat.Start() == 0);
+
+  int32 num_states = lat.NumStates();
+  vector<int32> state_times;
+  int32 max_time = LatticeStateTimes(lat, &state_times);
+  post->clear();
+  post->resize(max_time);
+
+  LevelSyncForwardBackward<Lattice> fb(lat);
+  std::vector<double> alpha, beta;
+  fb.ComputeAlphas(&alpha);
+  fb.ComputeBetas(&beta);
+
+  double tot_forward_prob = kLogZeroDouble;
+  for (StateId s = 0; s < num_states; s++) {
+    Weight f = lat.Final(s);
+    if (f != Weight::Zero()) {
+      tot_forward_prob = LogAdd(tot_forward_prob, alpha[s] - ConvertToCost(f));
+      KALDI_ASSERT(state_times[s] == max_time &&
+                   "Lattice is inconsistent (final-prob not at max_time)");
+    }
+  }
+  double tot_backward_prob = beta[0];
+  if (!ApproxEqual(tot_forward_prob, tot_backward_prob, 1e-8)) {
+    KALDI_WARN << "Total forward probability over lattice = " << tot_forward_prob
+              << ", while total backward probability = " << tot_backward_prob;
+  }
+
+  // As in LatticeForwardBackward(), the posteriors are normalized by the
+  // total forward probability.
+  Vector<double> arc_post;
+  fb.ComputeArcPosteriors(alpha, beta, tot_forward_prob, &arc_post);
+  int32 a = 0;
+  for (StateId s = 0; s < num_states; s++) {
+    for (ArcIterator<Lattice> aiter(lat, s); !aiter.Done(); aiter.Next(), a++) {
+      const Arc &arc = aiter.Value();
+      double posterior = arc_post(a);
+      if (arc.ilabel != 0)
+        (*post)[state_times[s]].push_back(
+            std::make_pair(arc.ilabel, static_cast<BaseFloat>(posterior)));
+      if (acoustic_like_sum != NULL)
+        *acoustic_like_sum -= posterior * arc.weight.Value2();
+    }
+    if (acoustic_like_sum != NULL) {
+      Weight f = lat.Final(s);
+      if (f != Weight::Zero()) {
+        double posterior = Exp(alpha[s] - ConvertToCost(f) - tot_forward_prob);
+        *acoustic_like_sum -= posterior * f.Value2();
+      }
+    }
+  }
+  for (int32 t = 0; t < max_time; t++)
+    MergePairVectorSumming(&((*post)[t]));
+  return tot_backward_prob;
+}
+
+bool ComputeCompactLatticeAlphasLevelSync(const CompactLattice &clat,
+                                          vector<double> *alpha) {
+  if (clat.Properties(fst::kTopSorted, true) == 0) {
+    KALDI_WARN << "Input lattice must be topologically sorted.";
+    return false;
+  }
+  if (clat.Start() != 0) {
+    KALDI_WARN << "Input lattice must start from state 0.";
+    return false;
+  }
+  LevelSyncForwardBackward<CompactLattice> fb(clat);
+  fb.ComputeAlphas(alpha);
+  return true;
+}
+
+bool ComputeCompactLatticeBetasLevelSync(const CompactLattice &clat,
+                                         vector<double> *beta) {
+  if (clat.Properties(fst::kTopSorted, true) == 0) {
+    KALDI_WARN << "Input lattice must be topologically sorted.";
+    return false;
+  }
+  if (clat.Start() != 0) {
+    KALDI_WARN << "Input lattice must start from state 0.";
+    return false;
+  }
+  LevelSyncForwardBackward<CompactLattice> fb(clat);
+  fb.ComputeBetas(beta);
+  return true;
+}
+
 template<class LatType>  // could be Lattice or CompactLattice
 bool PruneLattice(BaseFloat beam, LatType *lat) {
   typedef typename LatType::Arc Arc;
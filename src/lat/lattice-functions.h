@@ -92,6 +92,25 @@ bool ComputeCompactLatticeAlphas(const CompactLattice &lat,
 bool ComputeCompactLatticeBetas(const CompactLattice &lat,
                                 std::vector<double> *beta);
 
+/// This does the same as LatticeForwardBackward() (and gives the same
+/// results, up to roundoff), but is faster for large lattices.  The states are
+/// grouped by their depth in the lattice, i.e. the number of arcs on the
+/// longest path to them from the start state; since no arc connects states at
+/// the same depth, the alphas and betas of all states at a given depth are
+/// computed together, with a vectorized log-sum-exp over flat arrays of arcs
+/// rather than one LogAdd() per arc.
+BaseFloat LatticeForwardBackwardLevelSync(const Lattice &lat,
+                                          Posterior *arc_post,
+                                          double *acoustic_like_sum = NULL);
+
+/// Level-synchronous versions of ComputeCompactLatticeAlphas() and
+/// ComputeCompactLatticeBetas(); see LatticeForwardBackwardLevelSync().
+bool ComputeCompactLatticeAlphasLevelSync(const CompactLattice &lat,
+                                          std::vector<double> *alpha);
+
+bool ComputeCompactLatticeBetasLevelSync(const CompactLattice &lat,
+                                         std::vector<double> *beta);
+
 
 // Computes (normal or Viterbi) alphas and betas; returns (total-prob, or
 // best-path negated cost) Note: in either case, the alphas and betas are
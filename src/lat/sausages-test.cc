@@ -0,0 +1,138 @@
+// lat/sausages-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <algorithm>
+
+#include "lat/kaldi-lattice.h"
+#include "lat/sausages.h"
+
+
+namespace kaldi {
+
+// Creates a random word-level compact lattice with 'num_states' states whose
+// times are consistent: state i is at frame 2 * i, and each arc from state i
+// to state j, with i < j <= i + max_span, has a word label (or epsilon, for
+// silence) and a string of 2 * (j - i) transition-ids.  The last state is
+// final, and every state is on a path from the start to it.
+CompactLattice *RandWordCompactLattice(int32 num_states, int32 max_span) {
+  CompactLattice *clat = new CompactLattice;
+  for (int32 s = 0; s < num_states; s++)
+    clat->AddState();
+  clat->SetStart(0);
+  clat->SetFinal(num_states - 1,
+                 CompactLatticeWeight(LatticeWeight(RandUniform(), 0.0),
+                                      std::vector<int32>()));
+  for (int32 s = 0; s + 1 < num_states; s++) {
+    int32 num_arcs = RandInt(1, 3);
+    for (int32 n = 0; n < num_arcs; n++) {
+      // The first arc goes to the next state, so that every state is on a
+      // successful path.
+      int32 next_state = (n == 0 ? s + 1 :
+                          RandInt(s + 1, std::min(s + max_span, num_states - 1))),
+          word = (RandInt(0, 3) == 0 ? 0 : RandInt(1, 6));
+      std::vector<int32> string(2 * (next_state - s));
+      for (size_t i = 0; i < string.size(); i++)
+        string[i] = RandInt(1, 20);
+      CompactLatticeWeight weight(
+          LatticeWeight(5.0 * RandUniform(), 5.0 * RandUniform()), string);
+      clat->AddArc(s, CompactLatticeArc(word, word, weight, next_state));
+    }
+  }
+  return clat;
+}
+
+void AssertMbrEqual(const MinimumBayesRisk &mbr1,
+                    const MinimumBayesRisk &mbr2) {
+  KALDI_ASSERT(mbr1.GetOneBest() == mbr2.GetOneBest());
+  KALDI_ASSERT(ApproxEqual(mbr1.GetBayesRisk(), mbr2.GetBayesRisk()));
+  const std::vector<std::vector<std::pair<int32, BaseFloat> > >
+      &stats1 = mbr1.GetSausageStats(), &stats2 = mbr2.GetSausageStats();
+  KALDI_ASSERT(stats1.size() == stats2.size());
+  for (size_t q = 0; q < stats1.size(); q++) {
+    KALDI_ASSERT(stats1[q].size() == stats2[q].size());
+    for (size_t i = 0; i < stats1[q].size(); i++)
+      KALDI_ASSERT(stats1[q][i].first == stats2[q][i].first &&
+                   ApproxEqual(stats1[q][i].second, stats2[q][i].second));
+  }
+  std::vector<std::pair<BaseFloat, BaseFloat> >
+      times1 = mbr1.GetSausageTimes(), times2 = mbr2.GetSausageTimes();
+  KALDI_ASSERT(times1.size() == times2.size());
+  for (size_t q = 0; q < times1.size(); q++)
+    KALDI_ASSERT(ApproxEqual(times1[q].first, times2[q].first) &&
+                 ApproxEqual(times1[q].second, times2[q].second));
+}
+
+// Checks that with a band_margin wider than the lattice, the banded
+// computation in MinimumBayesRisk gives the same results as the full one,
+// both when it starts from the lattice best path and from supplied words.
+void TestMinimumBayesRiskWideBand() {
+  for (int32 i = 0; i < 50; i++) {
+    CompactLattice *clat = RandWordCompactLattice(RandInt(2, 12), 3);
+    MinimumBayesRiskOptions full_opts, banded_opts;
+    full_opts.decode_mbr = banded_opts.decode_mbr = (RandInt(0, 3) != 0);
+    banded_opts.band_margin = 1000;
+
+    MinimumBayesRisk full_mbr(*clat, full_opts),
+        banded_mbr(*clat, banded_opts);
+    AssertMbrEqual(full_mbr, banded_mbr);
+
+    std::vector<int32> words;
+    int32 num_words = RandInt(0, 4);
+    for (int32 n = 0; n < num_words; n++)
+      words.push_back(RandInt(1, 6));
+    MinimumBayesRisk full_mbr2(*clat, words, full_opts),
+        banded_mbr2(*clat, words, banded_opts);
+    AssertMbrEqual(full_mbr2, banded_mbr2);
+    delete clat;
+  }
+}
+
+// Checks that on lattices of a more realistic length (80 to 120 frames),
+// whose alternative words span at most 4 frames, a band_margin of 20 frames
+// gives the same 1-best words as the full computation, and confidences and
+// Bayes risk within a small tolerance.
+void TestMinimumBayesRiskBand() {
+  for (int32 i = 0; i < 20; i++) {
+    CompactLattice *clat = RandWordCompactLattice(RandInt(40, 60), 2);
+    MinimumBayesRiskOptions full_opts, banded_opts;
+    banded_opts.band_margin = 20;
+
+    MinimumBayesRisk full_mbr(*clat, full_opts),
+        banded_mbr(*clat, banded_opts);
+    KALDI_ASSERT(full_mbr.GetOneBest() == banded_mbr.GetOneBest());
+    const std::vector<BaseFloat>
+        &conf1 = full_mbr.GetOneBestConfidences(),
+        &conf2 = banded_mbr.GetOneBestConfidences();
+    KALDI_ASSERT(conf1.size() == conf2.size());
+    for (size_t w = 0; w < conf1.size(); w++)
+      KALDI_ASSERT(std::abs(conf1[w] - conf2[w]) < 0.01);
+    KALDI_ASSERT(ApproxEqual(full_mbr.GetBayesRisk(),
+                             banded_mbr.GetBayesRisk(), 0.01));
+    delete clat;
+  }
+}
+
+}  // end namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  TestMinimumBayesRiskWideBand();
+  TestMinimumBayesRiskBand();
+  std::cout << "Test OK.\n";
+  return 0;
+}
@@ -28,7 +28,10 @@ namespace kaldi {
 void MinimumBayesRisk::MbrDecode() {
 
   for (size_t counter = 0; ; counter++) {
+    std::vector<std::pair<BaseFloat, BaseFloat> > word_times;
+    GetWordTimes(&word_times);
     NormalizeEps(&R_);
+    SetBands(word_times);
     AccStats(); // writes to gamma_
     double delta_Q = 0.0; // change in objective function.
 
@@ -127,10 +130,77 @@ void MinimumBayesRisk::NormalizeEps(std::vector<int32> *vec) {
   (*vec)[0] = 0;
 }
 
+void MinimumBayesRisk::GetWordTimes(
+    std::vector<std::pair<BaseFloat, BaseFloat> > *word_times) const {
+  word_times->clear();
+  if (opts_.band_margin < 0 || sausage_times_.size() != R_.size())
+    return;
+  for (size_t q = 0; q < R_.size(); q++)
+    if (R_[q] != 0)
+      word_times->push_back(sausage_times_[q]);
+}
+
+void MinimumBayesRisk::SetBands(
+    const std::vector<std::pair<BaseFloat, BaseFloat> > &word_times) {
+  int32 N = static_cast<int32>(pre_.size()) - 1,
+      Q = static_cast<int32>(R_.size());
+  band_.clear();
+  band_.resize(N + 1, std::pair<int32, int32>(0, Q));
+  int32 K = word_times.size();
+  if (K == 0 || Q != 2 * K + 1)
+    return;
+
+  // bin_begin[q] and bin_end[q] are the times of bin q (one-based, like r(q));
+  // q == 0 means that no bins have been consumed.  We make them
+  // non-decreasing, so that the bands below are contiguous and move forward
+  // in time.
+  std::vector<double> bin_begin(Q + 1, 0.0), bin_end(Q + 1, 0.0);
+  double max_time = state_times_[N];
+  for (int32 q = 1; q <= Q; q++) {
+    int32 k = (q - 1) / 2;
+    double b, e;
+    if ((q - 1) % 2 == 1) {  // a word bin.
+      b = word_times[k].first;
+      e = word_times[k].second;
+    } else {  // an epsilon bin, spanning the gap between the words.
+      b = (k > 0 ? word_times[k - 1].second : 0.0);
+      e = (k < K ? word_times[k].first : max_time);
+    }
+    bin_begin[q] = std::max(b, bin_begin[q - 1]);
+    bin_end[q] = std::max(e, bin_end[q - 1]);
+  }
+  double margin = opts_.band_margin;
+  for (int32 n = 2; n <= N; n++) {
+    double t = state_times_[n];
+    int32 first = std::lower_bound(bin_end.begin(), bin_end.end(),
+                                   t - margin) - bin_end.begin(),
+        last = std::upper_bound(bin_begin.begin(), bin_begin.end(),
+                                t + margin) - bin_begin.begin() - 1;
+    first = std::min(first, Q);
+    band_[n].first = first;
+    band_[n].second = std::max(first, last);
+  }
+  band_[N].second = Q;  // since the edit distance is alpha_dash(N, Q).
+
+  // The code in EditDistance() and AccStats() requires that the band of a
+  // node does not start before the band of any node preceding it.  This is
+  // normally guaranteed because arcs go forward in time, but we make sure.
+  // Arcs are sorted on start_node, so going backwards through them, all arcs
+  // leaving a node are seen before any arc entering it.
+  for (int32 i = static_cast<int32>(arcs_.size()) - 1; i >= 0; i--) {
+    const Arc &arc = arcs_[i];
+    band_[arc.start_node].first = std::min(band_[arc.start_node].first,
+                                           band_[arc.end_node].first);
+  }
+  band_[1].first = 0;
+  band_[1].second = Q;
+}
+
 double MinimumBayesRisk::EditDistance(int32 N, int32 Q,
                                       Vector<double> &alpha,
                                       Matrix<double> &alpha_dash,
                                       Vector<double> &alpha_dash_arc) {
+  const double inf = std::numeric_limits<double>::infinity();
   alpha(1) = 0.0; // = log(1).  Line 5.
   alpha_dash(1, 0) = 0.0; // Line 5.
   for (int32 q = 1; q <= Q; q++)
@@ -143,23 +213,29 @@ double MinimumBayesRisk::EditDistance(int32 N, int32 Q,
     }
     alpha(n) = alpha_n; // Line 10.
     // Line 11 omitted: matrix was initialized to zero.
+    // We only compute alpha_dash(n, q) for q in band_[n]; for each arc we
+    // start from the first q in the band of its start node.
+    int32 n_first = band_[n].first, n_last = band_[n].second;
     for (size_t i = 0; i < pre_[n].size(); i++) {
       const Arc &arc = arcs_[pre_[n][i]];
-      int32 s_a = arc.start_node, w_a = arc.word;
+      int32 s_a = arc.start_node, w_a = arc.word,
+          first = band_[s_a].first;
       BaseFloat p_a = arc.loglike;
-      for (int32 q = 0; q <= Q; q++) {
+      double arc_post = Exp(alpha(s_a) + p_a - alpha(n));
+      for (int32 q = first; q <= n_last; q++) {
         if (q == 0) {
           alpha_dash_arc(q) = // line 15.
               alpha_dash(s_a, q) + l(w_a, 0, true);
         } else {  // a1,a2,a3 are the 3 parts of min expression of line 17.
           int32 r_q = r(q);
-          double a1 = alpha_dash(s_a, q-1) + l(w_a, r_q),
-              a2 = alpha_dash(s_a, q) + l(w_a, 0, true),
-              a3 = alpha_dash_arc(q-1) + l(0, r_q);
+          double a1 = AlphaDash(alpha_dash, s_a, q-1) + l(w_a, r_q),
+              a2 = AlphaDash(alpha_dash, s_a, q) + l(w_a, 0, true),
+              a3 = (q > first ? alpha_dash_arc(q-1) + l(0, r_q) : inf);
           alpha_dash_arc(q) = std::min(a1, std::min(a2, a3));
         }
         // line 19:
-        alpha_dash(n, q) += Exp(alpha(s_a) + p_a - alpha(n)) * alpha_dash_arc(q);
+        if (q >= n_first)
+          alpha_dash(n, q) += arc_post * alpha_dash_arc(q);
       }
     }
   }
@@ -197,17 +273,24 @@ void MinimumBayesRisk::AccStats() {
   KALDI_VLOG(2) << "L = " << L_;
   // omit line 10: zero when initialized.
   beta_dash(N, Q) = 1.0; // Line 11.
+  const double inf = std::numeric_limits<double>::infinity();
   for (int32 n = N; n >= 2; n--) {
+    // As in EditDistance(), we only visit the values of q in the bands.
+    int32 n_last = band_[n].second;
     for (size_t i = 0; i < pre_[n].size(); i++) {
       const Arc &arc = arcs_[pre_[n][i]];
-      int32 s_a = arc.start_node, w_a = arc.word;
+      int32 s_a = arc.start_node, w_a = arc.word,
+          first = band_[s_a].first;
       BaseFloat p_a = arc.loglike;
-      alpha_dash_arc(0) = alpha_dash(s_a, 0) + l(w_a, 0, true); // line 14.
-      for (int32 q = 1; q <= Q; q++) { // this loop == lines 15-18.
+      double arc_post = Exp(alpha(s_a) + p_a - alpha(n));
+      if (first == 0)
+        alpha_dash_arc(0) = alpha_dash(s_a, 0) + l(w_a, 0, true); // line 14.
+      for (int32 q = std::max(first, 1); q <= n_last; q++) {
+        // this loop == lines 15-18.
         int32 r_q = r(q);
-        double a1 = alpha_dash(s_a, q-1) + l(w_a, r_q),
-            a2 = alpha_dash(s_a, q) + l(w_a, 0, true),
-            a3 = alpha_dash_arc(q-1) + l(0, r_q);
+        double a1 = AlphaDash(alpha_dash, s_a, q-1) + l(w_a, r_q),
+            a2 = AlphaDash(alpha_dash, s_a, q) + l(w_a, 0, true),
+            a3 = (q > first ? alpha_dash_arc(q-1) + l(0, r_q) : inf);
         if (a1 <= a2) {
           if (a1 <= a3) { b_arc[q] = 1; alpha_dash_arc(q) = a1; }
           else { b_arc[q] = 3; alpha_dash_arc(q) = a3; }
@@ -216,10 +299,10 @@ void MinimumBayesRisk::AccStats() {
           else { b_arc[q] = 3; alpha_dash_arc(q) = a3; }
         }
       }
-      beta_dash_arc.SetZero(); // line 19.
-      for (int32 q = Q; q >= 1; q--) {
+      beta_dash_arc.Range(first, n_last - first + 1).SetZero(); // line 19.
+      for (int32 q = n_last; q >= std::max(first, 1); q--) {
         // line 21:
-        beta_dash_arc(q) += Exp(alpha(s_a) + p_a - alpha(n)) * beta_dash(n, q);
+        beta_dash_arc(q) += arc_post * beta_dash(n, q);
         switch (static_cast<int>(b_arc[q])) { // lines 22 and 23:
           case 1:
             beta_dash(s_a, q-1) += beta_dash_arc(q);
@@ -247,8 +330,10 @@ void MinimumBayesRisk::AccStats() {
             KALDI_ERR << "Invalid b_arc value"; // error in code.
         }
       }
-      beta_dash_arc(0) += Exp(alpha(s_a) + p_a - alpha(n)) * beta_dash(n, 0);
-      beta_dash(s_a, 0) += beta_dash_arc(0); // line 26.
+      if (first == 0) {
+        beta_dash_arc(0) += arc_post * beta_dash(n, 0);
+        beta_dash(s_a, 0) += beta_dash_arc(0); // line 26.
+      }
     }
   }
   beta_dash_arc.SetZero(); // line 29.
@@ -379,6 +464,29 @@ MinimumBayesRisk::MinimumBayesRisk(const CompactLattice &clat_in,
   // sorting.
 
   { // Now set R_ to one best in the FST.
+    std::vector<int32> best_path_words;
+    if (opts_.band_margin >= 0) {
+      // Get the times of the words on the best path, so that we can restrict
+      // the edit-distance computation on the first iteration too.
+      CompactLattice best_path;
+      CompactLatticeShortestPath(clat, &best_path);
+      int32 t = 0;
+      for (int32 s = best_path.Start();
+           s != fst::kNoStateId && best_path.NumArcs(s) > 0; ) {
+        fst::ArcIterator<CompactLattice> aiter(best_path, s);
+        const CompactLatticeArc &arc = aiter.Value();
+        int32 len = arc.weight.String().size();
+        if (arc.ilabel != 0) {
+          best_path_words.push_back(arc.ilabel);
+          sausage_times_.push_back(std::make_pair(
+              static_cast<BaseFloat>(t), static_cast<BaseFloat>(t + len)));
+        }
+        t += len;
+        s = arc.nextstate;
+      }
+      // The times are only used if the word sequence matches R_ below (it
+      // might not in case of ties).
+    }
     RemoveAlignmentsFromCompactLattice(&clat); // will be more efficient
     // in best-path if we do this.
     Lattice lat;
@@ -392,6 +500,8 @@ MinimumBayesRisk::MinimumBayesRisk(const CompactLattice &clat_in,
     GetLinearSymbolSequence(fst_shortest_path, &alignment, &words, &weight);
     KALDI_ASSERT(alignment.empty()); // we removed the alignment.
     R_ = words;
+    if (best_path_words != R_)
+      sausage_times_.clear();
     L_ = 0.0; // Set current edit-distance to 0 [just so we know
     // when we're on the 1st iter.]
   }
@@ -25,6 +25,7 @@
 
 #include <vector>
 #include <map>
+#include <limits>
 
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
@@ -60,14 +61,32 @@ struct MinimumBayesRiskOptions {
   bool decode_mbr;
   /// Boolean configuration parameter: if true, the 1-best path will 'keep' the <eps> bins,
   bool print_silence;
-
-  MinimumBayesRiskOptions() : decode_mbr(true), print_silence(false)
+  /// If >= 0, restricts the edit-distance computation for each lattice state
+  /// to the sausage bins whose time span, extended by this many frames on
+  /// each side, contains the time of the state (bins that are further away
+  /// are assumed not to align with it).  The bin times come from the
+  /// previous iteration (on the first iteration, from the 1-best path or the
+  /// supplied times).  If < 0, the full computation is done.
+  int32 band_margin;
+
+  MinimumBayesRiskOptions() : decode_mbr(true), print_silence(false),
+                              band_margin(-1)
   { }
   void Register(OptionsItf *opts) {
     opts->Register("decode-mbr", &decode_mbr, "If true, do Minimum Bayes Risk "
                    "decoding (else, Maximum a Posteriori)");
     opts->Register("print-silence", &print_silence, "Keep the inter-word '<eps>' "
                    "bins in the 1-best output (ctm, <eps> can be a 'silence' or a 'deleted' word)");
+    RegisterBandMargin(opts);
+  }
+  /// Registers only --band-margin, for programs that set the other options
+  /// themselves.
+  void RegisterBandMargin(OptionsItf *opts) {
+    opts->Register("band-margin", &band_margin, "If >= 0, only align each "
+                   "lattice state with the sausage bins whose times (extended "
+                   "by this many frames) overlap its time.  Much faster for "
+                   "long lattices; results are the same unless the margin is "
+                   "too small.  If < 0, align with all bins.");
   }
 };
 
@@ -172,6 +191,27 @@ class MinimumBayesRisk {
   /// Figure 5 of the paper.  Outputs to gamma_ and L_.
   void AccStats();
 
+  /// Sets band_.  'word_times' contains the (start, end) times of the
+  /// non-epsilon words in R_; R_ must already have been normalized with
+  /// NormalizeEps().  If word_times is empty, it sets the bands to include
+  /// all bins.
+  void SetBands(const std::vector<std::pair<BaseFloat, BaseFloat> > &word_times);
+
+  /// Outputs the (start, end) times of the non-epsilon words of R_ (before
+  /// normalization), for use by SetBands(), if opts_.band_margin >= 0 and they
+  /// are known, i.e. if sausage_times_ has the same size as R_; else outputs
+  /// the empty vector.
+  void GetWordTimes(
+      std::vector<std::pair<BaseFloat, BaseFloat> > *word_times) const;
+
+  /// Returns alpha_dash(n, q) if q is inside the band of node n, and
+  /// infinity otherwise.
+  inline double AlphaDash(const Matrix<double> &alpha_dash,
+                          int32 n, int32 q) const {
+    return (q >= band_[n].first && q <= band_[n].second ? alpha_dash(n, q) :
+            std::numeric_limits<double>::infinity());
+  }
+
   /// Removes epsilons (symbol 0) from a vector
   static void RemoveEps(std::vector<int32> *vec);
 
@@ -219,6 +259,11 @@ class MinimumBayesRisk {
   std::vector<int32> state_times_; // time of each state in the word lattice,
   // indexed from 1 (same index as into pre_)
 
+  std::vector<std::pair<int32, int32> > band_; // for each node in the
+  // lattice, the range [first, last] of values of q (bins of R_, plus 0) that
+  // we compute alpha_dash and beta_dash for; indexed from 1 like pre_.  See
+  // MinimumBayesRiskOptions::band_margin.
+
   std::vector<int32> R_; // current 1-best word sequence, normalized to have
   // epsilons between each word and at the beginning and end.  R in paper...
   // caution: indexed from zero, not from 1 as in paper.
@@ -34,18 +34,26 @@ class ArcPosteriorComputer {
   ArcPosteriorComputer(const CompactLattice &clat,
                        BaseFloat min_post,
                        bool print_alignment,
-                       const TransitionModel *trans_model = NULL):
+                       const TransitionModel *trans_model = NULL,
+                       bool level_synchronous = false):
       clat_(clat), min_post_(min_post), print_alignment_(print_alignment),
-      trans_model_(trans_model) { }
+      trans_model_(trans_model), level_synchronous_(level_synchronous) { }
 
   // returns the number of arc posteriors that it output.
   int32 OutputPosteriors(const std::string &utterance,
                          std::ostream &os) {
     int32 num_post = 0;
-    if (!ComputeCompactLatticeAlphas(clat_, &alpha_))
-      return num_post;
-    if (!ComputeCompactLatticeBetas(clat_, &beta_))
-      return num_post;
+    if (level_synchronous_) {
+      if (!ComputeCompactLatticeAlphasLevelSync(clat_, &alpha_))
+        return num_post;
+      if (!ComputeCompactLatticeBetasLevelSync(clat_, &beta_))
+        return num_post;
+    } else {
+      if (!ComputeCompactLatticeAlphas(clat_, &alpha_))
+        return num_post;
+      if (!ComputeCompactLatticeBetas(clat_, &beta_))
+        return num_post;
+    }
 
     CompactLatticeStateTimes(clat_, &state_times_);
     if (clat_.Start() < 0)
@@ -104,6 +112,7 @@ class ArcPosteriorComputer {
   BaseFloat min_post_;
   bool print_alignment_;
   const TransitionModel *trans_model_;
+  bool level_synchronous_;
 };
 
 }
@@ -138,6 +147,7 @@ int main(int argc, char *argv[]) {
     kaldi::BaseFloat acoustic_scale = 1.0, lm_scale = 1.0;
     kaldi::BaseFloat min_post = 0.0001;
     bool print_alignment = false;
+    bool level_synchronous = false;
 
     kaldi::ParseOptions po(usage);
     po.Register("acoustic-scale", &acoustic_scale,
@@ -149,6 +159,10 @@ int main(int argc, char *argv[]) {
                 "arc.");
     po.Register("min-post", &min_post,
                 "Arc posteriors below this value will be pruned away");
+    po.Register("level-synchronous", &level_synchronous,
+                "If true, use the level-synchronous forward-backward "
+                "computation, which is faster for large lattices (gives the "
+                "same results up to roundoff)");
     po.Read(argc, argv);
 
     if (po.NumArgs() < 2 || po.NumArgs() > 3) {
@@ -191,7 +205,8 @@ int main(int argc, char *argv[]) {
 
       kaldi::ArcPosteriorComputer computer(
           clat, min_post, print_alignment,
-          (po.NumArgs() == 3 ? &trans_model : NULL));
+          (po.NumArgs() == 3 ? &trans_model : NULL),
+          level_synchronous);
 
       int32 num_post = computer.OutputPosteriors(key, output.Stream());
       if (num_post != 0) {
@@ -18,9 +18,70 @@
 // limitations under the License.
 
 #include "util/common-utils.h"
+#include "util/kaldi-thread.h"
 #include "lat/sausages.h"
 #include "hmm/posterior.h"
 
+namespace kaldi {
+
+class MbrDecodeTask {
+ public:
+  // Initializer takes ownership of "clat".
+  MbrDecodeTask(const MinimumBayesRiskOptions &opts,
+                const std::string &key,
+                CompactLattice *clat,
+                bool one_best_times,
+                Int32VectorWriter *trans_writer,
+                BaseFloatWriter *bayes_risk_writer,
+                PosteriorWriter *sausage_stats_writer,
+                BaseFloatPairVectorWriter *times_writer,
+                int32 *n_words,
+                BaseFloat *tot_bayes_risk):
+      opts_(opts), key_(key), clat_(clat), mbr_(NULL),
+      one_best_times_(one_best_times), trans_writer_(trans_writer),
+      bayes_risk_writer_(bayes_risk_writer),
+      sausage_stats_writer_(sausage_stats_writer),
+      times_writer_(times_writer), n_words_(n_words),
+      tot_bayes_risk_(tot_bayes_risk) { }
+
+  void operator () () {
+    mbr_ = new MinimumBayesRisk(*clat_, opts_);
+    delete clat_;
+    clat_ = NULL;
+  }
+
+  // The output is written in the destructor, which TaskSequencer calls in
+  // the order in which the tasks were given to it.
+  ~MbrDecodeTask() {
+    if (trans_writer_->IsOpen())
+      trans_writer_->Write(key_, mbr_->GetOneBest());
+    if (bayes_risk_writer_->IsOpen())
+      bayes_risk_writer_->Write(key_, mbr_->GetBayesRisk());
+    if (sausage_stats_writer_->IsOpen())
+      sausage_stats_writer_->Write(key_, mbr_->GetSausageStats());
+    if (times_writer_->IsOpen())
+      times_writer_->Write(key_, one_best_times_ ? mbr_->GetOneBestTimes() :
+                           mbr_->GetSausageTimes());
+    *n_words_ += mbr_->GetOneBest().size();
+    *tot_bayes_risk_ += mbr_->GetBayesRisk();
+    delete mbr_;
+  }
+ private:
+  const MinimumBayesRiskOptions &opts_;
+  std::string key_;
+  CompactLattice *clat_;  // The input lattice.  Owned locally.
+  MinimumBayesRisk *mbr_;  // The output of our process.  Owned locally.
+  bool one_best_times_;
+  Int32VectorWriter *trans_writer_;
+  BaseFloatWriter *bayes_risk_writer_;
+  PosteriorWriter *sausage_stats_writer_;
+  BaseFloatPairVectorWriter *times_writer_;
+  int32 *n_words_;
+  BaseFloat *tot_bayes_risk_;
+};
+
+}  // namespace kaldi
+
 int main(int argc, char *argv[]) {
   try {
     using namespace kaldi;
@@ -61,6 +122,11 @@ int main(int argc, char *argv[]) {
     po.Register("one-best-times", &one_best_times, "If true, output times "
                 "corresponding to one-best, not whole sausage.");
 
+    MinimumBayesRiskOptions mbr_opts;
+    mbr_opts.RegisterBandMargin(&po);
+    TaskSequencerConfig sequencer_config; // has --num-threads option
+    sequencer_config.Register(&po);
+
     po.Read(argc, argv);
 
     if (po.NumArgs() < 2 || po.NumArgs() > 5) {
@@ -94,27 +160,22 @@ int main(int argc, char *argv[]) {
     int32 n_done = 0, n_words = 0;
     BaseFloat tot_bayes_risk = 0.0;
 
-    for (; !clat_reader.Done(); clat_reader.Next()) {
-      std::string key = clat_reader.Key();
-      CompactLattice clat = clat_reader.Value();
-      clat_reader.FreeCurrent();
-      fst::ScaleLattice(fst::LatticeScale(lm_scale, acoustic_scale), &clat);
-
-      MinimumBayesRisk mbr(clat);
-
-      if (trans_wspecifier != "")
-        trans_writer.Write(key, mbr.GetOneBest());
-      if (bayes_risk_wspecifier != "")
-        bayes_risk_writer.Write(key, mbr.GetBayesRisk());
-      if (sausage_stats_wspecifier != "")
-        sausage_stats_writer.Write(key, mbr.GetSausageStats());
-      if (times_wspecifier != "")
-        times_writer.Write(key, one_best_times ? mbr.GetOneBestTimes() :
-                           mbr.GetSausageTimes());
-
-      n_done++;
-      n_words += mbr.GetOneBest().size();
-      tot_bayes_risk += mbr.GetBayesRisk();
+    {
+      TaskSequencer<MbrDecodeTask> sequencer(sequencer_config);
+      for (; !clat_reader.Done(); clat_reader.Next()) {
+        std::string key = clat_reader.Key();
+        // will give ownership to "task" below.
+        CompactLattice *clat = new CompactLattice(clat_reader.Value());
+        clat_reader.FreeCurrent();
+        fst::ScaleLattice(fst::LatticeScale(lm_scale, acoustic_scale), clat);
+
+        sequencer.Run(new MbrDecodeTask(
+            mbr_opts, key, clat, one_best_times, &trans_writer,
+            &bayes_risk_writer, &sausage_stats_writer, &times_writer,
+            &n_words, &tot_bayes_risk));
+        n_done++;
+      }
+      sequencer.Wait();
     }
 
     KALDI_LOG << "Done " << n_done << " lattices.";
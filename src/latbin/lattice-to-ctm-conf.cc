@@ -20,9 +20,82 @@
 
 #include "util/common-utils.h"
 #include "util/kaldi-table.h"
+#include "util/kaldi-thread.h"
 #include "lat/sausages.h"
 #include <numeric>
 
+namespace kaldi {
+
+class LatticeToCtmTask {
+ public:
+  // Initializer takes ownership of "clat".  If "one_best" is NULL, the
+  // initial hypothesis is the 1-best of the lattice; if "times" is non-NULL
+  // it gives the initial times of the bins.
+  LatticeToCtmTask(const MinimumBayesRiskOptions &opts,
+                   const std::string &key,
+                   CompactLattice *clat,
+                   const std::vector<int32> *one_best,
+                   const std::vector<std::pair<BaseFloat, BaseFloat> > *times,
+                   BaseFloat frame_shift,
+                   std::ostream *os,
+                   int32 *n_words,
+                   BaseFloat *tot_bayes_risk):
+      opts_(opts), key_(key), clat_(clat), has_one_best_(one_best != NULL),
+      has_times_(times != NULL), mbr_(NULL), frame_shift_(frame_shift),
+      os_(os), n_words_(n_words), tot_bayes_risk_(tot_bayes_risk) {
+    if (one_best != NULL) one_best_ = *one_best;
+    if (times != NULL) times_ = *times;
+  }
+
+  void operator () () {
+    if (!has_one_best_)
+      mbr_ = new MinimumBayesRisk(*clat_, opts_);
+    else if (!has_times_)
+      mbr_ = new MinimumBayesRisk(*clat_, one_best_, opts_); // no 'times',
+    else  // with initial 'times' of the bins,
+      mbr_ = new MinimumBayesRisk(*clat_, one_best_, times_, opts_);
+    delete clat_;
+    clat_ = NULL;
+  }
+
+  // The output is written in the destructor, which TaskSequencer calls in
+  // the order in which the tasks were given to it.
+  ~LatticeToCtmTask() {
+    const std::vector<BaseFloat> &conf = mbr_->GetOneBestConfidences();
+    const std::vector<int32> &words = mbr_->GetOneBest();
+    const std::vector<std::pair<BaseFloat, BaseFloat> > &times =
+        mbr_->GetOneBestTimes();
+    KALDI_ASSERT(conf.size() == words.size() && words.size() == times.size());
+    for (size_t i = 0; i < words.size(); i++) {
+      KALDI_ASSERT(words[i] != 0 || opts_.print_silence); // Should not have epsilons.
+      *os_ << key_ << " 1 " << (frame_shift_ * times[i].first) << ' '
+           << (frame_shift_ * (times[i].second-times[i].first)) << ' '
+           << words[i] << ' ' << conf[i] << '\n';
+    }
+    KALDI_LOG << "For utterance " << key_ << ", Bayes Risk "
+              << mbr_->GetBayesRisk() << ", avg. confidence per-word "
+              << std::accumulate(conf.begin(),conf.end(),0.0) / words.size();
+    *n_words_ += mbr_->GetOneBest().size();
+    *tot_bayes_risk_ += mbr_->GetBayesRisk();
+    delete mbr_;
+  }
+ private:
+  const MinimumBayesRiskOptions &opts_;
+  std::string key_;
+  CompactLattice *clat_;  // The input lattice.  Owned locally.
+  bool has_one_best_;
+  bool has_times_;
+  std::vector<int32> one_best_;
+  std::vector<std::pair<BaseFloat, BaseFloat> > times_;
+  MinimumBayesRisk *mbr_;  // The output of our process.  Owned locally.
+  BaseFloat frame_shift_;
+  std::ostream *os_;
+  int32 *n_words_;
+  BaseFloat *tot_bayes_risk_;
+};
+
+}  // namespace kaldi
+
 int main(int argc, char *argv[]) {
   try {
     using namespace kaldi;
@@ -75,6 +148,8 @@ int main(int argc, char *argv[]) {
 
     MinimumBayesRiskOptions mbr_opts;
     mbr_opts.Register(&po);
+    TaskSequencerConfig sequencer_config; // has --num-threads option
+    sequencer_config.Register(&po);
 
     po.Read(argc, argv);
 
@@ -129,56 +204,41 @@ int main(int argc, char *argv[]) {
     int32 n_done = 0, n_words = 0;
     BaseFloat tot_bayes_risk = 0.0;
 
-    for (; !clat_reader.Done(); clat_reader.Next()) {
-      std::string key = clat_reader.Key();
-      CompactLattice clat = clat_reader.Value();
-      clat_reader.FreeCurrent();
-      fst::ScaleLattice(fst::LatticeScale(lm_scale, acoustic_scale), &clat);
-
-      MinimumBayesRisk *mbr = NULL;
-
-      if (one_best_rspecifier == "") {
-        mbr = new MinimumBayesRisk(clat, mbr_opts);
-      } else {
-        // check,
-        if (!one_best_reader.HasKey(key)) {
-          KALDI_WARN << "No 1-best present for utterance " << key;
-          continue;
-        }
-        if (times_rspecifier != "" && !times_reader.HasKey(key)) {
-          KALDI_WARN << "No 'times' present for utterance " << key;
-          continue;
-        }
-        // get the 'mbr' decoding object,
-        if (times_rspecifier == "") {
-          const std::vector<int32> &one_best = one_best_reader.Value(key);
-          mbr = new MinimumBayesRisk(clat, one_best, mbr_opts); // no 'times',
-        } else {
-          // with initial 'times' of the bins,
-          const std::vector<int32> &one_best = one_best_reader.Value(key);
-          const std::vector<std::pair<BaseFloat,BaseFloat> > &times = times_reader.Value(key);
-          mbr = new MinimumBayesRisk(clat, one_best, times, mbr_opts);
+    {
+      TaskSequencer<LatticeToCtmTask> sequencer(sequencer_config);
+      for (; !clat_reader.Done(); clat_reader.Next()) {
+        std::string key = clat_reader.Key();
+        // will give ownership to "task" below.
+        CompactLattice *clat = new CompactLattice(clat_reader.Value());
+        clat_reader.FreeCurrent();
+        fst::ScaleLattice(fst::LatticeScale(lm_scale, acoustic_scale), clat);
+
+        const std::vector<int32> *one_best = NULL;
+        const std::vector<std::pair<BaseFloat, BaseFloat> > *times = NULL;
+        if (one_best_rspecifier != "") {
+          // check,
+          if (!one_best_reader.HasKey(key)) {
+            KALDI_WARN << "No 1-best present for utterance " << key;
+            delete clat;
+            continue;
+          }
+          if (times_rspecifier != "" && !times_reader.HasKey(key)) {
+            KALDI_WARN << "No 'times' present for utterance " << key;
+            delete clat;
+            continue;
+          }
+          one_best = &one_best_reader.Value(key);
+          if (times_rspecifier != "")
+            times = &times_reader.Value(key);
         }
+        // The task copies one_best and times, since the readers may
+        // invalidate them.
+        sequencer.Run(new LatticeToCtmTask(
+            mbr_opts, key, clat, one_best, times, frame_shift, &(ko.Stream()),
+            &n_words, &tot_bayes_risk));
+        n_done++;
       }
-
-      const std::vector<BaseFloat> &conf = mbr->GetOneBestConfidences();
-      const std::vector<int32> &words = mbr->GetOneBest();
-      const std::vector<std::pair<BaseFloat, BaseFloat> > &times =
-          mbr->GetOneBestTimes();
-      KALDI_ASSERT(conf.size() == words.size() && words.size() == times.size());
-      for (size_t i = 0; i < words.size(); i++) {
-        KALDI_ASSERT(words[i] != 0 || mbr_opts.print_silence); // Should not have epsilons.
-        ko.Stream() << key << " 1 " << (frame_shift * times[i].first) << ' '
-                    << (frame_shift * (times[i].second-times[i].first)) << ' '
-                    << words[i] << ' ' << conf[i] << '\n';
-      }
-      KALDI_LOG << "For utterance " << key << ", Bayes Risk "
-                << mbr->GetBayesRisk() << ", avg. confidence per-word "
-                << std::accumulate(conf.begin(),conf.end(),0.0) / words.size();
-      n_done++;
-      n_words += mbr->GetOneBest().size();
-      tot_bayes_risk += mbr->GetBayesRisk();
-      delete mbr;
+      sequencer.Wait();
     }
 
     KALDI_LOG << "Done " << n_done << " lattices.";
@@ -38,11 +38,16 @@ int main(int argc, char *argv[]) {
         "See also: lattice-to-ctm-conf, post-to-pdf-post, lattice-arc-post\n";
 
     kaldi::BaseFloat acoustic_scale = 1.0, lm_scale = 1.0;
+    bool level_synchronous = false;
     kaldi::ParseOptions po(usage);
     po.Register("acoustic-scale", &acoustic_scale,
                 "Scaling factor for acoustic likelihoods");
     po.Register("lm-scale", &lm_scale,
                 "Scaling factor for \"graph costs\" (including LM costs)");
+    po.Register("level-synchronous", &level_synchronous,
+                "If true, use the level-synchronous forward-backward "
+                "computation, which is faster for large lattices (gives the "
+                "same results up to roundoff)");
     po.Read(argc, argv);
 
     if (po.NumArgs() < 2 || po.NumArgs() > 3) {
@@ -84,7 +89,11 @@ int main(int argc, char *argv[]) {
       }
 
       kaldi::Posterior post;
-      lat_like = kaldi::LatticeForwardBackward(lat, &post, &lat_ac_like);
+      if (level_synchronous)
+        lat_like = kaldi::LatticeForwardBackwardLevelSync(lat, &post,
+                                                          &lat_ac_like);
+      else
+        lat_like = kaldi::LatticeForwardBackward(lat, &post, &lat_ac_like);
       total_like += lat_like;
       lat_time = post.size();
       total_time += lat_time;
@@ -0,0 +1,110 @@
+// nnet3/am-nnet-mapped-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdio>
+#include "hmm/hmm-test-utils.h"
+#include "nnet3/am-nnet-mapped.h"
+#include "nnet3/nnet-simple-component.h"
+#include "nnet3/nnet-test-utils.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+void UnitTestMappedAmNnet() {
+  ContextDependency *ctx_dep = NULL;
+  TransitionModel *trans_model = GenRandTransitionModel(&ctx_dep);
+  std::vector<std::string> configs;
+  GenerateConfigSequenceInferenceTdnn(true, &configs);
+  Nnet nnet;
+  std::istringstream is(configs[0]);
+  nnet.ReadConfig(is);
+  AmNnetSimple am_nnet(nnet);
+  Vector<BaseFloat> priors(30);
+  priors.SetRandn();
+  am_nnet.SetPriors(priors);
+
+  int32 left_context = 2, right_context = 5, num_frames = 10;
+  Matrix<BaseFloat> input(left_context + num_frames + right_context, 40),
+      output(num_frames, 30);
+  input.SetRandn();
+  ComputeSimpleOutput(nnet, input, left_context, &output);
+
+  std::string filename = "tmp.mapped.mdl", filename2 = "tmp.ordinary.mdl";
+  WriteMappedAmNnet(*trans_model, am_nnet, filename);
+  Nnet *nnet_copy;
+  {
+    TransitionModel trans_model2;
+    AmNnetSimple am_nnet2;
+    ReadAmNnetMaybeMapped(filename, &trans_model2, &am_nnet2);
+    KALDI_ASSERT(trans_model2.Compatible(*trans_model) &&
+                 am_nnet2.Priors().ApproxEqual(priors, 0.0) &&
+                 am_nnet2.LeftContext() == left_context &&
+                 am_nnet2.RightContext() == right_context);
+    const Nnet &nnet2 = am_nnet2.GetNnet();
+    int32 num_mapped = 0;
+    for (int32 c = 0; c < nnet2.NumComponents(); c++) {
+      const MappedAffineComponent *component =
+          dynamic_cast<const MappedAffineComponent*>(nnet2.GetComponent(c));
+      if (component != NULL) {
+        KALDI_ASSERT(component->IsMapped() && !component->NeedsMappedData());
+        num_mapped++;
+      }
+    }
+    KALDI_ASSERT(num_mapped == 4);
+    nnet_copy = new Nnet(nnet2);
+  }
+  // The copy shares the mapped file, which must stay open after the model
+  // it was read into is gone.
+  std::remove(filename.c_str());
+  Matrix<BaseFloat> output2(num_frames, 30);
+  ComputeSimpleOutput(*nnet_copy, input, left_context, &output2);
+  AssertEqual(output, output2);
+
+  // Written as an ordinary model, the mapped model should be complete, and
+  // ReadAmNnetMaybeMapped() should read it too.
+  {
+    bool binary = (RandInt(0, 1) == 0);
+    Output ko(filename2, binary);
+    trans_model->Write(ko.Stream(), binary);
+    AmNnetSimple am_nnet3(*nnet_copy);
+    am_nnet3.Write(ko.Stream(), binary);
+  }
+  delete nnet_copy;
+  {
+    TransitionModel trans_model3;
+    AmNnetSimple am_nnet3;
+    ReadAmNnetMaybeMapped(filename2, &trans_model3, &am_nnet3);
+    Matrix<BaseFloat> output3(num_frames, 30);
+    ComputeSimpleOutput(am_nnet3.GetNnet(), input, left_context, &output3);
+    AssertEqual(output, output3);
+  }
+  std::remove(filename2.c_str());
+  delete trans_model;
+  delete ctx_dep;
+}
+
+}  // namespace nnet3
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  using namespace kaldi::nnet3;
+  for (int32 i = 0; i < 5; i++)
+    UnitTestMappedAmNnet();
+  KALDI_LOG << "Mapped model tests succeeded.";
+  return 0;
+}
@@ -0,0 +1,182 @@
+// nnet3/am-nnet-mapped.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+#include <streambuf>
+#include "nnet3/am-nnet-mapped.h"
+#include "nnet3/nnet-simple-component.h"
+#include "nnet3/nnet-utils.h"
+#include "util/kaldi-io.h"
+#include "util/kaldi-mmap.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+// Rows of the parameters in the data section are padded to a multiple of this
+// many elements.
+static const int32 kMappedNnetRowAlignment = 16;
+
+static inline int64 RoundUpToMultiple(int64 n, int64 m) {
+  return (n + m - 1) / m * m;
+}
+
+// Writes 'num_bytes' zero bytes to 'os'.
+static void WriteZeros(int64 num_bytes, std::ostream &os) {
+  static const char zeros[1024] = { 0 };
+  while (num_bytes > 0) {
+    int64 n = std::min<int64>(num_bytes, sizeof(zeros));
+    os.write(zeros, n);
+    num_bytes -= n;
+  }
+}
+
+void WriteMappedAmNnet(const TransitionModel &trans_model,
+                       const AmNnetSimple &am_nnet,
+                       const std::string &wxfilename) {
+  AmNnetSimple mapped_am_nnet(am_nnet);
+  Nnet &nnet = mapped_am_nnet.GetNnet();
+  ConvertToMappedAffine(&nnet);
+
+  // Lay out the data section.
+  std::vector<MappedAffineComponent*> mapped_components;
+  int64 data_size = 0;
+  for (int32 c = 0; c < nnet.NumComponents(); c++) {
+    MappedAffineComponent *component =
+        dynamic_cast<MappedAffineComponent*>(nnet.GetComponent(c));
+    if (component == NULL)
+      continue;
+    int32 stride = RoundUpToMultiple(component->InputDim(),
+                                     kMappedNnetRowAlignment);
+    component->SetMappedOffset(data_size, stride);
+    data_size += RoundUpToMultiple(
+        static_cast<int64>(sizeof(BaseFloat)) * stride *
+        component->OutputDim(), kMappedNnetAlignment);
+    mapped_components.push_back(component);
+  }
+
+  std::ostringstream header_os;
+  trans_model.Write(header_os, true);
+  mapped_am_nnet.Write(header_os, true);
+  std::string header = header_os.str();
+  std::ostringstream prefix_os;
+  InitKaldiOutputStream(prefix_os, true);
+  WriteToken(prefix_os, true, "<MappedAmNnet>");
+  WriteToken(prefix_os, true, "<FloatSize>");
+  WriteBasicType(prefix_os, true, static_cast<int32>(sizeof(BaseFloat)));
+  WriteToken(prefix_os, true, "<HeaderSize>");
+  WriteBasicType(prefix_os, true, static_cast<int64>(header.size()));
+  std::string prefix = prefix_os.str();
+  int64 header_end = prefix.size() + header.size();
+
+  Output ko(wxfilename, true, false);
+  std::ostream &os = ko.Stream();
+  os << prefix << header;
+  WriteZeros(RoundUpToMultiple(header_end, kMappedNnetAlignment) -
+             header_end, os);
+  for (size_t i = 0; i < mapped_components.size(); i++) {
+    const MappedAffineComponent *component = mapped_components[i];
+    int32 input_dim = component->InputDim(),
+        output_dim = component->OutputDim(),
+        stride = RoundUpToMultiple(input_dim, kMappedNnetRowAlignment);
+    Matrix<BaseFloat> params(output_dim, input_dim, kUndefined);
+    component->GetLinearParams(&params);
+    for (int32 r = 0; r < output_dim; r++) {
+      os.write(reinterpret_cast<const char*>(params.RowData(r)),
+               sizeof(BaseFloat) * input_dim);
+      WriteZeros(sizeof(BaseFloat) * (stride - input_dim), os);
+    }
+    int64 size = static_cast<int64>(sizeof(BaseFloat)) * stride * output_dim;
+    WriteZeros(RoundUpToMultiple(size, kMappedNnetAlignment) - size, os);
+  }
+  if (!ko.Close())
+    KALDI_ERR << "Error writing mapped model to "
+              << PrintableWxfilename(wxfilename);
+  KALDI_LOG << "Wrote mapped model with " << mapped_components.size()
+            << " mapped components, header size " << header_end
+            << " bytes and data size " << data_size << " bytes";
+}
+
+
+namespace {
+// A read-only streambuf over a block of memory, used to parse models in
+// place.
+class MemoryStreamBuf: public std::streambuf {
+ public:
+  MemoryStreamBuf(const char *data, size_t size) {
+    char *begin = const_cast<char*>(data);
+    setg(begin, begin, begin + size);
+  }
+  // Returns the number of bytes read so far.
+  size_t Position() const { return gptr() - eback(); }
+};
+}  // namespace
+
+void ReadAmNnetMaybeMapped(const std::string &rxfilename,
+                           TransitionModel *trans_model,
+                           AmNnetSimple *am_nnet) {
+  std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>(rxfilename);
+  MemoryStreamBuf buf(file->Data(), file->Size());
+  std::istream is(&buf);
+  bool binary;
+  if (!InitKaldiInputStream(is, &binary))
+    KALDI_ERR << "Error reading model from "
+              << PrintableRxfilename(rxfilename);
+  if (!binary || PeekToken(is, binary) != 'M') {
+    // An ordinary model; the file is closed when we return.
+    trans_model->Read(is, binary);
+    am_nnet->Read(is, binary);
+    return;
+  }
+  ExpectToken(is, binary, "<MappedAmNnet>");
+  ExpectToken(is, binary, "<FloatSize>");
+  int32 float_size;
+  ReadBasicType(is, binary, &float_size);
+  if (float_size != sizeof(BaseFloat))
+    KALDI_ERR << "Mapped model " << PrintableRxfilename(rxfilename)
+              << " was written with " << (8 * float_size) << "-bit floats; "
+              << "it must be rewritten for this build.";
+  ExpectToken(is, binary, "<HeaderSize>");
+  int64 header_size;
+  ReadBasicType(is, binary, &header_size);
+  size_t header_begin = buf.Position();
+  trans_model->Read(is, binary);
+  am_nnet->Read(is, binary);
+  size_t header_end = header_begin + header_size,
+      data_begin = RoundUpToMultiple(header_end, kMappedNnetAlignment);
+  if (buf.Position() != header_end || data_begin > file->Size())
+    KALDI_ERR << "Mapped model " << PrintableRxfilename(rxfilename)
+              << " is corrupted or truncated.";
+
+  Nnet &nnet = am_nnet->GetNnet();
+  int32 num_mapped = 0;
+  for (int32 c = 0; c < nnet.NumComponents(); c++) {
+    MappedAffineComponent *component =
+        dynamic_cast<MappedAffineComponent*>(nnet.GetComponent(c));
+    if (component != NULL && component->NeedsMappedData()) {
+      component->SetMappedData(file, file->Data() + data_begin,
+                               file->Size() - data_begin);
+      num_mapped++;
+    }
+  }
+  KALDI_VLOG(1) << "Read mapped model with " << num_mapped
+                << " mapped components from "
+                << PrintableRxfilename(rxfilename) << "; file was "
+                << (file->IsMapped() ? "memory-mapped." : "read into memory.");
+}
+
+}  // namespace nnet3
+}  // namespace kaldi
@@ -0,0 +1,76 @@
+// nnet3/am-nnet-mapped.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_NNET3_AM_NNET_MAPPED_H_
+#define KALDI_NNET3_AM_NNET_MAPPED_H_
+
+#include <string>
+#include "base/kaldi-common.h"
+#include "hmm/transition-model.h"
+#include "nnet3/am-nnet-simple.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+/// @file  am-nnet-mapped.h
+///
+/// This file contains the reading and writing code for "mapped" acoustic
+/// models, which are meant to be memory-mapped for decoding, so that all the
+/// decoding processes on a machine share one physical copy of the parameters
+/// and start without reading them.
+///
+/// A mapped model file is binary-only and consists of:
+///   - A header: the token <MappedAmNnet>, the size of BaseFloat and the size
+///     of the rest of the header, then the transition model and the
+///     AmNnetSimple written as usual, except that the affine components are
+///     MappedAffineComponents that contain only the offsets of their linear
+///     parameters in the data section.
+///   - Padding to a multiple of kMappedNnetAlignment bytes.
+///   - The data section: the linear parameters of each MappedAffineComponent
+///     in turn, each starting at a multiple of kMappedNnetAlignment bytes,
+///     with rows padded to a multiple of 16 elements.
+/// The header is parsed as usual when the model is read, but it is small
+/// since the bulk of the parameters are in the data section.
+
+
+/// The alignment, in bytes, of the data section and of the parameters of each
+/// component within it; this is the page size on most machines.
+static const int32 kMappedNnetAlignment = 4096;
+
+/// Writes 'am_nnet' in the mapped format to 'wxfilename', after converting
+/// its affine, linear and TDNN components to MappedAffineComponent (see
+/// ConvertToMappedAffine() in nnet-utils.h).  The model should already be
+/// prepared for test (see CollapseModel()), since the result can only be used
+/// for inference.
+void WriteMappedAmNnet(const TransitionModel &trans_model,
+                       const AmNnetSimple &am_nnet,
+                       const std::string &wxfilename);
+
+/// Reads an acoustic model (a transition model followed by an AmNnetSimple),
+/// which may be either an ordinary model, in binary or text form, or a model
+/// written by WriteMappedAmNnet().  In the latter case the file is
+/// memory-mapped if it is an ordinary file (see class MappedFile), and the
+/// MappedAffineComponents in 'am_nnet' refer to the parameters in place, and
+/// keep the file mapped for as long as they (or copies of them) exist.
+void ReadAmNnetMaybeMapped(const std::string &rxfilename,
+                           TransitionModel *trans_model,
+                           AmNnetSimple *am_nnet);
+
+}  // namespace nnet3
+}  // namespace kaldi
+
+#endif  // KALDI_NNET3_AM_NNET_MAPPED_H_
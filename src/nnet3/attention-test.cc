@@ -20,6 +20,7 @@
 
 #include "nnet3/attention.h"
 #include "util/common-utils.h"
+#include "base/timer.h"
 
 namespace kaldi {
 namespace nnet3 {
@@ -117,6 +118,91 @@ void UnitTestAttentionDotProductAndAddScales() {
   AssertEqual(B, B2);
 }
 
+// A reference version of AttentionForward(), built from the simple versions of
+// GetAttentionDotProducts() and ApplyScalesToOutput() above.
+void AttentionForwardSimple(BaseFloat key_scale,
+                            const CuMatrixBase<BaseFloat> &keys,
+                            const CuMatrixBase<BaseFloat> &queries,
+                            const CuMatrixBase<BaseFloat> &values,
+                            CuMatrixBase<BaseFloat> *c,
+                            CuMatrixBase<BaseFloat> *output) {
+  int32 key_dim = keys.NumCols(), num_output_rows = queries.NumRows(),
+      context_dim = c->NumCols(), value_dim = values.NumCols();
+  CuSubMatrix<BaseFloat> output_values_part(*output, 0, num_output_rows,
+                                            0, value_dim);
+  GetAttentionDotProductsSimple(key_scale,
+                                queries.ColRange(0, key_dim), keys, c);
+  c->AddMat(1.0, queries.ColRange(key_dim, context_dim));
+  c->SoftMaxPerRow(*c);
+  ApplyScalesToOutputSimple(1.0, values, *c, &output_values_part);
+  if (output->NumCols() == value_dim + context_dim)
+    output->ColRange(value_dim, context_dim).CopyFromMat(*c);
+}
+
+// Compares AttentionForward() with AttentionForwardSimple(), with the keys,
+// queries and values being parts of one matrix as they are in
+// RestrictedAttentionComponent.
+void UnitTestAttentionForward() {
+  BaseFloat key_scale = 0.5 * RandInt(1, 3);
+  bool output_context = (RandInt(0, 1) == 0);
+  int32 output_num_rows = RandInt(1, 100),
+      value_dim = RandInt(1, 50), key_dim = RandInt(1, 50),
+      row_shift = RandInt(1, 40), context_dim = RandInt(2, 15),
+      input_num_rows = output_num_rows + (context_dim - 1) * row_shift,
+      query_dim = key_dim + context_dim,
+      output_dim = value_dim + (output_context ? context_dim : 0);
+  CuMatrix<BaseFloat> input(input_num_rows, key_dim + value_dim + query_dim);
+  input.SetRandn();
+  CuSubMatrix<BaseFloat> keys(input, 0, input_num_rows, 0, key_dim),
+      values(input, 0, input_num_rows, key_dim, value_dim),
+      queries(input, 0, output_num_rows, key_dim + value_dim, query_dim);
+  CuMatrix<BaseFloat> c(output_num_rows, context_dim),
+      c2(output_num_rows, context_dim),
+      output(output_num_rows, output_dim),
+      output2(output_num_rows, output_dim);
+  output.SetRandn();  // the output is added to.
+  output2.CopyFromMat(output);
+  AttentionForward(key_scale, keys, queries, values, &c, &output);
+  AttentionForwardSimple(key_scale, keys, queries, values, &c2, &output2);
+  AssertEqual(c, c2);
+  AssertEqual(output, output2);
+}
+
+// Prints the throughput of AttentionForward() for some typical
+// configurations.
+void AttentionSpeedTest() {
+  // num-heads, key-dim, value-dim, num-left-inputs + num-right-inputs,
+  // num-images.
+  int32 configs[][5] = { { 15, 40, 80, 7, 1 }, { 15, 40, 80, 7, 64 },
+                         { 8, 64, 64, 20, 1 }, { 8, 64, 64, 20, 64 } };
+  for (int32 i = 0; i < 4; i++) {
+    int32 num_heads = configs[i][0], key_dim = configs[i][1],
+        value_dim = configs[i][2], context_dim = configs[i][3] + 1,
+        num_images = configs[i][4],
+        output_num_rows = num_images * (num_images == 1 ? 256 : 32),
+        input_num_rows = output_num_rows + (context_dim - 1) * num_images;
+    CuMatrix<BaseFloat> keys(input_num_rows, key_dim),
+        values(input_num_rows, value_dim),
+        queries(output_num_rows, key_dim + context_dim),
+        c(output_num_rows, context_dim),
+        output(output_num_rows, value_dim + context_dim);
+    keys.SetRandn();
+    values.SetRandn();
+    queries.SetRandn();
+    Timer timer;
+    int32 iter;
+    for (iter = 0; timer.Elapsed() < 0.25; iter++)
+      for (int32 h = 0; h < num_heads; h++)
+        AttentionForward(1.0, keys, queries, values, &c, &output);
+    KALDI_LOG << "For num-heads=" << num_heads << ", key-dim=" << key_dim
+              << ", value-dim=" << value_dim << ", context-dim="
+              << context_dim << ", num-images=" << num_images
+              << ": AttentionForward() did "
+              << (iter * output_num_rows / timer.Elapsed())
+              << " frames/sec.";
+  }
+}
+
 void TestAttentionForwardBackward() {
   BaseFloat key_scale = 0.5 * RandInt(1, 3);
   BaseFloat epsilon = 1.0e-03;
@@ -228,6 +314,7 @@ void TestAttentionForwardBackward() {
 
 void UnitTestAttention() {
   UnitTestAttentionDotProductAndAddScales();
+  UnitTestAttentionForward();
   TestAttentionForwardBackward();
 }
 
@@ -253,4 +340,5 @@ int main() {
       UnitTestAttention();
     }
   }
+  AttentionSpeedTest();
 }
@@ -24,6 +24,12 @@
 #include "nnet3/attention.h"
 #include "nnet3/nnet-parse.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    KALDI_DOUBLEPRECISION == 0
+#define KALDI_ATTENTION_AVX2 1
+#include <immintrin.h>
+#endif
+
 namespace kaldi {
 namespace nnet3 {
 namespace attention {
@@ -94,6 +100,166 @@ void ApplyScalesToInput(BaseFloat alpha,
   }
 }
 
+#ifdef KALDI_ATTENTION_AVX2
+// The following are the inner loops of AttentionForwardCpu().
+// StridedDotProducts() does
+//   b[o] += alpha * VecVec(a, B + o * stride)   for 0 <= o < num_rows,
+// where a and the rows of B have dimension 'dim', and StridedWeightedSum()
+// does
+//   a += \sum_o c[o] * (B + o * stride)           for 0 <= o < num_rows.
+// These are too small for BLAS calls to be efficient.  They end with
+// _mm256_zeroupper() because GCC only emits vzeroupper for us at -O2 and
+// above, and the Exp() calls between them are non-VEX SSE code.
+__attribute__((target("avx2,fma")))
+static inline float HorizontalSum(__m256 x) {
+  __m128 sum = _mm_add_ps(_mm256_castps256_ps128(x),
+                          _mm256_extractf128_ps(x, 1));
+  sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+  sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+  return _mm_cvtss_f32(sum);
+}
+
+__attribute__((target("avx2,fma")))
+static void StridedDotProducts(int32 num_rows, int32 dim, float alpha,
+                               const float *a, const float *B,
+                               MatrixIndexT stride, float *b) {
+  for (int32 o = 0; o < num_rows; o++) {
+    const float *B_row = B + static_cast<size_t>(o) * stride;
+    __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+    int32 d = 0;
+    for (; d + 16 <= dim; d += 16) {
+      sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + d),
+                             _mm256_loadu_ps(B_row + d), sum0);
+      sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + d + 8),
+                             _mm256_loadu_ps(B_row + d + 8), sum1);
+    }
+    for (; d + 8 <= dim; d += 8)
+      sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + d),
+                             _mm256_loadu_ps(B_row + d), sum0);
+    float sum = HorizontalSum(_mm256_add_ps(sum0, sum1));
+    for (; d < dim; d++)
+      sum += a[d] * B_row[d];
+    b[o] += alpha * sum;
+  }
+  _mm256_zeroupper();
+}
+
+__attribute__((target("avx2,fma")))
+static void StridedWeightedSum(int32 num_rows, int32 dim, const float *c,
+                               const float *B, MatrixIndexT stride,
+                               float *a) {
+  // Keep 32 elements of 'a' in registers while going through the rows.
+  int32 d = 0;
+  for (; d + 32 <= dim; d += 32) {
+    __m256 a0 = _mm256_loadu_ps(a + d), a1 = _mm256_loadu_ps(a + d + 8),
+        a2 = _mm256_loadu_ps(a + d + 16), a3 = _mm256_loadu_ps(a + d + 24);
+    for (int32 o = 0; o < num_rows; o++) {
+      const float *B_row = B + static_cast<size_t>(o) * stride + d;
+      __m256 c_o = _mm256_broadcast_ss(c + o);
+      a0 = _mm256_fmadd_ps(c_o, _mm256_loadu_ps(B_row), a0);
+      a1 = _mm256_fmadd_ps(c_o, _mm256_loadu_ps(B_row + 8), a1);
+      a2 = _mm256_fmadd_ps(c_o, _mm256_loadu_ps(B_row + 16), a2);
+      a3 = _mm256_fmadd_ps(c_o, _mm256_loadu_ps(B_row + 24), a3);
+    }
+    _mm256_storeu_ps(a + d, a0);
+    _mm256_storeu_ps(a + d + 8, a1);
+    _mm256_storeu_ps(a + d + 16, a2);
+    _mm256_storeu_ps(a + d + 24, a3);
+  }
+  for (; d + 8 <= dim; d += 8) {
+    __m256 a0 = _mm256_loadu_ps(a + d);
+    for (int32 o = 0; o < num_rows; o++)
+      a0 = _mm256_fmadd_ps(_mm256_broadcast_ss(c + o),
+                           _mm256_loadu_ps(B + static_cast<size_t>(o) *
+                                           stride + d), a0);
+    _mm256_storeu_ps(a + d, a0);
+  }
+  for (; d < dim; d++) {
+    float sum = a[d];
+    for (int32 o = 0; o < num_rows; o++)
+      sum += c[o] * B[static_cast<size_t>(o) * stride + d];
+    a[d] = sum;
+  }
+  _mm256_zeroupper();
+}
+
+
+// This is the CPU implementation of AttentionForward() (see its documentation
+// for the arguments), used if the CPU supports AVX2 and FMA; it does the
+// dot-products, the softmax and the weighted sum of the values for each output
+// row in one pass.  Output row i uses the key and value rows
+// i + o * row_shift for 0 <= o < context_dim, which are equally spaced.
+//
+// Consecutive output rows in the same 'phase' i % row_shift share all but
+// one of those key and value rows, so we go through the phases in blocks
+// that are small enough that the rows they use stay in cache, and for each
+// block we go through the output rows in time order.
+static void AttentionForwardCpu(BaseFloat key_scale,
+                                const MatrixBase<BaseFloat> &keys,
+                                const MatrixBase<BaseFloat> &queries,
+                                const MatrixBase<BaseFloat> &values,
+                                MatrixBase<BaseFloat> *c,
+                                MatrixBase<BaseFloat> *output) {
+  int32 num_input_rows = keys.NumRows(),
+      key_dim = keys.NumCols(),
+      num_output_rows = queries.NumRows(),
+      context_dim = c->NumCols(),
+      value_dim = values.NumCols(),
+      row_shift = (num_input_rows - num_output_rows) / (context_dim - 1);
+  bool output_context = (output->NumCols() == value_dim + context_dim);
+  // Aim for the key and value rows used by a block of phases to take up
+  // about 256KB.
+  int32 bytes_per_phase = sizeof(BaseFloat) * context_dim *
+      (key_dim + value_dim),
+      phase_block_size = std::max<int32>(1, std::min<int32>(
+          row_shift, (1 << 18) / bytes_per_phase));
+  MatrixIndexT keys_stride = keys.Stride() * row_shift,
+      values_stride = values.Stride() * row_shift;
+
+  for (int32 phase_begin = 0; phase_begin < row_shift;
+       phase_begin += phase_block_size) {
+    int32 phase_end = std::min(phase_begin + phase_block_size, row_shift);
+    for (int32 row_begin = 0; row_begin < num_output_rows;
+         row_begin += row_shift) {
+      int32 row_end = std::min(row_begin + phase_end, num_output_rows);
+      for (int32 i = row_begin + phase_begin; i < row_end; i++) {
+        const BaseFloat *query = queries.RowData(i);
+        BaseFloat *b = c->RowData(i), *out = output->RowData(i);
+        // b_o = s_{i,o} + key_scale * (r_i . k_{i + o * row_shift}); see
+        // [eqn:b] in attention.h.
+        std::copy(query + key_dim, query + key_dim + context_dim, b);
+        StridedDotProducts(context_dim, key_dim, key_scale, query,
+                           keys.RowData(i), keys_stride, b);
+        BaseFloat max = b[0], sum = 0.0;
+        for (int32 o = 1; o < context_dim; o++)
+          max = std::max(max, b[o]);
+        for (int32 o = 0; o < context_dim; o++)
+          sum += (b[o] = Exp(b[o] - max));
+        BaseFloat inv_sum = 1.0 / sum;
+        for (int32 o = 0; o < context_dim; o++)
+          b[o] *= inv_sum;
+        // out += \sum_o c_{i,o} v_{i + o * row_shift}; see [eqn:u].
+        StridedWeightedSum(context_dim, value_dim, b, values.RowData(i),
+                           values_stride, out);
+        if (output_context)
+          std::copy(b, b + context_dim, out + value_dim);
+      }
+    }
+  }
+}
+
+// Returns true if AttentionForward() should use AttentionForwardCpu().
+static bool UseAttentionForwardCpu() {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled())
+    return false;
+#endif
+  static bool have_avx2 = __builtin_cpu_supports("avx2") &&
+      __builtin_cpu_supports("fma");
+  return have_avx2;
+}
+#endif  // KALDI_ATTENTION_AVX2
+
 void AttentionForward(BaseFloat key_scale,
                       const CuMatrixBase<BaseFloat> &keys,
                       const CuMatrixBase<BaseFloat> &queries,
@@ -118,6 +284,14 @@ void AttentionForward(BaseFloat key_scale,
                (output->NumCols() == value_dim ||
                 output->NumCols() == value_dim + context_dim));
 
+#ifdef KALDI_ATTENTION_AVX2
+  if (UseAttentionForwardCpu()) {
+    AttentionForwardCpu(key_scale, keys.Mat(), queries.Mat(), values.Mat(),
+                        &(c->Mat()), &(output->Mat()));
+    return;
+  }
+#endif
+
   CuSubMatrix<BaseFloat> queries_key_part(
       queries, 0, num_output_rows,
       0, key_dim),
@@ -185,6 +185,13 @@ namespace attention {
 // but the blocks might go over the zero parts a bit.   This could be done with
 // Or perhaps we can figure out how to implement the block-diagonal matrix
 // multiplies in CUDA.
+//
+// On CPUs with AVX2 and FMA, AttentionForward() does not use the functions
+// below.  For a single output row t, the key rows k_{t+o-num_left_inputs} (and
+// likewise the value rows) are equally spaced in memory, so [eqn:b] and
+// [eqn:u] are each one matrix-vector product on a strided view of the keys or
+// values; it computes both of those and the softmax for one row at a time, in
+// an order that keeps the key and value rows in cache.
 
 
 
@@ -291,6 +298,10 @@ void ApplyScalesToInput(BaseFloat alpha,
                             If the output->NumCols() is value-dim + context-dim,
                             'c' will be added to the remaining columns of
                             'output'.
+
+   On CPUs with AVX2 and FMA this uses a fused implementation that processes
+   one output row at a time (see "Implementation" above); otherwise, and on
+   GPU, it uses GetAttentionDotProducts() and ApplyScalesToOutput().
  */
 void AttentionForward(BaseFloat key_scale,
                       const CuMatrixBase<BaseFloat> &keys,
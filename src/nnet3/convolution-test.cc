@@ -19,6 +19,7 @@
 
 #include "nnet3/convolution.h"
 #include "util/common-utils.h"
+#include "base/timer.h"
 
 namespace kaldi {
 namespace nnet3 {
@@ -286,20 +287,30 @@ void TestRunningComputation(const ConvolutionModel &conv_model,
       output(output_indexes.size(), conv_model.OutputDim(),
              kSetZero, kStrideEqualNumCols),
       output2(output),
+      output3(output_indexes.size(), conv_model.OutputDim(),
+              kSetZero, kStrideEqualNumCols),
       params(conv_model.ParamRows(), conv_model.ParamCols());
   input.SetRandn();
   params.SetRandn();
   ZeroBlankRows(input_indexes, &input);
   ConvolveForward(computation, input, params, &output);
   ZeroBlankRows(output_indexes, &output);
+  // ConvolveForward() may have used either of these; test both.
+  if (RandInt(0, 1) == 0)
+    ConvolveForwardDirect(computation, input, params, &output3);
+  else
+    ConvolveForwardWithTemp(computation, input, params, &output3);
+  ZeroBlankRows(output_indexes, &output3);
 
   ConvolveForwardSimple(conv_model, input_indexes, output_indexes,
                         input, params, &output2);
   KALDI_LOG << "Tested convolution for model: "
             << conv_model.Info();
-  if (!output.ApproxEqual(output2, 0.001)) {
+  if (!output.ApproxEqual(output2, 0.001) ||
+      !output3.ApproxEqual(output2, 0.001)) {
     KALDI_LOG << "Output is: " << output;
     KALDI_LOG << "Output2 is: " << output2;
+    KALDI_LOG << "Output3 is: " << output3;
     KALDI_ERR << "Convolution test failure.";
   }
 }
@@ -434,6 +445,111 @@ void UnitTestTimeHeightConvolutionCompile() {
 }
 
 
+// Creates a model for a typical 3x3 convolution with zero-padding on the
+// height axis, as used in CNN-TDNN setups.
+static void GetTypicalConvolutionModel(int32 num_filters_in,
+                                       int32 num_filters_out,
+                                       int32 height_in,
+                                       int32 height_subsample_out,
+                                       ConvolutionModel *model) {
+  model->num_filters_in = num_filters_in;
+  model->num_filters_out = num_filters_out;
+  model->height_in = height_in;
+  model->height_out = height_in / height_subsample_out;
+  model->height_subsample_out = height_subsample_out;
+  model->offsets.clear();
+  model->required_time_offsets.clear();
+  for (int32 t = -1; t <= 1; t++) {
+    for (int32 h = -1; h <= 1; h++) {
+      ConvolutionModel::Offset o;
+      o.time_offset = t;
+      o.height_offset = h;
+      model->offsets.push_back(o);
+    }
+    model->required_time_offsets.insert(t);
+  }
+  model->ComputeDerived();
+  KALDI_ASSERT(model->Check());
+}
+
+// Compares the speed of ConvolveForwardDirect() and ConvolveForwardWithTemp()
+// for a typical convolution applied to 'num_images' sequences of 'num_t_out'
+// frames, and checks that they give the same output.
+static void TestConvolutionSpeed(int32 num_filters_in, int32 num_filters_out,
+                                 int32 height_in, int32 height_subsample_out,
+                                 int32 num_images, int32 num_t_out) {
+  ConvolutionModel model;
+  GetTypicalConvolutionModel(num_filters_in, num_filters_out, height_in,
+                             height_subsample_out, &model);
+  std::vector<Index> input_indexes, output_indexes;
+  for (int32 n = 0; n < num_images; n++) {
+    for (int32 t = -1; t <= num_t_out; t++) {
+      input_indexes.push_back(Index(n, t, 0));
+      if (t >= 0 && t < num_t_out)
+        output_indexes.push_back(Index(n, t, 0));
+    }
+  }
+  ConvolutionComputationOptions opts;
+  ConvolutionComputation computation;
+  std::vector<Index> input_indexes_modified, output_indexes_modified;
+  CompileConvolutionComputation(model, input_indexes, output_indexes,
+                                opts, &computation,
+                                &input_indexes_modified,
+                                &output_indexes_modified);
+  CuMatrix<BaseFloat> input(input_indexes_modified.size(), model.InputDim(),
+                            kSetZero, kStrideEqualNumCols),
+      output(output_indexes_modified.size(), model.OutputDim(),
+             kSetZero, kStrideEqualNumCols),
+      output2(output),
+      params(model.ParamRows(), model.ParamCols());
+  input.SetRandn();
+  params.SetRandn();
+
+  BaseFloat time_in_secs = 0.05;
+  double direct_time, temp_time;
+  {
+    Timer timer;
+    int32 iter = 0;
+    for (; timer.Elapsed() < time_in_secs; iter++)
+      ConvolveForwardDirect(computation, input, params, &output);
+    direct_time = timer.Elapsed() / iter;
+    output.Scale(1.0 / iter);
+  }
+  {
+    Timer timer;
+    int32 iter = 0;
+    for (; timer.Elapsed() < time_in_secs; iter++)
+      ConvolveForwardWithTemp(computation, input, params, &output2);
+    temp_time = timer.Elapsed() / iter;
+    output2.Scale(1.0 / iter);
+  }
+  KALDI_LOG << "For " << model.Info() << ", num-images=" << num_images
+            << ", num-t-out=" << num_t_out << ": direct convolution took "
+            << (direct_time * 1.0e+03) << " ms vs. "
+            << (temp_time * 1.0e+03) << " ms with the temporary matrix.";
+  if (!output.ApproxEqual(output2, 0.001))
+    KALDI_ERR << "Direct convolution gives different output.";
+}
+
+void UnitTestConvolutionSpeed() {
+  // first layer of a CNN-TDNN on 40-dim fbank features (plus an i-vector
+  // channel and deltas, so 3 input filters).
+  TestConvolutionSpeed(3, 64, 40, 1, 1, 50);
+  TestConvolutionSpeed(3, 64, 40, 1, 64, 8);
+  // later layers, with and without height subsampling; for a single image with
+  // 50 or 8 frames (as in decoding), and for 64 images with 8 frames (as in
+  // training or batched decoding).
+  for (int32 i = 0; i < 3; i++) {
+    int32 num_images = (i == 2 ? 64 : 1),
+        num_t_out = (i == 0 ? 50 : 8);
+    TestConvolutionSpeed(64, 64, 40, 1, num_images, num_t_out);
+    TestConvolutionSpeed(64, 128, 40, 2, num_images, num_t_out);
+    TestConvolutionSpeed(128, 128, 20, 1, num_images, num_t_out);
+    TestConvolutionSpeed(256, 256, 10, 1, num_images, num_t_out);
+  }
+}
+
+
 void UnitTestTimeHeightConvolution() {
   UnitTestTimeHeightConvolutionIo();
   UnitTestTimeHeightConvolutionCompile();
@@ -461,5 +577,6 @@ int main() {
     for (int32 i = 0; i < 5; i++) {
       UnitTestTimeHeightConvolution();
     }
+    UnitTestConvolutionSpeed();
   }
 }
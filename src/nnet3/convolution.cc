@@ -521,7 +521,71 @@ static void ConvolveForwardInternal(
   }
 }
 
-void ConvolveForward(
+void ConvolveForwardDirect(
+    const ConvolutionComputation &cc,
+    const CuMatrixBase<BaseFloat> &input_in,
+    const CuMatrixBase<BaseFloat> &params,
+    CuMatrixBase<BaseFloat> *output) {
+  KALDI_ASSERT(input_in.NumCols() == input_in.Stride() &&
+               params.NumRows() == cc.num_filters_out &&
+               output->NumRows() == cc.num_t_out * cc.num_images &&
+               output->NumCols() == cc.height_out * cc.num_filters_out);
+  // the input might need to be reshaped, as in ConvolveForward(); we already
+  // checked that its Stride() == NumCols().
+  int32 input_rows = cc.num_images * cc.num_t_in;
+  if (input_in.NumRows() * input_in.NumCols() !=
+      input_rows * cc.height_in * cc.num_filters_in)
+    KALDI_ERR << "Input matrix has wrong size.";  // error in calling code.
+  CuSubMatrix<BaseFloat> input(input_in.Data(), input_rows,
+                               cc.height_in * cc.num_filters_in,
+                               cc.height_in * cc.num_filters_in);
+
+  int32 output_rows = output->NumRows(),
+      num_filters_in = cc.num_filters_in,
+      num_filters_out = cc.num_filters_out;
+  int32 num_steps = cc.steps.size();
+  for (int32 s = 0; s < num_steps; s++) {
+    const ConvolutionComputation::ConvolutionStep &step = cc.steps[s];
+    const std::vector<int32> &height_map = step.height_map;
+    // each output height uses 'heights_per_output' consecutive elements of
+    // 'height_map', and the same number of blocks of num_filters_in
+    // parameter columns starting from params_start_col.
+    int32 heights_per_output = height_map.size() / cc.height_out;
+    CuSubMatrix<BaseFloat> input_part(input,
+                                      step.input_time_shift * cc.num_images,
+                                      output_rows, 0, input.NumCols());
+    for (int32 h = 0; h < cc.height_out; h++) {
+      CuSubMatrix<BaseFloat> output_part(*output, 0, output_rows,
+                                         h * num_filters_out,
+                                         num_filters_out);
+      const int32 *this_height_map = &(height_map[h * heights_per_output]);
+      int32 i = 0;
+      while (i < heights_per_output) {
+        int32 h_in = this_height_map[i];
+        if (h_in < 0) {  // zero-padding; skip it.
+          i++;
+          continue;
+        }
+        // find the run of consecutive input heights starting here; all of
+        // it can be done in one matrix multiply.
+        int32 n = 1;
+        while (i + n < heights_per_output && this_height_map[i + n] == h_in + n)
+          n++;
+        CuSubMatrix<BaseFloat> input_block(input_part, 0, output_rows,
+                                           h_in * num_filters_in,
+                                           n * num_filters_in),
+            params_block(params, 0, num_filters_out,
+                         step.params_start_col + i * num_filters_in,
+                         n * num_filters_in);
+        output_part.AddMatMat(1.0, input_block, kNoTrans,
+                              params_block, kTrans, 1.0);
+        i += n;
+      }
+    }
+  }
+}
+
+void ConvolveForwardWithTemp(
     const ConvolutionComputation &cc,
     const CuMatrixBase<BaseFloat> &input,
     const CuMatrixBase<BaseFloat> &params,
@@ -551,7 +615,7 @@ void ConvolveForward(
         new_stride = new_num_cols;
     CuSubMatrix<BaseFloat> input_reshaped(
         input.Data(), required_input_rows, new_num_cols, new_stride);
-    ConvolveForward(cc, input_reshaped, params, output);
+    ConvolveForwardWithTemp(cc, input_reshaped, params, output);
     return;
   }
 
@@ -592,6 +656,59 @@ void ConvolveForward(
   ConvolveForwardInternal(cc, input, params, &temp_mat, output);
 }
 
+// Returns true if ConvolveForward() should use ConvolveForwardDirect().  On
+// GPU we always use the temporary matrix, because the direct method would need
+// too many kernel launches.  On CPU the direct method is faster if its matrix
+// multiplies are not too small.  They need enough rows: in tests with typical
+// CNN-TDNN layers the break-even point was around 32 to 50 rows, and with 512
+// rows it was 10% to 40% faster.  They also need enough columns (the number of
+// consecutive input heights times num_filters_in): with a 3x3 kernel and 1 or
+// 2 input filters, i.e. 3 or 6 columns, it was no faster even with 512 rows,
+// while with 3 input filters (9 columns) it was about 7% faster.
+static bool UseConvolveForwardDirect(const ConvolutionComputation &cc) {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled())
+    return false;
+#endif
+  if (cc.num_t_out * cc.num_images < 64)
+    return false;
+  // Work out the average number of columns of the matrix multiplies that
+  // ConvolveForwardDirect() would do; this follows the loops there.
+  int64 num_multiplies = 0, num_cols = 0;
+  for (size_t s = 0; s < cc.steps.size(); s++) {
+    const std::vector<int32> &height_map = cc.steps[s].height_map;
+    int32 heights_per_output = height_map.size() / cc.height_out;
+    for (int32 h = 0; h < cc.height_out; h++) {
+      const int32 *this_height_map = &(height_map[h * heights_per_output]);
+      int32 i = 0;
+      while (i < heights_per_output) {
+        int32 h_in = this_height_map[i], n = 1;
+        if (h_in < 0) {
+          i++;
+          continue;
+        }
+        while (i + n < heights_per_output && this_height_map[i + n] == h_in + n)
+          n++;
+        num_multiplies++;
+        num_cols += n * cc.num_filters_in;
+        i += n;
+      }
+    }
+  }
+  return num_cols >= 8 * num_multiplies;
+}
+
+void ConvolveForward(
+    const ConvolutionComputation &cc,
+    const CuMatrixBase<BaseFloat> &input,
+    const CuMatrixBase<BaseFloat> &params,
+    CuMatrixBase<BaseFloat> *output) {
+  if (UseConvolveForwardDirect(cc))
+    ConvolveForwardDirect(cc, input, params, output);
+  else
+    ConvolveForwardWithTemp(cc, input, params, output);
+}
+
 
 // Internal function called inside ConvolveBackwardData.
 // Note: the number of time steps covered may be different
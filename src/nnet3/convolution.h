@@ -46,7 +46,9 @@ namespace nnet3 {
 /// framework in a way that would support both GPUs and CPUs, at least for the
 /// typical setups that have small patch dimensions (like 1x1 or 3x3).  In a
 /// typical 3x3 convolution, the entire convolution can be done using 3 matrix
-/// multiplies (and 3 corresponding CopyColsFromMat calls).
+/// multiplies (and 3 corresponding CopyColsFromMat calls).  On CPU, the
+/// forward computation may instead be done without the copies, as more but
+/// smaller matrix multiplies; see ConvolveForwardDirect().
 
 
 namespace time_height_convolution {
@@ -481,6 +483,36 @@ void ConvolveForward(
     CuMatrixBase<BaseFloat> *output);
 
 
+/**
+   This does the same as ConvolveForward(), always using the temporary matrix
+   (see the comment at the top of this file); it's made available for testing
+   purposes.
+ */
+void ConvolveForwardWithTemp(
+    const ConvolutionComputation &conv_comp,
+    const CuMatrixBase<BaseFloat> &input,
+    const CuMatrixBase<BaseFloat> &params,
+    CuMatrixBase<BaseFloat> *output);
+
+/**
+   This does the same as ConvolveForward(), but without the temporary matrix:
+   instead of copying the input to a temporary matrix with a column mapping and
+   then doing a few large matrix multiplies, it does a matrix multiply for each
+   output height and each run of consecutive input heights, directly on
+   sub-matrices of the input and output.  This saves memory bandwidth and the
+   allocation of the temporary matrix, at the cost of doing more (and smaller)
+   matrix multiplies.  ConvolveForward() calls this automatically, on CPU only,
+   when it is likely to be faster (see the code for details); it's made
+   available for testing purposes.  The arguments are the same as for
+   ConvolveForward().
+ */
+void ConvolveForwardDirect(
+    const ConvolutionComputation &conv_comp,
+    const CuMatrixBase<BaseFloat> &input,
+    const CuMatrixBase<BaseFloat> &params,
+    CuMatrixBase<BaseFloat> *output);
+
+
 /**
    \brief This does the part of the backward derivative computation
           of convolution, that propagates derivatives back to
@@ -621,10 +621,14 @@ bool NnetBatchComputer::Compute(bool allow_partial_minibatch) {
   output.Scale(opts_.acoustic_scale);
   FormatOutputs(output, tasks);
 
-  // Update the stats, for diagnostics.
-  minfo->num_done++;
-  minfo->tot_num_tasks += static_cast<int64>(tasks.size());
-  minfo->seconds_taken += tim.Elapsed();
+  {
+    // Update the stats, for diagnostics.  We lock because several threads may
+    // be calling Compute() at once (e.g. in nnet3-align-compiled-batch).
+    std::unique_lock<std::mutex> lock(mutex_);
+    minfo->num_done++;
+    minfo->tot_num_tasks += static_cast<int64>(tasks.size());
+    minfo->seconds_taken += tim.Elapsed();
+  }
 
   SynchronizeGpu();
 
@@ -1470,15 +1470,9 @@ void* GruNonlinearityComponent::Propagate(
   // now h_t = hpart_t (note: hpart_t actually means U^h x_t).
   h_t.AddMatMat(1.0, sdotr, kNoTrans, w_h_, kTrans, 1.0);
   // now h_t = hpart_t + W^h (s_{t-1} \dot r_t).
-  h_t.Tanh(h_t);
-  // now, h_t = tanh(hpart_t + W^h (s_{t-1} \dot r_t)).
-
-  c_t.CopyFromMat(h_t);
-  // now c_t = h_t
-  c_t.AddMatMatElements(-1.0, z_t, h_t, 1.0);
-  // now c_t = (1 - z_t) \dot h_t.
-  c_t.AddMatMatElements(1.0, z_t, c_t1, 1.0);
-  // now c_t = (1 - z_t) \dot h_t  +  z_t \dot c_{t-1}.
+  cu::ComputeGruNonlinearity(z_t, c_t1, &h_t, &c_t);
+  // now, h_t = tanh(hpart_t + W^h (s_{t-1} \dot r_t)), and
+  // c_t = (1 - z_t) \dot h_t  +  z_t \dot c_{t-1}.
   return NULL;
 }
 
@@ -1543,9 +1537,8 @@ void GruNonlinearityComponent::Backprop(
   {  // we initialize h_t_deriv with the derivative from 'out_deriv'.
     // In real life in a GRU, this would always be zero; but in testing
     // code it may be nonzero and we include this term so that
-    // the tests don't fail.  Note: if you were to remove these
-    // lines, you'd have to change 'h_t_deriv.AddMat(1.0, c_t_deriv);' below
-    // to a CopyFromMat() call.
+    // the tests don't fail.  Note: cu::BackpropGruNonlinearity() below
+    // adds to h_t_deriv, so it has to be initialized.
     CuSubMatrix<BaseFloat> h_t_deriv_in(out_deriv, 0, num_rows, 0, c);
     h_t_deriv.CopyFromMat(h_t_deriv_in);
   }
@@ -1557,24 +1550,13 @@ void GruNonlinearityComponent::Backprop(
   sdotr.AddMatMatElements(1.0, r_t, s_t1, 0.0);
 
 
-  { // This block does the
-    // backprop corresponding to the
-    // forward-pass expression: c_t = (1 - z_t) \dot h_t + z_t \dot c_{t-1}.
-
-    // First do: h_t_deriv = c_t_deriv \dot (1 - z_t).
-    h_t_deriv.AddMat(1.0, c_t_deriv);
-    h_t_deriv.AddMatMatElements(-1.0, c_t_deriv, z_t, 1.0);
-
-    if (in_deriv) {
-      // these should be self-explanatory if you study
-      // the expression "c_t = (1 - z_t) \dot h_t + z_t \dot c_{t-1}".
-      z_t_deriv.AddMatMatElements(-1.0, c_t_deriv, h_t, 1.0);
-      z_t_deriv.AddMatMatElements(1.0, c_t_deriv, c_t1, 1.0);
-      c_t1_deriv.AddMatMatElements(1.0, c_t_deriv, z_t, 1.0);
-    }
-  }
-
-  h_t_deriv.DiffTanh(h_t, h_t_deriv);
+  // This does the backprop corresponding to the forward-pass expressions
+  // c_t = (1 - z_t) \dot h_t + z_t \dot c_{t-1} and
+  // h_t = tanh(...), adding to z_t_deriv and c_t1_deriv if in_deriv is
+  // non-NULL.
+  cu::BackpropGruNonlinearity(z_t, c_t1, h_t, c_t_deriv, &h_t_deriv,
+                              (in_deriv ? &z_t_deriv : NULL),
+                              (in_deriv ? &c_t1_deriv : NULL));
   if (to_update)
     to_update->TanhStatsAndSelfRepair(h_t, &h_t_deriv);
 
@@ -1972,15 +1954,9 @@ void* OutputGruNonlinearityComponent::Propagate(
   // now h_t = W^h \dot c_{t-1}
   h_t.AddMat(1.0, hpart_t, kNoTrans);
   // now h_t = hpart_t + W^h \dot c_{t-1}.(note: hpart_t actually means U^h x_t).
-  h_t.Tanh(h_t);
-  // now, h_t = tanh(hpart_t + W^h \dot c_{t-1}).
-
-  c_t.CopyFromMat(h_t);
-  // now c_t = h_t
-  c_t.AddMatMatElements(-1.0, z_t, h_t, 1.0);
-  // now c_t = (1 - z_t) \dot h_t.
-  c_t.AddMatMatElements(1.0, z_t, c_t1, 1.0);
-  // now c_t = (1 - z_t) \dot h_t  +  z_t \dot c_{t-1}.
+  cu::ComputeGruNonlinearity(z_t, c_t1, &h_t, &c_t);
+  // now, h_t = tanh(hpart_t + W^h \dot c_{t-1}), and
+  // c_t = (1 - z_t) \dot h_t  +  z_t \dot c_{t-1}.
   return NULL;
 }
 
@@ -2039,32 +2015,20 @@ void OutputGruNonlinearityComponent::Backprop(
   {  // we initialize h_t_deriv with the derivative from 'out_deriv'.
     // In real life in a GRU, this would always be zero; but in testing
     // code it may be nonzero and we include this term so that
-    // the tests don't fail.  Note: if you were to remove these
-    // lines, you'd have to change 'h_t_deriv.AddMat(1.0, c_t_deriv);' below
-    // to a CopyFromMat() call.
+    // the tests don't fail.  Note: cu::BackpropGruNonlinearity() below
+    // adds to h_t_deriv, so it has to be initialized.
     CuSubMatrix<BaseFloat> h_t_deriv_in(out_deriv, 0, num_rows, 0, c);
     h_t_deriv.CopyFromMat(h_t_deriv_in);
   }
 
 
-  { // This block does the
-    // backprop corresponding to the
-    // forward-pass expression: c_t = (1 - z_t) \dot h_t + z_t \dot c_{t-1}.
-
-    // First do: h_t_deriv = c_t_deriv \dot (1 - z_t).
-    h_t_deriv.AddMat(1.0, c_t_deriv);
-    h_t_deriv.AddMatMatElements(-1.0, c_t_deriv, z_t, 1.0);
-
-    if (in_deriv) {
-      // these should be self-explanatory if you study
-      // the expression "c_t = (1 - z_t) \dot h_t + z_t \dot c_{t-1}".
-      z_t_deriv.AddMatMatElements(-1.0, c_t_deriv, h_t, 1.0);
-      z_t_deriv.AddMatMatElements(1.0, c_t_deriv, c_t1, 1.0);
-      c_t1_deriv.AddMatMatElements(1.0, c_t_deriv, z_t, 1.0);
-    }
-  }
-
-  h_t_deriv.DiffTanh(h_t, h_t_deriv);
+  // This does the backprop corresponding to the forward-pass expressions
+  // c_t = (1 - z_t) \dot h_t + z_t \dot c_{t-1} and
+  // h_t = tanh(...), adding to z_t_deriv and c_t1_deriv if in_deriv is
+  // non-NULL.
+  cu::BackpropGruNonlinearity(z_t, c_t1, h_t, c_t_deriv, &h_t_deriv,
+                              (in_deriv ? &z_t_deriv : NULL),
+                              (in_deriv ? &c_t1_deriv : NULL));
   if (to_update)
     to_update->TanhStatsAndSelfRepair(h_t, &h_t_deriv);
   
@@ -127,10 +127,20 @@ Component* Component::NewComponentOfType(const std::string &component_type) {
     ans = new SumGroupComponent();
   } else if (component_type == "FixedAffineComponent") {
     ans = new FixedAffineComponent();
+  } else if (component_type == "QuantizedAffineComponent") {
+    ans = new QuantizedAffineComponent();
+  } else if (component_type == "HalfPrecisionAffineComponent") {
+    ans = new HalfPrecisionAffineComponent();
+  } else if (component_type == "MappedAffineComponent") {
+    ans = new MappedAffineComponent();
+  } else if (component_type == "SparseAffineComponent") {
+    ans = new SparseAffineComponent();
   } else if (component_type == "FixedScaleComponent") {
     ans = new FixedScaleComponent();
   } else if (component_type == "FixedBiasComponent") {
     ans = new FixedBiasComponent();
+  } else if (component_type == "BiasReluOffsetComponent") {
+    ans = new BiasReluOffsetComponent();
   } else if (component_type == "NoOpComponent") {
     ans = new NoOpComponent();
   } else if (component_type == "ClipGradientComponent") {
@@ -414,6 +414,8 @@ class RandomComponent: public Component {
   // from normal mode.
   void SetTestMode(bool test_mode) { test_mode_ = test_mode; }
 
+  bool TestMode() const { return test_mode_; }
+
   RandomComponent(): test_mode_(false) { }
 
   RandomComponent(const RandomComponent &other):
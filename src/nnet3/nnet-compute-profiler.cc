@@ -0,0 +1,444 @@
+// nnet3/nnet-compute-profiler.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <iomanip>
+#include "nnet3/nnet-compute-profiler.h"
+#include "nnet3/nnet-utils.h"
+#include "util/kaldi-io.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+
+// Returns the name of the command type, e.g. "kPropagate", as written by
+// NnetComputation::Command::Write().
+static const char *CommandTypeName(CommandType command_type) {
+  switch (command_type) {
+    case kAllocMatrix: return "kAllocMatrix";
+    case kDeallocMatrix: return "kDeallocMatrix";
+    case kSwapMatrix: return "kSwapMatrix";
+    case kSetConst: return "kSetConst";
+    case kPropagate: return "kPropagate";
+    case kBackprop: return "kBackprop";
+    case kBackpropNoModelUpdate: return "kBackpropNoModelUpdate";
+    case kMatrixCopy: return "kMatrixCopy";
+    case kMatrixAdd: return "kMatrixAdd";
+    case kCopyRows: return "kCopyRows";
+    case kAddRows: return "kAddRows";
+    case kCopyRowsMulti: return "kCopyRowsMulti";
+    case kCopyToRowsMulti: return "kCopyToRowsMulti";
+    case kAddRowsMulti: return "kAddRowsMulti";
+    case kAddToRowsMulti: return "kAddToRowsMulti";
+    case kAddRowRanges: return "kAddRowRanges";
+    case kCompressMatrix: return "kCompressMatrix";
+    case kDecompressMatrix: return "kDecompressMatrix";
+    case kAcceptInput: return "kAcceptInput";
+    case kProvideOutput: return "kProvideOutput";
+    case kNoOperation: return "kNoOperation";
+    case kNoOperationPermanent: return "kNoOperationPermanent";
+    case kNoOperationMarker: return "kNoOperationMarker";
+    case kNoOperationLabel: return "kNoOperationLabel";
+    case kGotoLabel: return "kGotoLabel";
+    default:
+      KALDI_ERR << "Unknown command type " << static_cast<int32>(command_type);
+      return NULL;  // suppress compiler warning.
+  }
+}
+
+
+void NnetComputeProfiler::Stats::Add(double seconds,
+                                     double flops, double bytes) {
+  count++;
+  this->seconds += seconds;
+  this->flops += flops;
+  this->bytes += bytes;
+}
+
+void NnetComputeProfiler::Stats::Add(const Stats &other) {
+  count += other.count;
+  seconds += other.seconds;
+  flops += other.flops;
+  bytes += other.bytes;
+}
+
+
+// static
+void NnetComputeProfiler::EstimateCost(const Nnet &nnet,
+                                       const NnetComputation &computation,
+                                       int32 command_index,
+                                       double *flops, double *bytes) {
+  const NnetComputation::Command &c = computation.commands[command_index];
+  const std::vector<NnetComputation::SubMatrixInfo> &submatrices =
+      computation.submatrices;
+  // the number of elements in sub-matrix arg1, which is the destination of
+  // most of the non-component commands.
+  double num_elements = 0.0;
+  if (c.arg1 >= 0 && c.arg1 < static_cast<int32>(submatrices.size()))
+    num_elements = static_cast<double>(submatrices[c.arg1].num_rows) *
+        submatrices[c.arg1].num_cols;
+  const double float_size = sizeof(BaseFloat);
+  *flops = 0.0;
+  *bytes = 0.0;
+  switch (c.command_type) {
+    case kPropagate: case kBackprop: case kBackpropNoModelUpdate: {
+      const Component *component = nnet.GetComponent(c.arg1);
+      int32 num_params = 0;
+      if (component->Properties() & kUpdatableComponent) {
+        const UpdatableComponent *uc =
+            dynamic_cast<const UpdatableComponent*>(component);
+        if (uc != NULL)
+          num_params = uc->NumParameters();
+      }
+      std::vector<int32> submatrix_args;
+      int32 num_rows;
+      double num_passes = 1.0;
+      if (c.command_type == kPropagate) {
+        submatrix_args.push_back(c.arg3);
+        submatrix_args.push_back(c.arg4);
+        num_rows = submatrices[c.arg4].num_rows;
+      } else {
+        submatrix_args.push_back(c.arg3);
+        submatrix_args.push_back(c.arg4);
+        submatrix_args.push_back(c.arg5);
+        submatrix_args.push_back(c.arg6);
+        num_rows = submatrices[c.arg5].num_rows;
+        // one pass for the input derivative, one for the model update.
+        bool update = (c.command_type == kBackprop && num_params != 0 &&
+                       computation.need_model_derivative);
+        num_passes = std::max<int32>(1, (c.arg6 != 0 ? 1 : 0) +
+                                     (update ? 1 : 0));
+        if (update)
+          *bytes += float_size * num_params;  // the parameter derivatives.
+      }
+      *flops = num_passes * num_rows * ComponentFlopsPerFrame(*component);
+      *bytes += float_size * num_params;
+      for (size_t i = 0; i < submatrix_args.size(); i++) {
+        const NnetComputation::SubMatrixInfo &s =
+            submatrices[submatrix_args[i]];
+        *bytes += float_size * s.num_rows * s.num_cols;
+      }
+      break;
+    }
+    case kSetConst:
+      *bytes = float_size * num_elements;
+      break;
+    case kMatrixCopy: case kCopyRows: case kCopyRowsMulti:
+    case kCopyToRowsMulti:
+      *bytes = 2.0 * float_size * num_elements;
+      if (c.alpha != 1.0)
+        *flops = num_elements;
+      break;
+    case kMatrixAdd: case kAddRows: case kAddRowsMulti: case kAddToRowsMulti:
+    case kAddRowRanges:
+      // read the destination and the source, and write the destination.
+      *flops = (c.alpha != 1.0 ? 2.0 : 1.0) * num_elements;
+      *bytes = 3.0 * float_size * num_elements;
+      break;
+    case kCompressMatrix: case kDecompressMatrix:
+      // the compressed form takes at least one byte per element.
+      *flops = num_elements;
+      *bytes = (float_size + 1.0) * num_elements;
+      break;
+    default:
+      // allocation, swapping and no-ops; we count the time only.
+      break;
+  }
+}
+
+
+// static
+std::string NnetComputeProfiler::CommandNodeName(
+    const Nnet &nnet, const NnetComputation &computation,
+    const std::vector<int32> &component_to_node, int32 command_index) {
+  const NnetComputation::Command &c = computation.commands[command_index];
+  int32 component_index = c.arg1;
+  // the output value for kPropagate, the output derivative for backprop.
+  int32 submatrix_index = (c.command_type == kPropagate ? c.arg4 : c.arg5);
+  if (submatrix_index > 0) {
+    const NnetComputation::SubMatrixInfo &submat =
+        computation.submatrices[submatrix_index];
+    if (submat.matrix_index <
+        static_cast<int32>(computation.matrix_debug_info.size())) {
+      const std::vector<Cindex> &cindexes =
+          computation.matrix_debug_info[submat.matrix_index].cindexes;
+      if (submat.row_offset < static_cast<int32>(cindexes.size())) {
+        // after optimization the matrix may be shared with other nodes, so
+        // check that the node really is for this component.
+        int32 node_index = cindexes[submat.row_offset].first;
+        if (nnet.IsComponentNode(node_index) &&
+            nnet.GetNode(node_index).u.component_index == component_index)
+          return nnet.GetNodeName(node_index);
+      }
+    }
+  }
+  int32 node_index = component_to_node[component_index];
+  if (node_index >= 0)
+    return nnet.GetNodeName(node_index);
+  else
+    return nnet.GetComponentName(component_index);
+}
+
+
+void NnetComputeProfiler::AccumulateCommands(
+    const Nnet &nnet, const NnetComputation &computation,
+    const std::vector<std::pair<int32, double> > &command_times) {
+  std::vector<int32> component_to_node(nnet.NumComponents(), -1);
+  {
+    std::vector<int32> num_nodes(nnet.NumComponents(), 0);
+    for (int32 n = 0; n < nnet.NumNodes(); n++) {
+      if (nnet.IsComponentNode(n)) {
+        int32 c = nnet.GetNode(n).u.component_index;
+        if (++num_nodes[c] == 1)
+          component_to_node[c] = n;
+        else
+          component_to_node[c] = -1;
+      }
+    }
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  num_runs_++;
+  for (size_t i = 0; i < command_times.size(); i++) {
+    int32 command_index = command_times[i].first;
+    double seconds = command_times[i].second;
+    const NnetComputation::Command &c = computation.commands[command_index];
+    double flops, bytes;
+    EstimateCost(nnet, computation, command_index, &flops, &bytes);
+    command_stats_[CommandTypeName(c.command_type)].Add(seconds, flops, bytes);
+    if (c.command_type == kPropagate || c.command_type == kBackprop ||
+        c.command_type == kBackpropNoModelUpdate) {
+      ComponentNodeStats &stats = node_stats_[
+          CommandNodeName(nnet, computation, component_to_node, command_index)];
+      if (stats.type.empty()) {
+        stats.component = nnet.GetComponentName(c.arg1);
+        stats.type = nnet.GetComponent(c.arg1)->Type();
+      }
+      if (c.command_type == kPropagate)
+        stats.propagate.Add(seconds, flops, bytes);
+      else
+        stats.backprop.Add(seconds, flops, bytes);
+    }
+  }
+}
+
+
+int64 NnetComputeProfiler::NumRuns() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return num_runs_;
+}
+
+NnetComputeProfiler::Stats NnetComputeProfiler::CommandTypeStats(
+    const std::string &command_type) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<std::string, Stats>::const_iterator iter =
+      command_stats_.find(command_type);
+  return (iter == command_stats_.end() ? Stats() : iter->second);
+}
+
+NnetComputeProfiler::Stats NnetComputeProfiler::NodeStats(
+    const std::string &node_name, bool backprop) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<std::string, ComponentNodeStats>::const_iterator iter =
+      node_stats_.find(node_name);
+  if (iter == node_stats_.end())
+    return Stats();
+  return (backprop ? iter->second.backprop : iter->second.propagate);
+}
+
+double NnetComputeProfiler::TotalSeconds() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  double ans = 0.0;
+  std::map<std::string, Stats>::const_iterator iter = command_stats_.begin(),
+      end = command_stats_.end();
+  for (; iter != end; ++iter)
+    ans += iter->second.seconds;
+  return ans;
+}
+
+
+// Prints the columns for the count, time, FLOPs and bytes (see PrintTable());
+// 'total_seconds' is used for the percentage.
+static void PrintStatsColumns(int64 count, double seconds, double flops,
+                              double bytes, double total_seconds,
+                              std::ostream &os) {
+  os << std::setw(10) << count << std::setw(11) << std::setprecision(4)
+     << seconds << std::setw(8) << std::setprecision(2)
+     << (total_seconds > 0.0 ? 100.0 * seconds / total_seconds : 0.0)
+     << std::setw(10) << std::setprecision(3) << flops * 1.0e-09
+     << std::setw(9) << std::setprecision(2)
+     << (seconds > 0.0 ? flops * 1.0e-09 / seconds : 0.0)
+     << std::setw(10) << std::setprecision(3) << bytes * 1.0e-09
+     << std::setw(8) << std::setprecision(2)
+     << (seconds > 0.0 ? bytes * 1.0e-09 / seconds : 0.0);
+}
+
+void NnetComputeProfiler::PrintTable(std::ostream &os) const {
+  double total_seconds = TotalSeconds();
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::ios_base::fmtflags flags = os.flags();
+  os << std::fixed;
+  os << "Profile of the neural net computation: " << num_runs_
+     << " runs, " << std::setprecision(3) << total_seconds
+     << " seconds in total.\n\n";
+
+  {  // per command type.
+    std::vector<std::pair<double, std::string> > sorted;
+    std::map<std::string, Stats>::const_iterator iter = command_stats_.begin(),
+        end = command_stats_.end();
+    for (; iter != end; ++iter)
+      sorted.push_back(std::pair<double, std::string>(-iter->second.seconds,
+                                                      iter->first));
+    std::sort(sorted.begin(), sorted.end());
+    os << std::left << std::setw(24) << "command-type" << std::right
+       << std::setw(10) << "count" << std::setw(11) << "seconds"
+       << std::setw(8) << "%time" << std::setw(10) << "GFLOP"
+       << std::setw(9) << "GFLOP/s" << std::setw(10) << "GB"
+       << std::setw(8) << "GB/s" << "\n";
+    for (size_t i = 0; i < sorted.size(); i++) {
+      const Stats &stats = command_stats_.find(sorted[i].second)->second;
+      os << std::left << std::setw(24) << sorted[i].second << std::right;
+      PrintStatsColumns(stats.count, stats.seconds, stats.flops, stats.bytes,
+                        total_seconds, os);
+      os << "\n";
+    }
+  }
+  if (!node_stats_.empty()) {  // per component node.
+    size_t name_width = 6, component_width = 11, type_width = 5;
+    std::vector<std::pair<double, std::string> > sorted;
+    std::map<std::string, ComponentNodeStats>::const_iterator
+        iter = node_stats_.begin(), end = node_stats_.end();
+    for (; iter != end; ++iter) {
+      sorted.push_back(std::pair<double, std::string>(
+          -(iter->second.propagate.seconds + iter->second.backprop.seconds),
+          iter->first));
+      name_width = std::max(name_width, iter->first.size() + 2);
+      component_width = std::max(component_width,
+                                 iter->second.component.size() + 2);
+      type_width = std::max(type_width, iter->second.type.size() + 2);
+    }
+    std::sort(sorted.begin(), sorted.end());
+    os << "\n" << std::left << std::setw(name_width) << "node"
+       << std::setw(component_width) << "component"
+       << std::setw(type_width) << "type" << std::right
+       << std::setw(11) << "prop-secs" << std::setw(11) << "bprop-secs"
+       << std::setw(10) << "count" << std::setw(11) << "seconds"
+       << std::setw(8) << "%time" << std::setw(10) << "GFLOP"
+       << std::setw(9) << "GFLOP/s" << std::setw(10) << "GB"
+       << std::setw(8) << "GB/s" << "\n";
+    for (size_t i = 0; i < sorted.size(); i++) {
+      const ComponentNodeStats &stats =
+          node_stats_.find(sorted[i].second)->second;
+      Stats sum(stats.propagate);
+      sum.Add(stats.backprop);
+      os << std::left << std::setw(name_width) << sorted[i].second
+         << std::setw(component_width) << stats.component
+         << std::setw(type_width) << stats.type << std::right
+         << std::setw(11) << std::setprecision(4) << stats.propagate.seconds
+         << std::setw(11) << stats.backprop.seconds;
+      PrintStatsColumns(sum.count, sum.seconds, sum.flops, sum.bytes,
+                        total_seconds, os);
+      os << "\n";
+    }
+  }
+  os.flags(flags);
+}
+
+
+// Writes 'str' as a JSON string literal.
+static void WriteJsonString(const std::string &str, std::ostream &os) {
+  os << '"';
+  for (size_t i = 0; i < str.size(); i++) {
+    char c = str[i];
+    if (c == '"' || c == '\\') {
+      os << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", static_cast<int32>(c));
+      os << buf;
+    } else {
+      os << c;
+    }
+  }
+  os << '"';
+}
+
+static void WriteJsonStats(int64 count, double seconds, double flops,
+                           double bytes, std::ostream &os) {
+  os << "{\"count\": " << count << ", \"seconds\": " << seconds
+     << ", \"flops\": " << flops << ", \"bytes\": " << bytes << "}";
+}
+
+void NnetComputeProfiler::WriteJson(std::ostream &os) const {
+  double total_seconds = TotalSeconds();
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::streamsize precision = os.precision(10);
+  os << "{\n  \"num_runs\": " << num_runs_
+     << ",\n  \"total_seconds\": " << total_seconds
+     << ",\n  \"command_types\": {";
+  std::map<std::string, Stats>::const_iterator iter = command_stats_.begin(),
+      end = command_stats_.end();
+  for (; iter != end; ++iter) {
+    os << (iter == command_stats_.begin() ? "\n    " : ",\n    ");
+    WriteJsonString(iter->first, os);
+    os << ": ";
+    const Stats &s = iter->second;
+    WriteJsonStats(s.count, s.seconds, s.flops, s.bytes, os);
+  }
+  os << "\n  },\n  \"nodes\": {";
+  std::map<std::string, ComponentNodeStats>::const_iterator
+      citer = node_stats_.begin(), cend = node_stats_.end();
+  for (; citer != cend; ++citer) {
+    os << (citer == node_stats_.begin() ? "\n    " : ",\n    ");
+    WriteJsonString(citer->first, os);
+    os << ": {\"component\": ";
+    WriteJsonString(citer->second.component, os);
+    os << ", \"type\": ";
+    WriteJsonString(citer->second.type, os);
+    const Stats &p = citer->second.propagate, &b = citer->second.backprop;
+    os << ",\n      \"propagate\": ";
+    WriteJsonStats(p.count, p.seconds, p.flops, p.bytes, os);
+    os << ",\n      \"backprop\": ";
+    WriteJsonStats(b.count, b.seconds, b.flops, b.bytes, os);
+    os << "}";
+  }
+  os << "\n  }\n}\n";
+  os.precision(precision);
+}
+
+
+void NnetComputeProfilerOptions::Check() const {
+  if (format != "table" && format != "json")
+    KALDI_ERR << "Invalid --profile-format '" << format
+              << "', expected 'table' or 'json'.";
+}
+
+
+void NnetComputeProfiler::Write(const NnetComputeProfilerOptions &opts) const {
+  opts.Check();
+  Output ko(opts.output, false);
+  if (opts.format == "table")
+    PrintTable(ko.Stream());
+  else
+    WriteJson(ko.Stream());
+  KALDI_LOG << "Wrote profile of the neural net computation ("
+            << TotalSeconds() << " seconds in total) to "
+            << PrintableWxfilename(opts.output);
+}
+
+
+} // namespace nnet3
+} // namespace kaldi
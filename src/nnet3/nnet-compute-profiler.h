@@ -0,0 +1,177 @@
+// nnet3/nnet-compute-profiler.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_NNET3_NNET_COMPUTE_PROFILER_H_
+#define KALDI_NNET3_NNET_COMPUTE_PROFILER_H_
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "base/kaldi-common.h"
+#include "itf/options-itf.h"
+#include "nnet3/nnet-nnet.h"
+#include "nnet3/nnet-computation.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+
+/// Options that control the writing of the profile accumulated by class
+/// NnetComputeProfiler; binaries that support profiling register these.
+struct NnetComputeProfilerOptions {
+  std::string output;
+  std::string format;
+
+  NnetComputeProfilerOptions(): format("table") { }
+
+  void Register(OptionsItf *opts) {
+    opts->Register("profile-output", &output, "If nonempty, time each command "
+                   "of the neural net computation and, at the end, write a "
+                   "summary of the time, estimated FLOPs and bytes moved per "
+                   "component node and per command type to this location "
+                   "(wxfilename, e.g. '-' for the standard output).  "
+                   "Note: on GPU this synchronizes after every command, so it "
+                   "slows things down.");
+    opts->Register("profile-format", &format, "Format of the profile written "
+                   "to --profile-output: 'table' or 'json'.");
+  }
+
+  /// Dies if the options are invalid.
+  void Check() const;
+
+  /// Returns true if profiling was requested.
+  bool Enabled() const { return !output.empty(); }
+};
+
+
+/**
+   class NnetComputeProfiler accumulates, over any number of runs of any number
+   of computations, the wall-clock time taken by the commands of a neural net
+   computation together with rough estimates of the floating-point operations
+   done and the bytes of memory read and written.  The stats are aggregated
+   per command type (kPropagate, kCopyRows and so on; not per individual
+   command, since the command indexes mean nothing across computations) and,
+   for kPropagate and kBackprop[NoModelUpdate] commands, per component node
+   (keyed by node name).  The node a command belongs to is worked out from the
+   debug info of the computation (see CompilerOptions::output_debug_info); if
+   that is missing and the component is used by more than one node, the stats
+   go under the component name instead.
+
+   To use it, set the 'profiler' member of NnetComputeOptions to point to an
+   object of this type; class NnetComputer then times each command it executes
+   and calls AccumulateCommands() at the end of each call to Run().  When the
+   pointer is NULL (the default) nothing is timed, so the overhead is a single
+   test per command.
+
+   The FLOP counts come from ComponentFlopsPerFrame() times the number of rows
+   processed (twice that for backprop commands that both propagate the
+   derivative and update the model), and for the non-component commands, one
+   operation per element added.  The byte counts assume every element of every
+   matrix involved is read or written once, plus the parameters of updatable
+   components.  They are only meant for judging which parts of a computation
+   are compute-bound or memory-bound and how far they are from the limits of
+   the hardware.
+
+   It is safe to call AccumulateCommands() from multiple threads.
+ */
+class NnetComputeProfiler {
+ public:
+  NnetComputeProfiler(): num_runs_(0) { }
+
+  /// Called by NnetComputer at the end of Run(); 'command_times' contains
+  /// pairs (command-index, elapsed seconds) for each command that was executed
+  /// in 'computation'.
+  void AccumulateCommands(
+      const Nnet &nnet, const NnetComputation &computation,
+      const std::vector<std::pair<int32, double> > &command_times);
+
+  /// Returns the total time of all the commands accumulated so far.
+  double TotalSeconds() const;
+
+  /// Prints the stats as human-readable tables, sorted by decreasing time.
+  void PrintTable(std::ostream &os) const;
+
+  /// Writes the stats as a JSON object.
+  void WriteJson(std::ostream &os) const;
+
+  /// Writes the stats to opts.output in the format given by opts.format
+  /// (which must be "table" or "json").
+  void Write(const NnetComputeProfilerOptions &opts) const;
+
+  struct Stats {
+    int64 count;
+    double seconds;
+    double flops;
+    double bytes;
+    Stats(): count(0), seconds(0.0), flops(0.0), bytes(0.0) { }
+    void Add(double seconds, double flops, double bytes);
+    void Add(const Stats &other);
+  };
+
+  /// Returns the number of calls to AccumulateCommands() so far.
+  int64 NumRuns() const;
+
+  /// Returns the stats for command type 'command_type', e.g. "kPropagate"
+  /// (all zero if there were no such commands).
+  Stats CommandTypeStats(const std::string &command_type) const;
+
+  /// Returns the stats for the kPropagate commands (if 'backprop' is false) or
+  /// the kBackprop[NoModelUpdate] commands (if true) of the component node
+  /// named 'node_name'.
+  Stats NodeStats(const std::string &node_name, bool backprop) const;
+
+ private:
+  struct ComponentNodeStats {
+    std::string component;  // the name of the component.
+    std::string type;  // the type of the component.
+    Stats propagate;
+    Stats backprop;  // includes kBackpropNoModelUpdate.
+  };
+
+  // Returns the name of the component node that the kPropagate or
+  // kBackprop[NoModelUpdate] command computation.commands[command_index] is
+  // for.  'component_to_node' maps each component index to the only
+  // component node that uses it, or -1 if there is not exactly one.
+  static std::string CommandNodeName(
+      const Nnet &nnet, const NnetComputation &computation,
+      const std::vector<int32> &component_to_node, int32 command_index);
+
+  // Sets 'flops' and 'bytes' to our estimates of the cost of command
+  // computation.commands[command_index].
+  static void EstimateCost(const Nnet &nnet,
+                           const NnetComputation &computation,
+                           int32 command_index,
+                           double *flops, double *bytes);
+
+  // Stats per command type, indexed by the string form of the CommandType,
+  // e.g. "kPropagate".
+  std::map<std::string, Stats> command_stats_;
+  // Stats per component node, indexed by the node name.
+  std::map<std::string, ComponentNodeStats> node_stats_;
+  // The number of calls to AccumulateCommands(), i.e. to NnetComputer::Run().
+  int64 num_runs_;
+  // Guards all the members above.
+  mutable std::mutex mutex_;
+};
+
+
+} // namespace nnet3
+} // namespace kaldi
+
+#endif  // KALDI_NNET3_NNET_COMPUTE_PROFILER_H_
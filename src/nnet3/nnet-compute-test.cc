@@ -25,6 +25,7 @@
 #include "nnet3/nnet-utils.h"
 #include "nnet3/nnet-optimize.h"
 #include "nnet3/nnet-compute.h"
+#include "nnet3/nnet-compute-profiler.h"
 #include "nnet3/nnet-am-decodable-simple.h"
 #include "nnet3/decodable-simple-looped.h"
 
@@ -218,6 +219,9 @@ void UnitTestNnetCompute() {
     NnetComputeOptions compute_opts;
     if (RandInt(0, 1) == 0)
       compute_opts.debug = true;
+    NnetComputeProfiler profiler;
+    if (RandInt(0, 1) == 0)
+      compute_opts.profiler = &profiler;
 
     computation.ComputeCudaIndexes();
     NnetComputer computer(compute_opts,
@@ -272,10 +276,109 @@ void UnitTestNnetCompute() {
         }
       }
     }
+    if (compute_opts.profiler != NULL) {
+      std::ostringstream table_os, json_os;
+      profiler.PrintTable(table_os);
+      profiler.WriteJson(json_os);
+      KALDI_LOG << "Profile is: " << table_os.str() << json_os.str();
+      // some of the generated nnets have no component nodes, so this can't
+      // check for kPropagate; UnitTestNnetComputeProfiler() checks the counts.
+      KALDI_ASSERT(profiler.NumRuns() >= 1 &&
+                   json_os.str().find("\"command_types\"") !=
+                   std::string::npos);
+    }
     TestNnetDecodable(&nnet);
   }
 }
 
+// Runs a small fixed TDNN with a component shared by two nodes forward and
+// backward with the profiler enabled, and checks the counts it accumulated
+// against the commands of the computation.
+void UnitTestNnetComputeProfiler() {
+  std::string config =
+      "input-node name=input dim=10\n"
+      "component name=affine1 type=AffineComponent input-dim=30 "
+      "output-dim=20\n"
+      "component-node name=affine1 component=affine1 "
+      "input=Append(Offset(input, -1), input, Offset(input, 1))\n"
+      "component name=relu1 type=RectifiedLinearComponent dim=20\n"
+      "component-node name=relu1 component=relu1 input=affine1\n"
+      "component name=affine2 type=AffineComponent input-dim=20 "
+      "output-dim=5\n"
+      "component-node name=affine2a component=affine2 input=relu1\n"
+      "component-node name=affine2b component=affine2 "
+      "input=Offset(relu1, 1)\n"
+      "output-node name=output input=Sum(affine2a, affine2b)\n";
+  Nnet nnet;
+  {
+    std::istringstream is(config);
+    nnet.ReadConfig(is);
+  }
+  int32 num_frames = RandInt(1, 10);
+  ComputationRequest request;
+  request.inputs.push_back(IoSpecification("input", -1, num_frames + 2));
+  request.outputs.push_back(IoSpecification("output", 0, num_frames));
+  request.outputs[0].has_deriv = true;
+  request.need_model_derivative = true;
+
+  NnetComputation computation;
+  Compiler compiler(request, nnet);
+  CompilerOptions opts;
+  compiler.CreateComputation(opts, &computation);
+  computation.ComputeCudaIndexes();
+
+  NnetComputeProfiler profiler;
+  NnetComputeOptions compute_opts;
+  compute_opts.profiler = &profiler;
+  Nnet nnet_to_update(nnet);
+  NnetComputer computer(compute_opts, computation, nnet, &nnet_to_update);
+  CuMatrix<BaseFloat> input(num_frames + 3, 10);
+  input.SetRandn();
+  computer.AcceptInput("input", &input);
+  computer.Run();
+  CuMatrix<BaseFloat> output_deriv(num_frames, 5);
+  output_deriv.SetRandn();
+  computer.AcceptInput("output", &output_deriv);
+  computer.Run();
+
+  // there are no loops, so each command apart from the input and output ones
+  // is run exactly once.
+  std::map<CommandType, int64> num_commands;
+  for (size_t i = 0; i < computation.commands.size(); i++)
+    num_commands[computation.commands[i].command_type]++;
+  KALDI_ASSERT(profiler.NumRuns() == 2);
+  KALDI_ASSERT(profiler.CommandTypeStats("kAcceptInput").count == 0 &&
+               profiler.CommandTypeStats("kProvideOutput").count == 0);
+  KALDI_ASSERT(profiler.CommandTypeStats("kPropagate").count ==
+               num_commands[kPropagate] && num_commands[kPropagate] == 4);
+  KALDI_ASSERT(profiler.CommandTypeStats("kBackprop").count +
+               profiler.CommandTypeStats("kBackpropNoModelUpdate").count ==
+               num_commands[kBackprop] + num_commands[kBackpropNoModelUpdate]);
+  KALDI_ASSERT(profiler.CommandTypeStats("kAllocMatrix").count ==
+               num_commands[kAllocMatrix]);
+
+  // each node is propagated and backpropagated once, and the nodes sharing
+  // 'affine2' are told apart.
+  const char *nodes[] = { "affine1", "relu1", "affine2a", "affine2b" };
+  double node_seconds = 0.0;
+  for (int32 i = 0; i < 4; i++) {
+    NnetComputeProfiler::Stats propagate = profiler.NodeStats(nodes[i], false),
+        backprop = profiler.NodeStats(nodes[i], true);
+    KALDI_ASSERT(propagate.count == 1 && propagate.seconds >= 0.0);
+    // we don't need the input derivative, so affine1 only updates the model.
+    KALDI_ASSERT(backprop.count == 1);
+    node_seconds += propagate.seconds + backprop.seconds;
+  }
+  KALDI_ASSERT(profiler.NodeStats("affine2", false).count == 0);
+  // affine1 is needed for t = 0 ... num_frames, and does 2 flops per
+  // parameter per frame.
+  KALDI_ASSERT(ApproxEqual(profiler.NodeStats("affine1", false).flops,
+                           2.0 * (30 * 20 + 20) * (num_frames + 1)));
+  KALDI_ASSERT(profiler.NodeStats("affine2b", false).flops ==
+               profiler.NodeStats("affine2a", false).flops);
+  KALDI_ASSERT(node_seconds <= profiler.TotalSeconds() * 1.0001 + 1.0e-09);
+}
+
 } // namespace nnet3
 } // namespace kaldi
 
@@ -296,6 +399,7 @@ int main() {
       CuDevice::Instantiate().SelectGpuId("yes");
 #endif
     UnitTestNnetCompute();
+    UnitTestNnetComputeProfiler();
   }
 
   KALDI_LOG << "Nnet tests succeeded.";
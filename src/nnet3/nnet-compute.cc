@@ -20,6 +20,7 @@
 #include <iterator>
 #include <sstream>
 #include "nnet3/nnet-compute.h"
+#include "nnet3/nnet-compute-profiler.h"
 
 namespace kaldi {
 namespace nnet3 {
@@ -522,6 +523,9 @@ void NnetComputer::Run() {
   CheckNoPendingIo();
 
   CommandDebugInfo info;
+  NnetComputeProfiler *profiler = options_.profiler;
+  // (command-index, elapsed time) for each command; only used if profiling.
+  std::vector<std::pair<int32, double> > command_times;
   Timer timer;
   double total_elapsed_previous = 0.0;
 
@@ -535,13 +539,29 @@ void NnetComputer::Run() {
     if (debug_)
       DebugBeforeExecute(program_counter_, &info);
     ExecuteCommand();
-    if (debug_) {
+    if (profiler != NULL) {
+#if HAVE_CUDA == 1
+      // wait for the kernels to finish, so the time is attributed to the
+      // command that launched them.
+      if (CuDevice::Instantiate().Enabled())
+        CU_SAFE_CALL(cudaStreamSynchronize(cudaStreamPerThread));
+#endif
+      double total_elapsed_now = timer.Elapsed();
+      command_times.push_back(std::pair<int32, double>(
+          program_counter_, total_elapsed_now - total_elapsed_previous));
+      if (debug_)
+        DebugAfterExecute(program_counter_, info,
+                          total_elapsed_now - total_elapsed_previous);
+      total_elapsed_previous = timer.Elapsed();
+    } else if (debug_) {
       double total_elapsed_now = timer.Elapsed();
       DebugAfterExecute(program_counter_, info,
                         total_elapsed_now - total_elapsed_previous);
       total_elapsed_previous = total_elapsed_now;
     }
   }
+  if (profiler != NULL)
+    profiler->AccumulateCommands(nnet_, computation_, command_times);
 }
 
 void NnetComputer::AcceptInput(const std::string &node_name,
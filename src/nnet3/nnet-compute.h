@@ -36,9 +36,15 @@ namespace kaldi {
 namespace nnet3 {
 
 
+class NnetComputeProfiler;
+
 struct NnetComputeOptions {
   bool debug;
-  NnetComputeOptions(): debug(false) { }
+  // If non-NULL, the time taken by each command will be accumulated in this
+  // object (see nnet-compute-profiler.h).  It is not registered as an option;
+  // binaries that support profiling set it from NnetComputeProfilerOptions.
+  NnetComputeProfiler *profiler;
+  NnetComputeOptions(): debug(false), profiler(NULL) { }
   void Register(OptionsItf *opts) {
     opts->Register("debug", &debug, "If true, turn on "
                    "debug for the neural net computation (very verbose!) "
@@ -301,6 +301,10 @@ class TimeHeightConvolutionComponent: public UpdatableComponent {
 
   void ScaleLinearParams(BaseFloat alpha) { linear_params_.Scale(alpha); }
 
+  const time_height_convolution::ConvolutionModel &Model() const {
+    return model_;
+  }
+
   void ConsolidateMemory();
  private:
 
@@ -552,10 +556,14 @@ class TdnnComponent: public UpdatableComponent {
   };
 
   CuMatrixBase<BaseFloat> &LinearParams() { return linear_params_; }
+  const CuMatrixBase<BaseFloat> &LinearParams() const { return linear_params_; }
 
   // This allows you to resize the vector in order to add a bias where
   // there previously was none-- obviously this should be done carefully.
   CuVector<BaseFloat> &BiasParams() { return bias_params_; }
+  const CuVector<BaseFloat> &BiasParams() const { return bias_params_; }
+
+  const std::vector<int32> &TimeOffsets() const { return time_offsets_; }
 
   BaseFloat OrthonormalConstraint() const { return orthonormal_constraint_; }
 
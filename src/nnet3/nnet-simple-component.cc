@@ -3445,6 +3445,671 @@ void FixedAffineComponent::Read(std::istream &is, bool binary) {
   ExpectToken(is, binary, "</FixedAffineComponent>");
 }
 
+void QuantizedAffineComponent::Init(
+    const CuMatrixBase<BaseFloat> &linear_params,
+    const CuVectorBase<BaseFloat> &bias_params) {
+  KALDI_ASSERT(linear_params.NumRows() > 0 && linear_params.NumCols() > 0 &&
+               (bias_params.Dim() == 0 ||
+                bias_params.Dim() == linear_params.NumRows()));
+  input_dim_ = linear_params.NumCols();
+  Matrix<BaseFloat> params(linear_params);
+  quantization::QuantizeWeights(params, &params_, &scales_, &row_sums_);
+  bias_params_.Resize(linear_params.NumRows());
+  if (bias_params.Dim() != 0)
+    bias_params_.CopyFromVec(bias_params);
+}
+
+void QuantizedAffineComponent::InitFromConfig(ConfigLine *cfl) {
+  int32 input_dim = -1, output_dim = -1;
+  if (!cfl->GetValue("input-dim", &input_dim) ||
+      !cfl->GetValue("output-dim", &output_dim) || cfl->HasUnusedValues() ||
+      input_dim <= 0 || output_dim <= 0)
+    KALDI_ERR << "Invalid initializer for layer of type "
+              << Type() << ": \"" << cfl->WholeLine() << "\"";
+  CuMatrix<BaseFloat> linear_params(output_dim, input_dim);
+  CuVector<BaseFloat> bias_params(output_dim);
+  linear_params.SetRandn();
+  linear_params.Scale(1.0 / sqrt(input_dim));
+  bias_params.SetRandn();
+  Init(linear_params, bias_params);
+}
+
+void QuantizedAffineComponent::ComputeRowSums() {
+  int32 output_dim = OutputDim(),
+      stride = quantization::QuantizedStride(input_dim_);
+  KALDI_ASSERT(params_.size() == static_cast<size_t>(output_dim) * stride);
+  row_sums_.resize(output_dim);
+  for (int32 i = 0; i < output_dim; i++) {
+    const int8 *row = &(params_[static_cast<size_t>(i) * stride]);
+    int32 sum = 0;
+    for (int32 j = 0; j < input_dim_; j++)
+      sum += row[j];
+    row_sums_[i] = sum;
+  }
+}
+
+void QuantizedAffineComponent::GetLinearParams(
+    MatrixBase<BaseFloat> *params) const {
+  int32 output_dim = OutputDim(),
+      stride = quantization::QuantizedStride(input_dim_);
+  KALDI_ASSERT(params->NumRows() == output_dim &&
+               params->NumCols() == input_dim_);
+  for (int32 i = 0; i < output_dim; i++) {
+    const int8 *row = &(params_[static_cast<size_t>(i) * stride]);
+    BaseFloat *params_row = params->RowData(i), scale = scales_(i);
+    for (int32 j = 0; j < input_dim_; j++)
+      params_row[j] = scale * row[j];
+  }
+}
+
+std::string QuantizedAffineComponent::Info() const {
+  std::ostringstream stream;
+  stream << Component::Info();
+  PrintParameterStats(stream, "scales", CuVector<BaseFloat>(scales_), true);
+  PrintParameterStats(stream, "bias", bias_params_, true);
+  return stream.str();
+}
+
+void* QuantizedAffineComponent::Propagate(
+    const ComponentPrecomputedIndexes *indexes,
+    const CuMatrixBase<BaseFloat> &in,
+    CuMatrixBase<BaseFloat> *out) const {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    // The int8 kernels are CPU-only; on GPU we just use floating point.
+    Matrix<BaseFloat> params(OutputDim(), input_dim_, kUndefined);
+    GetLinearParams(&params);
+    CuMatrix<BaseFloat> cu_params;
+    cu_params.Swap(&params);
+    out->AddMatMat(1.0, in, kNoTrans, cu_params, kTrans, 0.0);
+    out->AddVecToRows(1.0, bias_params_);
+    return NULL;
+  }
+#endif
+  int32 num_rows = in.NumRows(), output_dim = OutputDim(),
+      stride = quantization::QuantizedStride(input_dim_);
+  std::vector<uint8> quantized_in(static_cast<size_t>(num_rows) * stride);
+  std::vector<BaseFloat> in_scales(num_rows);
+  std::vector<int32> zero_points(num_rows),
+      products(static_cast<size_t>(num_rows) * output_dim);
+  quantization::QuantizeInput(in.Mat(), stride, &(quantized_in[0]),
+                              &(in_scales[0]), &(zero_points[0]));
+  quantization::QuantizedMatMul(quantization::BestKernelType(),
+                                &(quantized_in[0]), num_rows,
+                                &(params_[0]), output_dim, stride,
+                                &(products[0]));
+  MatrixBase<BaseFloat> &out_mat = out->Mat();
+  const BaseFloat *scales = scales_.Data();
+  for (int32 i = 0; i < num_rows; i++) {
+    const int32 *products_row = &(products[static_cast<size_t>(i) * output_dim]);
+    BaseFloat *out_row = out_mat.RowData(i), in_scale = in_scales[i];
+    int32 zero_point = zero_points[i];
+    for (int32 j = 0; j < output_dim; j++)
+      out_row[j] = in_scale * scales[j] *
+          (products_row[j] - zero_point * row_sums_[j]);
+  }
+  out->AddVecToRows(1.0, bias_params_);
+  return NULL;
+}
+
+void QuantizedAffineComponent::Backprop(
+    const std::string &debug_info,
+    const ComponentPrecomputedIndexes *indexes,
+    const CuMatrixBase<BaseFloat> &, // in_value
+    const CuMatrixBase<BaseFloat> &, // out_value
+    const CuMatrixBase<BaseFloat> &, // out_deriv
+    void *memo,
+    Component *, // to_update
+    CuMatrixBase<BaseFloat> *) const {
+  KALDI_ERR << "QuantizedAffineComponent is for inference only and does not "
+            << "support backprop [component " << debug_info << "]";
+}
+
+Component* QuantizedAffineComponent::Copy() const {
+  QuantizedAffineComponent *ans = new QuantizedAffineComponent();
+  ans->input_dim_ = input_dim_;
+  ans->params_ = params_;
+  ans->scales_ = scales_;
+  ans->row_sums_ = row_sums_;
+  ans->bias_params_ = bias_params_;
+  return ans;
+}
+
+void QuantizedAffineComponent::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<QuantizedAffineComponent>");
+  WriteToken(os, binary, "<InputDim>");
+  WriteBasicType(os, binary, input_dim_);
+  WriteToken(os, binary, "<Params>");
+  WriteIntegerVector(os, binary, params_);
+  WriteToken(os, binary, "<Scales>");
+  scales_.Write(os, binary);
+  WriteToken(os, binary, "<BiasParams>");
+  bias_params_.Write(os, binary);
+  WriteToken(os, binary, "</QuantizedAffineComponent>");
+}
+
+void QuantizedAffineComponent::Read(std::istream &is, bool binary) {
+  ExpectOneOrTwoTokens(is, binary, "<QuantizedAffineComponent>", "<InputDim>");
+  ReadBasicType(is, binary, &input_dim_);
+  ExpectToken(is, binary, "<Params>");
+  ReadIntegerVector(is, binary, &params_);
+  ExpectToken(is, binary, "<Scales>");
+  scales_.Read(is, binary);
+  ExpectToken(is, binary, "<BiasParams>");
+  bias_params_.Read(is, binary);
+  ExpectToken(is, binary, "</QuantizedAffineComponent>");
+  KALDI_ASSERT(bias_params_.Dim() == scales_.Dim());
+  ComputeRowSums();
+}
+
+void HalfPrecisionAffineComponent::Init(
+    quantization::HalfPrecisionType type,
+    const CuMatrixBase<BaseFloat> &linear_params,
+    const CuVectorBase<BaseFloat> &bias_params) {
+  KALDI_ASSERT(linear_params.NumRows() > 0 && linear_params.NumCols() > 0 &&
+               (bias_params.Dim() == 0 ||
+                bias_params.Dim() == linear_params.NumRows()));
+  type_ = type;
+  input_dim_ = linear_params.NumCols();
+  int32 output_dim = linear_params.NumRows();
+  Matrix<BaseFloat> params(linear_params);
+  params_.resize(static_cast<size_t>(output_dim) * input_dim_);
+  for (int32 i = 0; i < output_dim; i++)
+    quantization::ConvertToHalfPrecision(
+        type_, params.RowData(i), input_dim_,
+        &(params_[static_cast<size_t>(i) * input_dim_]));
+  bias_params_.Resize(output_dim);
+  if (bias_params.Dim() != 0)
+    bias_params_.CopyFromVec(bias_params);
+}
+
+void HalfPrecisionAffineComponent::InitFromConfig(ConfigLine *cfl) {
+  int32 input_dim = -1, output_dim = -1;
+  std::string type = "fp16";
+  cfl->GetValue("half-precision-type", &type);
+  if (!cfl->GetValue("input-dim", &input_dim) ||
+      !cfl->GetValue("output-dim", &output_dim) || cfl->HasUnusedValues() ||
+      input_dim <= 0 || output_dim <= 0)
+    KALDI_ERR << "Invalid initializer for layer of type "
+              << Type() << ": \"" << cfl->WholeLine() << "\"";
+  CuMatrix<BaseFloat> linear_params(output_dim, input_dim);
+  CuVector<BaseFloat> bias_params(output_dim);
+  linear_params.SetRandn();
+  linear_params.Scale(1.0 / sqrt(input_dim));
+  bias_params.SetRandn();
+  Init(quantization::HalfPrecisionTypeFromString(type), linear_params,
+       bias_params);
+}
+
+void HalfPrecisionAffineComponent::GetLinearParams(
+    MatrixBase<BaseFloat> *params) const {
+  int32 output_dim = OutputDim();
+  KALDI_ASSERT(params->NumRows() == output_dim &&
+               params->NumCols() == input_dim_);
+  for (int32 i = 0; i < output_dim; i++)
+    quantization::ConvertFromHalfPrecision(
+        type_, &(params_[static_cast<size_t>(i) * input_dim_]), input_dim_,
+        params->RowData(i));
+}
+
+std::string HalfPrecisionAffineComponent::Info() const {
+  std::ostringstream stream;
+  stream << Component::Info() << ", half-precision-type="
+         << quantization::HalfPrecisionTypeToString(type_);
+  Matrix<BaseFloat> params(OutputDim(), input_dim_, kUndefined);
+  GetLinearParams(&params);
+  PrintParameterStats(stream, "linear-params", CuMatrix<BaseFloat>(params));
+  PrintParameterStats(stream, "bias", bias_params_, true);
+  return stream.str();
+}
+
+void* HalfPrecisionAffineComponent::Propagate(
+    const ComponentPrecomputedIndexes *indexes,
+    const CuMatrixBase<BaseFloat> &in,
+    CuMatrixBase<BaseFloat> *out) const {
+  int32 output_dim = OutputDim();
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    Matrix<BaseFloat> params(output_dim, input_dim_, kUndefined);
+    GetLinearParams(&params);
+    CuMatrix<BaseFloat> cu_params;
+    cu_params.Swap(&params);
+    out->AddMatMat(1.0, in, kNoTrans, cu_params, kTrans, 0.0);
+    out->AddVecToRows(1.0, bias_params_);
+    return NULL;
+  }
+#endif
+  // Convert about 64k parameters (256KB) at a time, so the converted block
+  // stays in cache while it is used.
+  int32 block_rows = std::max<int32>(1, std::min<int32>(
+      output_dim, (1 << 16) / input_dim_));
+  Matrix<BaseFloat> block(block_rows, input_dim_, kUndefined);
+  MatrixBase<BaseFloat> &out_mat = out->Mat();
+  for (int32 row = 0; row < output_dim; row += block_rows) {
+    int32 this_block_rows = std::min(block_rows, output_dim - row);
+    SubMatrix<BaseFloat> this_block(block, 0, this_block_rows,
+                                    0, input_dim_);
+    for (int32 i = 0; i < this_block_rows; i++)
+      quantization::ConvertFromHalfPrecision(
+          type_, &(params_[static_cast<size_t>(row + i) * input_dim_]),
+          input_dim_, this_block.RowData(i));
+    SubMatrix<BaseFloat> this_out(out_mat, 0, out_mat.NumRows(),
+                                  row, this_block_rows);
+    this_out.AddMatMat(1.0, in.Mat(), kNoTrans, this_block, kTrans, 0.0);
+  }
+  out->AddVecToRows(1.0, bias_params_);
+  return NULL;
+}
+
+void HalfPrecisionAffineComponent::Backprop(
+    const std::string &debug_info,
+    const ComponentPrecomputedIndexes *indexes,
+    const CuMatrixBase<BaseFloat> &, // in_value
+    const CuMatrixBase<BaseFloat> &, // out_value
+    const CuMatrixBase<BaseFloat> &, // out_deriv
+    void *memo,
+    Component *, // to_update
+    CuMatrixBase<BaseFloat> *) const {
+  KALDI_ERR << "HalfPrecisionAffineComponent is for inference only and does "
+            << "not support backprop [component " << debug_info << "]";
+}
+
+Component* HalfPrecisionAffineComponent::Copy() const {
+  HalfPrecisionAffineComponent *ans = new HalfPrecisionAffineComponent();
+  ans->type_ = type_;
+  ans->input_dim_ = input_dim_;
+  ans->params_ = params_;
+  ans->bias_params_ = bias_params_;
+  return ans;
+}
+
+void HalfPrecisionAffineComponent::Write(std::ostream &os,
+                                         bool binary) const {
+  WriteToken(os, binary, "<HalfPrecisionAffineComponent>");
+  WriteToken(os, binary, "<HalfPrecisionType>");
+  WriteToken(os, binary, quantization::HalfPrecisionTypeToString(type_));
+  WriteToken(os, binary, "<InputDim>");
+  WriteBasicType(os, binary, input_dim_);
+  WriteToken(os, binary, "<Params>");
+  WriteIntegerVector(os, binary, params_);
+  WriteToken(os, binary, "<BiasParams>");
+  bias_params_.Write(os, binary);
+  WriteToken(os, binary, "</HalfPrecisionAffineComponent>");
+}
+
+void HalfPrecisionAffineComponent::Read(std::istream &is, bool binary) {
+  ExpectOneOrTwoTokens(is, binary, "<HalfPrecisionAffineComponent>",
+                       "<HalfPrecisionType>");
+  std::string type;
+  ReadToken(is, binary, &type);
+  type_ = quantization::HalfPrecisionTypeFromString(type);
+  ExpectToken(is, binary, "<InputDim>");
+  ReadBasicType(is, binary, &input_dim_);
+  ExpectToken(is, binary, "<Params>");
+  ReadIntegerVector(is, binary, &params_);
+  ExpectToken(is, binary, "<BiasParams>");
+  bias_params_.Read(is, binary);
+  ExpectToken(is, binary, "</HalfPrecisionAffineComponent>");
+  KALDI_ASSERT(params_.size() ==
+               static_cast<size_t>(bias_params_.Dim()) * input_dim_);
+}
+
+void MappedAffineComponent::Init(
+    const CuMatrixBase<BaseFloat> &linear_params,
+    const CuVectorBase<BaseFloat> &bias_params) {
+  KALDI_ASSERT(linear_params.NumRows() > 0 && linear_params.NumCols() > 0 &&
+               (bias_params.Dim() == 0 ||
+                bias_params.Dim() == linear_params.NumRows()));
+  input_dim_ = linear_params.NumCols();
+  linear_params_ = linear_params;
+  mapped_file_.reset();
+  mapped_params_ = NULL;
+  mapped_stride_ = 0;
+  mapped_offset_ = -1;
+  bias_params_.Resize(linear_params.NumRows());
+  if (bias_params.Dim() != 0)
+    bias_params_.CopyFromVec(bias_params);
+}
+
+void MappedAffineComponent::InitFromConfig(ConfigLine *cfl) {
+  int32 input_dim = -1, output_dim = -1;
+  if (!cfl->GetValue("input-dim", &input_dim) ||
+      !cfl->GetValue("output-dim", &output_dim) || cfl->HasUnusedValues() ||
+      input_dim <= 0 || output_dim <= 0)
+    KALDI_ERR << "Invalid initializer for layer of type "
+              << Type() << ": \"" << cfl->WholeLine() << "\"";
+  CuMatrix<BaseFloat> linear_params(output_dim, input_dim);
+  CuVector<BaseFloat> bias_params(output_dim);
+  linear_params.SetRandn();
+  linear_params.Scale(1.0 / sqrt(input_dim));
+  bias_params.SetRandn();
+  Init(linear_params, bias_params);
+}
+
+const SubMatrix<BaseFloat> MappedAffineComponent::MappedParams() const {
+  KALDI_ASSERT(mapped_params_ != NULL);
+  return SubMatrix<BaseFloat>(const_cast<BaseFloat*>(mapped_params_),
+                              OutputDim(), input_dim_, mapped_stride_);
+}
+
+void MappedAffineComponent::GetLinearParams(
+    MatrixBase<BaseFloat> *params) const {
+  if (NeedsMappedData())
+    KALDI_ERR << "MappedAffineComponent was read without its parameters; "
+              << "read mapped models with ReadAmNnetMaybeMapped().";
+  if (IsMapped())
+    params->CopyFromMat(MappedParams());
+  else
+    linear_params_.CopyToMat(params);
+}
+
+std::string MappedAffineComponent::Info() const {
+  std::ostringstream stream;
+  stream << Component::Info() << ", mapped=" << std::boolalpha << IsMapped();
+  Matrix<BaseFloat> params(OutputDim(), input_dim_, kUndefined);
+  GetLinearParams(&params);
+  PrintParameterStats(stream, "linear-params", CuMatrix<BaseFloat>(params));
+  PrintParameterStats(stream, "bias", bias_params_, true);
+  return stream.str();
+}
+
+void* MappedAffineComponent::Propagate(
+    const ComponentPrecomputedIndexes *indexes,
+    const CuMatrixBase<BaseFloat> &in,
+    CuMatrixBase<BaseFloat> *out) const {
+  if (NeedsMappedData())
+    KALDI_ERR << "MappedAffineComponent was read without its parameters; "
+              << "read mapped models with ReadAmNnetMaybeMapped().";
+  if (!IsMapped()) {
+    out->AddMatMat(1.0, in, kNoTrans, linear_params_, kTrans, 0.0);
+  } else {
+#if HAVE_CUDA == 1
+    if (CuDevice::Instantiate().Enabled()) {
+      CuMatrix<BaseFloat> cu_params(MappedParams());
+      out->AddMatMat(1.0, in, kNoTrans, cu_params, kTrans, 0.0);
+      out->AddVecToRows(1.0, bias_params_);
+      return NULL;
+    }
+#endif
+    out->Mat().AddMatMat(1.0, in.Mat(), kNoTrans, MappedParams(), kTrans,
+                         0.0);
+  }
+  out->AddVecToRows(1.0, bias_params_);
+  return NULL;
+}
+
+void MappedAffineComponent::Backprop(
+    const std::string &debug_info,
+    const ComponentPrecomputedIndexes *indexes,
+    const CuMatrixBase<BaseFloat> &, // in_value
+    const CuMatrixBase<BaseFloat> &, // out_value
+    const CuMatrixBase<BaseFloat> &, // out_deriv
+    void *memo,
+    Component *, // to_update
+    CuMatrixBase<BaseFloat> *) const {
+  KALDI_ERR << "MappedAffineComponent is for inference only and does "
+            << "not support backprop [component " << debug_info << "]";
+}
+
+Component* MappedAffineComponent::Copy() const {
+  MappedAffineComponent *ans = new MappedAffineComponent();
+  ans->input_dim_ = input_dim_;
+  ans->linear_params_ = linear_params_;
+  ans->mapped_file_ = mapped_file_;
+  ans->mapped_params_ = mapped_params_;
+  ans->mapped_stride_ = mapped_stride_;
+  ans->mapped_offset_ = mapped_offset_;
+  ans->bias_params_ = bias_params_;
+  return ans;
+}
+
+void MappedAffineComponent::SetMappedOffset(int64 offset, int32 stride) {
+  KALDI_ASSERT(offset >= 0 && stride >= input_dim_);
+  mapped_offset_ = offset;
+  mapped_stride_ = stride;
+}
+
+void MappedAffineComponent::SetMappedData(
+    const std::shared_ptr<const MappedFile> &file,
+    const char *data_begin, size_t data_size) {
+  KALDI_ASSERT(NeedsMappedData());
+  size_t end = static_cast<size_t>(mapped_offset_) + sizeof(BaseFloat) *
+      (static_cast<size_t>(OutputDim() - 1) * mapped_stride_ + input_dim_);
+  if (end > data_size || mapped_offset_ % sizeof(BaseFloat) != 0)
+    KALDI_ERR << "Parameters of MappedAffineComponent are outside the mapped "
+              << "data (offset " << mapped_offset_ << ", data size "
+              << data_size << "): corrupted or truncated model file?";
+  mapped_file_ = file;
+  mapped_params_ = reinterpret_cast<const BaseFloat*>(data_begin +
+                                                       mapped_offset_);
+  mapped_offset_ = -1;
+  linear_params_.Resize(0, 0);
+}
+
+void MappedAffineComponent::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<MappedAffineComponent>");
+  WriteToken(os, binary, "<InputDim>");
+  WriteBasicType(os, binary, input_dim_);
+  if (mapped_offset_ >= 0) {
+    WriteToken(os, binary, "<MappedOffset>");
+    WriteBasicType(os, binary, mapped_offset_);
+    WriteToken(os, binary, "<MappedStride>");
+    WriteBasicType(os, binary, mapped_stride_);
+  } else {
+    WriteToken(os, binary, "<LinearParams>");
+    if (IsMapped())
+      MappedParams().Write(os, binary);
+    else
+      linear_params_.Write(os, binary);
+  }
+  WriteToken(os, binary, "<BiasParams>");
+  bias_params_.Write(os, binary);
+  WriteToken(os, binary, "</MappedAffineComponent>");
+}
+
+void MappedAffineComponent::Read(std::istream &is, bool binary) {
+  ExpectOneOrTwoTokens(is, binary, "<MappedAffineComponent>", "<InputDim>");
+  ReadBasicType(is, binary, &input_dim_);
+  mapped_file_.reset();
+  mapped_params_ = NULL;
+  std::string tok;
+  ReadToken(is, binary, &tok);
+  if (tok == "<MappedOffset>") {
+    ReadBasicType(is, binary, &mapped_offset_);
+    ExpectToken(is, binary, "<MappedStride>");
+    ReadBasicType(is, binary, &mapped_stride_);
+    linear_params_.Resize(0, 0);
+  } else if (tok == "<LinearParams>") {
+    linear_params_.Read(is, binary);
+    mapped_offset_ = -1;
+    mapped_stride_ = 0;
+  } else {
+    KALDI_ERR << "Expected <MappedOffset> or <LinearParams>, got " << tok;
+  }
+  ExpectToken(is, binary, "<BiasParams>");
+  bias_params_.Read(is, binary);
+  ExpectToken(is, binary, "</MappedAffineComponent>");
+  KALDI_ASSERT(mapped_offset_ >= 0 ? mapped_stride_ >= input_dim_ :
+               linear_params_.NumRows() == bias_params_.Dim() &&
+               linear_params_.NumCols() == input_dim_);
+}
+
+void SparseAffineComponent::Init(
+    const CuMatrixBase<BaseFloat> &linear_params,
+    const CuVectorBase<BaseFloat> &bias_params,
+    BaseFloat threshold) {
+  KALDI_ASSERT(linear_params.NumRows() > 0 && linear_params.NumCols() > 0 &&
+               (bias_params.Dim() == 0 ||
+                bias_params.Dim() == linear_params.NumRows()) &&
+               threshold >= 0.0);
+  input_dim_ = linear_params.NumCols();
+  Matrix<BaseFloat> params(linear_params);
+  sparse_affine::DenseToCsr(params, threshold, &row_offsets_, &col_indexes_,
+                            &values_);
+  bias_params_.Resize(linear_params.NumRows());
+  if (bias_params.Dim() != 0)
+    bias_params_.CopyFromVec(bias_params);
+}
+
+void SparseAffineComponent::InitFromConfig(ConfigLine *cfl) {
+  int32 input_dim = -1, output_dim = -1;
+  BaseFloat sparsity = 0.7;
+  cfl->GetValue("sparsity", &sparsity);
+  if (!cfl->GetValue("input-dim", &input_dim) ||
+      !cfl->GetValue("output-dim", &output_dim) || cfl->HasUnusedValues() ||
+      input_dim <= 0 || output_dim <= 0 || sparsity < 0.0 || sparsity > 1.0)
+    KALDI_ERR << "Invalid initializer for layer of type "
+              << Type() << ": \"" << cfl->WholeLine() << "\"";
+  Matrix<BaseFloat> linear_params(output_dim, input_dim);
+  Vector<BaseFloat> bias_params(output_dim);
+  linear_params.SetRandn();
+  linear_params.Scale(1.0 / sqrt(input_dim * (1.0 - sparsity) + 1.0));
+  for (int32 i = 0; i < output_dim; i++)
+    for (int32 j = 0; j < input_dim; j++)
+      if (RandUniform() < sparsity)
+        linear_params(i, j) = 0.0;
+  bias_params.SetRandn();
+  Init(CuMatrix<BaseFloat>(linear_params), CuVector<BaseFloat>(bias_params));
+}
+
+void SparseAffineComponent::GetLinearParams(
+    MatrixBase<BaseFloat> *params) const {
+  KALDI_ASSERT(params->NumRows() == OutputDim() &&
+               params->NumCols() == input_dim_);
+  sparse_affine::CsrToDense(row_offsets_, col_indexes_, values_, params);
+}
+
+std::string SparseAffineComponent::Info() const {
+  std::ostringstream stream;
+  int64 num_params = static_cast<int64>(OutputDim()) * input_dim_;
+  stream << Component::Info() << ", num-nonzero=" << NumNonzero()
+         << ", sparsity=" << std::setprecision(4)
+         << (num_params == 0 ? 0.0 :
+             1.0 - NumNonzero() / static_cast<double>(num_params));
+  Matrix<BaseFloat> params(OutputDim(), input_dim_, kUndefined);
+  GetLinearParams(&params);
+  PrintParameterStats(stream, "linear-params", CuMatrix<BaseFloat>(params));
+  PrintParameterStats(stream, "bias", bias_params_, true);
+  return stream.str();
+}
+
+void* SparseAffineComponent::Propagate(
+    const ComponentPrecomputedIndexes *indexes,
+    const CuMatrixBase<BaseFloat> &in,
+    CuMatrixBase<BaseFloat> *out) const {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    Matrix<BaseFloat> params(OutputDim(), input_dim_, kUndefined);
+    GetLinearParams(&params);
+    CuMatrix<BaseFloat> cu_params;
+    cu_params.Swap(&params);
+    out->AddMatMat(1.0, in, kNoTrans, cu_params, kTrans, 0.0);
+    out->AddVecToRows(1.0, bias_params_);
+    return NULL;
+  }
+#endif
+  // The sparse kernel wants the frames as the fastest-changing index, so we
+  // work with the transposed input and output.
+  Matrix<BaseFloat> in_trans(in.Mat(), kTrans),
+      out_trans(OutputDim(), in.NumRows(), kUndefined);
+  sparse_affine::SparseMatMul(row_offsets_, col_indexes_, values_,
+                              in_trans, &out_trans);
+  out->Mat().CopyFromMat(out_trans, kTrans);
+  out->AddVecToRows(1.0, bias_params_);
+  return NULL;
+}
+
+void SparseAffineComponent::Backprop(
+    const std::string &debug_info,
+    const ComponentPrecomputedIndexes *indexes,
+    const CuMatrixBase<BaseFloat> &, // in_value
+    const CuMatrixBase<BaseFloat> &, // out_value
+    const CuMatrixBase<BaseFloat> &, // out_deriv
+    void *memo,
+    Component *, // to_update
+    CuMatrixBase<BaseFloat> *) const {
+  KALDI_ERR << "SparseAffineComponent is for inference only and does "
+            << "not support backprop [component " << debug_info << "]";
+}
+
+Component* SparseAffineComponent::Copy() const {
+  SparseAffineComponent *ans = new SparseAffineComponent();
+  ans->input_dim_ = input_dim_;
+  ans->row_offsets_ = row_offsets_;
+  ans->col_indexes_ = col_indexes_;
+  ans->values_ = values_;
+  ans->bias_params_ = bias_params_;
+  return ans;
+}
+
+void SparseAffineComponent::MulRowsVec(
+    const CuVectorBase<BaseFloat> &scales) {
+  KALDI_ASSERT(scales.Dim() == OutputDim());
+  Vector<BaseFloat> cpu_scales(scales);
+  for (int32 i = 0; i < OutputDim(); i++)
+    for (int32 k = row_offsets_[i]; k < row_offsets_[i + 1]; k++)
+      values_(k) *= cpu_scales(i);
+}
+
+void SparseAffineComponent::PreMultiply(
+    const CuVectorBase<BaseFloat> &offset,
+    const CuVectorBase<BaseFloat> &scale) {
+  KALDI_ASSERT(offset.Dim() == input_dim_ && scale.Dim() == input_dim_);
+  Vector<BaseFloat> cpu_offset(offset), cpu_scale(scale),
+      bias(bias_params_);
+  // The affine component does y = W x + b; replacing x with s x + o gives
+  // y = W s x + (b + W o).
+  for (int32 i = 0; i < OutputDim(); i++) {
+    double sum = 0.0;
+    for (int32 k = row_offsets_[i]; k < row_offsets_[i + 1]; k++) {
+      sum += values_(k) * cpu_offset(col_indexes_[k]);
+      values_(k) *= cpu_scale(col_indexes_[k]);
+    }
+    bias(i) += sum;
+  }
+  bias_params_.CopyFromVec(bias);
+}
+
+void SparseAffineComponent::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<SparseAffineComponent>");
+  WriteToken(os, binary, "<InputDim>");
+  WriteBasicType(os, binary, input_dim_);
+  WriteToken(os, binary, "<RowOffsets>");
+  WriteIntegerVector(os, binary, row_offsets_);
+  WriteToken(os, binary, "<ColIndexes>");
+  WriteIntegerVector(os, binary, col_indexes_);
+  WriteToken(os, binary, "<Values>");
+  values_.Write(os, binary);
+  WriteToken(os, binary, "<BiasParams>");
+  bias_params_.Write(os, binary);
+  WriteToken(os, binary, "</SparseAffineComponent>");
+}
+
+void SparseAffineComponent::Read(std::istream &is, bool binary) {
+  ExpectOneOrTwoTokens(is, binary, "<SparseAffineComponent>", "<InputDim>");
+  ReadBasicType(is, binary, &input_dim_);
+  ExpectToken(is, binary, "<RowOffsets>");
+  ReadIntegerVector(is, binary, &row_offsets_);
+  ExpectToken(is, binary, "<ColIndexes>");
+  ReadIntegerVector(is, binary, &col_indexes_);
+  ExpectToken(is, binary, "<Values>");
+  values_.Read(is, binary);
+  ExpectToken(is, binary, "<BiasParams>");
+  bias_params_.Read(is, binary);
+  ExpectToken(is, binary, "</SparseAffineComponent>");
+  // Check the indexes, since the kernel does not.
+  bool ok = (row_offsets_.size() == static_cast<size_t>(OutputDim()) + 1 &&
+             row_offsets_[0] == 0 && row_offsets_.back() == values_.Dim() &&
+             col_indexes_.size() == static_cast<size_t>(values_.Dim()));
+  for (int32 i = 0; ok && i < OutputDim(); i++)
+    ok = (row_offsets_[i] <= row_offsets_[i + 1]);
+  for (size_t k = 0; ok && k < col_indexes_.size(); k++)
+    ok = (col_indexes_[k] >= 0 && col_indexes_[k] < input_dim_);
+  if (!ok)
+    KALDI_ERR << "Invalid sparse parameters in SparseAffineComponent "
+              << "(corrupted model file?)";
+}
+
 void SumGroupComponent::Init(const std::vector<int32> &sizes) {
   KALDI_ASSERT(!sizes.empty());
   std::vector<Int32Pair> cpu_vec(sizes.size());
@@ -3811,6 +4476,85 @@ void FixedBiasComponent::Read(std::istream &is, bool binary) {
   ExpectToken(is, binary, "</FixedBiasComponent>");
 }
 
+void BiasReluOffsetComponent::Init(const CuVectorBase<BaseFloat> &bias,
+                                   const CuVectorBase<BaseFloat> &offset) {
+  KALDI_ASSERT(bias.Dim() != 0 && bias.Dim() == offset.Dim());
+  bias_ = bias;
+  offset_ = offset;
+}
+
+void BiasReluOffsetComponent::InitFromConfig(ConfigLine *cfl) {
+  int32 dim;
+  if (!cfl->GetValue("dim", &dim) || cfl->HasUnusedValues() || dim <= 0)
+    KALDI_ERR << "Invalid initializer for layer of type "
+              << Type() << ": \"" << cfl->WholeLine() << "\"";
+  CuVector<BaseFloat> bias(dim), offset(dim);
+  bias.SetRandn();
+  offset.SetRandn();
+  Init(bias, offset);
+}
+
+std::string BiasReluOffsetComponent::Info() const {
+  std::ostringstream stream;
+  stream << Component::Info();
+  PrintParameterStats(stream, "bias", bias_, true);
+  PrintParameterStats(stream, "offset", offset_, true);
+  return stream.str();
+}
+
+void* BiasReluOffsetComponent::Propagate(
+    const ComponentPrecomputedIndexes *indexes,
+    const CuMatrixBase<BaseFloat> &in,
+    CuMatrixBase<BaseFloat> *out) const {
+  // this works if in and out have the same memory.
+  out->BiasReluOffset(in, bias_, offset_);
+  return NULL;
+}
+
+void BiasReluOffsetComponent::Backprop(
+    const std::string &debug_info,
+    const ComponentPrecomputedIndexes *indexes,
+    const CuMatrixBase<BaseFloat> &in_value,
+    const CuMatrixBase<BaseFloat> &, // out_value
+    const CuMatrixBase<BaseFloat> &out_deriv,
+    void *memo,
+    Component *, // to_update
+    CuMatrixBase<BaseFloat> *in_deriv) const {
+  NVTX_RANGE("BiasReluOffsetComponent::Backprop");
+  if (in_deriv == NULL)
+    return;
+  // The derivative is 1 where the ReLU was active, i.e. where
+  // in_value + bias > 0, and 0 elsewhere.  We can't get this from the output:
+  // if the offset is large, a small positive ReLU output is lost when the
+  // offset is added to it.  This works if in_deriv and out_deriv have the
+  // same memory.
+  in_deriv->DiffBiasReluOffset(in_value, bias_, out_deriv);
+}
+
+Component* BiasReluOffsetComponent::Copy() const {
+  BiasReluOffsetComponent *ans = new BiasReluOffsetComponent();
+  ans->bias_ = bias_;
+  ans->offset_ = offset_;
+  return ans;
+}
+
+void BiasReluOffsetComponent::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<BiasReluOffsetComponent>");
+  WriteToken(os, binary, "<Bias>");
+  bias_.Write(os, binary);
+  WriteToken(os, binary, "<Offset>");
+  offset_.Write(os, binary);
+  WriteToken(os, binary, "</BiasReluOffsetComponent>");
+}
+
+void BiasReluOffsetComponent::Read(std::istream &is, bool binary) {
+  ExpectOneOrTwoTokens(is, binary, "<BiasReluOffsetComponent>", "<Bias>");
+  bias_.Read(is, binary);
+  ExpectToken(is, binary, "<Offset>");
+  offset_.Read(is, binary);
+  ExpectToken(is, binary, "</BiasReluOffsetComponent>");
+}
+
 
 void NaturalGradientPerElementScaleComponent::Read(
     std::istream &is, bool binary) {
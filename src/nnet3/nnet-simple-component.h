@@ -29,7 +29,11 @@
 #include "nnet3/nnet-common.h"
 #include "nnet3/nnet-component-itf.h"
 #include "nnet3/natural-gradient-online.h"
+#include "nnet3/quantization.h"
+#include "nnet3/sparse-affine.h"
+#include "util/kaldi-mmap.h"
 #include <iostream>
+#include <memory>
 
 namespace kaldi {
 namespace nnet3 {
@@ -1038,6 +1042,340 @@ class FixedAffineComponent: public Component {
   KALDI_DISALLOW_COPY_AND_ASSIGN(FixedAffineComponent);
 };
 
+
+/**
+   QuantizedAffineComponent is an inference-only affine transform whose linear
+   parameters are stored as 8-bit integers with one scale per output
+   dimension (see quantization.h).  It is normally created from
+   AffineComponent, NaturalGradientAffineComponent, LinearComponent or
+   TdnnComponent by ConvertToQuantized() in nnet-utils.h, and does not support
+   training or backprop.  On CPU, each input row is quantized on the fly and
+   the product is computed in integer arithmetic with the fastest kernel the
+   CPU supports; on GPU the dequantized parameters are used.
+
+   Config-line parameters (only useful for testing, since the parameters
+   are random):
+     input-dim, output-dim  The input and output dimensions.
+*/
+class QuantizedAffineComponent: public Component {
+ public:
+  QuantizedAffineComponent(): input_dim_(0) { }
+  virtual std::string Type() const { return "QuantizedAffineComponent"; }
+  virtual std::string Info() const;
+
+  /// Initializes from the linear and bias parameters of an affine transform;
+  /// 'bias_params' may be empty, meaning there is no bias.
+  void Init(const CuMatrixBase<BaseFloat> &linear_params,
+            const CuVectorBase<BaseFloat> &bias_params);
+
+  virtual void InitFromConfig(ConfigLine *cfl);
+
+  virtual int32 Properties() const { return kSimpleComponent; }
+  virtual int32 InputDim() const { return input_dim_; }
+  virtual int32 OutputDim() const { return scales_.Dim(); }
+
+  virtual void* Propagate(const ComponentPrecomputedIndexes *indexes,
+                         const CuMatrixBase<BaseFloat> &in,
+                         CuMatrixBase<BaseFloat> *out) const;
+  virtual void Backprop(const std::string &debug_info,
+                        const ComponentPrecomputedIndexes *indexes,
+                        const CuMatrixBase<BaseFloat> &in_value,
+                        const CuMatrixBase<BaseFloat> &, // out_value
+                        const CuMatrixBase<BaseFloat> &out_deriv,
+                        void *memo,
+                        Component *to_update,
+                        CuMatrixBase<BaseFloat> *in_deriv) const;
+
+  virtual Component* Copy() const;
+  virtual void Read(std::istream &is, bool binary);
+  virtual void Write(std::ostream &os, bool binary) const;
+
+  /// Outputs the dequantized linear parameters; 'params' must be of
+  /// dimension OutputDim() by InputDim().
+  void GetLinearParams(MatrixBase<BaseFloat> *params) const;
+  const CuVector<BaseFloat> &BiasParams() const { return bias_params_; }
+ private:
+  // Computes row_sums_ from params_.
+  void ComputeRowSums();
+
+  int32 input_dim_;
+  // The quantized linear parameters, OutputDim() rows of
+  // QuantizedStride(input_dim_) elements each.
+  std::vector<int8> params_;
+  // The scale for each row of params_.
+  Vector<BaseFloat> scales_;
+  // The sum of each row of params_ (derived, not written to disk).
+  std::vector<int32> row_sums_;
+  // The bias, of dimension OutputDim() (zero if there was none).
+  CuVector<BaseFloat> bias_params_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(QuantizedAffineComponent);
+};
+
+
+/**
+   HalfPrecisionAffineComponent is an inference-only affine transform whose
+   linear parameters are stored as 16-bit floating point, either IEEE half
+   precision or bfloat16 (see quantization.h), which halves the memory and
+   disk space they take.  It is normally created from AffineComponent,
+   NaturalGradientAffineComponent, LinearComponent or TdnnComponent by
+   ConvertToHalfPrecision() in nnet-utils.h, e.g. via nnet3-am-copy
+   --half-precision=fp16, and does not support training or backprop.
+   In Propagate() the parameters are converted back to BaseFloat in blocks of
+   rows small enough to stay in cache, and each block is multiplied by the
+   input with the usual BLAS call.  The bias is stored as BaseFloat.
+
+   Config-line parameters (only useful for testing, since the parameters
+   are random):
+     input-dim, output-dim  The input and output dimensions.
+     half-precision-type    "fp16" (the default) or "bf16".
+*/
+class HalfPrecisionAffineComponent: public Component {
+ public:
+  HalfPrecisionAffineComponent(): type_(quantization::kFloat16),
+                                  input_dim_(0) { }
+  virtual std::string Type() const { return "HalfPrecisionAffineComponent"; }
+  virtual std::string Info() const;
+
+  /// Initializes from the linear and bias parameters of an affine transform;
+  /// 'bias_params' may be empty, meaning there is no bias.
+  void Init(quantization::HalfPrecisionType type,
+            const CuMatrixBase<BaseFloat> &linear_params,
+            const CuVectorBase<BaseFloat> &bias_params);
+
+  virtual void InitFromConfig(ConfigLine *cfl);
+
+  virtual int32 Properties() const { return kSimpleComponent; }
+  virtual int32 InputDim() const { return input_dim_; }
+  virtual int32 OutputDim() const { return bias_params_.Dim(); }
+
+  virtual void* Propagate(const ComponentPrecomputedIndexes *indexes,
+                         const CuMatrixBase<BaseFloat> &in,
+                         CuMatrixBase<BaseFloat> *out) const;
+  virtual void Backprop(const std::string &debug_info,
+                        const ComponentPrecomputedIndexes *indexes,
+                        const CuMatrixBase<BaseFloat> &in_value,
+                        const CuMatrixBase<BaseFloat> &, // out_value
+                        const CuMatrixBase<BaseFloat> &out_deriv,
+                        void *memo,
+                        Component *to_update,
+                        CuMatrixBase<BaseFloat> *in_deriv) const;
+
+  virtual Component* Copy() const;
+  virtual void Read(std::istream &is, bool binary);
+  virtual void Write(std::ostream &os, bool binary) const;
+
+  quantization::HalfPrecisionType PrecisionType() const { return type_; }
+  /// Outputs the linear parameters converted to BaseFloat; 'params' must be
+  /// of dimension OutputDim() by InputDim().
+  void GetLinearParams(MatrixBase<BaseFloat> *params) const;
+  const CuVector<BaseFloat> &BiasParams() const { return bias_params_; }
+ private:
+  quantization::HalfPrecisionType type_;
+  int32 input_dim_;
+  // The linear parameters, OutputDim() rows of input_dim_ elements each.
+  std::vector<uint16> params_;
+  // The bias, of dimension OutputDim() (zero if there was none).
+  CuVector<BaseFloat> bias_params_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(HalfPrecisionAffineComponent);
+};
+
+
+/**
+   MappedAffineComponent is an inference-only affine transform whose linear
+   parameters can be used in place from a memory-mapped model file written
+   by WriteMappedAmNnet() (see am-nnet-mapped.h).  All the processes on a
+   machine that decode with the same mapped model then share one physical
+   copy of the parameters, and loading the model does not have to read them.
+   It is normally created from AffineComponent, NaturalGradientAffineComponent,
+   LinearComponent or TdnnComponent by ConvertToMappedAffine() in
+   nnet-utils.h, and does not support training or backprop.
+
+   The parameters are either owned by the component (as when it is read
+   from an ordinary model file, or just converted) or are a read-only view of
+   the mapped file, which the component keeps open.  Written to an ordinary
+   model file, the parameters are always written in full.  On GPU, mapped
+   parameters are copied to the GPU for each Propagate(), since mapped models
+   are intended for CPU decoding.
+
+   Config-line parameters (only useful for testing, since the parameters
+   are random):
+     input-dim, output-dim  The input and output dimensions.
+*/
+class MappedAffineComponent: public Component {
+ public:
+  MappedAffineComponent(): input_dim_(0), mapped_params_(NULL),
+                           mapped_stride_(0), mapped_offset_(-1) { }
+  virtual std::string Type() const { return "MappedAffineComponent"; }
+  virtual std::string Info() const;
+
+  /// Initializes from the linear and bias parameters of an affine transform;
+  /// 'bias_params' may be empty, meaning there is no bias.
+  void Init(const CuMatrixBase<BaseFloat> &linear_params,
+            const CuVectorBase<BaseFloat> &bias_params);
+
+  virtual void InitFromConfig(ConfigLine *cfl);
+
+  virtual int32 Properties() const { return kSimpleComponent; }
+  virtual int32 InputDim() const { return input_dim_; }
+  virtual int32 OutputDim() const { return bias_params_.Dim(); }
+
+  virtual void* Propagate(const ComponentPrecomputedIndexes *indexes,
+                         const CuMatrixBase<BaseFloat> &in,
+                         CuMatrixBase<BaseFloat> *out) const;
+  virtual void Backprop(const std::string &debug_info,
+                        const ComponentPrecomputedIndexes *indexes,
+                        const CuMatrixBase<BaseFloat> &in_value,
+                        const CuMatrixBase<BaseFloat> &, // out_value
+                        const CuMatrixBase<BaseFloat> &out_deriv,
+                        void *memo,
+                        Component *to_update,
+                        CuMatrixBase<BaseFloat> *in_deriv) const;
+
+  virtual Component* Copy() const;
+  virtual void Read(std::istream &is, bool binary);
+  virtual void Write(std::ostream &os, bool binary) const;
+
+  /// Outputs the linear parameters; 'params' must be of dimension
+  /// OutputDim() by InputDim().
+  void GetLinearParams(MatrixBase<BaseFloat> *params) const;
+  const CuVector<BaseFloat> &BiasParams() const { return bias_params_; }
+
+  /// Returns true if the parameters are a view of a mapped file.
+  bool IsMapped() const { return mapped_params_ != NULL; }
+
+  /// Used by WriteMappedAmNnet(): makes Write() output, instead of the
+  /// linear parameters, their byte offset in the data section of the mapped
+  /// file and the row stride (in elements) with which they are stored there.
+  void SetMappedOffset(int64 offset, int32 stride);
+
+  /// Returns true if this component was read from the header of a mapped
+  /// model file, so it has the offset of its parameters but not the
+  /// parameters themselves; SetMappedData() must be called before use.
+  bool NeedsMappedData() const {
+    return mapped_offset_ >= 0 && !IsMapped() && linear_params_.NumRows() == 0;
+  }
+
+  /// Makes the linear parameters refer to the data at the offset that Read()
+  /// found, in the data section of 'file', which starts at 'data_begin' and is
+  /// 'data_size' bytes long.  The component keeps 'file' open.
+  void SetMappedData(const std::shared_ptr<const MappedFile> &file,
+                     const char *data_begin, size_t data_size);
+ private:
+  // Returns a read-only view of the mapped parameters (CPU memory).
+  const SubMatrix<BaseFloat> MappedParams() const;
+
+  int32 input_dim_;
+  // The linear parameters, if they are owned by this component.
+  CuMatrix<BaseFloat> linear_params_;
+  // The mapped file and the location and row stride of the parameters in it,
+  // if they are mapped.
+  std::shared_ptr<const MappedFile> mapped_file_;
+  const BaseFloat *mapped_params_;
+  int32 mapped_stride_;
+  // The offset of the parameters in the data section, if we are about to
+  // write a mapped model or have just read one; -1 otherwise.
+  int64 mapped_offset_;
+  // The bias, of dimension OutputDim() (zero if there was none).
+  CuVector<BaseFloat> bias_params_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MappedAffineComponent);
+};
+
+
+/**
+   SparseAffineComponent is an inference-only affine transform whose linear
+   parameters are stored in compressed sparse row form, keeping only the
+   nonzero elements (see sparse-affine.h).  It is meant for models whose
+   weights have been pruned, and is normally created from AffineComponent,
+   NaturalGradientAffineComponent, LinearComponent or TdnnComponent by
+   ConvertToSparse() in nnet-utils.h (e.g. via nnet3-sparsify), which only
+   converts components that are sparse enough for this to be faster than the
+   dense product.  It does not support training or backprop.  On CPU the
+   product is computed with the sparse kernel, which costs time proportional
+   to the number of nonzero parameters; on GPU the parameters are expanded
+   to a dense matrix for each Propagate().
+
+   CollapseModel() can still fold dropout, test-mode batchnorm and fixed
+   scales and offsets into this component, since that only scales rows or
+   columns of the parameters and changes the bias, which keeps the sparsity.
+
+   Config-line parameters (only useful for testing, since the parameters
+   are random):
+     input-dim, output-dim  The input and output dimensions.
+     sparsity               The proportion of the linear parameters that are
+                            zero, default 0.7.
+*/
+class SparseAffineComponent: public Component {
+ public:
+  SparseAffineComponent(): input_dim_(0) { }
+  virtual std::string Type() const { return "SparseAffineComponent"; }
+  virtual std::string Info() const;
+
+  /// Initializes from the linear and bias parameters of an affine transform,
+  /// keeping the linear parameters whose absolute value is greater than
+  /// 'threshold'; 'bias_params' may be empty, meaning there is no bias.
+  void Init(const CuMatrixBase<BaseFloat> &linear_params,
+            const CuVectorBase<BaseFloat> &bias_params,
+            BaseFloat threshold = 0.0);
+
+  virtual void InitFromConfig(ConfigLine *cfl);
+
+  virtual int32 Properties() const { return kSimpleComponent; }
+  virtual int32 InputDim() const { return input_dim_; }
+  virtual int32 OutputDim() const { return bias_params_.Dim(); }
+
+  virtual void* Propagate(const ComponentPrecomputedIndexes *indexes,
+                         const CuMatrixBase<BaseFloat> &in,
+                         CuMatrixBase<BaseFloat> *out) const;
+  virtual void Backprop(const std::string &debug_info,
+                        const ComponentPrecomputedIndexes *indexes,
+                        const CuMatrixBase<BaseFloat> &in_value,
+                        const CuMatrixBase<BaseFloat> &, // out_value
+                        const CuMatrixBase<BaseFloat> &out_deriv,
+                        void *memo,
+                        Component *to_update,
+                        CuMatrixBase<BaseFloat> *in_deriv) const;
+
+  virtual Component* Copy() const;
+  virtual void Read(std::istream &is, bool binary);
+  virtual void Write(std::ostream &os, bool binary) const;
+
+  /// Outputs the linear parameters, with zeros where no parameter is stored;
+  /// 'params' must be of dimension OutputDim() by InputDim().
+  void GetLinearParams(MatrixBase<BaseFloat> *params) const;
+  CuVector<BaseFloat> &BiasParams() { return bias_params_; }
+  const CuVector<BaseFloat> &BiasParams() const { return bias_params_; }
+
+  /// Returns the number of linear parameters stored.
+  int32 NumNonzero() const { return values_.Dim(); }
+
+  /// Scales the linear parameters by 'alpha'.
+  void ScaleLinearParams(BaseFloat alpha) { values_.Scale(alpha); }
+  /// Scales row i of the linear parameters by scales(i); does not affect the
+  /// bias.
+  void MulRowsVec(const CuVectorBase<BaseFloat> &scales);
+  /// Modifies the parameters to give the same output as before for the
+  /// input x when the input is replaced by scale * x + offset (elementwise),
+  /// i.e. does bias += W offset, then scales column j of W by scale(j).
+  /// 'offset' and 'scale' must have dimension InputDim().
+  void PreMultiply(const CuVectorBase<BaseFloat> &offset,
+                   const CuVectorBase<BaseFloat> &scale);
+ private:
+  int32 input_dim_;
+  // The linear parameters in CSR form: the nonzero elements of row i are
+  // values_(k) in column col_indexes_[k], for row_offsets_[i] <= k <
+  // row_offsets_[i+1].
+  std::vector<int32> row_offsets_;
+  std::vector<int32> col_indexes_;
+  Vector<BaseFloat> values_;
+  // The bias, of dimension OutputDim() (zero if there was none).
+  CuVector<BaseFloat> bias_params_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(SparseAffineComponent);
+};
+
 /// SumGroupComponent is used to sum up groups of posteriors.
 /// It's used to introduce a kind of Gaussian-mixture-model-like
 /// idea into neural nets.  This is basically a degenerate case of
@@ -1154,6 +1492,7 @@ class FixedBiasComponent: public Component {
   virtual void InitFromConfig(ConfigLine *cfl);
   virtual int32 InputDim() const { return bias_.Dim(); }
   virtual int32 OutputDim() const { return bias_.Dim(); }
+  const CuVector<BaseFloat> &Bias() const { return bias_; }
   using Component::Propagate; // to avoid name hiding
   virtual void* Propagate(const ComponentPrecomputedIndexes *indexes,
                          const CuMatrixBase<BaseFloat> &in,
@@ -1175,6 +1514,59 @@ class FixedBiasComponent: public Component {
   KALDI_DISALLOW_COPY_AND_ASSIGN(FixedBiasComponent);
 };
 
+/**
+   BiasReluOffsetComponent computes y = max(x + bias, 0) + offset, with
+   per-element 'bias' and 'offset'.  It is not normally created from configs:
+   CollapseModel() uses it to replace the sequence affine -> ReLU ->
+   batchnorm (in test mode) that appears in TDNN-F layers, after moving the
+   affine bias here and folding the batchnorm scale into the affine
+   parameters, so that the bias, ReLU and batchnorm are done in a single pass
+   over the data.  Config parameters, for testing only:
+
+      dim               E.g. dim=1024.  Required.  The bias and offset are
+                        initialized randomly.
+*/
+class BiasReluOffsetComponent: public Component {
+ public:
+  BiasReluOffsetComponent() { }
+  virtual std::string Type() const { return "BiasReluOffsetComponent"; }
+  virtual std::string Info() const;
+
+  virtual int32 Properties() const {
+    return kSimpleComponent|kBackpropNeedsInput|kPropagateInPlace|
+        kBackpropInPlace;
+  }
+
+  void Init(const CuVectorBase<BaseFloat> &bias,
+            const CuVectorBase<BaseFloat> &offset);
+
+  virtual void InitFromConfig(ConfigLine *cfl);
+  virtual int32 InputDim() const { return bias_.Dim(); }
+  virtual int32 OutputDim() const { return bias_.Dim(); }
+  using Component::Propagate; // to avoid name hiding
+  virtual void* Propagate(const ComponentPrecomputedIndexes *indexes,
+                         const CuMatrixBase<BaseFloat> &in,
+                         CuMatrixBase<BaseFloat> *out) const;
+  virtual void Backprop(const std::string &debug_info,
+                        const ComponentPrecomputedIndexes *indexes,
+                        const CuMatrixBase<BaseFloat> &in_value,
+                        const CuMatrixBase<BaseFloat> &, // out_value,
+                        const CuMatrixBase<BaseFloat> &out_deriv,
+                        void *memo,
+                        Component *, // to_update
+                        CuMatrixBase<BaseFloat> *in_deriv) const;
+  virtual Component* Copy() const;
+  virtual void Read(std::istream &is, bool binary);
+  virtual void Write(std::ostream &os, bool binary) const;
+
+  const CuVector<BaseFloat> &Bias() const { return bias_; }
+  const CuVector<BaseFloat> &Offset() const { return offset_; }
+ protected:
+  CuVector<BaseFloat> bias_;
+  CuVector<BaseFloat> offset_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(BiasReluOffsetComponent);
+};
+
 /**
    NoOpComponent just duplicates its input.  We don't anticipate this being used
     very often, but it may sometimes make your life easier.  Config parameters:
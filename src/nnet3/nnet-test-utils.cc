@@ -23,6 +23,9 @@
 #include <sstream>
 #include "nnet3/nnet-test-utils.h"
 #include "nnet3/nnet-utils.h"
+#include "nnet3/nnet-compile.h"
+#include "nnet3/nnet-compute.h"
+#include "base/timer.h"
 
 namespace kaldi {
 namespace nnet3 {
@@ -1335,6 +1338,67 @@ start:
   KALDI_ASSERT(!configs->empty());
 }
 
+void GenerateConfigSequenceInferenceTdnn(bool log_softmax,
+                                         std::vector<std::string> *configs) {
+  std::ostringstream os;
+  os << "input-node name=input dim=40\n"
+     << "component name=tdnn1 type=TdnnComponent input-dim=40 output-dim=200 "
+     << "time-offsets=-1,0,1\n"
+     << "component-node name=tdnn1 component=tdnn1 input=input\n"
+     << "component name=relu1 type=RectifiedLinearComponent dim=200\n"
+     << "component-node name=relu1 component=relu1 input=tdnn1\n"
+     << "component name=linear2 type=LinearComponent input-dim=200 "
+     << "output-dim=50\n"
+     << "component-node name=linear2 component=linear2 input=relu1\n"
+     << "component name=tdnn3 type=TdnnComponent input-dim=50 output-dim=200 "
+     << "time-offsets=0,3 use-bias=false\n"
+     << "component-node name=tdnn3 component=tdnn3 "
+     << "input=Sum(linear2, Offset(linear2, 1))\n"
+     << "component name=relu3 type=RectifiedLinearComponent dim=200\n"
+     << "component-node name=relu3 component=relu3 "
+     << "input=Sum(Scale(0.5, relu1), tdnn3)\n"
+     << "component name=affine4 type=NaturalGradientAffineComponent "
+     << "input-dim=400 output-dim=30\n"
+     << "component-node name=affine4 component=affine4 "
+     << "input=Append(Offset(relu3, -1), relu3)\n";
+  if (log_softmax) {
+    os << "component name=log-softmax type=LogSoftmaxComponent dim=30\n"
+       << "component-node name=log-softmax component=log-softmax "
+       << "input=affine4\n"
+       << "output-node name=output input=log-softmax\n";
+  } else {
+    os << "output-node name=output input=affine4\n";
+  }
+  configs->push_back(os.str());
+}
+
+void ComputeSimpleOutput(const Nnet &nnet,
+                         const Matrix<BaseFloat> &input,
+                         int32 left_context,
+                         Matrix<BaseFloat> *output) {
+  ComputationRequest request;
+  request.inputs.resize(1);
+  request.outputs.resize(1);
+  request.inputs[0].name = "input";
+  request.outputs[0].name = "output";
+  for (int32 t = 0; t < input.NumRows(); t++)
+    request.inputs[0].indexes.push_back(Index(0, t - left_context));
+  for (int32 t = 0; t < output->NumRows(); t++)
+    request.outputs[0].indexes.push_back(Index(0, t));
+  NnetComputation computation;
+  Compiler compiler(request, nnet);
+  CompilerOptions opts;
+  compiler.CreateComputation(opts, &computation);
+  computation.ComputeCudaIndexes();
+  NnetComputeOptions compute_opts;
+  NnetComputer computer(compute_opts, computation, nnet, NULL);
+  computer.AcceptInput("input", new CuMatrix<BaseFloat>(input));
+  computer.Run();
+  CuMatrix<BaseFloat> cu_output;
+  computer.GetOutputDestructive("output", &cu_output);
+  output->CopyFromMat(cu_output);
+}
+
 void ComputeExampleComputationRequestSimple(
     const Nnet &nnet,
     ComputationRequest *request,
@@ -1400,7 +1464,7 @@ void ComputeExampleComputationRequestSimple(
 static void GenerateRandomComponentConfig(std::string *component_type,
                                           std::string *config) {
 
-  int32 n = RandInt(0, 37);
+  int32 n = RandInt(0, 38);
   BaseFloat learning_rate = 0.001 * RandInt(1, 100);
 
   std::ostringstream os;
@@ -1773,6 +1837,11 @@ static void GenerateRandomComponentConfig(std::string *component_type,
 
       break;
     }
+    case 38: {
+      *component_type = "BiasReluOffsetComponent";
+      os << "dim=" << RandInt(1, 100);
+      break;
+    }
     default:
       KALDI_ERR << "Error generating random component";
   }
@@ -1799,6 +1868,61 @@ Component *GenerateRandomSimpleComponent() {
   return c;
 }
 
+BaseFloat TestInferenceAffineComponent(
+    const Component &component,
+    const CuMatrixBase<BaseFloat> &linear_params,
+    const CuVectorBase<BaseFloat> &bias_params,
+    BaseFloat max_relative_error,
+    Component **component_read) {
+  int32 num_rows = RandInt(1, 50), input_dim = linear_params.NumCols(),
+      output_dim = linear_params.NumRows();
+  KALDI_ASSERT(component.InputDim() == input_dim &&
+               component.OutputDim() == output_dim);
+  CuMatrix<BaseFloat> input(num_rows, input_dim),
+      output_ref(num_rows, output_dim), output(num_rows, output_dim);
+  input.SetRandn();
+  output_ref.AddMatMat(1.0, input, kNoTrans, linear_params, kTrans, 0.0);
+  if (bias_params.Dim() != 0)
+    output_ref.AddVecToRows(1.0, bias_params);
+  component.Propagate(NULL, input, &output);
+  output.AddMat(-1.0, output_ref);
+  BaseFloat relative_error = output.FrobeniusNorm() /
+      output_ref.FrobeniusNorm();
+  KALDI_LOG << "Relative error of " << component.Type() << " is "
+            << relative_error;
+  KALDI_ASSERT(relative_error <= max_relative_error);
+
+  bool binary = (RandInt(0, 1) == 0);
+  std::ostringstream os;
+  component.Write(os, binary);
+  std::istringstream is(os.str());
+  Component *component2 = Component::ReadNew(is, binary),
+      *component3 = component2->Copy();
+  KALDI_ASSERT(component2->Type() == component.Type());
+  CuMatrix<BaseFloat> output1(num_rows, output_dim),
+      output2(num_rows, output_dim);
+  component.Propagate(NULL, input, &output1);
+  component3->Propagate(NULL, input, &output2);
+  delete component3;
+  KALDI_ASSERT(output1.ApproxEqual(output2, 1.0e-05));
+  if (component_read != NULL)
+    *component_read = component2;
+  else
+    delete component2;
+  return relative_error;
+}
+
+double TimeComponentPropagate(const Component &component, int32 num_rows) {
+  CuMatrix<BaseFloat> input(num_rows, component.InputDim()),
+      output(num_rows, component.OutputDim());
+  input.SetRandn();
+  Timer timer;
+  int32 iter;
+  for (iter = 0; timer.Elapsed() < 0.5; iter++)
+    component.Propagate(NULL, input, &output);
+  return timer.Elapsed() / iter;
+}
+
 bool NnetParametersAreIdentical(const Nnet &nnet1,
                                 const Nnet &nnet2,
                                 BaseFloat threshold = 1.0e-05) {
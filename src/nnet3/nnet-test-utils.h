@@ -71,6 +71,25 @@ void GenerateConfigSequence(const NnetGenerationOptions &opts,
 void GenerateConfigSequenceCompositeBlock(const NnetGenerationOptions &opts,
                                           std::vector<std::string> *configs);
 
+/// Generates the config of a small, fixed TDNN-F-like nnet for testing the
+/// conversions of models for inference.  It has a 40-dimensional "input", a
+/// 30-dimensional "output", left and right context of 2 and 5, and contains
+/// two TdnnComponents (one without a bias), a LinearComponent and a
+/// NaturalGradientAffineComponent, i.e. four affine-type components; if
+/// 'log_softmax' is true, the output goes through a LogSoftmaxComponent.
+void GenerateConfigSequenceInferenceTdnn(bool log_softmax,
+                                         std::vector<std::string> *configs);
+
+/// Computes the output of a simple nnet (see IsSimpleNnet()) with input and
+/// output named "input" and "output", for a single sequence whose output
+/// frames are numbered from zero.  "input" must include 'left_context' frames
+/// before the first output frame and enough frames after the last one;
+/// 'output' must already have the right size.
+void ComputeSimpleOutput(const Nnet &nnet,
+                         const Matrix<BaseFloat> &input,
+                         int32 left_context,
+                         Matrix<BaseFloat> *output);
+
 /**  This function computes an example computation request, for testing purposes.
      The "Simple" in the name means that it currently only supports neural nets
      that satisfy IsSimple(nnet) (defined in nnet-utils.h).
@@ -88,6 +107,26 @@ void ComputeExampleComputationRequestSimple(
 
 Component *GenerateRandomSimpleComponent();
 
+/** Tests a component that does an (approximate) affine transform at inference
+    time, such as QuantizedAffineComponent, that was initialized from
+    'linear_params' and 'bias_params' (which may be empty).  It checks that
+    the relative error of its output on random input (in Frobenius norm) is
+    at most 'max_relative_error', and that the output does not change after
+    Write(), Component::ReadNew() and Copy().  If 'component_read' is not NULL,
+    it is set to the component that was read back (which the caller must
+    delete), so that type-specific things can be checked.  Returns the
+    relative error. */
+BaseFloat TestInferenceAffineComponent(
+    const Component &component,
+    const CuMatrixBase<BaseFloat> &linear_params,
+    const CuVectorBase<BaseFloat> &bias_params,
+    BaseFloat max_relative_error,
+    Component **component_read = NULL);
+
+/// Returns the average time in seconds that component.Propagate() takes on
+/// 'num_rows' rows of random input, over at least half a second.
+double TimeComponentPropagate(const Component &component, int32 num_rows);
+
 
 /** Used for testing that the updatable parameters in two networks are the same.
     May crash if structure differs.  Prints warning and returns false if
@@ -20,6 +20,7 @@
 
 #include "nnet3/nnet-nnet.h"
 #include "nnet3/nnet-simple-component.h"
+#include "nnet3/nnet-convolutional-component.h"
 #include "nnet3/nnet-test-utils.h"
 
 namespace kaldi {
@@ -100,6 +101,157 @@ void UnitTestConvertRepeatedToBlockAffineComposite() {
   }
 }
 
+// Checks ConvertToQuantized() and ConvertToHalfPrecision() by comparing the
+// outputs of the converted nnets with the original.
+void UnitTestConvertForInference() {
+  std::vector<std::string> configs;
+  GenerateConfigSequenceInferenceTdnn(false, &configs);
+  Nnet nnet;
+  std::istringstream is(configs[0]);
+  nnet.ReadConfig(is);
+  int32 left_context = 2, right_context = 5, num_frames = 20;
+  Matrix<BaseFloat> input(left_context + num_frames + right_context, 40),
+      output(num_frames, 30);
+  input.SetRandn();
+  ComputeSimpleOutput(nnet, input, left_context, &output);
+
+  // 0 is quantized, 1 is fp16 and 2 is bf16.
+  for (int32 conversion = 0; conversion < 3; conversion++) {
+    Nnet converted_nnet(nnet);
+    std::string expected_type;
+    if (conversion == 0) {
+      KALDI_ASSERT(ConvertToQuantized(&converted_nnet) == 4);
+      expected_type = "QuantizedAffineComponent";
+    } else {
+      quantization::HalfPrecisionType type = (conversion == 1 ?
+          quantization::kFloat16 : quantization::kBfloat16);
+      KALDI_ASSERT(ConvertToHalfPrecision(type, &converted_nnet) == 4);
+      expected_type = "HalfPrecisionAffineComponent";
+    }
+    converted_nnet.Check();
+    for (int32 c = 0; c < converted_nnet.NumComponents(); c++) {
+      std::string type = converted_nnet.GetComponent(c)->Type();
+      KALDI_ASSERT(type == expected_type ||
+                   type == "RectifiedLinearComponent");
+    }
+    Matrix<BaseFloat> converted_output(num_frames, 30);
+    ComputeSimpleOutput(converted_nnet, input, left_context,
+                        &converted_output);
+    converted_output.AddMat(-1.0, output);
+    BaseFloat relative_error = converted_output.FrobeniusNorm() /
+        output.FrobeniusNorm();
+    KALDI_LOG << "Relative error of nnet with " << expected_type
+              << " (conversion " << conversion << ") is " << relative_error;
+    KALDI_ASSERT(relative_error < (conversion == 1 ? 0.005 : 0.05));
+  }
+}
+
+// Checks that ConvertToSparse() converts only the components that are
+// sparse enough, and that the converted nnet gives the same output.
+void UnitTestConvertToSparse() {
+  std::vector<std::string> configs;
+  GenerateConfigSequenceInferenceTdnn(false, &configs);
+  Nnet nnet;
+  std::istringstream is(configs[0]);
+  nnet.ReadConfig(is);
+  // Prune tdnn3 to about 80% sparsity.
+  TdnnComponent *tdnn3 = dynamic_cast<TdnnComponent*>(
+      nnet.GetComponent(nnet.GetComponentIndex("tdnn3")));
+  KALDI_ASSERT(tdnn3 != NULL);
+  Matrix<BaseFloat> params(tdnn3->LinearParams());
+  for (int32 i = 0; i < params.NumRows(); i++)
+    for (int32 j = 0; j < params.NumCols(); j++)
+      if (RandUniform() < 0.8)
+        params(i, j) = 0.0;
+  tdnn3->LinearParams().CopyFromMat(params);
+
+  int32 left_context = 2, right_context = 5, num_frames = 20;
+  Matrix<BaseFloat> input(left_context + num_frames + right_context, 40),
+      output(num_frames, 30), converted_output(num_frames, 30);
+  input.SetRandn();
+  ComputeSimpleOutput(nnet, input, left_context, &output);
+
+  Nnet converted_nnet(nnet);
+  KALDI_ASSERT(ConvertToSparse(0.0, 0.5, &converted_nnet) == 1);
+  converted_nnet.Check();
+  KALDI_ASSERT(converted_nnet.GetComponent(
+      converted_nnet.GetComponentIndex("tdnn1"))->Type() == "TdnnComponent");
+  const SparseAffineComponent *sparse =
+      dynamic_cast<const SparseAffineComponent*>(converted_nnet.GetComponent(
+          converted_nnet.GetComponentIndex("tdnn3")));
+  KALDI_ASSERT(sparse != NULL &&
+               sparse->NumNonzero() < 0.3 * params.NumRows() *
+               params.NumCols());
+  ComputeSimpleOutput(converted_nnet, input, left_context, &converted_output);
+  KALDI_ASSERT(converted_output.ApproxEqual(output, 1.0e-04));
+
+  // With min-sparsity of zero, everything is converted.
+  Nnet converted_nnet2(nnet);
+  KALDI_ASSERT(ConvertToSparse(0.0, 0.0, &converted_nnet2) == 4);
+  converted_nnet2.Check();
+  ComputeSimpleOutput(converted_nnet2, input, left_context,
+                      &converted_output);
+  KALDI_ASSERT(converted_output.ApproxEqual(output, 1.0e-04));
+}
+
+// Checks that CollapseModel() removes the NoOpComponent, the test-mode
+// GeneralDropoutComponent and the FixedScaleComponent and FixedBiasComponent
+// of a small TDNN without changing its output, and that NnetFlopsPerFrame()
+// gives the hand-computed counts before and after.
+void UnitTestCollapseModelFixedAndIdentity() {
+  std::ostringstream os;
+  os << "input-node name=input dim=40\n"
+     << "component name=scale1 type=FixedScaleComponent dim=40\n"
+     << "component-node name=scale1 component=scale1 input=input\n"
+     << "component name=tdnn1 type=TdnnComponent input-dim=40 output-dim=50 "
+     << "time-offsets=-1,0,1\n"
+     << "component-node name=tdnn1 component=tdnn1 input=scale1\n"
+     << "component name=relu1 type=RectifiedLinearComponent dim=50\n"
+     << "component-node name=relu1 component=relu1 input=tdnn1\n"
+     << "component name=noop1 type=NoOpComponent dim=50\n"
+     << "component-node name=noop1 component=noop1 input=Offset(relu1, -1)\n"
+     << "component name=dropout1 type=GeneralDropoutComponent dim=50 "
+     << "dropout-proportion=0.5 test-mode=true\n"
+     << "component-node name=dropout1 component=dropout1 input=noop1\n"
+     << "component name=bias2 type=FixedBiasComponent dim=50\n"
+     << "component-node name=bias2 component=bias2 input=dropout1\n"
+     << "component name=affine2 type=NaturalGradientAffineComponent "
+     << "input-dim=100 output-dim=30\n"
+     << "component-node name=affine2 component=affine2 "
+     << "input=Append(bias2, Offset(bias2, 1))\n"
+     << "output-node name=output input=affine2\n";
+  Nnet nnet;
+  std::istringstream is(os.str());
+  nnet.ReadConfig(is);
+
+  // tdnn1 is 2 * (50 * 120 + 50), affine2 is 2 * (30 * 100 + 30), and the
+  // other components count one operation per output element.
+  double tdnn1_flops = 2 * (50 * 120 + 50),
+      affine2_flops = 2 * (30 * 100 + 30);
+  KALDI_ASSERT(NnetFlopsPerFrame(nnet) ==
+               tdnn1_flops + affine2_flops + 40 + 4 * 50);
+
+  int32 left_context = 2, right_context = 2, num_frames = 20;
+  Matrix<BaseFloat> input(left_context + num_frames + right_context, 40),
+      output(num_frames, 30), collapsed_output(num_frames, 30);
+  input.SetRandn();
+  ComputeSimpleOutput(nnet, input, left_context, &output);
+
+  Nnet collapsed_nnet(nnet);
+  CollapseModel(CollapseModelConfig(), &collapsed_nnet);
+  collapsed_nnet.Check();
+  for (int32 c = 0; c < collapsed_nnet.NumComponents(); c++) {
+    std::string type = collapsed_nnet.GetComponent(c)->Type();
+    KALDI_ASSERT(type == "TdnnComponent" ||
+                 type == "RectifiedLinearComponent" ||
+                 type == "NaturalGradientAffineComponent");
+  }
+  KALDI_ASSERT(NnetFlopsPerFrame(collapsed_nnet) ==
+               tdnn1_flops + affine2_flops + 50);
+  ComputeSimpleOutput(collapsed_nnet, input, left_context, &collapsed_output);
+  KALDI_ASSERT(collapsed_output.ApproxEqual(output, 1.0e-04));
+}
+
 } // namespace nnet3
 } // namespace kaldi
 
@@ -111,6 +263,9 @@ int main() {
   UnitTestNnetContext();
   UnitTestConvertRepeatedToBlockAffine();
   UnitTestConvertRepeatedToBlockAffineComposite();
+  UnitTestConvertForInference();
+  UnitTestConvertToSparse();
+  UnitTestCollapseModelFixedAndIdentity();
 
   KALDI_LOG << "Nnet tests succeeded.";
 
@@ -489,6 +489,193 @@ void ConvertRepeatedToBlockAffine(Nnet *nnet) {
   }
 }
 
+// Replaces the input Descriptor of the component node 'node_index', which must
+// use a TdnnComponent with time-offsets 'time_offsets', with one that appends
+// the time offsets, e.g. 'foo' with time-offsets -1,0 becomes
+// 'Append(Offset(foo, -1), foo)'.
+static void SpliceTdnnInput(const std::vector<int32> &time_offsets,
+                            int32 node_index, Nnet *nnet) {
+  const std::vector<std::string> &node_names = nnet->GetNodeNames();
+  Descriptor &descriptor = nnet->GetNode(node_index - 1).descriptor;
+  std::ostringstream input_os, spliced_os;
+  descriptor.WriteConfig(input_os, node_names);
+  spliced_os << "Append(";
+  for (size_t i = 0; i < time_offsets.size(); i++) {
+    if (i > 0)
+      spliced_os << ", ";
+    if (time_offsets[i] == 0)
+      spliced_os << input_os.str();
+    else
+      spliced_os << "Offset(" << input_os.str() << ", " << time_offsets[i]
+                 << ")";
+  }
+  spliced_os << ")";
+  std::vector<std::string> tokens;
+  bool b = DescriptorTokenize(spliced_os.str(), &tokens);
+  KALDI_ASSERT(b);
+  tokens.push_back("end of input");
+  const std::string *next_token = &(tokens[0]);
+  Descriptor spliced;
+  // Normalization in the parsing code takes care of things like Offset(Sum(a,
+  // b), 1) and Offset(Offset(a, 1), 1).
+  spliced.Parse(node_names, &next_token);
+  KALDI_ASSERT(*next_token == "end of input");
+  descriptor = spliced;
+}
+
+// Splices the inputs of all TdnnComponents in 'nnet' that have time offsets
+// other than just zero (see SpliceTdnnInput()), in preparation for replacing
+// them with simple components.  If 'selected_components' is non-NULL, only
+// the nodes whose component-index c has (*selected_components)[c] == true
+// are spliced, i.e. those whose components are going to be replaced.
+static void SpliceTdnnInputs(
+    Nnet *nnet, const std::vector<bool> *selected_components = NULL) {
+  for (int32 n = 0; n < nnet->NumNodes(); n++) {
+    if (!nnet->IsComponentNode(n))
+      continue;
+    int32 c = nnet->GetNode(n).u.component_index;
+    if (selected_components != NULL && !(*selected_components)[c])
+      continue;
+    const TdnnComponent *tdnn_component = dynamic_cast<const TdnnComponent*>(
+        nnet->GetComponent(c));
+    if (tdnn_component != NULL &&
+        !(tdnn_component->TimeOffsets().size() == 1 &&
+          tdnn_component->TimeOffsets()[0] == 0))
+      SpliceTdnnInput(tdnn_component->TimeOffsets(), n, nnet);
+  }
+}
+
+// If 'component' is an AffineComponent, NaturalGradientAffineComponent,
+// LinearComponent or TdnnComponent, outputs its linear and bias parameters
+// and returns true ('*bias_params' is set to an empty vector for
+// LinearComponent and for TdnnComponent without bias); otherwise returns
+// false.
+static bool GetAffineParams(const Component *component,
+                            const CuMatrixBase<BaseFloat> **linear_params,
+                            const CuVectorBase<BaseFloat> **bias_params) {
+  static const CuVector<BaseFloat> empty_bias;
+  const AffineComponent *affine_component =
+      dynamic_cast<const AffineComponent*>(component);
+  const LinearComponent *linear_component =
+      dynamic_cast<const LinearComponent*>(component);
+  const TdnnComponent *tdnn_component =
+      dynamic_cast<const TdnnComponent*>(component);
+  if (affine_component != NULL) {
+    // AffineComponent or NaturalGradientAffineComponent.
+    *linear_params = &(affine_component->LinearParams());
+    *bias_params = &(affine_component->BiasParams());
+  } else if (linear_component != NULL) {
+    *linear_params = &(linear_component->Params());
+    *bias_params = &empty_bias;
+  } else if (tdnn_component != NULL) {
+    *linear_params = &(tdnn_component->LinearParams());
+    *bias_params = &(tdnn_component->BiasParams());
+  } else {
+    return false;
+  }
+  return true;
+}
+
+int32 ConvertToQuantized(Nnet *nnet) {
+  SpliceTdnnInputs(nnet);
+  int32 num_converted = 0;
+  for (int32 c = 0; c < nnet->NumComponents(); c++) {
+    const CuMatrixBase<BaseFloat> *linear_params;
+    const CuVectorBase<BaseFloat> *bias_params;
+    if (GetAffineParams(nnet->GetComponent(c), &linear_params,
+                        &bias_params)) {
+      QuantizedAffineComponent *quantized_component =
+          new QuantizedAffineComponent();
+      quantized_component->Init(*linear_params, *bias_params);
+      // the following call deletes the old component.
+      nnet->SetComponent(c, quantized_component);
+      num_converted++;
+    }
+  }
+  return num_converted;
+}
+
+int32 ConvertToHalfPrecision(quantization::HalfPrecisionType type,
+                             Nnet *nnet) {
+  SpliceTdnnInputs(nnet);
+  int32 num_converted = 0;
+  for (int32 c = 0; c < nnet->NumComponents(); c++) {
+    const CuMatrixBase<BaseFloat> *linear_params;
+    const CuVectorBase<BaseFloat> *bias_params;
+    if (GetAffineParams(nnet->GetComponent(c), &linear_params,
+                        &bias_params)) {
+      HalfPrecisionAffineComponent *half_component =
+          new HalfPrecisionAffineComponent();
+      half_component->Init(type, *linear_params, *bias_params);
+      // the following call deletes the old component.
+      nnet->SetComponent(c, half_component);
+      num_converted++;
+    }
+  }
+  return num_converted;
+}
+
+int32 ConvertToMappedAffine(Nnet *nnet) {
+  SpliceTdnnInputs(nnet);
+  int32 num_converted = 0;
+  for (int32 c = 0; c < nnet->NumComponents(); c++) {
+    const CuMatrixBase<BaseFloat> *linear_params;
+    const CuVectorBase<BaseFloat> *bias_params;
+    if (GetAffineParams(nnet->GetComponent(c), &linear_params,
+                        &bias_params)) {
+      MappedAffineComponent *mapped_component = new MappedAffineComponent();
+      mapped_component->Init(*linear_params, *bias_params);
+      // the following call deletes the old component.
+      nnet->SetComponent(c, mapped_component);
+      num_converted++;
+    }
+  }
+  return num_converted;
+}
+
+int32 ConvertToSparse(BaseFloat threshold, BaseFloat min_sparsity,
+                      Nnet *nnet) {
+  KALDI_ASSERT(threshold >= 0.0 && min_sparsity >= 0.0 &&
+               min_sparsity <= 1.0);
+  int32 num_components = nnet->NumComponents(), num_converted = 0;
+  std::vector<bool> to_convert(num_components, false);
+  for (int32 c = 0; c < num_components; c++) {
+    const CuMatrixBase<BaseFloat> *linear_params;
+    const CuVectorBase<BaseFloat> *bias_params;
+    if (!GetAffineParams(nnet->GetComponent(c), &linear_params,
+                         &bias_params))
+      continue;
+    Matrix<BaseFloat> params(*linear_params);
+    int64 num_zero = 0;
+    for (int32 i = 0; i < params.NumRows(); i++) {
+      const BaseFloat *row = params.RowData(i);
+      for (int32 j = 0; j < params.NumCols(); j++)
+        num_zero += (std::abs(row[j]) <= threshold);
+    }
+    BaseFloat sparsity = num_zero /
+        (static_cast<BaseFloat>(params.NumRows()) * params.NumCols());
+    KALDI_VLOG(2) << "Component " << nnet->GetComponentName(c)
+                  << " has sparsity " << sparsity;
+    to_convert[c] = (sparsity >= min_sparsity);
+  }
+  SpliceTdnnInputs(nnet, &to_convert);
+  for (int32 c = 0; c < num_components; c++) {
+    if (!to_convert[c])
+      continue;
+    const CuMatrixBase<BaseFloat> *linear_params;
+    const CuVectorBase<BaseFloat> *bias_params;
+    bool b = GetAffineParams(nnet->GetComponent(c), &linear_params,
+                             &bias_params);
+    KALDI_ASSERT(b);
+    SparseAffineComponent *sparse_component = new SparseAffineComponent();
+    sparse_component->Init(*linear_params, *bias_params, threshold);
+    // the following call deletes the old component.
+    nnet->SetComponent(c, sparse_component);
+    num_converted++;
+  }
+  return num_converted;
+}
+
 std::string NnetInfo(const Nnet &nnet) {
   std::ostringstream ostr;
   if (IsSimpleNnet(nnet)) {
@@ -1496,9 +1683,15 @@ class ModelCollapser {
     int32 num_components1 = nnet_->NumComponents();
     for (; changed; num_iters++) {
       changed = false;
-      for (int32 n = 0; n < num_nodes; n++)
+      for (int32 n = 0; n < num_nodes; n++) {
         if (OptimizeNode(n))
           changed = true;
+        else if (config_.collapse_relu_batchnorm &&
+                 FuseAffineReluBatchnorm(n))
+          changed = true;
+        else if (config_.remove_identity && BypassIdentityNode(n))
+          changed = true;
+      }
       // we shouldn't iterate more than a couple of times.
       if (num_iters >= 10)
         KALDI_ERR << "Something went wrong collapsing model.";
@@ -1549,6 +1742,10 @@ class ModelCollapser {
         (ans = CollapseComponentsScale(component_index1,
                                        component_index2)) != -1)
       return ans;
+    if (config_.collapse_scale &&
+        (ans = CollapseComponentsFixedPre(component_index1,
+                                          component_index2)) != -1)
+      return ans;
     return -1;
   }
 
@@ -1719,6 +1916,214 @@ class ModelCollapser {
   }
 
 
+  // If the input-descriptor at 'node_index' (which must be followed by the
+  // node for its component) is of the form "foo" or "Offset(foo, t)", with no
+  // scale, where 'foo' is a component node, returns the index of 'foo';
+  // otherwise returns -1.
+  int32 GetSoleInputNode(int32 node_index) {
+    if (node_index + 1 >= nnet_->NumNodes() ||
+        nnet_->GetNode(node_index).node_type != kDescriptor ||
+        nnet_->GetNode(node_index + 1).node_type != kComponent)
+      return -1;
+    const Descriptor &descriptor = nnet_->GetNode(node_index).descriptor;
+    if (descriptor.NumParts() != 1)
+      return -1;
+    int32 input_node_index = SumDescriptorIsCollapsible(descriptor.Part(0));
+    if (input_node_index == -1 ||
+        nnet_->GetNode(input_node_index).node_type != kComponent ||
+        descriptor.Part(0).GetScaleForNode(input_node_index) != 1.0)
+      return -1;
+    return input_node_index;
+  }
+
+  /**
+     This function bypasses a component node whose component computes the
+     identity at test time (NoOpComponent, or GeneralDropoutComponent in test
+     mode), where 'node_index' is the index of its input-descriptor node.  If
+     that descriptor is of the form "foo" or "Offset(foo, t)" (possibly with a
+     scale), all references to the component node in other nodes' Descriptors
+     are replaced by that descriptor, which leaves the node orphaned.  Nodes
+     with more general inputs, like the NoOpComponent that sums the bypass
+     connection in TDNN-F layers, are left alone, since they avoid repeating
+     the sum for each consumer.  Returns true if it changed the network.
+  */
+  bool BypassIdentityNode(int32 node_index) {
+    if (node_index + 1 >= nnet_->NumNodes() ||
+        nnet_->GetNode(node_index).node_type != kDescriptor ||
+        nnet_->GetNode(node_index + 1).node_type != kComponent)
+      return false;
+    const Component *component = nnet_->GetComponent(
+        nnet_->GetNode(node_index + 1).u.component_index);
+    const GeneralDropoutComponent *dropout_component =
+        dynamic_cast<const GeneralDropoutComponent*>(component);
+    if (dynamic_cast<const NoOpComponent*>(component) == NULL &&
+        (dropout_component == NULL || !dropout_component->TestMode()))
+      return false;
+    const Descriptor &input_descriptor = nnet_->GetNode(node_index).descriptor;
+    if (input_descriptor.NumParts() != 1 ||
+        SumDescriptorIsCollapsible(input_descriptor.Part(0)) == -1)
+      return false;
+
+    std::vector<std::vector<int32> > graph;
+    NnetToDirectedGraph(*nnet_, &graph);
+    const std::vector<int32> &consumers = graph[node_index + 1];
+    if (consumers.empty())
+      return false;  // already orphaned.
+    for (size_t i = 0; i < consumers.size(); i++)
+      if (nnet_->GetNode(consumers[i]).node_type != kDescriptor)
+        return false;  // e.g. a dim-range node; we can't rewrite those.
+    for (size_t i = 0; i < consumers.size(); i++) {
+      Descriptor &descriptor = nnet_->GetNode(consumers[i]).descriptor;
+      descriptor = ReplaceNodeInDescriptor(descriptor, node_index + 1,
+                                           input_descriptor);
+    }
+    return true;
+  }
+
+  /**
+     This function handles the sequence affine -> ReLU -> batchnorm that
+     appears in TDNN-F and similar layers; 'node_index' is the index of
+     the input-descriptor node for the batchnorm component.  If the batchnorm
+     is in test mode and the outputs of the affine and ReLU nodes are not used
+     anywhere else, it replaces the affine component with one whose linear
+     parameters are scaled by the batchnorm scale and which has no bias, and
+     it replaces the batchnorm component with a BiasReluOffsetComponent that
+     adds the scaled bias, applies the ReLU and adds the batchnorm offset, all
+     in one pass.  This relies on the batchnorm scale being positive, so that
+     scale * max(x, 0) = max(scale * x, 0).
+
+     The ReLU node becomes orphaned and is removed later by
+     RemoveOrphanNodes().  Returns true if it changed the network.
+  */
+  bool FuseAffineReluBatchnorm(int32 node_index) {
+    int32 relu_node_index = GetSoleInputNode(node_index);
+    if (relu_node_index == -1)
+      return false;
+    int32 bn_component_index =
+        nnet_->GetNode(node_index + 1).u.component_index,
+        relu_component_index =
+        nnet_->GetNode(relu_node_index).u.component_index;
+    const BatchNormComponent *bn_component =
+        dynamic_cast<const BatchNormComponent*>(
+            nnet_->GetComponent(bn_component_index));
+    const RectifiedLinearComponent *relu_component =
+        dynamic_cast<const RectifiedLinearComponent*>(
+            nnet_->GetComponent(relu_component_index));
+    if (bn_component == NULL || relu_component == NULL ||
+        bn_component->Offset().Dim() == 0)  // not in test mode.
+      return false;
+    int32 affine_node_index = GetSoleInputNode(relu_node_index - 1);
+    if (affine_node_index == -1)
+      return false;
+    int32 affine_component_index =
+        nnet_->GetNode(affine_node_index).u.component_index;
+    const Component *affine_component =
+        nnet_->GetComponent(affine_component_index);
+    int32 dim = bn_component->InputDim();
+    if (relu_component->InputDim() != dim ||
+        affine_component->OutputDim() != dim)
+      return false;
+
+    // The batchnorm scale and offset, repeated if its block-dim is less than
+    // its dim.
+    int32 block_dim = bn_component->Scale().Dim();
+    KALDI_ASSERT(block_dim > 0 && dim % block_dim == 0);
+    CuVector<BaseFloat> scale(dim), offset(dim);
+    for (int32 d = 0; d < dim; d += block_dim) {
+      scale.Range(d, block_dim).CopyFromVec(bn_component->Scale());
+      offset.Range(d, block_dim).CopyFromVec(bn_component->Offset());
+    }
+    if (scale.Min() <= 0.0)
+      return false;
+
+    // The outputs of the affine and ReLU nodes must be consumed only by the
+    // ReLU and batchnorm respectively, since we are changing what they
+    // compute.
+    std::vector<std::vector<int32> > graph;
+    NnetToDirectedGraph(*nnet_, &graph);
+    if (graph[affine_node_index].size() != 1 ||
+        graph[affine_node_index][0] != relu_node_index - 1 ||
+        graph[relu_node_index].size() != 1 ||
+        graph[relu_node_index][0] != node_index)
+      return false;
+
+    std::string affine_name = nnet_->GetComponentName(affine_component_index),
+        bn_name = nnet_->GetComponentName(bn_component_index),
+        new_affine_name = affine_name + "." + bn_name,
+        fused_name = affine_name + "." +
+        nnet_->GetComponentName(relu_component_index) + "." + bn_name;
+
+    CuVector<BaseFloat> bias(dim);  // the scaled bias, zero if none.
+    int32 new_affine_index = nnet_->GetComponentIndex(new_affine_name);
+    {
+      const AffineComponent *affine =
+          dynamic_cast<const AffineComponent*>(affine_component);
+      const LinearComponent *linear =
+          dynamic_cast<const LinearComponent*>(affine_component);
+      const TdnnComponent *tdnn =
+          dynamic_cast<const TdnnComponent*>(affine_component);
+      const SparseAffineComponent *sparse =
+          dynamic_cast<const SparseAffineComponent*>(affine_component);
+      Component *new_component = NULL;
+      if (affine != NULL) {
+        // AffineComponent or NaturalGradientAffineComponent; the result is a
+        // LinearComponent since there is no bias.
+        bias.CopyFromVec(affine->BiasParams());
+        if (new_affine_index < 0) {
+          CuMatrix<BaseFloat> params(affine->LinearParams());
+          params.MulRowsVec(scale);
+          new_component = new LinearComponent(params);
+        }
+      } else if (linear != NULL) {
+        if (new_affine_index < 0) {
+          LinearComponent *new_linear =
+              dynamic_cast<LinearComponent*>(linear->Copy());
+          new_linear->Params().MulRowsVec(scale);
+          new_component = new_linear;
+        }
+      } else if (tdnn != NULL) {
+        if (tdnn->BiasParams().Dim() != 0)
+          bias.CopyFromVec(tdnn->BiasParams());
+        if (new_affine_index < 0) {
+          TdnnComponent *new_tdnn =
+              dynamic_cast<TdnnComponent*>(tdnn->Copy());
+          new_tdnn->LinearParams().MulRowsVec(scale);
+          new_tdnn->BiasParams().Resize(0);
+          new_component = new_tdnn;
+        }
+      } else if (sparse != NULL) {
+        bias.CopyFromVec(sparse->BiasParams());
+        if (new_affine_index < 0) {
+          SparseAffineComponent *new_sparse =
+              dynamic_cast<SparseAffineComponent*>(sparse->Copy());
+          new_sparse->MulRowsVec(scale);
+          new_sparse->BiasParams().SetZero();
+          new_component = new_sparse;
+        }
+      } else {
+        return false;
+      }
+      if (new_affine_index < 0)
+        new_affine_index = nnet_->AddComponent(new_affine_name, new_component);
+    }
+    bias.MulElements(scale);
+
+    int32 fused_index = nnet_->GetComponentIndex(fused_name);
+    if (fused_index < 0) {
+      BiasReluOffsetComponent *fused = new BiasReluOffsetComponent();
+      fused->Init(bias, offset);
+      fused_index = nnet_->AddComponent(fused_name, fused);
+    }
+
+    nnet_->GetNode(affine_node_index).u.component_index = new_affine_index;
+    nnet_->GetNode(node_index + 1).u.component_index = fused_index;
+    Descriptor &descriptor = nnet_->GetNode(node_index).descriptor;
+    descriptor = ReplaceNodeInDescriptor(
+        descriptor, relu_node_index,
+        nnet_->GetNode(relu_node_index - 1).descriptor);
+    return true;
+  }
+
   /**
      Tries to produce a component that's equivalent to running the component
      'component_index2' with input given by 'component_index1'.  This handles
@@ -1903,12 +2308,15 @@ class ModelCollapser {
     const AffineComponent *affine_component1 =
         dynamic_cast<const AffineComponent*>(
             nnet_->GetComponent(component_index1));
+    const SparseAffineComponent *sparse_component1 =
+        dynamic_cast<const SparseAffineComponent*>(
+            nnet_->GetComponent(component_index1));
     const FixedScaleComponent *fixed_scale_component2 =
         dynamic_cast<const FixedScaleComponent*>(
                     nnet_->GetComponent(component_index2));
-    if (affine_component1 == NULL ||
+    if ((affine_component1 == NULL && sparse_component1 == NULL) ||
         fixed_scale_component2 == NULL ||
-        affine_component1->OutputDim() !=
+        nnet_->GetComponent(component_index1)->OutputDim() !=
         fixed_scale_component2->InputDim())
       return -1;
 
@@ -1920,9 +2328,17 @@ class ModelCollapser {
     if (new_component_index >= 0)
       return new_component_index;  // we previously created this.
 
+    const CuVector<BaseFloat> &scales = fixed_scale_component2->Scales();
+    if (sparse_component1 != NULL) {
+      SparseAffineComponent *new_sparse_component =
+          dynamic_cast<SparseAffineComponent*>(sparse_component1->Copy());
+      new_sparse_component->MulRowsVec(scales);
+      new_sparse_component->BiasParams().MulElements(scales);
+      return nnet_->AddComponent(new_component_name, new_sparse_component);
+    }
+
     CuMatrix<BaseFloat> linear_params(affine_component1->LinearParams());
     CuVector<BaseFloat> bias_params(affine_component1->BiasParams());
-    const CuVector<BaseFloat> &scales = fixed_scale_component2->Scales();
 
     bias_params.MulElements(scales);
     linear_params.MulRowsVec(scales);
@@ -1935,6 +2351,41 @@ class ModelCollapser {
   }
 
 
+  /**
+     Tries to produce a component that's equivalent to running the component
+     'component_index2' with input given by 'component_index1'.  This handles
+     the case where 'component_index1' is of type FixedScaleComponent or
+     FixedBiasComponent and 'component_index2' is of a type supported by
+     GetDiagonallyPreModifiedComponentIndex() (affine, linear or TDNN).
+
+     Returns -1 if this code can't produce a combined component.
+   */
+  int32 CollapseComponentsFixedPre(int32 component_index1,
+                                   int32 component_index2) {
+    const Component *component1 = nnet_->GetComponent(component_index1);
+    const FixedScaleComponent *fixed_scale_component1 =
+        dynamic_cast<const FixedScaleComponent*>(component1);
+    const FixedBiasComponent *fixed_bias_component1 =
+        dynamic_cast<const FixedBiasComponent*>(component1);
+    if (fixed_scale_component1 == NULL && fixed_bias_component1 == NULL)
+      return -1;
+    int32 dim = component1->OutputDim();
+    if (dim == 0 ||
+        nnet_->GetComponent(component_index2)->InputDim() % dim != 0)
+      return -1;
+    CuVector<BaseFloat> offset(dim), scale(dim);
+    if (fixed_scale_component1 != NULL) {
+      scale.CopyFromVec(fixed_scale_component1->Scales());
+    } else {
+      offset.CopyFromVec(fixed_bias_component1->Bias());
+      scale.Set(1.0);
+    }
+    return GetDiagonallyPreModifiedComponentIndex(
+        offset, scale, nnet_->GetComponentName(component_index1),
+        component_index2);
+  }
+
+
   /**
      This function finds, or creates, a component which is like
      'component_index' but is combined with a diagonal offset-and-scale
@@ -1996,6 +2447,8 @@ class ModelCollapser {
         dynamic_cast<const LinearComponent*>(component);
     const TdnnComponent *tdnn_component =
         dynamic_cast<const TdnnComponent*>(component);
+    const SparseAffineComponent *sparse_component =
+        dynamic_cast<const SparseAffineComponent*>(component);
 
     Component *new_component = NULL;
     if (affine_component != NULL) {
@@ -2028,6 +2481,19 @@ class ModelCollapser {
                                   &(new_tdnn_component->BiasParams()),
                                   &(new_tdnn_component->LinearParams()));
 
+    } else if (sparse_component != NULL) {
+      int32 input_dim = sparse_component->InputDim(),
+          transform_dim = offset.Dim();
+      KALDI_ASSERT(input_dim % transform_dim == 0);
+      CuVector<BaseFloat> full_offset(input_dim), full_scale(input_dim);
+      for (int32 d = 0; d < input_dim; d += transform_dim) {
+        full_offset.Range(d, transform_dim).CopyFromVec(offset);
+        full_scale.Range(d, transform_dim).CopyFromVec(scale);
+      }
+      SparseAffineComponent *new_sparse_component =
+          dynamic_cast<SparseAffineComponent*>(sparse_component->Copy());
+      new_sparse_component->PreMultiply(full_offset, full_scale);
+      new_component = new_sparse_component;
     } else {
       return -1;  // we can't do this: this component isn't of the right type.
     }
@@ -2107,9 +2573,12 @@ class ModelCollapser {
         dynamic_cast<const LinearComponent*>(current_component);
     const TdnnComponent *tdnn_component =
         dynamic_cast<const TdnnComponent*>(current_component);
+    const SparseAffineComponent *sparse_component =
+        dynamic_cast<const SparseAffineComponent*>(current_component);
 
     if (affine_component == NULL && conv_component == NULL &&
-        linear_component == NULL && tdnn_component == NULL) {
+        linear_component == NULL && tdnn_component == NULL &&
+        sparse_component == NULL) {
       // We can't scale this component (at least, not using this code).
       return -1;
     }
@@ -2125,9 +2594,12 @@ class ModelCollapser {
           ScaleLinearParams(scale);
     } else if (linear_component != NULL) {
       dynamic_cast<LinearComponent*>(new_component)->Params().Scale(scale);
-    } else {
-      KALDI_ASSERT(tdnn_component != NULL);
+    } else if (tdnn_component != NULL) {
       dynamic_cast<TdnnComponent*>(new_component)->LinearParams().Scale(scale);
+    } else {
+      KALDI_ASSERT(sparse_component != NULL);
+      dynamic_cast<SparseAffineComponent*>(new_component)->
+          ScaleLinearParams(scale);
     }
     return nnet_->AddComponent(new_component_name, new_component);
   }
@@ -2143,6 +2615,54 @@ void CollapseModel(const CollapseModelConfig &config,
   c.Collapse();
 }
 
+double ComponentFlopsPerFrame(const Component &component) {
+  const TimeHeightConvolutionComponent *conv_component =
+      dynamic_cast<const TimeHeightConvolutionComponent*>(&component);
+  const FixedAffineComponent *fixed_affine_component =
+      dynamic_cast<const FixedAffineComponent*>(&component);
+  const SparseAffineComponent *sparse_component =
+      dynamic_cast<const SparseAffineComponent*>(&component);
+  if (conv_component != NULL) {
+    // the parameters are shared across output heights.
+    return 2.0 * conv_component->NumParameters() *
+        conv_component->Model().height_out;
+  } else if (fixed_affine_component != NULL) {
+    return 2.0 * fixed_affine_component->LinearParams().NumRows() *
+        (fixed_affine_component->LinearParams().NumCols() + 1);
+  } else if (sparse_component != NULL) {
+    return 2.0 * (sparse_component->NumNonzero() +
+                  sparse_component->OutputDim());
+  } else if (component.Properties() & kUpdatableComponent) {
+    const UpdatableComponent *uc =
+        dynamic_cast<const UpdatableComponent*>(&component);
+    KALDI_ASSERT(uc != NULL);
+    return 2.0 * uc->NumParameters();
+  } else {
+    return component.OutputDim();
+  }
+}
+
+double NnetFlopsPerFrame(const Nnet &nnet) {
+  double ans = 0.0;
+  for (int32 n = 0; n < nnet.NumNodes(); n++) {
+    if (nnet.IsComponentNode(n)) {
+      int32 c = nnet.GetNode(n).u.component_index;
+      ans += ComponentFlopsPerFrame(*(nnet.GetComponent(c)));
+    }
+  }
+  return ans;
+}
+
+int64 NnetComponentBytes(const Nnet &nnet) {
+  int64 ans = 0;
+  for (int32 c = 0; c < nnet.NumComponents(); c++) {
+    std::ostringstream os;
+    nnet.GetComponent(c)->Write(os, true);
+    ans += os.str().size();
+  }
+  return ans;
+}
+
 bool UpdateNnetWithMaxChange(const Nnet &delta_nnet,
                              BaseFloat max_param_change,
                              BaseFloat max_change_scale,
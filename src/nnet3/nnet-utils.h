@@ -28,6 +28,7 @@
 #include "nnet3/nnet-descriptor.h"
 #include "nnet3/nnet-computation.h"
 #include "nnet3/nnet-example.h"
+#include "nnet3/quantization.h"
 
 namespace kaldi {
 namespace nnet3 {
@@ -164,6 +165,44 @@ void FreezeNaturalGradient(bool freeze, Nnet *nnet);
 /// NaturalGradientRepeatedAffineComponent to BlockAffineComponent in nnet.
 void ConvertRepeatedToBlockAffine(Nnet *nnet);
 
+/// Converts all components of type AffineComponent,
+/// NaturalGradientAffineComponent, LinearComponent and TdnnComponent in the
+/// nnet to QuantizedAffineComponent, which stores its parameters as 8-bit
+/// integers and can only be used for inference.  The input Descriptors of
+/// TdnnComponents with time offsets other than zero are rewritten to append
+/// the offsets, e.g. 'foo' becomes 'Append(Offset(foo, -1), foo)', since
+/// QuantizedAffineComponent is a simple component.  This should be done after
+/// CollapseModel().  Returns the number of components converted.
+int32 ConvertToQuantized(Nnet *nnet);
+
+/// Converts the same components as ConvertToQuantized() (and rewrites the
+/// TdnnComponent inputs in the same way) to HalfPrecisionAffineComponent,
+/// which stores its linear parameters as 16-bit floating point of type
+/// 'type', halving the memory and disk space they take; the result can only
+/// be used for inference.  Returns the number of components converted.
+int32 ConvertToHalfPrecision(quantization::HalfPrecisionType type,
+                             Nnet *nnet);
+
+/// Converts the same components as ConvertToQuantized() (and rewrites the
+/// TdnnComponent inputs in the same way) to MappedAffineComponent, whose
+/// parameters can be used in place from a memory-mapped model file; see
+/// WriteMappedAmNnet() in am-nnet-mapped.h, which calls this.  Returns the
+/// number of components converted.
+int32 ConvertToMappedAffine(Nnet *nnet);
+
+/// Converts those of the same components as ConvertToQuantized() whose linear
+/// parameters are mostly zero (e.g. because the model was pruned) to
+/// SparseAffineComponent, which stores only the nonzero parameters and on CPU
+/// takes time proportional to their number.  Parameters whose absolute value
+/// is <= 'threshold' count as zero (and are dropped), and a component is
+/// converted only if the proportion of such parameters is at least
+/// 'min_sparsity'; below about 0.5 the dense BLAS product is usually faster.
+/// The inputs of the TdnnComponents that are converted are rewritten as in
+/// ConvertToQuantized().  The result can only be used for inference.  Returns
+/// the number of components converted.
+int32 ConvertToSparse(BaseFloat threshold, BaseFloat min_sparsity,
+                      Nnet *nnet);
+
 /// This function returns various info about the neural net.
 /// If the nnet satisfied IsSimpleNnet(nnet), the info includes "left-context=5\nright-context=3\n...".  The info includes
 /// the output of nnet.Info().
@@ -241,11 +280,36 @@ struct CollapseModelConfig {
   bool collapse_dropout;  // dropout then affine/conv.
   bool collapse_batchnorm;  // batchnorm then affine.
   bool collapse_affine;  // affine or fixed-affine then affine.
-  bool collapse_scale;  // affine then fixed-scale.
+  bool collapse_scale;  // affine then fixed-scale, or fixed-scale or
+                        // fixed-bias then affine.
+  bool collapse_relu_batchnorm;  // affine, ReLU, then test-mode batchnorm.
+  bool remove_identity;  // no-op and test-mode general-dropout components.
   CollapseModelConfig(): collapse_dropout(false),
                          collapse_batchnorm(false),
                          collapse_affine(true),
-                         collapse_scale(true) { }
+                         collapse_scale(true),
+                         collapse_relu_batchnorm(true),
+                         remove_identity(true) { }
+  void Register(OptionsItf *opts) {
+    opts->Register("collapse-dropout", &collapse_dropout, "If true, remove "
+                   "dropout components that precede affine, linear or "
+                   "convolutional components, scaling their parameters.");
+    opts->Register("collapse-batchnorm", &collapse_batchnorm, "If true, "
+                   "remove batchnorm components (which must be in test mode) "
+                   "that precede affine, linear or TDNN components.");
+    opts->Register("collapse-affine", &collapse_affine, "If true, combine "
+                   "successive affine components where this won't increase "
+                   "the computation.");
+    opts->Register("collapse-scale", &collapse_scale, "If true, combine "
+                   "fixed-scale and fixed-bias components with neighboring "
+                   "affine components.");
+    opts->Register("collapse-relu-batchnorm", &collapse_relu_batchnorm,
+                   "If true, fuse the sequence affine, ReLU, batchnorm into a "
+                   "bias-free affine component and a BiasReluOffsetComponent.");
+    opts->Register("remove-identity", &remove_identity, "If true, bypass "
+                   "NoOpComponent and test-mode GeneralDropoutComponent nodes "
+                   "whose input is a single node.");
+  }
 };
 
 /**
@@ -253,11 +317,37 @@ struct CollapseModelConfig {
    suitable to be done in test time.  For example, it tries to get
    rid of dropout, batchnorm and fixed-scale components, and to
    collapse subsequent affine components if doing so won't hurt
-   speed.
+   speed.  The sequence affine -> ReLU -> batchnorm (as in TDNN-F layers)
+   is turned into a bias-free affine followed by a single
+   BiasReluOffsetComponent, if the batchnorm is in test mode.
+   SparseAffineComponent is handled like AffineComponent in all these cases
+   except collapse-affine, since multiplying two sparse matrices would
+   generally give a dense one.
  */
 void CollapseModel(const CollapseModelConfig &config,
                    Nnet *nnet);
 
+/**
+   Returns a rough estimate of the number of floating-point operations
+   (counting a multiply-add as two) needed to compute one frame of every
+   component node in the network.  It ignores frame subsampling and the
+   cost of Descriptors, and treats components without parameters as
+   costing one operation per output element, so it is only meant for
+   comparing versions of the same model, e.g. before and after
+   CollapseModel().
+ */
+double NnetFlopsPerFrame(const Nnet &nnet);
+
+/// Returns the approximate number of floating-point operations per frame for
+/// one instance of 'component', as used by NnetFlopsPerFrame() (see its
+/// documentation for the caveats).
+double ComponentFlopsPerFrame(const Component &component);
+
+/// Returns the memory used by the components of the nnet, in bytes, measured
+/// as the size of their binary representation (this includes things like
+/// batchnorm statistics and natural-gradient state as well as parameters).
+int64 NnetComponentBytes(const Nnet &nnet);
+
 /**
    ReadEditConfig() reads a file with a similar-looking format to the config file
    read by Nnet::ReadConfig(), but this consists of a sequence of operations to
@@ -0,0 +1,270 @@
+// nnet3/quantization-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nnet3/quantization.h"
+#include "nnet3/nnet-simple-component.h"
+#include "nnet3/nnet-test-utils.h"
+#include "util/common-utils.h"
+#include "base/timer.h"
+
+namespace kaldi {
+namespace nnet3 {
+namespace quantization {
+
+
+// Checks that all the supported kernels give the same result as a simple
+// implementation.
+void UnitTestQuantizedMatMul() {
+  int32 num_a_rows = RandInt(1, 20), num_b_rows = RandInt(1, 20),
+      stride = kQuantizedColumnAlignment * RandInt(1, 5);
+  std::vector<uint8> a(num_a_rows * stride);
+  std::vector<int8> b(num_b_rows * stride);
+  for (size_t i = 0; i < a.size(); i++)
+    a[i] = static_cast<uint8>(RandInt(0, 255));
+  for (size_t i = 0; i < b.size(); i++)
+    b[i] = static_cast<int8>(RandInt(-127, 127));
+  std::vector<int32> c_ref(num_a_rows * num_b_rows);
+  for (int32 i = 0; i < num_a_rows; i++) {
+    for (int32 j = 0; j < num_b_rows; j++) {
+      int32 sum = 0;
+      for (int32 k = 0; k < stride; k++)
+        sum += a[i * stride + k] * b[j * stride + k];
+      c_ref[i * num_b_rows + j] = sum;
+    }
+  }
+  for (int32 t = kGenericKernel; t <= kVnniKernel; t++) {
+    KernelType type = static_cast<KernelType>(t);
+    if (!KernelTypeSupported(type))
+      continue;
+    std::vector<int32> c(num_a_rows * num_b_rows);
+    QuantizedMatMul(type, &(a[0]), num_a_rows, &(b[0]), num_b_rows,
+                    stride, &(c[0]));
+    KALDI_ASSERT(c == c_ref);
+  }
+}
+
+void UnitTestQuantize() {
+  int32 num_rows = RandInt(1, 20), num_cols = RandInt(1, 100),
+      stride = QuantizedStride(num_cols);
+  Matrix<BaseFloat> m(num_rows, num_cols);
+  m.SetRandn();
+  if (RandInt(0, 1) == 0)
+    m.ApplyFloor(0.0);  // e.g. ReLU outputs.
+  if (RandInt(0, 3) == 0)
+    m.Row(0).SetZero();
+
+  std::vector<int8> weights;
+  Vector<BaseFloat> weight_scales;
+  std::vector<int32> row_sums;
+  QuantizeWeights(m, &weights, &weight_scales, &row_sums);
+  KALDI_ASSERT(weights.size() == static_cast<size_t>(num_rows * stride));
+
+  std::vector<uint8> input(num_rows * stride);
+  std::vector<BaseFloat> input_scales(num_rows);
+  std::vector<int32> zero_points(num_rows);
+  QuantizeInput(m, stride, &(input[0]), &(input_scales[0]),
+                &(zero_points[0]));
+
+  for (int32 i = 0; i < num_rows; i++) {
+    int32 sum = 0;
+    for (int32 j = 0; j < stride; j++) {
+      sum += weights[i * stride + j];
+      if (j >= num_cols) {
+        KALDI_ASSERT(weights[i * stride + j] == 0 &&
+                     input[i * stride + j] == zero_points[i]);
+        continue;
+      }
+      // rounding error is at most half a quantization step.
+      BaseFloat x = m(i, j),
+          w = weight_scales(i) * weights[i * stride + j],
+          y = input_scales[i] * (input[i * stride + j] - zero_points[i]);
+      KALDI_ASSERT(std::abs(x - w) <= 0.501 * weight_scales(i) &&
+                   std::abs(x - y) <= 0.501 * input_scales[i]);
+      if (x == 0.0)
+        KALDI_ASSERT(w == 0.0 && y == 0.0);
+    }
+    KALDI_ASSERT(sum == row_sums[i]);
+  }
+}
+
+// Compares QuantizedAffineComponent with the unquantized affine transform,
+// and checks I/O.
+void UnitTestQuantizedAffineComponent() {
+  int32 input_dim = RandInt(1, 300), output_dim = RandInt(1, 100);
+  CuMatrix<BaseFloat> linear_params(output_dim, input_dim);
+  CuVector<BaseFloat> bias_params(output_dim);
+  linear_params.SetRandn();
+  bias_params.SetRandn();
+  QuantizedAffineComponent component;
+  component.Init(linear_params, bias_params);
+  // The relative error of each product is at most about 1/127 + 1/255, and
+  // the errors are independent, so this is very conservative.
+  TestInferenceAffineComponent(component, linear_params, bias_params, 0.05);
+}
+
+// Checks the 16-bit floating point conversions against a direct computation
+// of the value that each bit pattern represents.
+void UnitTestHalfPrecision() {
+  for (int32 i = 0; i < 1 << 16; i++) {
+    uint16 h = static_cast<uint16>(i);
+    BaseFloat f;
+    ConvertFromHalfPrecision(kFloat16, &h, 1, &f);
+    int32 sign = (i >> 15 ? -1 : 1), exponent = (i >> 10) & 0x1f,
+        mantissa = i & 0x3ff;
+    if (exponent == 31) {
+      KALDI_ASSERT(mantissa == 0 ? f == sign * HUGE_VAL : f != f);
+      continue;
+    }
+    double ref = (exponent == 0 ? std::ldexp(mantissa, -24) :
+                  std::ldexp(1024 + mantissa, exponent - 25));
+    KALDI_ASSERT(f == sign * ref && std::signbit(f) == (sign < 0));
+    // All the values must survive a round trip.
+    uint16 h2;
+    ConvertToHalfPrecision(kFloat16, &f, 1, &h2);
+    KALDI_ASSERT(h2 == h);
+  }
+
+  int32 dim = RandInt(1, 100);
+  Vector<BaseFloat> v(dim), v2(dim);
+  v.SetRandn();
+  // Cover a large range of magnitudes, including fp16 subnormals.
+  for (int32 i = 0; i < dim; i++)
+    v(i) *= std::pow(2.0, RandInt(-20, 10));
+  std::vector<uint16> h(dim);
+  for (int32 t = kFloat16; t <= kBfloat16; t++) {
+    HalfPrecisionType type = static_cast<HalfPrecisionType>(t);
+    KALDI_ASSERT(HalfPrecisionTypeFromString(
+        HalfPrecisionTypeToString(type)) == type);
+    ConvertToHalfPrecision(type, v.Data(), dim, &(h[0]));
+    ConvertFromHalfPrecision(type, &(h[0]), dim, v2.Data());
+    // the rounding error is at most half a unit in the last place, i.e.
+    // 2^-11 relative for fp16 (8 bits of mantissa for bf16), or half of the
+    // smallest subnormal, 2^-25.
+    BaseFloat relative_tolerance = (type == kFloat16 ? 1.0 / 2048 : 1.0 / 256),
+        absolute_tolerance = (type == kFloat16 ? std::ldexp(1.0, -25) : 0.0);
+    for (int32 i = 0; i < dim; i++)
+      KALDI_ASSERT(std::abs(v(i) - v2(i)) <=
+                   std::max(relative_tolerance * std::abs(v(i)),
+                            absolute_tolerance));
+  }
+  // Overflow to infinity for fp16.
+  BaseFloat big[3] = { 65504.0, 65519.0, -65520.0 };
+  uint16 big_h[3];
+  ConvertToHalfPrecision(kFloat16, big, 3, big_h);
+  KALDI_ASSERT(big_h[0] == 0x7bff && big_h[1] == 0x7bff &&
+               big_h[2] == 0xfc00);
+}
+
+// Compares HalfPrecisionAffineComponent with the float affine transform,
+// and checks I/O.
+void UnitTestHalfPrecisionAffineComponent() {
+  int32 input_dim = RandInt(1, 1000), output_dim = RandInt(1, 300);
+  CuMatrix<BaseFloat> linear_params(output_dim, input_dim);
+  CuVector<BaseFloat> bias_params(output_dim);
+  linear_params.SetRandn();
+  bias_params.SetRandn();
+  HalfPrecisionType type = (RandInt(0, 1) == 0 ? kFloat16 : kBfloat16);
+  HalfPrecisionAffineComponent component;
+  component.Init(type, linear_params, bias_params);
+  Component *component_read;
+  TestInferenceAffineComponent(component, linear_params, bias_params,
+                               (type == kFloat16 ? 0.001 : 0.01),
+                               &component_read);
+  KALDI_ASSERT(dynamic_cast<HalfPrecisionAffineComponent*>(
+      component_read)->PrecisionType() == type);
+  delete component_read;
+}
+
+// Prints the speed of QuantizedAffineComponent and HalfPrecisionAffineComponent
+// compared with AffineComponent, and of each supported int8 kernel.
+void QuantizedAffineSpeedTest() {
+  int32 num_rows = 256, input_dim = 1536, output_dim = 1536;
+  Matrix<BaseFloat> linear_params(output_dim, input_dim);
+  linear_params.SetRandn();
+  CuMatrix<BaseFloat> input(num_rows, input_dim);
+  input.SetRandn();
+
+  double gflop = 2.0 * num_rows * input_dim * output_dim / 1.0e+09;
+  {
+    CuMatrix<BaseFloat> params(linear_params);
+    CuVector<BaseFloat> bias_params(output_dim);
+    AffineComponent affine_component(params, bias_params, 0.0);
+    QuantizedAffineComponent quantized_component;
+    quantized_component.Init(params, bias_params);
+    HalfPrecisionAffineComponent half_component;
+    half_component.Init(kFloat16, params, bias_params);
+    const Component *components[] = { &affine_component,
+                                      &quantized_component, &half_component };
+    for (int32 c = 0; c < 3; c++)
+      KALDI_LOG << "For " << components[c]->Type() << ", speed was "
+                << (gflop / TimeComponentPropagate(*components[c], num_rows))
+                << " giga-ops.";
+  }
+  std::vector<int8> weights;
+  Vector<BaseFloat> scales;
+  std::vector<int32> row_sums;
+  QuantizeWeights(linear_params, &weights, &scales, &row_sums);
+  int32 stride = QuantizedStride(input_dim);
+  std::vector<uint8> quantized_input(num_rows * stride);
+  std::vector<BaseFloat> input_scales(num_rows);
+  std::vector<int32> zero_points(num_rows), products(num_rows * output_dim);
+  QuantizeInput(Matrix<BaseFloat>(input), stride, &(quantized_input[0]),
+                &(input_scales[0]), &(zero_points[0]));
+  for (int32 t = kGenericKernel; t <= kVnniKernel; t++) {
+    KernelType type = static_cast<KernelType>(t);
+    if (!KernelTypeSupported(type))
+      continue;
+    Timer timer;
+    int32 iter;
+    for (iter = 0; timer.Elapsed() < 0.5; iter++)
+      QuantizedMatMul(type, &(quantized_input[0]), num_rows,
+                      &(weights[0]), output_dim, stride, &(products[0]));
+    KALDI_LOG << "For int8 matrix multiplication with kernel type " << t
+              << ", speed was " << (gflop * iter / timer.Elapsed())
+              << " giga-ops.";
+  }
+}
+
+
+}  // namespace quantization
+}  // namespace nnet3
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  using namespace kaldi::nnet3;
+  using namespace kaldi::nnet3::quantization;
+  for (int32 loop = 0; loop < 2; loop++) {
+#if HAVE_CUDA == 1
+    if (loop == 0)
+      CuDevice::Instantiate().SelectGpuId("no"); // -1 means no GPU
+    else
+      CuDevice::Instantiate().SelectGpuId("optional"); // -2 .. automatic selection
+#endif
+    for (int32 i = 0; i < 10; i++) {
+      UnitTestQuantizedMatMul();
+      UnitTestQuantize();
+      UnitTestQuantizedAffineComponent();
+      UnitTestHalfPrecision();
+      UnitTestHalfPrecisionAffineComponent();
+    }
+  }
+  QuantizedAffineSpeedTest();
+  KALDI_LOG << "Quantization tests succeeded; best kernel type is "
+            << static_cast<int32>(BestKernelType());
+  return 0;
+}
@@ -0,0 +1,410 @@
+// nnet3/quantization.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "nnet3/quantization.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KALDI_QUANTIZATION_X86 1
+#include <immintrin.h>
+// The AVX512-VNNI intrinsics need gcc >= 8 or clang >= 8.
+#if (!defined(__clang__) && __GNUC__ >= 8) || \
+    (defined(__clang__) && __clang_major__ >= 8)
+#define KALDI_QUANTIZATION_VNNI 1
+#endif
+#endif
+
+namespace kaldi {
+namespace nnet3 {
+namespace quantization {
+
+
+bool KernelTypeSupported(KernelType type) {
+  switch (type) {
+    case kGenericKernel:
+      return true;
+    case kAvx2Kernel:
+#ifdef KALDI_QUANTIZATION_X86
+      return __builtin_cpu_supports("avx2");
+#else
+      return false;
+#endif
+    case kVnniKernel:
+#ifdef KALDI_QUANTIZATION_VNNI
+      return __builtin_cpu_supports("avx512vnni") &&
+          __builtin_cpu_supports("avx512vl");
+#else
+      return false;
+#endif
+    default:
+      KALDI_ERR << "Invalid kernel type " << static_cast<int32>(type);
+      return false;  // suppress compiler warning.
+  }
+}
+
+KernelType BestKernelType() {
+  static KernelType ans = (KernelTypeSupported(kVnniKernel) ? kVnniKernel :
+                           (KernelTypeSupported(kAvx2Kernel) ? kAvx2Kernel :
+                            kGenericKernel));
+  return ans;
+}
+
+
+void QuantizeWeights(const MatrixBase<BaseFloat> &src,
+                     std::vector<int8> *dest,
+                     Vector<BaseFloat> *scales,
+                     std::vector<int32> *row_sums) {
+  int32 num_rows = src.NumRows(), num_cols = src.NumCols(),
+      stride = QuantizedStride(num_cols);
+  dest->clear();
+  dest->resize(static_cast<size_t>(num_rows) * stride, 0);
+  scales->Resize(num_rows);
+  row_sums->resize(num_rows);
+  for (int32 i = 0; i < num_rows; i++) {
+    const BaseFloat *src_row = src.RowData(i);
+    BaseFloat max_abs = 0.0;
+    for (int32 j = 0; j < num_cols; j++)
+      max_abs = std::max<BaseFloat>(max_abs, std::abs(src_row[j]));
+    BaseFloat scale = (max_abs == 0.0 ? 1.0 : max_abs / 127.0),
+        inv_scale = 1.0 / scale;
+    int8 *dest_row = &((*dest)[static_cast<size_t>(i) * stride]);
+    int32 sum = 0;
+    for (int32 j = 0; j < num_cols; j++) {
+      int32 q = static_cast<int32>(std::round(src_row[j] * inv_scale));
+      q = std::max(-127, std::min(127, q));
+      dest_row[j] = static_cast<int8>(q);
+      sum += q;
+    }
+    (*scales)(i) = scale;
+    (*row_sums)[i] = sum;
+  }
+}
+
+
+void QuantizeInput(const MatrixBase<BaseFloat> &src,
+                   int32 stride,
+                   uint8 *dest,
+                   BaseFloat *scales,
+                   int32 *zero_points) {
+  int32 num_rows = src.NumRows(), num_cols = src.NumCols();
+  KALDI_ASSERT(stride >= num_cols);
+  for (int32 i = 0; i < num_rows; i++) {
+    const BaseFloat *src_row = src.RowData(i);
+    BaseFloat min = 0.0, max = 0.0;
+    for (int32 j = 0; j < num_cols; j++) {
+      min = std::min(min, src_row[j]);
+      max = std::max(max, src_row[j]);
+    }
+    BaseFloat scale = (max == min ? 1.0 : (max - min) / 255.0),
+        inv_scale = 1.0 / scale;
+    int32 zero_point = static_cast<int32>(std::round(-min * inv_scale));
+    zero_point = std::max(0, std::min(255, zero_point));
+    uint8 *dest_row = dest + static_cast<size_t>(i) * stride;
+    for (int32 j = 0; j < num_cols; j++) {
+      int32 q = static_cast<int32>(std::round(src_row[j] * inv_scale)) +
+          zero_point;
+      dest_row[j] = static_cast<uint8>(std::max(0, std::min(255, q)));
+    }
+    for (int32 j = num_cols; j < stride; j++)
+      dest_row[j] = static_cast<uint8>(zero_point);
+    scales[i] = scale;
+    zero_points[i] = zero_point;
+  }
+}
+
+
+static void QuantizedMatMulGeneric(const uint8 *a, int32 num_a_rows,
+                                   const int8 *b, int32 num_b_rows,
+                                   int32 stride, int32 *c) {
+  for (int32 i = 0; i < num_a_rows; i++) {
+    const uint8 *a_row = a + static_cast<size_t>(i) * stride;
+    for (int32 j = 0; j < num_b_rows; j++) {
+      const int8 *b_row = b + static_cast<size_t>(j) * stride;
+      int32 sum = 0;
+      for (int32 k = 0; k < stride; k++)
+        sum += static_cast<int32>(a_row[k]) * static_cast<int32>(b_row[k]);
+      c[static_cast<size_t>(i) * num_b_rows + j] = sum;
+    }
+  }
+}
+
+
+#ifdef KALDI_QUANTIZATION_X86
+
+__attribute__((target("avx2")))
+static inline int32 HorizontalSum(__m256i v) {
+  __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v),
+                            _mm256_extracti128_si256(v, 1));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(s);
+}
+
+// Each 16 elements of a row of 'a' are widened to 16 bits once and used for
+// four rows of 'b'; _mm256_madd_epi16 multiplies and adds adjacent pairs into
+// 32 bits, which cannot overflow since |a * b| <= 255 * 128.
+// GCC inserts vzeroupper on return from functions like this only at -O2 and
+// above (and Kaldi is built with -O1 by default), so we clear the upper halves
+// of the ymm registers ourselves; otherwise the non-VEX SSE code that runs
+// afterwards is slowed down by the dirty upper state.
+__attribute__((target("avx2")))
+static void QuantizedMatMulAvx2(const uint8 *a, int32 num_a_rows,
+                                const int8 *b, int32 num_b_rows,
+                                int32 stride, int32 *c) {
+  for (int32 i = 0; i < num_a_rows; i++) {
+    const uint8 *a_row = a + static_cast<size_t>(i) * stride;
+    int32 *c_row = c + static_cast<size_t>(i) * num_b_rows;
+    int32 j = 0;
+    for (; j + 4 <= num_b_rows; j += 4) {
+      const int8 *b0 = b + static_cast<size_t>(j) * stride,
+          *b1 = b0 + stride, *b2 = b1 + stride, *b3 = b2 + stride;
+      __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256(),
+          acc2 = _mm256_setzero_si256(), acc3 = _mm256_setzero_si256();
+      for (int32 k = 0; k < stride; k += 16) {
+        __m256i av = _mm256_cvtepu8_epi16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(a_row + k)));
+        acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(av, _mm256_cvtepi8_epi16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(b0 + k)))));
+        acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(av, _mm256_cvtepi8_epi16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(b1 + k)))));
+        acc2 = _mm256_add_epi32(acc2, _mm256_madd_epi16(av, _mm256_cvtepi8_epi16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(b2 + k)))));
+        acc3 = _mm256_add_epi32(acc3, _mm256_madd_epi16(av, _mm256_cvtepi8_epi16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(b3 + k)))));
+      }
+      c_row[j] = HorizontalSum(acc0);
+      c_row[j + 1] = HorizontalSum(acc1);
+      c_row[j + 2] = HorizontalSum(acc2);
+      c_row[j + 3] = HorizontalSum(acc3);
+    }
+    for (; j < num_b_rows; j++) {
+      const int8 *b0 = b + static_cast<size_t>(j) * stride;
+      __m256i acc0 = _mm256_setzero_si256();
+      for (int32 k = 0; k < stride; k += 16) {
+        __m256i av = _mm256_cvtepu8_epi16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(a_row + k)));
+        acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(av, _mm256_cvtepi8_epi16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(b0 + k)))));
+      }
+      c_row[j] = HorizontalSum(acc0);
+    }
+  }
+  _mm256_zeroupper();
+}
+
+#endif  // KALDI_QUANTIZATION_X86
+
+
+#ifdef KALDI_QUANTIZATION_VNNI
+
+// _mm256_dpbusd_epi32 multiplies groups of four unsigned bytes of 'a' with
+// the corresponding signed bytes of 'b' and adds them to 32-bit accumulators,
+// without saturation.
+__attribute__((target("avx2,avx512vnni,avx512vl")))
+static void QuantizedMatMulVnni(const uint8 *a, int32 num_a_rows,
+                                const int8 *b, int32 num_b_rows,
+                                int32 stride, int32 *c) {
+  for (int32 i = 0; i < num_a_rows; i++) {
+    const uint8 *a_row = a + static_cast<size_t>(i) * stride;
+    int32 *c_row = c + static_cast<size_t>(i) * num_b_rows;
+    int32 j = 0;
+    for (; j + 4 <= num_b_rows; j += 4) {
+      const int8 *b0 = b + static_cast<size_t>(j) * stride,
+          *b1 = b0 + stride, *b2 = b1 + stride, *b3 = b2 + stride;
+      __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256(),
+          acc2 = _mm256_setzero_si256(), acc3 = _mm256_setzero_si256();
+      for (int32 k = 0; k < stride; k += 32) {
+        __m256i av = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(a_row + k));
+        acc0 = _mm256_dpbusd_epi32(acc0, av, _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(b0 + k)));
+        acc1 = _mm256_dpbusd_epi32(acc1, av, _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(b1 + k)));
+        acc2 = _mm256_dpbusd_epi32(acc2, av, _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(b2 + k)));
+        acc3 = _mm256_dpbusd_epi32(acc3, av, _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(b3 + k)));
+      }
+      c_row[j] = HorizontalSum(acc0);
+      c_row[j + 1] = HorizontalSum(acc1);
+      c_row[j + 2] = HorizontalSum(acc2);
+      c_row[j + 3] = HorizontalSum(acc3);
+    }
+    for (; j < num_b_rows; j++) {
+      const int8 *b0 = b + static_cast<size_t>(j) * stride;
+      __m256i acc0 = _mm256_setzero_si256();
+      for (int32 k = 0; k < stride; k += 32)
+        acc0 = _mm256_dpbusd_epi32(
+            acc0,
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a_row + k)),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b0 + k)));
+      c_row[j] = HorizontalSum(acc0);
+    }
+  }
+  _mm256_zeroupper();  // see QuantizedMatMulAvx2().
+}
+
+#endif  // KALDI_QUANTIZATION_VNNI
+
+
+void QuantizedMatMul(KernelType type,
+                     const uint8 *a, int32 num_a_rows,
+                     const int8 *b, int32 num_b_rows,
+                     int32 stride, int32 *c) {
+  KALDI_ASSERT(stride % kQuantizedColumnAlignment == 0 &&
+               KernelTypeSupported(type));
+  switch (type) {
+#ifdef KALDI_QUANTIZATION_VNNI
+    case kVnniKernel:
+      QuantizedMatMulVnni(a, num_a_rows, b, num_b_rows, stride, c);
+      return;
+#endif
+#ifdef KALDI_QUANTIZATION_X86
+    case kAvx2Kernel:
+      QuantizedMatMulAvx2(a, num_a_rows, b, num_b_rows, stride, c);
+      return;
+#endif
+    default:
+      QuantizedMatMulGeneric(a, num_a_rows, b, num_b_rows, stride, c);
+  }
+}
+
+
+HalfPrecisionType HalfPrecisionTypeFromString(const std::string &str) {
+  if (str == "fp16")
+    return kFloat16;
+  else if (str == "bf16")
+    return kBfloat16;
+  KALDI_ERR << "Invalid half-precision type '" << str
+            << "', expected fp16 or bf16";
+  return kFloat16;  // suppress compiler warning.
+}
+
+std::string HalfPrecisionTypeToString(HalfPrecisionType type) {
+  switch (type) {
+    case kFloat16: return "fp16";
+    case kBfloat16: return "bf16";
+    default:
+      KALDI_ERR << "Invalid half-precision type " << static_cast<int32>(type);
+      return "";  // suppress compiler warning.
+  }
+}
+
+static inline uint32 FloatBits(float f) {
+  uint32 ans;
+  memcpy(&ans, &f, sizeof(ans));
+  return ans;
+}
+
+static inline float BitsToFloat(uint32 bits) {
+  float ans;
+  memcpy(&ans, &bits, sizeof(ans));
+  return ans;
+}
+
+static inline uint16 FloatToFloat16(float f) {
+  uint32 bits = FloatBits(f), sign = (bits >> 16) & 0x8000,
+      abs_bits = bits & 0x7fffffff;
+  if (abs_bits >= 0x7f800000)  // infinity or NaN.
+    return sign | 0x7c00 | (abs_bits > 0x7f800000 ? 0x200 : 0);
+  if (abs_bits >= 0x477ff000)  // rounds to more than 65504, the largest value.
+    return sign | 0x7c00;
+  if (abs_bits < 0x38800000) {
+    // The result is subnormal (or zero).  Adding 0.5 leaves the value
+    // rounded to a multiple of 2^-24 in the low mantissa bits.
+    float rounded = BitsToFloat(abs_bits) + 0.5f;
+    return sign | (FloatBits(rounded) - 0x3f000000);
+  }
+  // Normal: re-bias the exponent from 127 to 15 and round the mantissa to
+  // nearest, ties to even.
+  uint32 mantissa_odd = (abs_bits >> 13) & 1;
+  abs_bits += 0xc8000fff + mantissa_odd;
+  return sign | (abs_bits >> 13);
+}
+
+static inline float Float16ToFloat(uint16 h) {
+  uint32 sign = static_cast<uint32>(h & 0x8000) << 16,
+      exponent = (h >> 10) & 0x1f, mantissa = h & 0x3ff;
+  if (exponent == 0)  // zero or subnormal.
+    return BitsToFloat(sign | FloatBits(mantissa * (1.0f / 16777216.0f)));
+  if (exponent == 31)  // infinity or NaN.
+    return BitsToFloat(sign | 0x7f800000 | (mantissa << 13));
+  return BitsToFloat(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+static inline uint16 FloatToBfloat16(float f) {
+  uint32 bits = FloatBits(f);
+  if ((bits & 0x7fffffff) > 0x7f800000)  // NaN; keep it a NaN.
+    return (bits >> 16) | 0x40;
+  bits += 0x7fff + ((bits >> 16) & 1);
+  return bits >> 16;
+}
+
+static inline float Bfloat16ToFloat(uint16 b) {
+  return BitsToFloat(static_cast<uint32>(b) << 16);
+}
+
+void ConvertToHalfPrecision(HalfPrecisionType type, const BaseFloat *src,
+                            int32 dim, uint16 *dest) {
+  if (type == kFloat16) {
+    for (int32 i = 0; i < dim; i++)
+      dest[i] = FloatToFloat16(src[i]);
+  } else {
+    KALDI_ASSERT(type == kBfloat16);
+    for (int32 i = 0; i < dim; i++)
+      dest[i] = FloatToBfloat16(src[i]);
+  }
+}
+
+#if defined(KALDI_QUANTIZATION_X86) && KALDI_DOUBLEPRECISION == 0
+__attribute__((target("avx,f16c")))
+static void Float16ToFloatF16c(const uint16 *src, int32 dim, float *dest) {
+  int32 i = 0;
+  for (; i + 8 <= dim; i += 8)
+    _mm256_storeu_ps(dest + i, _mm256_cvtph_ps(_mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(src + i))));
+  _mm256_zeroupper();  // see QuantizedMatMulAvx2().
+  for (; i < dim; i++)
+    dest[i] = Float16ToFloat(src[i]);
+}
+#endif
+
+void ConvertFromHalfPrecision(HalfPrecisionType type, const uint16 *src,
+                              int32 dim, BaseFloat *dest) {
+  if (type == kFloat16) {
+#if defined(KALDI_QUANTIZATION_X86) && KALDI_DOUBLEPRECISION == 0
+    static bool have_f16c = __builtin_cpu_supports("f16c");
+    if (have_f16c) {
+      Float16ToFloatF16c(src, dim, dest);
+      return;
+    }
+#endif
+    for (int32 i = 0; i < dim; i++)
+      dest[i] = Float16ToFloat(src[i]);
+  } else {
+    KALDI_ASSERT(type == kBfloat16);
+    for (int32 i = 0; i < dim; i++)
+      dest[i] = Bfloat16ToFloat(src[i]);
+  }
+}
+
+
+}  // namespace quantization
+}  // namespace nnet3
+}  // namespace kaldi
@@ -0,0 +1,144 @@
+// nnet3/quantization.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_NNET3_QUANTIZATION_H_
+#define KALDI_NNET3_QUANTIZATION_H_
+
+#include <string>
+#include <vector>
+#include "base/kaldi-common.h"
+#include "matrix/matrix-lib.h"
+
+namespace kaldi {
+namespace nnet3 {
+namespace quantization {
+
+/// @file  quantization.h
+///
+/// This file contains the lower-level CPU code for 8-bit quantized inference,
+/// as used by class QuantizedAffineComponent.  Weights are stored as signed
+/// 8-bit integers with one scale per row (per output dimension), and each
+/// row of the input (each frame) is quantized on the fly to unsigned 8-bit
+/// integers with its own scale and zero-point.  The products are accumulated
+/// exactly in 32-bit integers, so all the kernels below give identical
+/// results; they differ only in speed.
+///
+/// The kernel is chosen at runtime depending on what the CPU supports:
+/// AVX512-VNNI (vpdpbusd), AVX2 (vpmaddwd on values widened to 16 bits), or
+/// plain C++.
+///
+/// It also contains the conversions to and from 16-bit floating point
+/// (IEEE half precision or bfloat16) used by HalfPrecisionAffineComponent,
+/// which stores its parameters in 16 bits to halve the memory and disk
+/// space they use, and converts them back to BaseFloat block by block as
+/// they are needed.
+
+
+/// Quantized rows are stored with this alignment, i.e. the number of columns
+/// is rounded up to a multiple of it and the extra elements are zero.
+static const int32 kQuantizedColumnAlignment = 32;
+
+/// Returns 'dim' rounded up to a multiple of kQuantizedColumnAlignment.
+inline int32 QuantizedStride(int32 dim) {
+  return (dim + kQuantizedColumnAlignment - 1) /
+      kQuantizedColumnAlignment * kQuantizedColumnAlignment;
+}
+
+enum KernelType {
+  kGenericKernel = 0,
+  kAvx2Kernel = 1,
+  kVnniKernel = 2
+};
+
+/// Returns true if the kernel 'type' is compiled in and supported by this
+/// CPU.  kGenericKernel is always supported.
+bool KernelTypeSupported(KernelType type);
+
+/// Returns the fastest kernel type supported by this CPU.
+KernelType BestKernelType();
+
+
+/**
+   Quantizes the rows of 'src' to signed 8-bit integers in [-127, 127], with
+   one scale per row, so that src(i, j) is approximately
+   (*scales)(i) * (*dest)[i * QuantizedStride(src.NumCols()) + j].
+   Also outputs the sum of each quantized row in 'row_sums', which is needed
+   to correct for the zero-point of the input.
+ */
+void QuantizeWeights(const MatrixBase<BaseFloat> &src,
+                     std::vector<int8> *dest,
+                     Vector<BaseFloat> *scales,
+                     std::vector<int32> *row_sums);
+
+/**
+   Quantizes the rows of 'src' to unsigned 8-bit integers, so that src(i, j)
+   is approximately scales[i] * (dest[i * stride + j] - zero_points[i]).
+   The range of each row is extended to include zero, so zero is
+   represented exactly.  'stride' must be >= src.NumCols(); the elements
+   between src.NumCols() and 'stride' are set to zero_points[i] (i.e. zero).
+ */
+void QuantizeInput(const MatrixBase<BaseFloat> &src,
+                   int32 stride,
+                   uint8 *dest,
+                   BaseFloat *scales,
+                   int32 *zero_points);
+
+/**
+   Computes the matrix product c = a b^T in 32-bit integers, i.e.
+     c[i * num_b_rows + j] = sum_k a[i * stride + k] * b[j * stride + k]
+   for 0 <= i < num_a_rows, 0 <= j < num_b_rows, 0 <= k < stride.
+   'stride' must be a multiple of kQuantizedColumnAlignment, and 'type' must be
+   supported (see KernelTypeSupported()).
+ */
+void QuantizedMatMul(KernelType type,
+                     const uint8 *a, int32 num_a_rows,
+                     const int8 *b, int32 num_b_rows,
+                     int32 stride, int32 *c);
+
+
+
+/// The 16-bit floating point formats supported by
+/// HalfPrecisionAffineComponent.
+enum HalfPrecisionType {
+  kFloat16 = 0,   // IEEE 754 half precision: 5 exponent bits, 10 mantissa
+                  // bits.  Values above 65504 in magnitude become infinity.
+  kBfloat16 = 1   // bfloat16: the top 16 bits of a float, i.e. 8 exponent
+                  // bits and 7 mantissa bits.
+};
+
+/// Converts "fp16" or "bf16" to HalfPrecisionType; dies on other strings.
+HalfPrecisionType HalfPrecisionTypeFromString(const std::string &str);
+
+/// Converts HalfPrecisionType to "fp16" or "bf16".
+std::string HalfPrecisionTypeToString(HalfPrecisionType type);
+
+/// Converts 'dim' values to 16-bit floating point of type 'type', rounding to
+/// the nearest representable value (ties to even).
+void ConvertToHalfPrecision(HalfPrecisionType type, const BaseFloat *src,
+                            int32 dim, uint16 *dest);
+
+/// Converts 'dim' 16-bit floating point values of type 'type' back to
+/// BaseFloat; this is exact.  It uses the F16C instructions for kFloat16 if
+/// the CPU supports them.
+void ConvertFromHalfPrecision(HalfPrecisionType type, const uint16 *src,
+                              int32 dim, BaseFloat *dest);
+
+}  // namespace quantization
+}  // namespace nnet3
+}  // namespace kaldi
+
+#endif  // KALDI_NNET3_QUANTIZATION_H_
@@ -0,0 +1,169 @@
+// nnet3/sparse-affine-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nnet3/sparse-affine.h"
+#include "nnet3/nnet-simple-component.h"
+#include "nnet3/nnet-test-utils.h"
+#include "util/common-utils.h"
+
+namespace kaldi {
+namespace nnet3 {
+namespace sparse_affine {
+
+// Sets a proportion 'sparsity' of the elements of 'mat' to zero and the rest
+// to Gaussian random values.
+static void SetRandSparse(BaseFloat sparsity, MatrixBase<BaseFloat> *mat) {
+  mat->SetRandn();
+  for (int32 i = 0; i < mat->NumRows(); i++)
+    for (int32 j = 0; j < mat->NumCols(); j++)
+      if (RandUniform() < sparsity)
+        (*mat)(i, j) = 0.0;
+}
+
+// Compares SparseMatMul() with the dense product, with and without SIMD,
+// and checks the conversions to and from CSR form.
+void UnitTestSparseMatMul() {
+  int32 num_rows = RandInt(1, 100), num_cols = RandInt(1, 100),
+      num_frames = RandInt(1, 80);
+  Matrix<BaseFloat> params(num_rows, num_cols), params2(num_rows, num_cols),
+      in(num_cols, num_frames), out_ref(num_rows, num_frames),
+      out(num_rows, num_frames);
+  SetRandSparse(RandUniform(), &params);
+  in.SetRandn();
+  out_ref.AddMatMat(1.0, params, kNoTrans, in, kNoTrans, 0.0);
+
+  std::vector<int32> row_offsets, col_indexes;
+  Vector<BaseFloat> values;
+  DenseToCsr(params, 0.0, &row_offsets, &col_indexes, &values);
+  CsrToDense(row_offsets, col_indexes, values, &params2);
+  KALDI_ASSERT(params.ApproxEqual(params2, 0.0));
+  for (int32 k = 0; k < values.Dim(); k++)
+    KALDI_ASSERT(values(k) != 0.0);
+
+  for (int32 simd = 0; simd <= 1; simd++) {
+    out.Set(1.0);  // the output should be overwritten.
+    SparseMatMul(row_offsets, col_indexes, values, in, &out, simd != 0);
+    KALDI_ASSERT(out.ApproxEqual(out_ref, 1.0e-05));
+  }
+
+  // With a threshold, the small elements are dropped.
+  BaseFloat threshold = 0.5;
+  DenseToCsr(params, threshold, &row_offsets, &col_indexes, &values);
+  CsrToDense(row_offsets, col_indexes, values, &params2);
+  for (int32 i = 0; i < num_rows; i++)
+    for (int32 j = 0; j < num_cols; j++)
+      KALDI_ASSERT(params2(i, j) == (std::abs(params(i, j)) > threshold ?
+                                     params(i, j) : 0.0));
+}
+
+// Compares SparseAffineComponent with the dense affine transform, checks
+// the functions used by CollapseModel(), and checks I/O.
+void UnitTestSparseAffineComponent() {
+  int32 num_rows = RandInt(1, 50), input_dim = RandInt(1, 300),
+      output_dim = RandInt(1, 100);
+  Matrix<BaseFloat> cpu_params(output_dim, input_dim);
+  SetRandSparse(0.7, &cpu_params);
+  CuMatrix<BaseFloat> linear_params(cpu_params);
+  CuVector<BaseFloat> bias_params(output_dim);
+  bias_params.SetRandn();
+
+  SparseAffineComponent component;
+  component.Init(linear_params, bias_params);
+  Component *component_read;
+  TestInferenceAffineComponent(component, linear_params, bias_params, 1.0e-05,
+                               &component_read);
+  KALDI_ASSERT(dynamic_cast<SparseAffineComponent*>(
+      component_read)->NumNonzero() == component.NumNonzero());
+  delete component_read;
+
+  // PreMultiply() and MulRowsVec() must be equivalent to modifying the input
+  // and output.
+  CuMatrix<BaseFloat> input(num_rows, input_dim),
+      output_ref(num_rows, output_dim), output(num_rows, output_dim);
+  input.SetRandn();
+  CuVector<BaseFloat> offset(input_dim), scale(input_dim),
+      row_scale(output_dim);
+  offset.SetRandn();
+  scale.SetRandn();
+  row_scale.SetRandn();
+  CuMatrix<BaseFloat> modified_input(input);
+  modified_input.MulColsVec(scale);
+  modified_input.AddVecToRows(1.0, offset);
+  component.Propagate(NULL, modified_input, &output_ref);
+  output_ref.MulColsVec(row_scale);
+  SparseAffineComponent *modified_component =
+      dynamic_cast<SparseAffineComponent*>(component.Copy());
+  modified_component->PreMultiply(offset, scale);
+  modified_component->MulRowsVec(row_scale);
+  modified_component->BiasParams().MulElements(row_scale);
+  modified_component->Propagate(NULL, input, &output);
+  delete modified_component;
+  KALDI_ASSERT(output.ApproxEqual(output_ref, 1.0e-04));
+}
+
+// Prints the speed of SparseAffineComponent at several sparsities, compared
+// with AffineComponent.
+void SparseAffineSpeedTest() {
+  int32 num_rows = 256, input_dim = 1536, output_dim = 1536;
+  CuVector<BaseFloat> bias_params(output_dim);
+  double dense_time;
+  {
+    CuMatrix<BaseFloat> params(output_dim, input_dim);
+    params.SetRandn();
+    AffineComponent component(params, bias_params, 0.0);
+    dense_time = TimeComponentPropagate(component, num_rows);
+    KALDI_LOG << "Dense affine transform took " << (dense_time * 1000.0)
+              << " ms per " << num_rows << " frames.";
+  }
+  BaseFloat sparsities[] = { 0.5, 0.7, 0.9 };
+  for (int32 s = 0; s < 3; s++) {
+    Matrix<BaseFloat> params(output_dim, input_dim);
+    SetRandSparse(sparsities[s], &params);
+    SparseAffineComponent component;
+    component.Init(CuMatrix<BaseFloat>(params), bias_params);
+    double sparse_time = TimeComponentPropagate(component, num_rows);
+    KALDI_LOG << "With sparsity " << sparsities[s]
+              << ", SparseAffineComponent took " << (sparse_time * 1000.0)
+              << " ms, speedup vs. dense is " << (dense_time / sparse_time);
+  }
+}
+
+
+}  // namespace sparse_affine
+}  // namespace nnet3
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  using namespace kaldi::nnet3;
+  using namespace kaldi::nnet3::sparse_affine;
+  for (int32 loop = 0; loop < 2; loop++) {
+#if HAVE_CUDA == 1
+    if (loop == 0)
+      CuDevice::Instantiate().SelectGpuId("no"); // -1 means no GPU
+    else
+      CuDevice::Instantiate().SelectGpuId("optional"); // -2 .. automatic selection
+#endif
+    for (int32 i = 0; i < 10; i++) {
+      UnitTestSparseMatMul();
+      UnitTestSparseAffineComponent();
+    }
+  }
+  SparseAffineSpeedTest();
+  KALDI_LOG << "Sparse affine tests succeeded.";
+  return 0;
+}
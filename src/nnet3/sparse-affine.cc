@@ -0,0 +1,176 @@
+// nnet3/sparse-affine.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include "nnet3/sparse-affine.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    KALDI_DOUBLEPRECISION == 0
+#define KALDI_SPARSE_AFFINE_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace kaldi {
+namespace nnet3 {
+namespace sparse_affine {
+
+
+void DenseToCsr(const MatrixBase<BaseFloat> &src,
+                BaseFloat threshold,
+                std::vector<int32> *row_offsets,
+                std::vector<int32> *col_indexes,
+                Vector<BaseFloat> *values) {
+  int32 num_rows = src.NumRows(), num_cols = src.NumCols();
+  row_offsets->resize(num_rows + 1);
+  col_indexes->clear();
+  std::vector<BaseFloat> nonzeros;
+  for (int32 i = 0; i < num_rows; i++) {
+    (*row_offsets)[i] = col_indexes->size();
+    const BaseFloat *src_row = src.RowData(i);
+    for (int32 j = 0; j < num_cols; j++) {
+      if (std::abs(src_row[j]) > threshold) {
+        col_indexes->push_back(j);
+        nonzeros.push_back(src_row[j]);
+      }
+    }
+  }
+  (*row_offsets)[num_rows] = col_indexes->size();
+  values->Resize(nonzeros.size(), kUndefined);
+  if (!nonzeros.empty())
+    std::copy(nonzeros.begin(), nonzeros.end(), values->Data());
+}
+
+void CsrToDense(const std::vector<int32> &row_offsets,
+                const std::vector<int32> &col_indexes,
+                const VectorBase<BaseFloat> &values,
+                MatrixBase<BaseFloat> *dest) {
+  KALDI_ASSERT(static_cast<int32>(row_offsets.size()) == dest->NumRows() + 1);
+  dest->SetZero();
+  for (int32 i = 0; i < dest->NumRows(); i++) {
+    BaseFloat *dest_row = dest->RowData(i);
+    for (int32 k = row_offsets[i]; k < row_offsets[i + 1]; k++)
+      dest_row[col_indexes[k]] = values(k);
+  }
+}
+
+
+static void SparseMatMulGeneric(const int32 *row_offsets,
+                                const int32 *col_indexes,
+                                const BaseFloat *values,
+                                const MatrixBase<BaseFloat> &in,
+                                MatrixBase<BaseFloat> *out) {
+  int32 num_rows = out->NumRows(), num_cols = out->NumCols();
+  for (int32 i = 0; i < num_rows; i++) {
+    BaseFloat *out_row = out->RowData(i);
+    for (int32 n = 0; n < num_cols; n++)
+      out_row[n] = 0.0;
+    for (int32 k = row_offsets[i]; k < row_offsets[i + 1]; k++) {
+      const BaseFloat *in_row = in.RowData(col_indexes[k]);
+      BaseFloat value = values[k];
+      for (int32 n = 0; n < num_cols; n++)
+        out_row[n] += value * in_row[n];
+    }
+  }
+}
+
+#ifdef KALDI_SPARSE_AFFINE_AVX2
+// For each output row, this keeps 32 columns of the output in four registers
+// while it goes through the nonzero elements of the row.
+__attribute__((target("avx2,fma")))
+static void SparseMatMulAvx2(const int32 *row_offsets,
+                             const int32 *col_indexes,
+                             const float *values,
+                             const MatrixBase<float> &in,
+                             MatrixBase<float> *out) {
+  int32 num_rows = out->NumRows(), num_cols = out->NumCols(),
+      in_stride = in.Stride();
+  const float *in_data = in.Data();
+  for (int32 i = 0; i < num_rows; i++) {
+    float *out_row = out->RowData(i);
+    int32 begin = row_offsets[i], end = row_offsets[i + 1], n = 0;
+    for (; n + 32 <= num_cols; n += 32) {
+      __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps(),
+          sum2 = _mm256_setzero_ps(), sum3 = _mm256_setzero_ps();
+      for (int32 k = begin; k < end; k++) {
+        const float *in_row = in_data +
+            static_cast<size_t>(col_indexes[k]) * in_stride + n;
+        __m256 value = _mm256_broadcast_ss(values + k);
+        sum0 = _mm256_fmadd_ps(value, _mm256_loadu_ps(in_row), sum0);
+        sum1 = _mm256_fmadd_ps(value, _mm256_loadu_ps(in_row + 8), sum1);
+        sum2 = _mm256_fmadd_ps(value, _mm256_loadu_ps(in_row + 16), sum2);
+        sum3 = _mm256_fmadd_ps(value, _mm256_loadu_ps(in_row + 24), sum3);
+      }
+      _mm256_storeu_ps(out_row + n, sum0);
+      _mm256_storeu_ps(out_row + n + 8, sum1);
+      _mm256_storeu_ps(out_row + n + 16, sum2);
+      _mm256_storeu_ps(out_row + n + 24, sum3);
+    }
+    for (; n + 8 <= num_cols; n += 8) {
+      __m256 sum = _mm256_setzero_ps();
+      for (int32 k = begin; k < end; k++) {
+        const float *in_row = in_data +
+            static_cast<size_t>(col_indexes[k]) * in_stride + n;
+        sum = _mm256_fmadd_ps(_mm256_broadcast_ss(values + k),
+                              _mm256_loadu_ps(in_row), sum);
+      }
+      _mm256_storeu_ps(out_row + n, sum);
+    }
+    for (; n < num_cols; n++) {
+      float sum = 0.0;
+      for (int32 k = begin; k < end; k++)
+        sum += values[k] * in_data[static_cast<size_t>(col_indexes[k]) *
+                                   in_stride + n];
+      out_row[n] = sum;
+    }
+  }
+  // Needed because GCC only adds vzeroupper itself at -O2 and above.
+  _mm256_zeroupper();
+}
+#endif  // KALDI_SPARSE_AFFINE_AVX2
+
+
+void SparseMatMul(const std::vector<int32> &row_offsets,
+                  const std::vector<int32> &col_indexes,
+                  const VectorBase<BaseFloat> &values,
+                  const MatrixBase<BaseFloat> &in,
+                  MatrixBase<BaseFloat> *out,
+                  bool allow_simd) {
+  KALDI_ASSERT(static_cast<int32>(row_offsets.size()) == out->NumRows() + 1 &&
+               in.NumCols() == out->NumCols() &&
+               col_indexes.size() == static_cast<size_t>(values.Dim()) &&
+               row_offsets.back() == values.Dim());
+  if (out->NumRows() == 0)
+    return;
+  const int32 *col_indexes_data = (col_indexes.empty() ? NULL :
+                                   &(col_indexes[0]));
+#ifdef KALDI_SPARSE_AFFINE_AVX2
+  static bool have_avx2 = __builtin_cpu_supports("avx2") &&
+      __builtin_cpu_supports("fma");
+  if (allow_simd && have_avx2) {
+    SparseMatMulAvx2(&(row_offsets[0]), col_indexes_data, values.Data(),
+                     in, out);
+    return;
+  }
+#endif
+  SparseMatMulGeneric(&(row_offsets[0]), col_indexes_data, values.Data(),
+                      in, out);
+}
+
+
+}  // namespace sparse_affine
+}  // namespace nnet3
+}  // namespace kaldi
@@ -0,0 +1,83 @@
+// nnet3/sparse-affine.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_NNET3_SPARSE_AFFINE_H_
+#define KALDI_NNET3_SPARSE_AFFINE_H_
+
+#include <vector>
+#include "base/kaldi-common.h"
+#include "matrix/matrix-lib.h"
+
+namespace kaldi {
+namespace nnet3 {
+namespace sparse_affine {
+
+/// @file  sparse-affine.h
+///
+/// This file contains the lower-level CPU code for the sparse matrix
+/// multiplication used by SparseAffineComponent, whose linear parameters are
+/// stored in compressed sparse row (CSR) form: the nonzero elements of row i
+/// are values[k] at column col_indexes[k], for row_offsets[i] <= k <
+/// row_offsets[i+1].
+///
+/// The multiplication is done with the dense operand transposed, so that the
+/// frames are the fastest-changing index: each nonzero parameter is then
+/// multiplied by a contiguous row of the transposed input, and the output row
+/// is accumulated in registers.  This is worthwhile compared with dense BLAS
+/// when most of the parameters are zero (e.g. for models pruned to 70%
+/// sparsity or more).  There is an AVX2/FMA kernel, chosen at runtime, and a
+/// plain C++ one.
+
+
+/// Converts the dense matrix 'src' to CSR form, keeping the elements whose
+/// absolute value is greater than 'threshold' (so with threshold = 0.0, only
+/// the exact zeros are dropped).
+void DenseToCsr(const MatrixBase<BaseFloat> &src,
+                BaseFloat threshold,
+                std::vector<int32> *row_offsets,
+                std::vector<int32> *col_indexes,
+                Vector<BaseFloat> *values);
+
+/// Converts a CSR matrix back to dense form; 'dest' must already have the
+/// right number of rows (row_offsets.size() - 1), and at least as many columns
+/// as the largest column index plus one.
+void CsrToDense(const std::vector<int32> &row_offsets,
+                const std::vector<int32> &col_indexes,
+                const VectorBase<BaseFloat> &values,
+                MatrixBase<BaseFloat> *dest);
+
+/**
+   Computes out = W in, where W is a sparse matrix in CSR form with
+   out->NumRows() rows and in.NumRows() columns, i.e.
+     out(i, n) = sum_k values[k] * in(col_indexes[k], n)
+   for row_offsets[i] <= k < row_offsets[i+1].  'in' and 'out' must have the
+   same number of columns (normally the number of frames).  If 'allow_simd'
+   is false the plain C++ kernel is used even if the CPU supports AVX2 (this
+   is for testing).
+ */
+void SparseMatMul(const std::vector<int32> &row_offsets,
+                  const std::vector<int32> &col_indexes,
+                  const VectorBase<BaseFloat> &values,
+                  const MatrixBase<BaseFloat> &in,
+                  MatrixBase<BaseFloat> *out,
+                  bool allow_simd = true);
+
+}  // namespace sparse_affine
+}  // namespace nnet3
+}  // namespace kaldi
+
+#endif  // KALDI_NNET3_SPARSE_AFFINE_H_
@@ -0,0 +1,338 @@
+// nnet3bin/nnet3-align-compiled-batch.cc
+
+// Copyright 2009-2012     Microsoft Corporation
+//                         Johns Hopkins University (author: Daniel Povey)
+//                2015     Vijayaditya Peddinti
+//                2015-16  Vimal Manohar
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "base/timer.h"
+#include "util/common-utils.h"
+#include "util/kaldi-thread.h"
+#include "hmm/transition-model.h"
+#include "hmm/hmm-utils.h"
+#include "fstext/fstext-lib.h"
+#include "decoder/decoder-wrappers.h"
+#include "decoder/decodable-matrix.h"
+#include "nnet3/am-nnet-simple.h"
+#include "nnet3/nnet-batch-compute.h"
+#include "nnet3/nnet-utils.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+/**
+   This class aligns one utterance, for use with TaskSequencer.  In operator
+   () it gives the chunks of the utterance to the shared NnetBatchComputer,
+   helps with the neural net computation until they are done (so the
+   minibatches contain chunks of all the utterances being aligned at the
+   time), and then does the Viterbi alignment.  The output happens in the
+   destructor, so it is in the same order as the input.
+*/
+class NnetAlignTask {
+ public:
+  // Takes ownership of "decode_fst".  The other pointers are not owned.
+  NnetAlignTask(const AlignConfig &align_config,
+                const TransitionModel &trans_model,
+                BaseFloat transition_scale,
+                BaseFloat self_loop_scale,
+                NnetBatchComputer *computer,
+                const std::string &utt,
+                const Matrix<BaseFloat> &features,
+                const Vector<BaseFloat> *ivector,
+                const Matrix<BaseFloat> *online_ivectors,
+                int32 online_ivector_period,
+                double priority,
+                fst::VectorFst<fst::StdArc> *decode_fst,
+                Int32VectorWriter *alignment_writer,
+                BaseFloatWriter *scores_writer,
+                BaseFloatVectorWriter *per_frame_acwt_writer,
+                int32 *num_done, int32 *num_err, int32 *num_retry,
+                double *tot_like, int64 *frame_count):
+      align_config_(align_config), trans_model_(trans_model),
+      transition_scale_(transition_scale), self_loop_scale_(self_loop_scale),
+      computer_(computer), utt_(utt), decode_fst_(decode_fst),
+      alignment_writer_(alignment_writer), scores_writer_(scores_writer),
+      per_frame_acwt_writer_(per_frame_acwt_writer), num_done_(num_done),
+      num_err_(num_err), num_retry_(num_retry), tot_like_(tot_like),
+      frame_count_(frame_count), decodable_(NULL), aligner_(NULL) {
+    bool output_to_cpu = true;
+    computer_->SplitUtteranceIntoTasks(output_to_cpu, features, ivector,
+                                       online_ivectors, online_ivector_period,
+                                       &tasks_);
+    // Earlier utterances have higher priority, so that they can be output
+    // sooner.
+    for (size_t i = 0; i < tasks_.size(); i++)
+      tasks_[i].priority = priority;
+  }
+
+  void operator () () {
+    // We don't limit the number of full minibatches queued, as there is no
+    // separate computation thread that would make progress while we wait;
+    // the number of utterances in flight is limited by the TaskSequencer.
+    for (size_t i = 0; i < tasks_.size(); i++)
+      computer_->AcceptTask(&(tasks_[i]));
+    for (size_t i = 0; i < tasks_.size(); i++) {
+      while (!tasks_[i].semaphore.TryWait()) {
+        // If there is nothing left to compute, the remaining chunks of this
+        // utterance are being computed by other threads.
+        if (!computer_->Compute(true)) {
+          tasks_[i].semaphore.Wait();
+          break;
+        }
+      }
+    }
+    Matrix<BaseFloat> *loglikes = new Matrix<BaseFloat>();
+    MergeTaskOutput(tasks_, loglikes);
+    tasks_.clear();
+
+    {  // Add transition-probs to the FST.
+      std::vector<int32> disambig_syms;  // empty.
+      AddTransitionProbs(trans_model_, disambig_syms,
+                         transition_scale_, self_loop_scale_,
+                         decode_fst_);
+    }
+    // The acoustic scale was already applied by the NnetBatchComputer.
+    decodable_ = new DecodableMatrixScaledMapped(trans_model_, 1.0, loglikes);
+    aligner_ = new AlignUtteranceClass(
+        align_config_, utt_, computer_->GetOptions().acoustic_scale,
+        decode_fst_, decodable_, alignment_writer_, scores_writer_,
+        num_done_, num_err_, num_retry_, tot_like_, frame_count_,
+        per_frame_acwt_writer_);
+    (*aligner_)();
+  }
+
+  ~NnetAlignTask() {
+    delete aligner_;  // the output happens here.
+    delete decodable_;
+    delete decode_fst_;
+  }
+
+ private:
+  const AlignConfig &align_config_;
+  const TransitionModel &trans_model_;
+  BaseFloat transition_scale_;
+  BaseFloat self_loop_scale_;
+  NnetBatchComputer *computer_;
+  std::string utt_;
+  std::vector<NnetInferenceTask> tasks_;
+  fst::VectorFst<fst::StdArc> *decode_fst_;
+  Int32VectorWriter *alignment_writer_;
+  BaseFloatWriter *scores_writer_;
+  BaseFloatVectorWriter *per_frame_acwt_writer_;
+  int32 *num_done_;
+  int32 *num_err_;
+  int32 *num_retry_;
+  double *tot_like_;
+  int64 *frame_count_;
+  DecodableMatrixScaledMapped *decodable_;
+  AlignUtteranceClass *aligner_;
+};
+
+}  // namespace nnet3
+}  // namespace kaldi
+
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace kaldi::nnet3;
+    typedef kaldi::int32 int32;
+    typedef kaldi::int64 int64;
+    using fst::VectorFst;
+    using fst::StdArc;
+
+    const char *usage =
+        "Align features given nnet3 neural net model.  This version uses\n"
+        "multiple threads: the neural net computation is done in minibatches\n"
+        "that combine chunks of several utterances, and the alignment of\n"
+        "different utterances happens in parallel.  The output is in the same\n"
+        "order as the input.\n"
+        "Usage:   nnet3-align-compiled-batch [options] <nnet-in> "
+        "<graphs-rspecifier> <features-rspecifier> <alignments-wspecifier> "
+        "[<scores-wspecifier>]\n"
+        "e.g.: \n"
+        " nnet3-align-compiled-batch --num-threads=8 1.mdl ark:graphs.fsts "
+        "scp:train.scp ark:1.ali\n"
+        "See also: nnet3-align-compiled\n";
+
+    ParseOptions po(usage);
+    Timer timer;
+    AlignConfig align_config;
+    NnetBatchComputerOptions opts;
+    TaskSequencerConfig sequencer_config;
+    std::string use_gpu = "no";
+    BaseFloat transition_scale = 1.0;
+    BaseFloat self_loop_scale = 1.0;
+    std::string per_frame_acwt_wspecifier;
+
+    std::string ivector_rspecifier,
+        online_ivector_rspecifier,
+        utt2spk_rspecifier;
+    int32 online_ivector_period = 0;
+    align_config.Register(&po);
+    opts.Register(&po);
+    sequencer_config.Register(&po);
+
+    po.Register("use-gpu", &use_gpu,
+                "yes|no|optional|wait, only has effect if compiled with CUDA");
+    po.Register("transition-scale", &transition_scale,
+                "Transition-probability scale [relative to acoustics]");
+    po.Register("self-loop-scale", &self_loop_scale,
+                "Scale of self-loop versus non-self-loop "
+                "log probs [relative to acoustics]");
+    po.Register("write-per-frame-acoustic-loglikes", &per_frame_acwt_wspecifier,
+                "Wspecifier for table of vectors containing the acoustic log-likelihoods "
+                "per frame for each utterance. E.g. ark:foo/per_frame_logprobs.1.ark");
+    po.Register("ivectors", &ivector_rspecifier, "Rspecifier for "
+                "iVectors as vectors (i.e. not estimated online); per utterance "
+                "by default, or per speaker if you provide the --utt2spk option.");
+    po.Register("utt2spk", &utt2spk_rspecifier, "Rspecifier for "
+                "utt2spk option used to get ivectors per speaker");
+    po.Register("online-ivectors", &online_ivector_rspecifier, "Rspecifier for "
+                "iVectors estimated online, as matrices.  If you supply this,"
+                " you must set the --online-ivector-period option.");
+    po.Register("online-ivector-period", &online_ivector_period, "Number of frames "
+                "between iVectors in matrices supplied to the --online-ivectors "
+                "option");
+    po.Read(argc, argv);
+
+    if (po.NumArgs() < 4 || po.NumArgs() > 5) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+#if HAVE_CUDA==1
+    CuDevice::Instantiate().AllowMultithreading();
+    CuDevice::Instantiate().SelectGpuId(use_gpu);
+#endif
+
+    std::string model_in_filename = po.GetArg(1),
+        fst_rspecifier = po.GetArg(2),
+        feature_rspecifier = po.GetArg(3),
+        alignment_wspecifier = po.GetArg(4),
+        scores_wspecifier = po.GetOptArg(5);
+
+    int num_done = 0, num_err = 0, num_retry = 0;
+    double tot_like = 0.0;
+    kaldi::int64 frame_count = 0;
+
+    {
+      TransitionModel trans_model;
+      AmNnetSimple am_nnet;
+      {
+        bool binary;
+        Input ki(model_in_filename, &binary);
+        trans_model.Read(ki.Stream(), binary);
+        am_nnet.Read(ki.Stream(), binary);
+      }
+      SetBatchnormTestMode(true, &(am_nnet.GetNnet()));
+      SetDropoutTestMode(true, &(am_nnet.GetNnet()));
+      CollapseModel(CollapseModelConfig(), &(am_nnet.GetNnet()));
+
+      RandomAccessBaseFloatMatrixReader online_ivector_reader(
+          online_ivector_rspecifier);
+      RandomAccessBaseFloatVectorReaderMapped ivector_reader(
+          ivector_rspecifier, utt2spk_rspecifier);
+
+      SequentialTableReader<fst::VectorFstHolder> fst_reader(fst_rspecifier);
+      RandomAccessBaseFloatMatrixReader feature_reader(feature_rspecifier);
+      Int32VectorWriter alignment_writer(alignment_wspecifier);
+      BaseFloatWriter scores_writer(scores_wspecifier);
+      BaseFloatVectorWriter per_frame_acwt_writer(per_frame_acwt_wspecifier);
+
+      // The priors are subtracted, and the acoustic scale applied, by the
+      // computer; this matches what DecodableAmNnetSimple does.
+      NnetBatchComputer computer(opts, am_nnet.GetNnet(), am_nnet.Priors());
+
+      {
+        TaskSequencer<NnetAlignTask> sequencer(sequencer_config);
+        int64 utterance_counter = 0;
+
+        for (; !fst_reader.Done(); fst_reader.Next()) {
+          std::string utt = fst_reader.Key();
+          if (!feature_reader.HasKey(utt)) {
+            KALDI_WARN << "No features for utterance " << utt;
+            num_err++;
+            continue;
+          }
+          const Matrix<BaseFloat> &features = feature_reader.Value(utt);
+          if (features.NumRows() == 0) {
+            KALDI_WARN << "Zero-length utterance: " << utt;
+            num_err++;
+            continue;
+          }
+
+          const Matrix<BaseFloat> *online_ivectors = NULL;
+          const Vector<BaseFloat> *ivector = NULL;
+          if (!ivector_rspecifier.empty()) {
+            if (!ivector_reader.HasKey(utt)) {
+              KALDI_WARN << "No iVector available for utterance " << utt;
+              num_err++;
+              continue;
+            } else {
+              ivector = &ivector_reader.Value(utt);
+            }
+          }
+          if (!online_ivector_rspecifier.empty()) {
+            if (!online_ivector_reader.HasKey(utt)) {
+              KALDI_WARN << "No online iVector available for utterance " << utt;
+              num_err++;
+              continue;
+            } else {
+              online_ivectors = &online_ivector_reader.Value(utt);
+            }
+          }
+
+          VectorFst<StdArc> *decode_fst = new VectorFst<StdArc>(
+              fst_reader.Value());
+          fst_reader.FreeCurrent();  // this stops copy-on-write of the fst
+          // by deleting the fst inside the reader, since we're about to
+          // mutate the fst by adding transition probs.
+
+          // The inputs are copied into the tasks by the constructor, so the
+          // readers' values may change after this.
+          double priority = -1.0 * (utterance_counter++);
+          sequencer.Run(new NnetAlignTask(
+              align_config, trans_model, transition_scale, self_loop_scale,
+              &computer, utt, features, ivector, online_ivectors,
+              online_ivector_period, priority, decode_fst,
+              &alignment_writer, &scores_writer, &per_frame_acwt_writer,
+              &num_done, &num_err, &num_retry, &tot_like, &frame_count));
+        }
+        sequencer.Wait();
+      }
+      KALDI_LOG << "Overall log-likelihood per frame is "
+                << (tot_like/frame_count)
+                << " over " << frame_count<< " frames.";
+      KALDI_LOG << "Retried " << num_retry << " out of "
+                << (num_done + num_err) << " utterances.";
+      KALDI_LOG << "Done " << num_done << ", errors on " << num_err;
+    }
+
+#if HAVE_CUDA==1
+    CuDevice::Instantiate().PrintProfile();
+#endif
+    double elapsed = timer.Elapsed();
+    KALDI_LOG << "Time taken " << elapsed << "s";
+    return (num_done != 0 ? 0 : 1);
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -23,6 +23,7 @@
 #include "util/common-utils.h"
 #include "hmm/transition-model.h"
 #include "nnet3/am-nnet-simple.h"
+#include "nnet3/am-nnet-mapped.h"
 #include "nnet3/nnet-utils.h"
 
 int main(int argc, char *argv[]) {
@@ -37,12 +38,19 @@ int main(int argc, char *argv[]) {
         "Also supports setting all learning rates to a supplied\n"
         "value (the --learning-rate option),\n"
         "and supports replacing the raw nnet in the model (the Nnet)\n"
-        "with a provided raw nnet (the --set-raw-nnet option)\n"
+        "with a provided raw nnet (the --set-raw-nnet option),\n"
+        "and storing the parameters in 16 bits for inference (the\n"
+        "--half-precision option) and writing models that decoders\n"
+        "can memory-map and share (the --write-mapped option)\n"
         "\n"
         "Usage:  nnet3-am-copy [options] <nnet-in> <nnet-out>\n"
         "e.g.:\n"
         " nnet3-am-copy --binary=false 1.mdl text.mdl\n"
-        " nnet3-am-copy --raw=true 1.mdl 1.raw\n";
+        " nnet3-am-copy --raw=true 1.mdl 1.raw\n"
+        " nnet3-am-copy --prepare-for-test=true --half-precision=fp16 \\\n"
+        "   final.mdl final_fp16.mdl\n"
+        " nnet3-am-copy --prepare-for-test=true --write-mapped=true \\\n"
+        "   final.mdl final_mapped.mdl\n";
 
     bool binary_write = true,
         raw = false;
@@ -50,8 +58,10 @@ int main(int argc, char *argv[]) {
     std::string set_raw_nnet = "";
     bool convert_repeated_to_block = false;
     BaseFloat scale = 1.0;
-    bool prepare_for_test = false;
+    bool prepare_for_test = false,
+        write_mapped = false;
     std::string nnet_config, edits_config, edits_str;
+    std::string half_precision;
 
     ParseOptions po(usage);
     po.Register("binary", &binary_write, "Write output in binary mode");
@@ -87,6 +97,21 @@ int main(int argc, char *argv[]) {
                 "slightly.  Involves setting test mode in dropout and batch-norm "
                 "components, and calling CollapseModel() which may remove some "
                 "components.");
+    po.Register("half-precision", &half_precision,
+                "If set to fp16 or bf16, converts the affine, linear and TDNN "
+                "components to HalfPrecisionAffineComponent, which stores its "
+                "parameters as 16-bit floats of that type, halving their size "
+                "on disk and in memory.  The result can only be used for "
+                "inference, so this is normally combined with "
+                "--prepare-for-test=true.");
+    po.Register("write-mapped", &write_mapped,
+                "If true, write the model in the mapped format, whose "
+                "parameters are used in place from the memory-mapped file by "
+                "the decoding programs, so all the decoders on a machine share "
+                "one copy.  The affine, linear and TDNN components are "
+                "converted to MappedAffineComponent, so this is for inference "
+                "only and is normally combined with --prepare-for-test=true.  "
+                "Always binary; incompatible with --raw.");
 
     po.Read(argc, argv);
 
@@ -100,12 +125,7 @@ int main(int argc, char *argv[]) {
 
     TransitionModel trans_model;
     AmNnetSimple am_nnet;
-    {
-      bool binary;
-      Input ki(nnet_rxfilename, &binary);
-      trans_model.Read(ki.Stream(), binary);
-      am_nnet.Read(ki.Stream(), binary);
-    }
+    ReadAmNnetMaybeMapped(nnet_rxfilename, &trans_model, &am_nnet);
 
     if (!set_raw_nnet.empty()) {
       Nnet nnet;
@@ -148,7 +168,22 @@ int main(int argc, char *argv[]) {
       CollapseModel(CollapseModelConfig(), &am_nnet.GetNnet());
     }
 
-    if (raw) {
+    if (!half_precision.empty()) {
+      int32 num_converted = ConvertToHalfPrecision(
+          quantization::HalfPrecisionTypeFromString(half_precision),
+          &am_nnet.GetNnet());
+      KALDI_LOG << "Converted " << num_converted << " components to "
+                << half_precision;
+    }
+
+    if (write_mapped) {
+      if (raw || !binary_write)
+        KALDI_ERR << "--write-mapped=true is incompatible with --raw=true "
+                  << "and --binary=false";
+      WriteMappedAmNnet(trans_model, am_nnet, nnet_wxfilename);
+      KALDI_LOG << "Copied neural net from " << nnet_rxfilename
+                << " to mapped format as " << nnet_wxfilename;
+    } else if (raw) {
       WriteKaldiObject(am_nnet.GetNnet(), nnet_wxfilename, binary_write);
       KALDI_LOG << "Copied neural net from " << nnet_rxfilename
                 << " to raw format as " << nnet_wxfilename;
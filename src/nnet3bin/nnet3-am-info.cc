@@ -20,6 +20,7 @@
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
 #include "nnet3/am-nnet-simple.h"
+#include "nnet3/am-nnet-mapped.h"
 #include "hmm/transition-model.h"
 
 int main(int argc, char *argv[]) {
@@ -50,12 +51,7 @@ int main(int argc, char *argv[]) {
 
     TransitionModel trans_model;
     AmNnetSimple am_nnet;
-    {
-      bool binary;
-      Input ki(nnet_rxfilename, &binary);
-      trans_model.Read(ki.Stream(), binary);
-      am_nnet.Read(ki.Stream(), binary);
-    }
+    ReadAmNnetMaybeMapped(nnet_rxfilename, &trans_model, &am_nnet);
     std::cout << am_nnet.Info();
 
     return 0;
@@ -22,6 +22,7 @@
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
 #include "nnet3/nnet-am-decodable-simple.h"
+#include "nnet3/nnet-compute-profiler.h"
 #include "base/timer.h"
 #include "nnet3/nnet-utils.h"
 
@@ -49,6 +50,7 @@ int main(int argc, char *argv[]) {
 
     NnetSimpleComputationOptions opts;
     opts.acoustic_scale = 1.0; // by default do no scaling.
+    NnetComputeProfilerOptions profiler_opts;
 
     bool apply_exp = false, use_priors = false;
     std::string use_gpu = "yes";
@@ -58,6 +60,7 @@ int main(int argc, char *argv[]) {
                 utt2spk_rspecifier;
     int32 online_ivector_period = 0;
     opts.Register(&po);
+    profiler_opts.Register(&po);
 
     po.Register("ivectors", &ivector_rspecifier, "Rspecifier for "
                 "iVectors as vectors (i.e. not estimated online); per utterance "
@@ -88,6 +91,10 @@ int main(int argc, char *argv[]) {
       po.PrintUsage();
       exit(1);
     }
+    profiler_opts.Check();
+    NnetComputeProfiler profiler;
+    if (profiler_opts.Enabled())
+      opts.compute_config.profiler = &profiler;
 
 #if HAVE_CUDA==1
     CuDevice::Instantiate().SelectGpuId(use_gpu);
@@ -185,6 +192,8 @@ int main(int argc, char *argv[]) {
 #if HAVE_CUDA==1
     CuDevice::Instantiate().PrintProfile();
 #endif
+    if (profiler_opts.Enabled())
+      profiler.Write(profiler_opts);
     double elapsed = timer.Elapsed();
     KALDI_LOG << "Time taken "<< elapsed
               << "s: real-time factor assuming 100 frames/sec is "
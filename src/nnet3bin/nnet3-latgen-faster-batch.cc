@@ -25,6 +25,7 @@
 #include "fstext/fstext-lib.h"
 #include "hmm/transition-model.h"
 #include "nnet3/nnet-batch-compute.h"
+#include "nnet3/am-nnet-mapped.h"
 #include "nnet3/nnet-utils.h"
 #include "util/kaldi-thread.h"
 #include "tree/context-dep.h"
@@ -132,10 +133,7 @@ int main(int argc, char *argv[]) {
     TransitionModel trans_model;
     AmNnetSimple am_nnet;
     {
-      bool binary;
-      Input ki(model_in_rxfilename, &binary);
-      trans_model.Read(ki.Stream(), binary);
-      am_nnet.Read(ki.Stream(), binary);
+      ReadAmNnetMaybeMapped(model_in_rxfilename, &trans_model, &am_nnet);
       SetBatchnormTestMode(true, &(am_nnet.GetNnet()));
       SetDropoutTestMode(true, &(am_nnet.GetNnet()));
       CollapseModel(CollapseModelConfig(), &(am_nnet.GetNnet()));
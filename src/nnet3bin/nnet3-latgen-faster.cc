@@ -26,6 +26,8 @@
 #include "fstext/fstext-lib.h"
 #include "decoder/decoder-wrappers.h"
 #include "nnet3/nnet-am-decodable-simple.h"
+#include "nnet3/nnet-compute-profiler.h"
+#include "nnet3/am-nnet-mapped.h"
 #include "nnet3/nnet-utils.h"
 #include "base/timer.h"
 
@@ -52,6 +54,7 @@ int main(int argc, char *argv[]) {
     bool allow_partial = false;
     LatticeFasterDecoderConfig config;
     NnetSimpleComputationOptions decodable_opts;
+    NnetComputeProfilerOptions profiler_opts;
 
     std::string word_syms_filename;
     std::string ivector_rspecifier,
@@ -60,6 +63,7 @@ int main(int argc, char *argv[]) {
     int32 online_ivector_period = 0;
     config.Register(&po);
     decodable_opts.Register(&po);
+    profiler_opts.Register(&po);
     po.Register("word-symbol-table", &word_syms_filename,
                 "Symbol table for words [for debug output]");
     po.Register("allow-partial", &allow_partial,
@@ -82,6 +86,10 @@ int main(int argc, char *argv[]) {
       po.PrintUsage();
       exit(1);
     }
+    profiler_opts.Check();
+    NnetComputeProfiler profiler;
+    if (profiler_opts.Enabled())
+      decodable_opts.compute_config.profiler = &profiler;
 
     std::string model_in_filename = po.GetArg(1),
         fst_in_str = po.GetArg(2),
@@ -93,10 +101,7 @@ int main(int argc, char *argv[]) {
     TransitionModel trans_model;
     AmNnetSimple am_nnet;
     {
-      bool binary;
-      Input ki(model_in_filename, &binary);
-      trans_model.Read(ki.Stream(), binary);
-      am_nnet.Read(ki.Stream(), binary);
+      ReadAmNnetMaybeMapped(model_in_filename, &trans_model, &am_nnet);
       SetBatchnormTestMode(true, &(am_nnet.GetNnet()));
       SetDropoutTestMode(true, &(am_nnet.GetNnet()));
       CollapseModel(CollapseModelConfig(), &(am_nnet.GetNnet()));
@@ -252,6 +257,9 @@ int main(int argc, char *argv[]) {
     kaldi::int64 input_frame_count =
         frame_count * decodable_opts.frame_subsampling_factor;
 
+    if (profiler_opts.Enabled())
+      profiler.Write(profiler_opts);
+
     double elapsed = timer.Elapsed();
     KALDI_LOG << "Time taken "<< elapsed
               << "s: real-time factor assuming 100 frames/sec is "
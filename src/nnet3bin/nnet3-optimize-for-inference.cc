@@ -0,0 +1,116 @@
+// nnet3bin/nnet3-optimize-for-inference.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "hmm/transition-model.h"
+#include "nnet3/am-nnet-simple.h"
+#include "nnet3/nnet-utils.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+static void PrintNnetCost(const std::string &prefix, const Nnet &nnet) {
+  KALDI_LOG << prefix << ": " << nnet.NumComponents() << " components, "
+            << nnet.NumNodes() << " nodes, "
+            << NnetFlopsPerFrame(nnet) << " flops per frame, "
+            << NnetComponentBytes(nnet) << " bytes of components.";
+}
+
+}  // namespace nnet3
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace kaldi::nnet3;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Rewrite an nnet3 neural net for inference: set batchnorm and dropout\n"
+        "components to test mode, then remove or merge components that are\n"
+        "constant at test time (dropout, batchnorm, fixed-scale, fixed-bias,\n"
+        "no-op, fixed-affine) into neighboring affine components where\n"
+        "possible.  Prints the number of components and nodes, an estimate of\n"
+        "the flops per frame and the memory used by the components, before\n"
+        "and after.  The output model should only be used for decoding.\n"
+        "\n"
+        "Usage:  nnet3-optimize-for-inference [options] <nnet-in> <nnet-out>\n"
+        "e.g.:\n"
+        " nnet3-optimize-for-inference final.mdl final_test.mdl\n"
+        " nnet3-optimize-for-inference --raw=true final.raw final_test.raw\n";
+
+    bool binary_write = true,
+        raw = false;
+    CollapseModelConfig collapse_config;
+    // when preparing a model for inference we want everything that can be
+    // collapsed to be collapsed.
+    collapse_config.collapse_dropout = true;
+    collapse_config.collapse_batchnorm = true;
+
+    ParseOptions po(usage);
+    po.Register("binary", &binary_write, "Write output in binary mode");
+    po.Register("raw", &raw, "If true, read and write a raw neural net "
+                "rather than an acoustic model with transition model and "
+                "priors.");
+    collapse_config.Register(&po);
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string nnet_rxfilename = po.GetArg(1),
+        nnet_wxfilename = po.GetArg(2);
+
+    TransitionModel trans_model;
+    AmNnetSimple am_nnet;
+    Nnet raw_nnet;
+    if (raw) {
+      ReadKaldiObject(nnet_rxfilename, &raw_nnet);
+    } else {
+      bool binary;
+      Input ki(nnet_rxfilename, &binary);
+      trans_model.Read(ki.Stream(), binary);
+      am_nnet.Read(ki.Stream(), binary);
+    }
+    Nnet &nnet = (raw ? raw_nnet : am_nnet.GetNnet());
+
+    PrintNnetCost("Before optimization", nnet);
+    SetBatchnormTestMode(true, &nnet);
+    SetDropoutTestMode(true, &nnet);
+    CollapseModel(collapse_config, &nnet);
+    PrintNnetCost("After optimization", nnet);
+
+    if (raw) {
+      WriteKaldiObject(nnet, nnet_wxfilename, binary_write);
+    } else {
+      am_nnet.SetContext();
+      Output ko(nnet_wxfilename, binary_write);
+      trans_model.Write(ko.Stream(), binary_write);
+      am_nnet.Write(ko.Stream(), binary_write);
+    }
+    KALDI_LOG << "Wrote optimized neural net from " << nnet_rxfilename
+              << " to " << nnet_wxfilename;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return -1;
+  }
+}
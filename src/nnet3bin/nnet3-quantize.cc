@@ -0,0 +1,105 @@
+// nnet3bin/nnet3-quantize.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "hmm/transition-model.h"
+#include "nnet3/am-nnet-simple.h"
+#include "nnet3/nnet-utils.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace kaldi::nnet3;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Convert the affine, linear and TDNN components of an nnet3 neural net\n"
+        "to QuantizedAffineComponent, which stores its parameters as 8-bit\n"
+        "integers and uses integer arithmetic on CPU.  The resulting model\n"
+        "can only be used for inference.  By default the model is first\n"
+        "prepared for test as by nnet3-am-copy --prepare-for-test=true, since\n"
+        "quantized components can't be collapsed with their neighbors.\n"
+        "\n"
+        "Usage:  nnet3-quantize [options] <nnet-in> <nnet-out>\n"
+        "e.g.:\n"
+        " nnet3-quantize final.mdl final_int8.mdl\n"
+        " nnet3-quantize --raw=true final.raw final_int8.raw\n";
+
+    bool binary_write = true,
+        raw = false,
+        prepare_for_test = true;
+
+    ParseOptions po(usage);
+    po.Register("binary", &binary_write, "Write output in binary mode");
+    po.Register("raw", &raw, "If true, read and write a raw neural net "
+                "rather than an acoustic model with transition model and "
+                "priors.");
+    po.Register("prepare-for-test", &prepare_for_test,
+                "If true, set test mode for batchnorm and dropout components "
+                "and call CollapseModel() before quantizing.");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string nnet_rxfilename = po.GetArg(1),
+        nnet_wxfilename = po.GetArg(2);
+
+    TransitionModel trans_model;
+    AmNnetSimple am_nnet;
+    Nnet raw_nnet;
+    if (raw) {
+      ReadKaldiObject(nnet_rxfilename, &raw_nnet);
+    } else {
+      bool binary;
+      Input ki(nnet_rxfilename, &binary);
+      trans_model.Read(ki.Stream(), binary);
+      am_nnet.Read(ki.Stream(), binary);
+    }
+    Nnet &nnet = (raw ? raw_nnet : am_nnet.GetNnet());
+
+    if (prepare_for_test) {
+      SetBatchnormTestMode(true, &nnet);
+      SetDropoutTestMode(true, &nnet);
+      CollapseModel(CollapseModelConfig(), &nnet);
+    }
+    int64 bytes_before = NnetComponentBytes(nnet);
+    int32 num_converted = ConvertToQuantized(&nnet);
+    KALDI_LOG << "Quantized " << num_converted << " components; the size of "
+              << "the components changed from " << bytes_before << " to "
+              << NnetComponentBytes(nnet) << " bytes.";
+
+    if (raw) {
+      WriteKaldiObject(nnet, nnet_wxfilename, binary_write);
+    } else {
+      am_nnet.SetContext();
+      Output ko(nnet_wxfilename, binary_write);
+      trans_model.Write(ko.Stream(), binary_write);
+      am_nnet.Write(ko.Stream(), binary_write);
+    }
+    KALDI_LOG << "Wrote quantized neural net from " << nnet_rxfilename
+              << " to " << nnet_wxfilename;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return -1;
+  }
+}
@@ -20,8 +20,13 @@
 // limitations under the License.
 
 
+#include <deque>
+#include <map>
+#include <mutex>
+
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
+#include "util/kaldi-thread.h"
 #include "nnet3/nnet-am-decodable-simple.h"
 #include "base/timer.h"
 #include "nnet3/nnet-utils.h"
@@ -29,32 +34,318 @@
 namespace kaldi {
 namespace nnet3 {
 
-// Computes an xvector from a chunk of speech features.
-static void RunNnetComputation(const MatrixBase<BaseFloat> &features,
-    const Nnet &nnet, CachingOptimizingCompiler *compiler,
-    Vector<BaseFloat> *xvector) {
+// Splits the features of an utterance into the chunks we compute xvectors
+// for, as described in the usage message.  Outputs the features of each
+// chunk, which are padded to min_chunk_size frames if needed and pad_input
+// is true, and the weight of the chunk's xvector in the average (its number
+// of frames before padding).
+static void SplitIntoChunks(const Matrix<BaseFloat> &features,
+                            int32 this_chunk_size, int32 min_chunk_size,
+                            bool pad_input,
+                            std::vector<Matrix<BaseFloat> > *chunks,
+                            std::vector<BaseFloat> *weights) {
+  int32 num_rows = features.NumRows(),
+      feat_dim = features.NumCols();
+  int32 num_chunks = ceil(
+    num_rows / static_cast<BaseFloat>(this_chunk_size));
+  chunks->clear();
+  weights->clear();
+  for (int32 chunk_indx = 0; chunk_indx < num_chunks; chunk_indx++) {
+    // If we're nearing the end of the input, we may need to shift the
+    // offset back so that we can get this_chunk_size frames of input to
+    // the nnet.
+    int32 offset = std::min(
+      this_chunk_size, num_rows - chunk_indx * this_chunk_size);
+    if (!pad_input && offset < min_chunk_size)
+      continue;
+    SubMatrix<BaseFloat> sub_features(
+      features, chunk_indx * this_chunk_size, offset, 0, feat_dim);
+    weights->push_back(offset);
+    chunks->resize(chunks->size() + 1);
+    Matrix<BaseFloat> &chunk = chunks->back();
+    // Pad input if the offset is less than the minimum chunk size
+    if (pad_input && offset < min_chunk_size) {
+      chunk.Resize(min_chunk_size, feat_dim);
+      int32 left_context = (min_chunk_size - offset) / 2;
+      int32 right_context = min_chunk_size - offset - left_context;
+      for (int32 i = 0; i < left_context; i++) {
+        chunk.Row(i).CopyFromVec(sub_features.Row(0));
+      }
+      for (int32 i = 0; i < right_context; i++) {
+        chunk.Row(min_chunk_size - i - 1).CopyFromVec(sub_features.Row(offset - 1));
+      }
+      chunk.Range(left_context, offset, 0, feat_dim).CopyFromMat(sub_features);
+    } else {
+      chunk = sub_features;
+    }
+  }
+}
+
+
+struct BucketedXvectorComputerOptions {
+  int32 batch_size;
+  int32 max_pending_chunks;
+  TaskSequencerConfig sequencer_config;
+
+  BucketedXvectorComputerOptions(): batch_size(1), max_pending_chunks(1024) { }
+
+  void Register(OptionsItf *po) {
+    po->Register("batch-size", &batch_size,
+                 "Number of chunks of the same length that are computed "
+                 "together in one nnet computation.  The xvectors are the "
+                 "same whatever the batch size; larger values are faster on "
+                 "CPU if there are many short segments.  Only chunks of "
+                 "exactly the same number of frames are batched, so this "
+                 "helps with --chunk-size (all chunks but an utterance's last "
+                 "have that length) or with segments of equal length, and "
+                 "does little for whole utterances of varying lengths.");
+    po->Register("max-pending-chunks", &max_pending_chunks,
+                 "Maximum number of chunks waiting for a batch of their "
+                 "length to fill up; when exceeded, the batch holding the "
+                 "oldest chunk is computed even if it is not full.  Limits "
+                 "memory use and output latency.");
+    sequencer_config.Register(po);
+  }
+};
+
+
+/**
+   BucketedXvectorComputer computes the xvectors of utterances that have been
+   split into chunks, batching chunks of the same length (from any
+   utterances) into a single nnet computation.  Because every chunk keeps its
+   exact length and has its own 'n' index, the statistics pooling is done
+   separately for each chunk and the xvectors are the same as if each chunk
+   were computed on its own; batching only saves the per-computation
+   overhead and lets the matrix multiplications work on more rows at once.
+   Compiled computations are cached by the CachingOptimizingCompiler, so
+   there is one per (chunk length, batch size) that occurs.
+
+   Batches are computed by a TaskSequencer, so several can be computed in
+   parallel (--num-threads); the xvectors are written in the same order as
+   the utterances were given.
+ */
+class BucketedXvectorComputer {
+ public:
+  BucketedXvectorComputer(const BucketedXvectorComputerOptions &opts,
+                          const Nnet &nnet,
+                          CachingOptimizingCompiler *compiler,
+                          BaseFloatVectorWriter *writer);
+
+  /// Accepts the chunks of an utterance and their weights, as output by
+  /// SplitIntoChunks() (the chunks are consumed).  Any batches that become
+  /// full are computed.
+  void AcceptUtterance(const std::string &utt,
+                       std::vector<Matrix<BaseFloat> > *chunks,
+                       const std::vector<BaseFloat> &weights);
+
+  /// Computes all remaining chunks and writes all remaining xvectors.
+  void Finish();
+
+  int64 NumWritten() const { return num_written_; }
+
+ private:
+  // An utterance whose xvector has not been written yet.
+  struct XvectorUtterance {
+    std::string utt;
+    int32 num_chunks_remaining;
+    BaseFloat tot_weight;
+    Vector<BaseFloat> xvector_sum;
+  };
+  struct XvectorChunk {
+    XvectorUtterance *utterance;
+    BaseFloat weight;
+    int64 seq;  // order in which the chunk was accepted.
+    Matrix<BaseFloat> features;
+  };
+
+  // Computes one batch of chunks of the same length, and in its destructor
+  // adds their xvectors to their utterances' totals.
+  class BatchTask {
+   public:
+    BatchTask(BucketedXvectorComputer *computer,
+              std::vector<XvectorChunk> *chunks):
+        computer_(computer) { chunks_.swap(*chunks); }
+    void operator () ();
+    ~BatchTask();
+   private:
+    BucketedXvectorComputer *computer_;
+    std::vector<XvectorChunk> chunks_;
+    Matrix<BaseFloat> output_;
+  };
+
+  // Computes the chunks of the given length that are waiting.
+  void ComputeBucket(int32 length);
+
+  // Writes the xvectors of the utterances at the front of utterances_
+  // whose chunks have all been computed.  Must be called with mutex_ held.
+  void WriteReadyXvectors();
+
+  const BucketedXvectorComputerOptions &opts_;
+  const Nnet &nnet_;
+  CachingOptimizingCompiler *compiler_;
+  BaseFloatVectorWriter *writer_;
+  int32 xvector_dim_;
+
+  // Chunks waiting to be computed, indexed by their exact number of frames.
+  // We don't pad chunks to share a bucket with nearby lengths, as padding
+  // would change the statistics pooling and so the xvectors.
+  std::map<int32, std::vector<XvectorChunk> > buckets_;
+  int64 num_pending_chunks_;
+  int64 num_chunks_accepted_;
+
+  // Guards utterances_, the utterances' totals, writer_ and num_written_,
+  // which are accessed by the destructors of the tasks.
+  std::mutex mutex_;
+  std::deque<XvectorUtterance*> utterances_;
+  int64 num_written_;
+
+  TaskSequencer<BatchTask> sequencer_;
+};
+
+
+BucketedXvectorComputer::BucketedXvectorComputer(
+    const BucketedXvectorComputerOptions &opts,
+    const Nnet &nnet,
+    CachingOptimizingCompiler *compiler,
+    BaseFloatVectorWriter *writer):
+    opts_(opts), nnet_(nnet), compiler_(compiler), writer_(writer),
+    xvector_dim_(nnet.OutputDim("output")),
+    num_pending_chunks_(0), num_chunks_accepted_(0), num_written_(0),
+    sequencer_(opts.sequencer_config) {
+  KALDI_ASSERT(opts.batch_size > 0);
+}
+
+void BucketedXvectorComputer::BatchTask::operator () () {
+  int32 batch_size = chunks_.size(),
+      num_frames = chunks_[0].features.NumRows(),
+      feat_dim = chunks_[0].features.NumCols();
   ComputationRequest request;
   request.need_model_derivative = false;
   request.store_component_stats = false;
-  request.inputs.push_back(
-    IoSpecification("input", 0, features.NumRows()));
-  IoSpecification output_spec;
-  output_spec.name = "output";
-  output_spec.has_deriv = false;
-  output_spec.indexes.resize(1);
-  request.outputs.resize(1);
-  request.outputs[0].Swap(&output_spec);
-  std::shared_ptr<const NnetComputation> computation(compiler->Compile(request));
+  request.inputs.resize(1);
+  IoSpecification &input(request.inputs[0]);
+  input.name = "input";
+  input.has_deriv = false;
+  input.indexes.resize(batch_size * num_frames);
+  // The chunks are interleaved in the input, which is how nnet3 orders the
+  // indexes anyway.
+  for (int32 n = 0; n < batch_size; n++) {
+    for (int32 t = 0; t < num_frames; t++) {
+      input.indexes[n + batch_size * t].n = n;
+      input.indexes[n + batch_size * t].t = t;
+    }
+  }
+  IoSpecification output;
+  output.name = "output";
+  output.has_deriv = false;
+  output.indexes.resize(batch_size);
+  for (int32 n = 0; n < batch_size; n++)
+    output.indexes[n].n = n;
+  request.outputs.push_back(output);
+  std::shared_ptr<const NnetComputation> computation(
+      computer_->compiler_->Compile(request));
+
+  CuMatrix<BaseFloat> input_feats(batch_size * num_frames, feat_dim,
+                                  kUndefined);
+  {
+    Matrix<BaseFloat> input_feats_cpu(batch_size * num_frames, feat_dim,
+                                      kUndefined);
+    for (int32 n = 0; n < batch_size; n++)
+      for (int32 t = 0; t < num_frames; t++)
+        input_feats_cpu.Row(n + batch_size * t).CopyFromVec(
+            chunks_[n].features.Row(t));
+    input_feats.Swap(&input_feats_cpu);
+  }
   Nnet *nnet_to_update = NULL;  // we're not doing any update.
   NnetComputer computer(NnetComputeOptions(), *computation,
-                  nnet, nnet_to_update);
-  CuMatrix<BaseFloat> input_feats_cu(features);
-  computer.AcceptInput("input", &input_feats_cu);
+                        computer_->nnet_, nnet_to_update);
+  computer.AcceptInput("input", &input_feats);
   computer.Run();
   CuMatrix<BaseFloat> cu_output;
   computer.GetOutputDestructive("output", &cu_output);
-  xvector->Resize(cu_output.NumCols());
-  xvector->CopyFromVec(cu_output.Row(0));
+  cu_output.Swap(&output_);
+}
+
+BucketedXvectorComputer::BatchTask::~BatchTask() {
+  std::lock_guard<std::mutex> lock(computer_->mutex_);
+  for (size_t n = 0; n < chunks_.size(); n++) {
+    XvectorUtterance *utterance = chunks_[n].utterance;
+    utterance->xvector_sum.AddVec(chunks_[n].weight, output_.Row(n));
+    utterance->num_chunks_remaining--;
+  }
+  computer_->WriteReadyXvectors();
+}
+
+void BucketedXvectorComputer::WriteReadyXvectors() {
+  while (!utterances_.empty() &&
+         utterances_.front()->num_chunks_remaining == 0) {
+    XvectorUtterance *utterance = utterances_.front();
+    utterance->xvector_sum.Scale(1.0 / utterance->tot_weight);
+    writer_->Write(utterance->utt, utterance->xvector_sum);
+    num_written_++;
+    delete utterance;
+    utterances_.pop_front();
+  }
+}
+
+void BucketedXvectorComputer::ComputeBucket(int32 length) {
+  std::vector<XvectorChunk> &bucket = buckets_[length];
+  num_pending_chunks_ -= bucket.size();
+  sequencer_.Run(new BatchTask(this, &bucket));
+  buckets_.erase(length);
+}
+
+void BucketedXvectorComputer::AcceptUtterance(
+    const std::string &utt,
+    std::vector<Matrix<BaseFloat> > *chunks,
+    const std::vector<BaseFloat> &weights) {
+  KALDI_ASSERT(chunks->size() == weights.size());
+  XvectorUtterance *utterance = new XvectorUtterance;
+  utterance->utt = utt;
+  utterance->num_chunks_remaining = chunks->size();
+  utterance->tot_weight = 0.0;
+  for (size_t i = 0; i < weights.size(); i++)
+    utterance->tot_weight += weights[i];
+  utterance->xvector_sum.Resize(xvector_dim_);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    utterances_.push_back(utterance);
+    WriteReadyXvectors();  // in case it had no chunks.
+  }
+
+  for (size_t i = 0; i < chunks->size(); i++) {
+    int32 length = (*chunks)[i].NumRows();
+    std::vector<XvectorChunk> &bucket = buckets_[length];
+    bucket.resize(bucket.size() + 1);
+    XvectorChunk &chunk = bucket.back();
+    chunk.utterance = utterance;
+    chunk.weight = weights[i];
+    chunk.seq = num_chunks_accepted_++;
+    chunk.features.Swap(&((*chunks)[i]));
+    num_pending_chunks_++;
+    if (static_cast<int32>(bucket.size()) == opts_.batch_size)
+      ComputeBucket(length);
+  }
+
+  while (num_pending_chunks_ > opts_.max_pending_chunks) {
+    // Compute the bucket with the oldest chunk, which is the one the output
+    // is most likely to be waiting for.
+    std::map<int32, std::vector<XvectorChunk> >::iterator
+        iter = buckets_.begin(), oldest = buckets_.begin();
+    for (; iter != buckets_.end(); ++iter)
+      if (iter->second[0].seq < oldest->second[0].seq)
+        oldest = iter;
+    ComputeBucket(oldest->first);
+  }
+}
+
+void BucketedXvectorComputer::Finish() {
+  while (!buckets_.empty())
+    ComputeBucket(buckets_.begin()->first);
+  sequencer_.Wait();
+  std::lock_guard<std::mutex> lock(mutex_);
+  WriteReadyXvectors();
+  KALDI_ASSERT(utterances_.empty());
 }
 
 } // namespace nnet3
@@ -80,6 +371,11 @@ int main(int argc, char *argv[]) {
         "xvector is extracted directly from the set of features for each\n"
         "utterance.  Optionally, xvectors are extracted from chunks of input\n"
         "features and averaged, to produce a single vector.\n"
+        "For fast extraction on CPU from many short segments, use\n"
+        "--batch-size to compute chunks of the same length together and\n"
+        "--num-threads to compute several batches in parallel; the output\n"
+        "is the same.  Only chunks of exactly the same length are batched\n"
+        "together, so this is most useful with --chunk-size.\n"
         "\n"
         "Usage: nnet3-xvector-compute [options] <raw-nnet-in> "
         "<features-rspecifier> <vector-wspecifier>\n"
@@ -92,6 +388,7 @@ int main(int argc, char *argv[]) {
 
     NnetSimpleComputationOptions opts;
     CachingOptimizingCompilerOptions compiler_config;
+    BucketedXvectorComputerOptions bucket_opts;
 
     opts.acoustic_scale = 1.0; // by default do no scaling in this recipe.
 
@@ -104,6 +401,7 @@ int main(int argc, char *argv[]) {
 
     opts.Register(&po);
     compiler_config.Register(&po);
+    bucket_opts.Register(&po);
 
     po.Register("use-gpu", &use_gpu,
       "yes|no|optional|wait, only has effect if compiled with CUDA");
@@ -129,6 +427,8 @@ int main(int argc, char *argv[]) {
       po.PrintUsage();
       exit(1);
     }
+    if (bucket_opts.batch_size <= 0)
+      KALDI_ERR << "--batch-size must be positive.";
 
 #if HAVE_CUDA==1
     CuDevice::Instantiate().SelectGpuId(use_gpu);
@@ -154,12 +454,12 @@ int main(int argc, char *argv[]) {
     }
 
     BaseFloatVectorWriter vector_writer(vector_wspecifier);
-
     int32 num_success = 0, num_fail = 0;
     int64 frame_count = 0;
-    int32 xvector_dim = nnet.OutputDim("output");
 
     SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
+    BucketedXvectorComputer computer(bucket_opts, nnet, &compiler,
+                                     &vector_writer);
 
     for (; !feature_reader.Done(); feature_reader.Next()) {
       std::string utt = feature_reader.Key();
@@ -170,7 +470,6 @@ int main(int argc, char *argv[]) {
         continue;
       }
       int32 num_rows = features.NumRows(),
-            feat_dim = features.NumCols(),
             this_chunk_size = chunk_size;
       if (!pad_input && num_rows < min_chunk_size) {
         KALDI_WARN << "Minimum chunk size of " << min_chunk_size
@@ -187,49 +486,17 @@ int main(int argc, char *argv[]) {
         this_chunk_size = num_rows;
       }
 
-      int32 num_chunks = ceil(
-        num_rows / static_cast<BaseFloat>(this_chunk_size));
-      Vector<BaseFloat> xvector_avg(xvector_dim, kSetZero);
-      BaseFloat tot_weight = 0.0;
-
-      // Iterate over the feature chunks.
-      for (int32 chunk_indx = 0; chunk_indx < num_chunks; chunk_indx++) {
-        // If we're nearing the end of the input, we may need to shift the
-        // offset back so that we can get this_chunk_size frames of input to
-        // the nnet.
-        int32 offset = std::min(
-          this_chunk_size, num_rows - chunk_indx * this_chunk_size);
-        if (!pad_input && offset < min_chunk_size)
-          continue;
-        SubMatrix<BaseFloat> sub_features(
-          features, chunk_indx * this_chunk_size, offset, 0, feat_dim);
-        Vector<BaseFloat> xvector;
-        tot_weight += offset;
-
-        // Pad input if the offset is less than the minimum chunk size
-        if (pad_input && offset < min_chunk_size) {
-          Matrix<BaseFloat> padded_features(min_chunk_size, feat_dim);
-          int32 left_context = (min_chunk_size - offset) / 2;
-          int32 right_context = min_chunk_size - offset - left_context;
-          for (int32 i = 0; i < left_context; i++) {
-            padded_features.Row(i).CopyFromVec(sub_features.Row(0));
-          }
-          for (int32 i = 0; i < right_context; i++) {
-            padded_features.Row(min_chunk_size - i - 1).CopyFromVec(sub_features.Row(offset - 1));
-          }
-          padded_features.Range(left_context, offset, 0, feat_dim).CopyFromMat(sub_features);
-          RunNnetComputation(padded_features, nnet, &compiler, &xvector);
-        } else {
-          RunNnetComputation(sub_features, nnet, &compiler, &xvector);
-        }
-        xvector_avg.AddVec(offset, xvector);
-      }
-      xvector_avg.Scale(1.0 / tot_weight);
-      vector_writer.Write(utt, xvector_avg);
+      std::vector<Matrix<BaseFloat> > chunks;
+      std::vector<BaseFloat> weights;
+      SplitIntoChunks(features, this_chunk_size, min_chunk_size, pad_input,
+                      &chunks, &weights);
+      computer.AcceptUtterance(utt, &chunks, weights);
 
       frame_count += features.NumRows();
       num_success++;
     }
+    computer.Finish();
+    KALDI_ASSERT(computer.NumWritten() == num_success);
 
 #if HAVE_CUDA==1
     CuDevice::Instantiate().PrintProfile();
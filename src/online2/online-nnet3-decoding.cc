@@ -37,7 +37,8 @@ SingleUtteranceNnet3DecoderTpl<FST>::SingleUtteranceNnet3DecoderTpl(
     trans_model_(trans_model),
     decodable_(trans_model_, info,
                features->InputFeature(), features->IvectorFeature()),
-    decoder_(fst, decoder_opts_) {
+    decoder_(fst, decoder_opts_),
+    determinizer_(trans_model_, decoder_opts_) {
   decoder_.InitDecoding();
 }
 
@@ -45,6 +46,7 @@ template <typename FST>
 void SingleUtteranceNnet3DecoderTpl<FST>::InitDecoding(int32 frame_offset) {
   decoder_.InitDecoding();
   decodable_.SetFrameOffset(frame_offset);
+  determinizer_.Init();
 }
 
 template <typename FST>
@@ -67,15 +69,15 @@ void SingleUtteranceNnet3DecoderTpl<FST>::GetLattice(bool end_of_utterance,
                                              CompactLattice *clat) const {
   if (NumFramesDecoded() == 0)
     KALDI_ERR << "You cannot get a lattice if you decoded no frames.";
-  Lattice raw_lat;
-  decoder_.GetRawLattice(&raw_lat, end_of_utterance);
-
   if (!decoder_opts_.determinize_lattice)
     KALDI_ERR << "--determinize-lattice=false option is not supported at the moment";
+  determinizer_.GetLattice(decoder_, end_of_utterance, clat);
+}
 
-  BaseFloat lat_beam = decoder_opts_.lattice_beam;
-  DeterminizeLatticePhonePrunedWrapper(
-      trans_model_, &raw_lat, lat_beam, clat, decoder_opts_.det_opts);
+template <typename FST>
+int32 SingleUtteranceNnet3DecoderTpl<FST>::UpdateLatticeDeterminization(
+    int32 min_chunk_size) {
+  return determinizer_.Update(decoder_, min_chunk_size);
 }
 
 template <typename FST>
@@ -84,6 +84,26 @@ class SingleUtteranceNnet3DecoderTpl {
   void GetLattice(bool end_of_utterance,
                   CompactLattice *clat) const;
 
+  /// Determinizes, and stores, the part of the lattice that precedes the most
+  /// recent frame on which only a single token is active, provided that this
+  /// would add at least 'min_chunk_size' frames to the part already
+  /// determinized.  Calling this regularly (e.g. after each call to
+  /// AdvanceDecoding()) means that GetLattice() only has to determinize the
+  /// frames after that point, so the work done at the end of the utterance
+  /// (e.g. when an endpoint is detected) no longer grows with its length.
+  /// The lattice GetLattice() returns is equivalent to the one it would
+  /// return otherwise, but it may have epsilon arcs where the determinized
+  /// pieces were joined, and since each piece is pruned separately with
+  /// --lattice-beam it may retain a few more paths.
+  /// Returns the number of frames covered by the determinized part.
+  int32 UpdateLatticeDeterminization(int32 min_chunk_size);
+
+  /// Returns the number of frames for which the lattice has already been
+  /// determinized by UpdateLatticeDeterminization().
+  int32 NumFramesDeterminized() const {
+    return determinizer_.NumFramesDeterminized();
+  }
+
   /// Outputs an FST corresponding to the single best path through the current
   /// lattice. If "use_final_probs" is true AND we reached the final-state of
   /// the graph then it will include those as final-probs, else it will treat
@@ -115,6 +135,9 @@ class SingleUtteranceNnet3DecoderTpl {
 
   LatticeFasterOnlineDecoderTpl<FST> decoder_;
 
+  // Keeps the already-determinized part of the lattice; see
+  // UpdateLatticeDeterminization().
+  LatticeSegmentDeterminizer<FST> determinizer_;
 };
 
 
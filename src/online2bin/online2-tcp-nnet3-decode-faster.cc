@@ -147,6 +147,7 @@ int main(int argc, char *argv[]) {
     int port_num = 5050;
     int read_timeout = 3;
     bool produce_time = false;
+    int32 determinize_min_chunk_size = 0;
 
     po.Register("samp-freq", &samp_freq,
                 "Sampling frequency of the input signal (coded as 16-bit slinear).");
@@ -162,6 +163,11 @@ int main(int argc, char *argv[]) {
                 "Port number the server will listen on.");
     po.Register("produce-time", &produce_time,
                 "Prepend begin/end times between endpoints (e.g. '5.46 6.81 <text_output>', in seconds)");
+    po.Register("determinize-min-chunk-size", &determinize_min_chunk_size,
+                "If >0, determinize the lattice incrementally while decoding, "
+                "in chunks of at least this many frames, so that getting the "
+                "lattice at the end of an utterance is fast.  If <= 0, the "
+                "whole lattice is determinized at the end.");
 
     feature_opts.Register(&po);
     decodable_opts.Register(&po);
@@ -299,6 +305,8 @@ int main(int argc, char *argv[]) {
           }
 
           decoder.AdvanceDecoding();
+          if (determinize_min_chunk_size > 0)
+            decoder.UpdateLatticeDeterminization(determinize_min_chunk_size);
 
           if (samp_count > check_count) {
             if (decoder.NumFramesDecoded() > 0) {
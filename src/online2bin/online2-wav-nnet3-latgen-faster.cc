@@ -27,6 +27,7 @@
 #include "fstext/fstext-lib.h"
 #include "lat/lattice-functions.h"
 #include "util/kaldi-thread.h"
+#include "nnet3/am-nnet-mapped.h"
 #include "nnet3/nnet-utils.h"
 
 namespace kaldi {
@@ -108,6 +109,7 @@ int main(int argc, char *argv[]) {
     BaseFloat chunk_length_secs = 0.18;
     bool do_endpointing = false;
     bool online = true;
+    int32 determinize_min_chunk_size = 0;
 
     po.Register("chunk-length", &chunk_length_secs,
                 "Length of chunk size in seconds, that we process.  Set to <= 0 "
@@ -127,6 +129,11 @@ int main(int argc, char *argv[]) {
                 "--chunk-length=-1.");
     po.Register("num-threads-startup", &g_num_threads,
                 "Number of threads used when initializing iVector extractor.");
+    po.Register("determinize-min-chunk-size", &determinize_min_chunk_size,
+                "If >0, determinize the lattice incrementally while decoding, "
+                "in chunks of at least this many frames, so that getting the "
+                "lattice at the end of an utterance is fast.  If <= 0, the "
+                "whole lattice is determinized at the end.");
 
     feature_opts.Register(&po);
     decodable_opts.Register(&po);
@@ -162,10 +169,7 @@ int main(int argc, char *argv[]) {
     TransitionModel trans_model;
     nnet3::AmNnetSimple am_nnet;
     {
-      bool binary;
-      Input ki(nnet3_rxfilename, &binary);
-      trans_model.Read(ki.Stream(), binary);
-      am_nnet.Read(ki.Stream(), binary);
+      nnet3::ReadAmNnetMaybeMapped(nnet3_rxfilename, &trans_model, &am_nnet);
       SetBatchnormTestMode(true, &(am_nnet.GetNnet()));
       SetDropoutTestMode(true, &(am_nnet.GetNnet()));
       nnet3::CollapseModel(nnet3::CollapseModelConfig(), &(am_nnet.GetNnet()));
@@ -266,6 +270,8 @@ int main(int argc, char *argv[]) {
           }
 
           decoder.AdvanceDecoding();
+          if (determinize_min_chunk_size > 0)
+            decoder.UpdateLatticeDeterminization(determinize_min_chunk_size);
 
           if (do_endpointing && decoder.EndpointDetected(endpoint_opts)) {
             break;
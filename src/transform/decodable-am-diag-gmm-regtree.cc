@@ -26,6 +26,13 @@ using std::vector;
 namespace kaldi {
 
 
+void DecodableAmDiagGmmRegtreeFmllr::SetBatchComputer(
+    const AmDiagGmmBatchComputer *computer, int32 frames_per_block) {
+  if (computer != NULL)
+    KALDI_ERR << "Batched likelihood computation is not supported with "
+              << "regression-tree FMLLR.";
+}
+
 BaseFloat DecodableAmDiagGmmRegtreeFmllr::LogLikelihoodZeroBased(int32 frame,
                                                           int32 state) {
   KALDI_ASSERT(frame < NumFramesReady() && frame >= 0);
@@ -187,6 +194,13 @@ const Vector<BaseFloat>& DecodableAmDiagGmmRegtreeMllr::GetXformedGconsts(
   return *xformed_gconsts_[state];
 }
 
+void DecodableAmDiagGmmRegtreeMllr::SetBatchComputer(
+    const AmDiagGmmBatchComputer *computer, int32 frames_per_block) {
+  if (computer != NULL)
+    KALDI_ERR << "Batched likelihood computation is not supported with "
+              << "regression-tree MLLR.";
+}
+
 BaseFloat DecodableAmDiagGmmRegtreeMllr::LogLikelihoodZeroBased(int32 frame,
                                                                 int32 state) {
 //  KALDI_ERR << "Function not completely implemented yet.";
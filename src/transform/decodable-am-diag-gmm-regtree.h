@@ -59,6 +59,10 @@ class DecodableAmDiagGmmRegtreeFmllr: public DecodableAmDiagGmmUnmapped {
   // Indices are one-based!  This is for compatibility with OpenFst.
   virtual int32 NumIndices() const { return trans_model_.NumTransitionIds(); }
 
+  /// Not supported: the batch computer does not know about the transforms.
+  virtual void SetBatchComputer(const AmDiagGmmBatchComputer *computer,
+                                int32 frames_per_block = 8);
+
  protected:
   virtual BaseFloat LogLikelihoodZeroBased(int32 frame, int32 state_index);
 
@@ -104,6 +108,10 @@ class DecodableAmDiagGmmRegtreeMllr: public DecodableAmDiagGmmUnmapped {
 
   const TransitionModel *TransModel() { return &trans_model_; }
 
+  /// Not supported: the batch computer does not know about the transforms.
+  virtual void SetBatchComputer(const AmDiagGmmBatchComputer *computer,
+                                int32 frames_per_block = 8);
+
  protected:
   virtual BaseFloat LogLikelihoodZeroBased(int32 frame, int32 state_index);
 
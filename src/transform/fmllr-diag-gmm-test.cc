@@ -222,6 +222,32 @@ void UnitTestFmllrDiagGmmOffset() {
   // mean that something is wrong.
 }
 
+// Checks that accumulating the stats in two parts and adding them gives
+// the same stats as accumulating them all at once.
+void UnitTestFmllrDiagGmmAdd() {
+  using namespace kaldi;
+  DiagGmm gmm;
+  InitRandomGmm(&gmm);
+  int32 dim = gmm.Dim(), npoints = 20 + Rand() % 20;
+  FmllrDiagGmmAccs stats_all(dim), stats_a(dim), stats_b(dim);
+  for (int32 i = 0; i < npoints; i++) {
+    Vector<BaseFloat> row(dim);
+    gmm.Generate(&row);
+    Vector<BaseFloat> posteriors(gmm.NumGauss());
+    gmm.ComponentPosteriors(row, &posteriors);
+    stats_all.AccumulateFromPosteriors(gmm, row, posteriors);
+    (i % 2 == 0 ? stats_a : stats_b).AccumulateFromPosteriors(gmm, row,
+                                                              posteriors);
+  }
+  // stats_b still has the last frame in its single-frame stats.
+  stats_a.Add(stats_b);
+  stats_all.Add(FmllrDiagGmmAccs(dim));  // commits the last frame.
+  KALDI_ASSERT(ApproxEqual(stats_a.beta_, stats_all.beta_));
+  KALDI_ASSERT(stats_a.K_.ApproxEqual(stats_all.K_));
+  for (int32 d = 0; d < dim; d++)
+    KALDI_ASSERT(stats_a.G_[d].ApproxEqual(stats_all.G_[d]));
+}
+
 }  // namespace kaldi ends here
 
 int main() {
@@ -229,6 +255,7 @@ int main() {
     kaldi::UnitTestFmllrDiagGmmOffset();
     kaldi::UnitTestFmllrDiagGmmDiagonal();
     kaldi::UnitTestFmllrDiagGmm();
+    kaldi::UnitTestFmllrDiagGmmAdd();
   }
   std::cout << "Test OK.\n";
 }
@@ -559,6 +559,17 @@ void FmllrDiagGmmAccs::InitSingleFrameStats(const VectorBase<BaseFloat> &data) {
   stats.b.SetZero();
 }
 
+void FmllrDiagGmmAccs::Add(const FmllrDiagGmmAccs &other) {
+  CommitSingleFrameStats();
+  if (other.single_frame_stats_.count == 0.0) {
+    AffineXformStats::Add(other);
+  } else {
+    FmllrDiagGmmAccs other_copy(other);
+    other_copy.CommitSingleFrameStats();
+    AffineXformStats::Add(other_copy);
+  }
+}
+
 void FmllrDiagGmmAccs::CommitSingleFrameStats() {
   // Commit the stats for this from (in SingleFrameStats).
   int32 dim = Dim();
@@ -110,6 +110,12 @@ class FmllrDiagGmmAccs: public AffineXformStats {
       const VectorBase<BaseFloat> &data,
       const VectorBase<BaseFloat> &posteriors);
 
+
+  /// Adds the stats in "other" to this object (e.g. to combine the stats
+  /// accumulated in different threads), including the stats of the
+  /// current frame that neither object has committed yet.  This hides
+  /// AffineXformStats::Add(), which would ignore the latter.
+  void Add(const FmllrDiagGmmAccs &other);
   
   /// Update
   void Update(const FmllrOptions &opts,
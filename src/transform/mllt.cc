@@ -31,6 +31,13 @@ void MlltAccs::Init(int32 dim, BaseFloat rand_prune) {  // initializes (destroys
     G_[i].Resize(dim);  // will zero it too.
 }
 
+void MlltAccs::Add(const MlltAccs &other) {
+  KALDI_ASSERT(G_.size() == other.G_.size());
+  beta_ += other.beta_;
+  for (size_t i = 0; i < G_.size(); i++)
+    G_[i].AddSp(1.0, other.G_[i]);
+}
+
 void MlltAccs::Read(std::istream &is, bool binary, bool add) {
   ExpectToken(is, binary, "<MlltAccs>");
   double beta;
@@ -59,6 +59,10 @@ class MlltAccs {
 
   int32 Dim() { return G_.size(); };  // returns model dimension.
 
+  /// Adds the stats in "other" to this object (e.g. to combine the stats
+  /// accumulated in different threads).
+  void Add(const MlltAccs &other);
+
   /// The Update function does the ML update; it requires that M has the
   /// right size.
   ///  @param [in, out] M  The output transform, will be of dimension Dim() x Dim().
@@ -517,7 +517,8 @@ void TestClusterEventMapRestricted() {
     else
       map_clustered = ClusterEventMapRestrictedByMap(*split_tree, stats,
                                                      thresh, *table_split_map,
-                                                     &num_removed);
+                                                     &num_removed,
+                                                     1 + Rand() % 3);
 
     std::cout << "ClusterEventMapRestricted: num_removed = "<<num_removed;
     // should take it back to status after table split.
@@ -525,6 +526,25 @@ void TestClusterEventMapRestricted() {
     delete map_clustered;
   }
 
+  {  // Check that clustering in several threads gives the same map as
+     // clustering in one thread, with a threshold that only merges some of
+     // the leaves.
+    BaseFloat partial_thresh = 0.1 * RandInt(1, 10);
+    int32 num_removed, num_removed_threaded;
+    EventMap *map_clustered = ClusterEventMapRestrictedByMap(
+        *split_tree, stats, partial_thresh, *table_split_map, &num_removed, 1);
+    EventMap *map_clustered_threaded = ClusterEventMapRestrictedByMap(
+        *split_tree, stats, partial_thresh, *table_split_map,
+        &num_removed_threaded, 2 + Rand() % 3);
+    KALDI_ASSERT(num_removed_threaded == num_removed);
+    std::ostringstream os, os_threaded;
+    map_clustered->Write(os, false);
+    map_clustered_threaded->Write(os_threaded, false);
+    KALDI_ASSERT(os.str() == os_threaded.str());
+    delete map_clustered;
+    delete map_clustered_threaded;
+  }
+
   delete split_tree;
   delete trivial_map;
   delete table_split_map;
@@ -810,6 +830,25 @@ void TestSplitDecisionTree() {
                                                &num_leaves, &impr, &smallest_split);
       KALDI_ASSERT(num_leaves <= max_leaves && smallest_split >= thresh);
 
+      {  // Check that splitting in several threads gives the same tree.
+        int32 num_leaves_threaded = 0;
+        EventMap *trivial_tree_threaded = TrivialTree(&num_leaves_threaded);
+        BaseFloat impr_threaded, smallest_split_threaded;
+        EventMap *split_tree_threaded = SplitDecisionTree(
+            *trivial_tree_threaded, stats, qo, thresh, max_leaves,
+            &num_leaves_threaded, &impr_threaded, &smallest_split_threaded,
+            1 + Rand() % 4);
+        KALDI_ASSERT(num_leaves_threaded == num_leaves &&
+                     impr_threaded == impr &&
+                     smallest_split_threaded == smallest_split);
+        std::ostringstream os, os_threaded;
+        split_tree->Write(os, false);
+        split_tree_threaded->Write(os_threaded, false);
+        KALDI_ASSERT(os.str() == os_threaded.str());
+        delete trivial_tree_threaded;
+        delete split_tree_threaded;
+      }
+
       {
         BaseFloat impr_check = ObjfGivenMap(stats, *split_tree) - ObjfGivenMap(stats, *trivial_tree);
         std::cout << "Objf impr is " << impr << ", computed differently: " <<impr_check<<'\n';
@@ -17,9 +17,11 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <atomic>
 #include <set>
 #include <queue>
 #include "util/stl-utils.h"
+#include "util/kaldi-thread.h"
 #include "tree/build-tree-utils.h"
 
 
@@ -444,15 +446,28 @@ class DecisionTreeSplitter {
       best_split_impr_ = std::max(yes_->BestSplit(), no_->BestSplit());  // may have changed.
     }
   }
+  // Note: the caller must call FindBestSplits() on the new object before
+  // using it.
   DecisionTreeSplitter(EventAnswerType leaf, const BuildTreeStatsType &stats,
-                      const Questions &q_opts): q_opts_(q_opts), yes_(NULL), no_(NULL), leaf_(leaf), stats_(stats) {
-    // not, this must work when stats is empty too. [just gives zero improvement, non-splittable].
-    FindBestSplit();
-  }
+                       const Questions &q_opts, int32 num_threads):
+      q_opts_(q_opts), best_split_impr_(0.0), yes_(NULL), no_(NULL),
+      leaf_(leaf), stats_(stats), num_threads_(num_threads) { }
   ~DecisionTreeSplitter() {
     delete yes_;
     delete no_;
   }
+
+  // This sets best_split_impr_, key_ and yes_set_ for each of the leaf
+  // nodes in "nodes".  May just pick best question, or may iterate a bit
+  // (depends on q_opts; see FindBestSplitForKey for details).  The search
+  // over all (node, key) pairs is done in up to "num_threads" threads; the
+  // result does not depend on the number of threads.  Note, this must work
+  // when the stats are empty too [just gives zero improvement,
+  // non-splittable].
+  static void FindBestSplits(const std::vector<DecisionTreeSplitter*> &nodes,
+                             const Questions &q_opts,
+                             int32 num_threads);
+
  private:
   void DoSplitInternal(int32 *next_leaf) {
     // Does the split; applicable only to leaf nodes.
@@ -481,35 +496,15 @@ class DecisionTreeSplitter {
       delete yes_clust; delete no_clust;
     }
 #endif
-    yes_ = new DecisionTreeSplitter(yes_leaf, yes_stats, q_opts_);
-    no_ = new DecisionTreeSplitter(no_leaf, no_stats, q_opts_);
+    yes_ = new DecisionTreeSplitter(yes_leaf, yes_stats, q_opts_, num_threads_);
+    no_ = new DecisionTreeSplitter(no_leaf, no_stats, q_opts_, num_threads_);
+    std::vector<DecisionTreeSplitter*> children(2);
+    children[0] = yes_;
+    children[1] = no_;
+    FindBestSplits(children, q_opts_, num_threads_);
     best_split_impr_ = std::max(yes_->BestSplit(), no_->BestSplit());
     stats_.clear();  // note: pointers in stats_ were not owned here.
   }
-  void FindBestSplit() {
-    // This sets best_split_impr_, key_ and yes_set_.
-    // May just pick best question, or may iterate a bit (depends on
-    // q_opts; see FindBestSplitForKey for details)
-    std::vector<EventKeyType> all_keys;
-    q_opts_.GetKeysWithQuestions(&all_keys);
-    if (all_keys.size() == 0) {
-      KALDI_WARN << "DecisionTreeSplitter::FindBestSplit(), no keys available to split on (maybe no key covered all of your events, or there was a problem with your questions configuration?)";
-    }
-    best_split_impr_ = 0;
-    for (size_t i = 0; i < all_keys.size(); i++) {
-      if (q_opts_.HasQuestionsForKey(all_keys[i])) {
-        std::vector<EventValueType> temp_yes_set;
-        BaseFloat split_improvement = FindBestSplitForKey(stats_, q_opts_, all_keys[i], &temp_yes_set);
-        if (split_improvement > best_split_impr_) {
-          best_split_impr_ = split_improvement;
-          yes_set_ = temp_yes_set;
-          key_ = all_keys[i];
-        }
-      }
-    }
-  }
-
-
 
   // Data members... Always used:
   const Questions &q_opts_;
@@ -527,8 +522,97 @@ class DecisionTreeSplitter {
   EventKeyType key_;
   std::vector<EventValueType> yes_set_;
 
+  int32 num_threads_;
+};
+
+
+// This class is used in DecisionTreeSplitter::FindBestSplits() to call
+// FindBestSplitForKey() for a list of (node, key) pairs in parallel.  The
+// threads take the next unprocessed pair from a shared counter, as the cost
+// of the pairs varies a lot with the amount of stats.
+class FindBestSplitForKeyClass: public MultiThreadable {
+ public:
+  FindBestSplitForKeyClass(
+      const std::vector<const BuildTreeStatsType*> &stats,
+      const Questions &q_opts,
+      const std::vector<EventKeyType> &keys,
+      std::atomic<int32> *next_pair,
+      std::vector<BaseFloat> *improvements,
+      std::vector<std::vector<EventValueType> > *yes_sets):
+      stats_(stats), q_opts_(q_opts), keys_(keys), next_pair_(next_pair),
+      improvements_(improvements), yes_sets_(yes_sets) { }
+
+  void operator() () {
+    int32 num_keys = keys_.size(),
+        num_pairs = stats_.size() * num_keys;
+    for (int32 p = (*next_pair_)++; p < num_pairs; p = (*next_pair_)++) {
+      (*improvements_)[p] = FindBestSplitForKey(*(stats_[p / num_keys]),
+                                                q_opts_, keys_[p % num_keys],
+                                                &((*yes_sets_)[p]));
+    }
+  }
+ private:
+  const std::vector<const BuildTreeStatsType*> &stats_;
+  const Questions &q_opts_;
+  const std::vector<EventKeyType> &keys_;
+  std::atomic<int32> *next_pair_;
+  std::vector<BaseFloat> *improvements_;
+  std::vector<std::vector<EventValueType> > *yes_sets_;
 };
 
+
+void DecisionTreeSplitter::FindBestSplits(
+    const std::vector<DecisionTreeSplitter*> &nodes,
+    const Questions &q_opts,
+    int32 num_threads) {
+  std::vector<EventKeyType> all_keys, keys;
+  q_opts.GetKeysWithQuestions(&all_keys);
+  if (all_keys.size() == 0) {
+    KALDI_WARN << "DecisionTreeSplitter::FindBestSplit(), no keys available to split on (maybe no key covered all of your events, or there was a problem with your questions configuration?)";
+  }
+  for (size_t i = 0; i < all_keys.size(); i++)
+    if (q_opts.HasQuestionsForKey(all_keys[i]))
+      keys.push_back(all_keys[i]);
+
+  std::vector<const BuildTreeStatsType*> stats(nodes.size());
+  size_t tot_stats = 0;
+  for (size_t n = 0; n < nodes.size(); n++) {
+    stats[n] = &(nodes[n]->stats_);
+    tot_stats += nodes[n]->stats_.size();
+  }
+  int32 num_pairs = nodes.size() * keys.size();
+  std::vector<BaseFloat> improvements(num_pairs);
+  std::vector<std::vector<EventValueType> > yes_sets(num_pairs);
+  std::atomic<int32> next_pair(0);
+  FindBestSplitForKeyClass c(stats, q_opts, keys, &next_pair,
+                             &improvements, &yes_sets);
+  // Deep in the tree the nodes have few stats, and starting threads would
+  // cost more than it saves.
+  const size_t min_stats_for_threads = 1000;
+  if (num_threads <= 1 || num_pairs <= 1 || tot_stats < min_stats_for_threads) {
+    c();
+  } else {
+    MultiThreader<FindBestSplitForKeyClass> m(std::min(num_threads,
+                                                       num_pairs), c);
+  }
+
+  // Pick the best key for each node, in the same order as a sequential search
+  // would, so ties are resolved the same way whatever the number of threads.
+  for (size_t n = 0; n < nodes.size(); n++) {
+    DecisionTreeSplitter *node = nodes[n];
+    node->best_split_impr_ = 0;
+    for (size_t k = 0; k < keys.size(); k++) {
+      int32 p = n * keys.size() + k;
+      if (improvements[p] > node->best_split_impr_) {
+        node->best_split_impr_ = improvements[p];
+        node->yes_set_.swap(yes_sets[p]);
+        node->key_ = keys[k];
+      }
+    }
+  }
+}
+
+
 EventMap *SplitDecisionTree(const EventMap &input_map,
                             const BuildTreeStatsType &stats,
                             Questions &q_opts,
@@ -536,7 +620,8 @@ EventMap *SplitDecisionTree(const EventMap &input_map,
                             int32 max_leaves,  // max_leaves<=0 -> no maximum.
                             int32 *num_leaves,
                             BaseFloat *obj_impr_out,
-                            BaseFloat *smallest_split_change_out) {
+                            BaseFloat *smallest_split_change_out,
+                            int32 num_threads) {
   KALDI_ASSERT(num_leaves != NULL && *num_leaves > 0);  // can't be 0 or input_map would be empty.
   int32 num_empty_leaves = 0;
   BaseFloat like_impr = 0.0;
@@ -551,8 +636,10 @@ EventMap *SplitDecisionTree(const EventMap &input_map,
     for (size_t i = 0;i < split_stats.size();i++) {
       EventAnswerType leaf = static_cast<EventAnswerType>(i);
       if (split_stats[i].size() == 0) num_empty_leaves++;
-      builders[i] = new DecisionTreeSplitter(leaf, split_stats[i], q_opts);
+      builders[i] = new DecisionTreeSplitter(leaf, split_stats[i], q_opts,
+                                             num_threads);
     }
+    DecisionTreeSplitter::FindBestSplits(builders, q_opts, num_threads);
   }
 
   {  // Do the splitting.
@@ -835,20 +922,80 @@ EventMap *ClusterEventMapRestrictedByKeys(const EventMap &e_in,
 }
 
 
+// This class is used in ClusterEventMapRestrictedByMap() to call
+// ClusterEventMapGetMapping() on the classes of stats in parallel; each class
+// gets its own mapping, which are combined afterwards.
+class ClusterEventMapGetMappingClass: public MultiThreadable {
+ public:
+  ClusterEventMapGetMappingClass(
+      const EventMap &e_in,
+      const std::vector<BuildTreeStatsType> &split_stats,
+      BaseFloat thresh,
+      std::atomic<int32> *next_class,
+      std::vector<std::vector<EventMap*> > *mappings,
+      std::vector<int32> *num_removed):
+      e_in_(e_in), split_stats_(split_stats), thresh_(thresh),
+      next_class_(next_class), mappings_(mappings), num_removed_(num_removed) { }
+
+  void operator() () {
+    int32 num_classes = split_stats_.size();
+    for (int32 i = (*next_class_)++; i < num_classes; i = (*next_class_)++) {
+      if (!split_stats_[i].empty())
+        (*num_removed_)[i] = ClusterEventMapGetMapping(e_in_, split_stats_[i],
+                                                       thresh_,
+                                                       &((*mappings_)[i]));
+    }
+  }
+ private:
+  const EventMap &e_in_;
+  const std::vector<BuildTreeStatsType> &split_stats_;
+  BaseFloat thresh_;
+  std::atomic<int32> *next_class_;
+  std::vector<std::vector<EventMap*> > *mappings_;
+  std::vector<int32> *num_removed_;
+};
+
 EventMap *ClusterEventMapRestrictedByMap(const EventMap &e_in,
                                          const BuildTreeStatsType &stats,
                                          BaseFloat thresh,
                                          const EventMap &e_restrict,
-                                         int32 *num_removed_ptr) {
+                                         int32 *num_removed_ptr,
+                                         int32 num_threads) {
   std::vector<EventMap*> leaf_mapping;
 
   std::vector<BuildTreeStatsType> split_stats;
   int num_removed = 0;
   SplitStatsByMap(stats, e_restrict, &split_stats);
-  for (size_t i = 0; i < split_stats.size(); i++) {
-    if (!split_stats[i].empty())
-      num_removed += ClusterEventMapGetMapping(e_in, split_stats[i], thresh,
-                                               &leaf_mapping);
+  if (num_threads <= 1) {
+    for (size_t i = 0; i < split_stats.size(); i++) {
+      if (!split_stats[i].empty())
+        num_removed += ClusterEventMapGetMapping(e_in, split_stats[i], thresh,
+                                                 &leaf_mapping);
+    }
+  } else {
+    int32 num_classes = split_stats.size();
+    std::vector<std::vector<EventMap*> > mappings(num_classes);
+    std::vector<int32> num_removed_per_class(num_classes, 0);
+    std::atomic<int32> next_class(0);
+    {
+      ClusterEventMapGetMappingClass c(e_in, split_stats, thresh, &next_class,
+                                       &mappings, &num_removed_per_class);
+      MultiThreader<ClusterEventMapGetMappingClass> m(
+          std::min(num_threads, std::max(num_classes, 1)), c);
+    }
+    for (int32 i = 0; i < num_classes; i++) {
+      num_removed += num_removed_per_class[i];
+      if (mappings[i].size() > leaf_mapping.size())
+        leaf_mapping.resize(mappings[i].size(), NULL);
+      for (size_t j = 0; j < mappings[i].size(); j++) {
+        if (mappings[i][j] != NULL) {
+          KALDI_ASSERT(leaf_mapping[j] == NULL || "Error: Cluster seems to have been "
+                       "called for different parts of the tree with overlapping sets of "
+                       "indices.");
+          leaf_mapping[j] = mappings[i][j];
+        }
+      }
+    }
   }
 
   if (num_removed_ptr != NULL) *num_removed_ptr = num_removed;
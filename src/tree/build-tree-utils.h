@@ -215,12 +215,14 @@ EventMap *ClusterEventMapRestrictedByKeys(const EventMap &e_in,
 
 /// This version of ClusterEventMapRestricted restricts the clustering to only
 /// allow things that "e_restrict" maps to the same value to be clustered
-/// together.
+/// together.  The classes defined by "e_restrict" are clustered in up to
+/// "num_threads" threads; the output does not depend on the number of threads.
 EventMap *ClusterEventMapRestrictedByMap(const EventMap &e_in,
                                          const BuildTreeStatsType &stats,
                                          BaseFloat thresh,
                                          const EventMap &e_restrict,
-                                         int32 *num_removed);
+                                         int32 *num_removed,
+                                         int32 num_threads = 1);
 
 
 /// This version of ClusterEventMapRestrictedByMap clusters to get a
@@ -278,6 +280,9 @@ EventMap *ShareEventMapLeaves(const EventMap &e_in, EventKeyType key,
 /// @param smallest_split_change_out If non-NULL, will be set to the smallest objective-function
 ///         improvement that we got from splitting any leaf; useful to provide a threshold
 ///         for ClusterEventMap.
+/// @param num_threads [in] The number of threads used in the search for the best
+///         question to split each leaf on (the search is done in parallel over
+///         leaves and keys).  The tree does not depend on the number of threads.
 /// @return The EventMap after splitting is returned; pointer is owned by caller.
 EventMap *SplitDecisionTree(const EventMap &orig,
                             const BuildTreeStatsType &stats,
@@ -286,7 +291,8 @@ EventMap *SplitDecisionTree(const EventMap &orig,
                             int32 max_leaves,  // max_leaves<=0 -> no maximum.
                             int32 *num_leaves,
                             BaseFloat *objf_impr_out,
-                            BaseFloat *smallest_split_change_out);
+                            BaseFloat *smallest_split_change_out,
+                            int32 num_threads = 1);
 
 /// CreateRandomQuestions will initialize a Questions randomly, in a reasonable
 /// way [for testing purposes, or when hand-designed questions are not available].
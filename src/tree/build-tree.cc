@@ -19,6 +19,7 @@
 
 #include <set>
 #include <queue>
+#include "base/timer.h"
 #include "util/stl-utils.h"
 #include "tree/build-tree-utils.h"
 #include "tree/clusterable-classes.h"
@@ -143,7 +144,8 @@ EventMap *BuildTree(Questions &qopts,
                     int32 max_leaves,
                     BaseFloat cluster_thresh,  // typically == thresh.  If negative, use smallest split.
                     int32 P,
-                    bool round_num_leaves) {
+                    bool round_num_leaves,
+                    int32 num_threads) {
   KALDI_ASSERT(thresh > 0 || max_leaves > 0);
   KALDI_ASSERT(stats.size() != 0);
   KALDI_ASSERT(!phone_sets.empty()
@@ -178,10 +180,14 @@ EventMap *BuildTree(Questions &qopts,
                    // in "nonsplit_phones"
                    &filtered_stats);
 
+  Timer timer;
   EventMap *tree_split = SplitDecisionTree(*tree_stub,
                                            filtered_stats,
                                            qopts, thresh, max_leaves,
-                                           &num_leaves, &impr, &smallest_split);
+                                           &num_leaves, &impr, &smallest_split,
+                                           num_threads);
+  KALDI_LOG << "BuildTree: decision-tree splitting took "
+            << timer.Elapsed() << " seconds.";
 
   if (cluster_thresh < 0.0) {
     KALDI_LOG <<  "Setting clustering threshold to smallest split " << smallest_split;
@@ -207,12 +213,15 @@ EventMap *BuildTree(Questions &qopts,
 
     // Now do the clustering.
     int32 num_removed = 0;
+    timer.Reset();
     EventMap *tree_clustered = ClusterEventMapRestrictedByMap(*tree_split,
                                                               stats,
                                                               cluster_thresh,
                                                               *tree_stub,
-                                                              &num_removed);
-    KALDI_LOG <<  "BuildTree: removed "<< num_removed << " leaves.";
+                                                              &num_removed,
+                                                              num_threads);
+    KALDI_LOG <<  "BuildTree: removed "<< num_removed << " leaves; clustering "
+              << "took " << timer.Elapsed() << " seconds.";
 
     int32 num_leaves_out = 0;
     EventMap *tree_renumbered;
@@ -223,13 +232,15 @@ EventMap *BuildTree(Questions &qopts,
       std::vector<EventMap*> leaf_mapping;
 
       int32 num_removed_in_rounding = 0;
+      timer.Reset();
       EventMap *tree_rounded = ClusterEventMapToNClustersRestrictedByMap(
           *tree_clustered, stats, num_leaves_required, *tree_stub,
           &num_removed_in_rounding);
 
       if (num_removed_in_rounding > 0)
         KALDI_LOG <<  "BuildTree: Rounded num leaves to multiple of 8 by"
-                  << " removing " << num_removed_in_rounding << " leaves.";
+                  << " removing " << num_removed_in_rounding << " leaves; this"
+                  << " took " << timer.Elapsed() << " seconds.";
 
       if (num_leaves - num_removed - num_removed_in_rounding !=
           num_leaves_required) {
@@ -276,13 +287,15 @@ EventMap *BuildTree(Questions &qopts,
       std::vector<EventMap*> leaf_mapping;
 
       int32 num_removed_in_rounding = 0;
+      timer.Reset();
       EventMap *tree_rounded = ClusterEventMapToNClustersRestrictedByMap(
           *tree_split, stats, num_leaves_required, *tree_stub,
           &num_removed_in_rounding);
 
       if (num_removed_in_rounding > 0)
         KALDI_LOG <<  "BuildTree: Rounded num leaves to multiple of 8 by"
-                  << " removing " << num_removed_in_rounding << " leaves.";
+                  << " removing " << num_removed_in_rounding << " leaves; this"
+                  << " took " << timer.Elapsed() << " seconds.";
 
       KALDI_ASSERT(num_removed_in_rounding < 8);
 
@@ -17,6 +17,8 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <limits>
+
 #include "tree/cluster-utils.h"
 #include "tree/clusterable-classes.h"
 #include "util/stl-utils.h"
@@ -282,6 +284,60 @@ static void TestClusterBottomUp() {
 
 }
 
+// Checks ClusterBottomUp against a simple (cubic-time) implementation that
+// merges the closest pair of clusters on each iteration.
+static void TestClusterBottomUpBruteForce() {
+  for (size_t i = 0; i < 10; i++) {
+    size_t n_points = Rand() % 60;
+    std::vector<Clusterable*> points;
+    for (size_t j = 0; j < n_points; j++)
+      points.push_back(new ScalarClusterable(RandGauss()));
+    BaseFloat max_merge_thresh = 0.5 * RandUniform();
+    int32 min_clust = Rand() % 5;
+
+    std::vector<int32> assignments;
+    ClusterBottomUp(points, max_merge_thresh, min_clust, NULL, &assignments);
+
+    std::vector<Clusterable*> ref_clusters;
+    std::vector<int32> ref_assignments(n_points);
+    for (size_t j = 0; j < n_points; j++) {
+      ref_clusters.push_back(points[j]->Copy());
+      ref_assignments[j] = j;
+    }
+    int32 num_clust = n_points;
+    while (num_clust > min_clust) {
+      BaseFloat best_dist = std::numeric_limits<BaseFloat>::infinity();
+      int32 best_j = -1, best_k = -1;
+      for (int32 j = 0; j < n_points; j++) {
+        if (ref_clusters[j] == NULL) continue;
+        for (int32 k = j + 1; k < n_points; k++) {
+          if (ref_clusters[k] == NULL) continue;
+          BaseFloat dist = ref_clusters[j]->Distance(*(ref_clusters[k]));
+          if (dist < best_dist) {
+            best_dist = dist;
+            best_j = j;
+            best_k = k;
+          }
+        }
+      }
+      if (best_j == -1 || best_dist > max_merge_thresh) break;
+      ref_clusters[best_j]->Add(*(ref_clusters[best_k]));
+      delete ref_clusters[best_k];
+      ref_clusters[best_k] = NULL;
+      for (size_t j = 0; j < n_points; j++)
+        if (ref_assignments[j] == best_k) ref_assignments[j] = best_j;
+      num_clust--;
+    }
+    KALDI_ASSERT(assignments.size() == n_points);
+    for (size_t j = 0; j < n_points; j++)
+      for (size_t k = 0; k < n_points; k++)
+        KALDI_ASSERT((assignments[j] == assignments[k]) ==
+                     (ref_assignments[j] == ref_assignments[k]));
+    DeletePointers(&ref_clusters);
+    DeletePointers(&points);
+  }
+}
+
 
 static void TestRefineClusters() {
   for (size_t n = 0;n < 4;n++) {
@@ -572,5 +628,6 @@ int main() {
   TestClusterKMeans();
   TestClusterKMeansVector();
   TestClusterBottomUp();
+  TestClusterBottomUpBruteForce();
   TestRefineClusters();
 }
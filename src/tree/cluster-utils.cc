@@ -19,6 +19,7 @@
 // limitations under the License.
 
 #include <functional>
+#include <limits>
 #include <queue>
 #include <vector>
 using std::vector;
@@ -190,6 +191,17 @@ void AddToClustersOptimized(const std::vector<Clusterable*> &stats,
 // Bottom-up clustering routines
 // ============================================================================
 
+// BottomUpClusterer stores the distances between the clusters in an
+// upper-triangular array (row i holds the distances to clusters j > i), and
+// for each row the nearest neighbour in that row and its distance, which is
+// allowed to be a lower bound on the real distance: after a merge we only
+// update the rows whose distance to the merged cluster went down, and a row
+// whose neighbour got further away (or was merged away) is rescanned only when
+// it reaches the top of the priority queue.  The queue holds one entry per row
+// [plus stale entries, which are skipped], so both the time per merge and the
+// memory are O(npoints) rather than O(npoints^2) for a queue of all pairs.  Pairs
+// are ordered by (distance, larger index, smaller index), so ties are broken
+// deterministically.
 class BottomUpClusterer {
  public:
   BottomUpClusterer(const std::vector<Clusterable*> &points,
@@ -202,7 +214,7 @@ class BottomUpClusterer {
             : &tmp_clusters_), assignments_(assignments_out != NULL ?
                 assignments_out : &tmp_assignments_) {
     nclusters_ = npoints_ = points.size();
-    dist_vec_.resize((npoints_ * (npoints_ - 1)) / 2);
+    dist_vec_.resize((static_cast<size_t>(npoints_) * (npoints_ - 1)) / 2);
   }
 
   BaseFloat Cluster();
@@ -211,19 +223,23 @@ class BottomUpClusterer {
  private:
   void Renumber();
   void InitializeAssignments();
-  void SetInitialDistances();  ///< Sets up distances and queue.
-  /// CanMerge returns true if i and j are existing clusters, and the distance
-  /// (negated objf-change) "dist" is accurate (i.e. not outdated).
-  bool CanMerge(int32 i, int32 j, BaseFloat dist);
-  /// Merge j into i and delete j.
+  void SetInitialDistances();  ///< Sets up distances, neighbours and queue.
+  /// Merge j into i and delete j; requires j < i.
   void MergeClusters(int32 i, int32 j);
-  /// Reconstructs the priority queue from the distances.
+  /// Reconstructs the priority queue from the nearest neighbours.
   void ReconstructQueue();
+  /// Finds the nearest neighbour of cluster i among the clusters j > i, and
+  /// adds it to the queue.
+  void FindNearestNeighbor(int32 i);
+  /// Adds the pair (i, nearest_[i]) to the queue, if it could be merged.
+  void PushNearestNeighbor(int32 i);
 
   void SetDistance(int32 i, int32 j);
+  // Requires i > j.
   BaseFloat& Distance(int32 i, int32 j) {
-    KALDI_ASSERT(i < npoints_ && j < i);
-    return dist_vec_[(i * (i - 1)) / 2 + j];
+    KALDI_PARANOID_ASSERT(i < npoints_ && j < i);
+    return dist_vec_[(static_cast<size_t>(j) * (2 * npoints_ - j - 1)) / 2 +
+                     (i - j - 1)];
   }
 
   BaseFloat ans_;
@@ -237,8 +253,15 @@ class BottomUpClusterer {
   std::vector<int32> tmp_assignments_;
 
   std::vector<BaseFloat> dist_vec_;
+  // nearest_[i] is the cluster j > i closest to i, or -1 if there is none,
+  // and nearest_dist_[i] is a lower bound on Distance(nearest_[i], i).  The
+  // pair (nearest_dist_[i], nearest_[i]) is never greater than the real
+  // (distance, index) of any cluster j > i.
+  std::vector<int32> nearest_;
+  std::vector<BaseFloat> nearest_dist_;
   int32 nclusters_;
   int32 npoints_;
+  // Elements are (distance, (larger index, smaller index)).
   typedef std::pair<BaseFloat, std::pair<uint_smaller, uint_smaller> > QueueElement;
   // Priority queue using greater (lowest distances are highest priority).
   typedef std::priority_queue<QueueElement, std::vector<QueueElement>,
@@ -258,7 +281,15 @@ BaseFloat BottomUpClusterer::Cluster() {
     BaseFloat dist = pr.first;
     int32 i = (int32) pr.second.first, j = (int32) pr.second.second;
     queue_.pop();
-    if (CanMerge(i, j, dist)) MergeClusters(i, j);
+    if ((*clusters_)[j] == NULL || nearest_[j] != i || nearest_dist_[j] != dist)
+      continue;  // stale queue entry.
+    if ((*clusters_)[i] == NULL || Distance(i, j) != dist) {
+      // the neighbour was merged away or got further away; the row has to be
+      // rescanned.
+      FindNearestNeighbor(j);
+      continue;
+    }
+    MergeClusters(i, j);
   }
   KALDI_VLOG(2) << "Renumbering clusters to contiguous numbers.";
   Renumber();
@@ -272,17 +303,6 @@ void BottomUpClusterer::Renumber() {
     tmp.swap(dist_vec_);
   }
 
-// Commented the following out since it was causing the process to take up too
-// much memory with larger models. While the swap() method of STL types swaps 
-// the data pointers, std::swap() creates a temporary copy. -Arnab
-//  KALDI_VLOG(2) << "Freeing up the queue";
-//   // first free up memory by getting rid of queue.  this is a special trick
-//   // to force STL to free memory.
-//  {
-//    QueueType tmp;
-//    std::swap(tmp, queue_);
-//  }
-
   // called after clustering, renumbers to make clusters contiguously
   // numbered. also processes assignments_ to remove chains of references.
   KALDI_VLOG(2) << "Creating new copy of non-NULL clusters.";
@@ -323,46 +343,74 @@ void BottomUpClusterer::InitializeAssignments() {
 }
 
 void BottomUpClusterer::SetInitialDistances() {
-  for (int32 i = 0; i < npoints_; i++) {
-    for (int32 j = 0; j < i; j++) {
-      BaseFloat dist = (*clusters_)[i]->Distance(*((*clusters_)[j]));
-      dist_vec_[(i * (i - 1)) / 2 + j] = dist;
-      if (dist <= max_merge_thresh_)
-        queue_.push(std::make_pair(dist, std::make_pair(static_cast<uint_smaller>(i),
-            static_cast<uint_smaller>(j))));
+  nearest_.resize(npoints_, -1);
+  nearest_dist_.resize(npoints_, std::numeric_limits<BaseFloat>::infinity());
+  for (int32 j = 0; j < npoints_; j++) {
+    for (int32 i = j + 1; i < npoints_; i++)
+      SetDistance(i, j);
+    FindNearestNeighbor(j);
+  }
+}
+
+void BottomUpClusterer::FindNearestNeighbor(int32 j) {
+  int32 best = -1;
+  BaseFloat best_dist = std::numeric_limits<BaseFloat>::infinity();
+  for (int32 i = j + 1; i < npoints_; i++) {
+    if ((*clusters_)[i] != NULL) {
+      BaseFloat dist = Distance(i, j);
+      if (best == -1 || dist < best_dist) {
+        best = i;
+        best_dist = dist;
+      }
     }
   }
+  nearest_[j] = best;
+  nearest_dist_[j] = best_dist;
+  PushNearestNeighbor(j);
 }
 
-bool BottomUpClusterer::CanMerge(int32 i, int32 j, BaseFloat dist) {
-  KALDI_ASSERT(i != j && i < npoints_ && j < npoints_);
-  if ((*clusters_)[i] == NULL || (*clusters_)[j] == NULL)
-    return false;
-  BaseFloat cached_dist = dist_vec_[(i * (i - 1)) / 2 + j];
-  return (std::fabs(cached_dist - dist) <= 1.0e-05 * std::fabs(dist));
+void BottomUpClusterer::PushNearestNeighbor(int32 j) {
+  int32 i = nearest_[j];
+  if (i == -1 || !(nearest_dist_[j] <= max_merge_thresh_)) return;
+  queue_.push(std::make_pair(nearest_dist_[j], std::make_pair(
+      static_cast<uint_smaller>(i), static_cast<uint_smaller>(j))));
+  // Control memory use by getting rid of orphaned queue entries.
+  if (queue_.size() >= 4 * static_cast<size_t>(npoints_))
+    ReconstructQueue();
 }
 
 void BottomUpClusterer::MergeClusters(int32 i, int32 j) {
-  KALDI_ASSERT(i != j && i < npoints_ && j < npoints_);
+  KALDI_ASSERT(j < i && i < npoints_);
   (*clusters_)[i]->Add(*((*clusters_)[j]));
   delete (*clusters_)[j];
   (*clusters_)[j] = NULL;
+  nearest_[j] = -1;
   // note that we may have to follow the chain within "assignment_" to get
   // final assignments.
   (*assignments_)[j] = i;
   // subtract negated objective function change, i.e. add objective function
   // change.
-  ans_ -= dist_vec_[(i * (i - 1)) / 2 + j];
+  ans_ -= Distance(i, j);
   nclusters_--;
-  // Now update "distances".
+  // Now update "distances", and the neighbours of the clusters k < i where the
+  // distance to i went down [the others can wait until they are popped].
   for (int32 k = 0; k < npoints_; k++) {
     if (k != i && (*clusters_)[k] != NULL) {
-      if (k < i)
+      if (k < i) {
         SetDistance(i, k);  // SetDistance requires k < i.
-      else
+        BaseFloat dist = Distance(i, k);
+        if (dist < nearest_dist_[k] ||
+            (dist == nearest_dist_[k] && i < nearest_[k])) {
+          nearest_[k] = i;
+          nearest_dist_[k] = dist;
+          PushNearestNeighbor(k);
+        }
+      } else {
         SetDistance(k, i);
+      }
     }
   }
+  FindNearestNeighbor(i);
 }
 
 void BottomUpClusterer::ReconstructQueue() {
@@ -371,17 +419,12 @@ void BottomUpClusterer::ReconstructQueue() {
     QueueType tmp;
     std::swap(tmp, queue_);
   }
-  for (int32 i = 0; i < npoints_; i++) {
-    if ((*clusters_)[i] != NULL) {
-      for (int32 j = 0; j < i; j++) {
-        if ((*clusters_)[j] != NULL) {
-          BaseFloat dist = dist_vec_[(i * (i - 1)) / 2 + j];
-          if (dist <= max_merge_thresh_) {
-            queue_.push(std::make_pair(dist, std::make_pair(
-                static_cast<uint_smaller>(i), static_cast<uint_smaller>(j))));
-          }
-        }
-      }
+  for (int32 j = 0; j < npoints_; j++) {
+    int32 i = nearest_[j];
+    if ((*clusters_)[j] != NULL && i != -1 &&
+        nearest_dist_[j] <= max_merge_thresh_) {
+      queue_.push(std::make_pair(nearest_dist_[j], std::make_pair(
+          static_cast<uint_smaller>(i), static_cast<uint_smaller>(j))));
     }
   }
 }
@@ -389,17 +432,8 @@ void BottomUpClusterer::ReconstructQueue() {
 void BottomUpClusterer::SetDistance(int32 i, int32 j) {
   KALDI_ASSERT(i < npoints_ && j < i && (*clusters_)[i] != NULL
          && (*clusters_)[j] != NULL);
-  BaseFloat dist = (*clusters_)[i]->Distance(*((*clusters_)[j]));
-  dist_vec_[(i * (i - 1)) / 2 + j] = dist;  // set the distance in the array.
-  if (dist < max_merge_thresh_) {
-    queue_.push(std::make_pair(dist, std::make_pair(static_cast<uint_smaller>(i),
-        static_cast<uint_smaller>(j))));
-  }
-  // every time it's at least twice the maximum possible size.
-  if (queue_.size() >= static_cast<size_t> (npoints_ * npoints_)) {
-    // Control memory use by getting rid of orphaned queue entries
-    ReconstructQueue();
-  }
+  // set the distance in the array.
+  Distance(i, j) = (*clusters_)[i]->Distance(*((*clusters_)[j]));
 }
 
 
@@ -0,0 +1,63 @@
+// util/kaldi-mmap-test.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdio>
+#include <cstring>
+#include "util/kaldi-io.h"
+#include "util/kaldi-mmap.h"
+#include "base/kaldi-math.h"
+
+namespace kaldi {
+
+void UnitTestMappedFile(bool allow_mmap) {
+  std::string filename = "tmpf";
+  std::vector<char> contents(Rand() % 100000);
+  for (size_t i = 0; i < contents.size(); i++)
+    contents[i] = static_cast<char>(Rand() % 256);
+  {
+    Output ko(filename, true, false);
+    if (!contents.empty())
+      ko.Stream().write(&(contents[0]), contents.size());
+    ko.Close();
+  }
+  for (int32 i = 0; i < 2; i++) {
+    // The second time, read it through a pipe so it can't be mapped.
+    std::string rxfilename = (i == 0 ? filename : "cat " + filename + " |");
+    MappedFile mf(rxfilename, allow_mmap);
+    KALDI_ASSERT(mf.Size() == contents.size());
+    KALDI_ASSERT(reinterpret_cast<size_t>(mf.Data()) % 8 == 0);
+    if (!contents.empty())
+      KALDI_ASSERT(memcmp(mf.Data(), &(contents[0]), contents.size()) == 0);
+    if (i != 0 || !allow_mmap)
+      KALDI_ASSERT(!mf.IsMapped());
+  }
+  MappedFile mf;
+  KALDI_ASSERT(!mf.Open("/nonexistent/file", allow_mmap));
+  std::remove(filename.c_str());
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 5; i++) {
+    UnitTestMappedFile(true);
+    UnitTestMappedFile(false);
+  }
+  KALDI_LOG << "Success.";
+  return 0;
+}
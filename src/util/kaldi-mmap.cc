@@ -0,0 +1,109 @@
+// util/kaldi-mmap.cc
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cerrno>
+#include <cstring>
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "util/kaldi-io.h"
+#include "util/kaldi-mmap.h"
+
+namespace kaldi {
+
+MappedFile::MappedFile(const std::string &rxfilename, bool allow_mmap):
+    data_(NULL), size_(0), mapped_(false) {
+  if (!Open(rxfilename, allow_mmap))
+    KALDI_ERR << "Error opening file " << PrintableRxfilename(rxfilename);
+}
+
+bool MappedFile::Open(const std::string &rxfilename, bool allow_mmap) {
+  Close();
+#ifndef _MSC_VER
+  if (allow_mmap && ClassifyRxfilename(rxfilename) == kFileInput) {
+    int fd = open(rxfilename.c_str(), O_RDONLY);
+    if (fd == -1) {
+      KALDI_WARN << "Could not open " << rxfilename << ": "
+                 << strerror(errno);
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      KALDI_WARN << "Could not stat " << rxfilename << ": "
+                 << strerror(errno);
+      close(fd);
+      return false;
+    }
+    size_ = st.st_size;
+    if (size_ == 0) {  // mmap() does not accept zero-length mappings.
+      close(fd);
+      return true;
+    }
+    void *addr = mmap(NULL, size_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);  // the mapping stays valid after the descriptor is closed.
+    if (addr != MAP_FAILED) {
+      data_ = static_cast<const char*>(addr);
+      mapped_ = true;
+      return true;
+    }
+    KALDI_WARN << "Could not memory-map " << rxfilename << " ("
+               << strerror(errno) << "), reading it instead.";
+    size_ = 0;
+  }
+#endif
+  Input ki;
+  if (!ki.Open(rxfilename))
+    return false;
+  std::istream &is = ki.Stream();
+  std::vector<char> contents;
+  const size_t chunk = 1 << 20;
+  while (is.good()) {
+    size_t old_size = contents.size();
+    contents.resize(old_size + chunk);
+    is.read(&(contents[old_size]), chunk);
+    contents.resize(old_size + is.gcount());
+  }
+  if (is.bad()) {
+    KALDI_WARN << "Error reading " << PrintableRxfilename(rxfilename);
+    return false;
+  }
+  size_ = contents.size();
+  buffer_.resize((size_ + sizeof(uint64) - 1) / sizeof(uint64));
+  if (size_ != 0)
+    memcpy(&(buffer_[0]), &(contents[0]), size_);
+  data_ = reinterpret_cast<const char*>(buffer_.empty() ? NULL : &(buffer_[0]));
+  return true;
+}
+
+void MappedFile::Close() {
+#ifndef _MSC_VER
+  if (mapped_)
+    munmap(const_cast<char*>(data_), size_);
+#endif
+  data_ = NULL;
+  size_ = 0;
+  mapped_ = false;
+  std::vector<uint64> empty;
+  buffer_.swap(empty);
+}
+
+}  // namespace kaldi
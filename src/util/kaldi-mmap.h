@@ -0,0 +1,73 @@
+// util/kaldi-mmap.h
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_UTIL_KALDI_MMAP_H_
+#define KALDI_UTIL_KALDI_MMAP_H_
+
+#include <string>
+#include <vector>
+
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/// MappedFile gives read-only access to the whole contents of a file, for
+/// file formats that are designed to be used in place (flat arrays with a
+/// fixed layout) rather than parsed.  If the rxfilename is an ordinary file
+/// and the platform supports it, the file is memory-mapped, so the pages are
+/// only read from disk when they are touched and are shared between all the
+/// processes that map the same file.  Otherwise (pipes, standard input,
+/// offsets into archives, or Windows) the contents are read into a buffer
+/// owned by this object, so the calling code does not have to care which
+/// method was used.  The data is aligned to at least 8 bytes.
+class MappedFile {
+ public:
+  MappedFile(): data_(NULL), size_(0), mapped_(false) { }
+
+  /// Opens the file; throws on error.  "rxfilename" is interpreted as for
+  /// class Input.  If "allow_mmap" is false, the file is always read into
+  /// memory.
+  explicit MappedFile(const std::string &rxfilename, bool allow_mmap = true);
+
+  /// As the constructor, but returns false on error instead of throwing.
+  /// Any previously opened file is closed first.
+  bool Open(const std::string &rxfilename, bool allow_mmap = true);
+
+  void Close();
+
+  const char *Data() const { return data_; }
+  size_t Size() const { return size_; }
+
+  /// Returns true if the data is memory-mapped (as opposed to having been
+  /// read into memory).
+  bool IsMapped() const { return mapped_; }
+
+  ~MappedFile() { Close(); }
+ private:
+  const char *data_;
+  size_t size_;
+  bool mapped_;
+  std::vector<uint64> buffer_;  // used if we could not map the file.  uint64
+                                // so the data is 8-byte aligned.
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MappedFile);
+};
+
+
+}  // namespace kaldi
+
+#endif  // KALDI_UTIL_KALDI_MMAP_H_
@@ -123,6 +123,48 @@ void TestTaskSequencer() {
 }
 
 
+// Adds i to one of the accumulators in the pool, checking that no other
+// task is using that accumulator at the same time.
+class MyAccumulateClass {
+ public:
+  MyAccumulateClass(int32 i, ObjectPool<std::pair<int64, int32> > *pool):
+      i_(i), pool_(pool) { }
+
+  void operator() () {
+    std::pair<int64, int32> *acc = pool_->Acquire();
+    KALDI_ASSERT(acc->second == 0);
+    acc->second = 1;  // mark as in use.
+    int32 spin = 1000000 * Rand() % 100;
+    for (int32 i = 0; i < spin; i++);
+    acc->first += i_;
+    acc->second = 0;
+    pool_->Release(acc);
+  }
+
+ private:
+  int32 i_;
+  ObjectPool<std::pair<int64, int32> > *pool_;
+};
+
+void TestObjectPool() {
+  TaskSequencerConfig config;
+  config.num_threads = Rand() % 10;
+  int32 num_tasks = Rand() % 100;
+  std::vector<std::pair<int64, int32>* > accs;
+  for (int32 i = 0; i < std::max<int32>(1, config.num_threads); i++)
+    accs.push_back(new std::pair<int64, int32>(0, 0));
+  ObjectPool<std::pair<int64, int32> > pool(accs);
+  {
+    TaskSequencer<MyAccumulateClass> sequencer(config);
+    for (int32 i = 0; i < num_tasks; i++)
+      sequencer.Run(new MyAccumulateClass(i, &pool));
+  }
+  int64 sum = 0;
+  for (size_t i = 0; i < pool.Objects().size(); i++)
+    sum += pool.Objects()[i]->first;
+  KALDI_ASSERT(sum == static_cast<int64>(num_tasks) * (num_tasks - 1) / 2);
+}
+
 }  // end namespace kaldi.
 
 int main() {
@@ -130,4 +172,6 @@ int main() {
   TestThreads();
   for (int32 i = 0; i < 10; i++)
     TestTaskSequencer();
+  for (int32 i = 0; i < 10; i++)
+    TestObjectPool();
 }
@@ -24,6 +24,9 @@
 
 #include <thread>
 #include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
 #include "itf/options-itf.h"
 #include "util/kaldi-semaphore.h"
 
@@ -285,6 +288,56 @@ class TaskSequencer {
 
 };
 
+/// ObjectPool holds a fixed set of objects that tasks running in parallel can
+/// borrow, so that each task has exclusive use of one while it runs without
+/// any finer-grained locking.  The typical use is statistics accumulation with
+/// TaskSequencer: create a pool with one accumulator per thread (that is,
+/// max(1, --num-threads) of them, since TaskSequencer never runs more
+/// operator ()'s than that at once), have each task's operator () call
+/// Acquire() and Release() around its accumulation, and at the end sum the
+/// objects from Objects() into the final stats.
+template<class C>
+class ObjectPool {
+ public:
+  /// Takes ownership of the objects.
+  explicit ObjectPool(const std::vector<C*> &objects):
+      objects_(objects), free_(objects) {
+    KALDI_ASSERT(!objects.empty());
+  }
+
+  /// Returns an object that no other caller is using; waits if all of them
+  /// are in use.
+  C *Acquire() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (free_.empty())
+      condition_variable_.wait(lock);
+    C *ans = free_.back();
+    free_.pop_back();
+    return ans;
+  }
+
+  /// Gives back an object obtained from Acquire().
+  void Release(C *c) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    free_.push_back(c);
+    condition_variable_.notify_one();
+  }
+
+  /// Returns all the objects; only call this when no tasks are using them.
+  const std::vector<C*> &Objects() const { return objects_; }
+
+  ~ObjectPool() {
+    for (size_t i = 0; i < objects_.size(); i++)
+      delete objects_[i];
+  }
+ private:
+  std::vector<C*> objects_;
+  std::vector<C*> free_;
+  std::mutex mutex_;
+  std::condition_variable condition_variable_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(ObjectPool);
+};
+
 } // namespace kaldi
 
 #endif  // KALDI_THREAD_KALDI_THREAD_H_